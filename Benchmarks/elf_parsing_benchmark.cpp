@@ -0,0 +1,101 @@
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+
+// Benchmark comparing elf parsing with a single thread against parsing with one thread per hardware thread.
+// Usage: ElfParsingBenchmark <elf file> [iterations]
+
+// Parses the elf the given number of times and returns the average time per parse in milliseconds.
+bool time_parse(const std::filesystem::path& elf_path, size_t thread_count, size_t iteration_count, N64Recomp::Context& context_out, double& time_out) {
+    N64Recomp::ElfParsingConfig elf_config {
+        .bss_section_suffix = ".bss",
+        .has_entrypoint = false,
+        .entrypoint_address = 0,
+        .use_absolute_symbols = false,
+        .unpaired_lo16_warnings = false,
+        // Treat every section as relocatable so that all of the elf's relocations are read.
+        .all_sections_relocatable = true,
+        .use_mdebug = false,
+        .thread_count = thread_count,
+    };
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t iteration = 0; iteration < iteration_count; iteration++) {
+        N64Recomp::Context context{};
+        N64Recomp::DataSymbolMap data_syms{};
+        bool found_entrypoint;
+        if (!N64Recomp::Context::from_elf_file(elf_path, context, elf_config, false, data_syms, found_entrypoint)) {
+            return false;
+        }
+        context_out = std::move(context);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    time_out = std::chrono::duration<double, std::milli>(end - start).count() / (double)iteration_count;
+    return true;
+}
+
+// Checks that both parses produced the same relocations and the same patched rom.
+bool contexts_match(const N64Recomp::Context& a, const N64Recomp::Context& b) {
+    if (a.rom != b.rom || a.sections.size() != b.sections.size() || a.functions.size() != b.functions.size()) {
+        return false;
+    }
+    for (size_t section_index = 0; section_index < a.sections.size(); section_index++) {
+        const auto& relocs_a = a.sections[section_index].relocs;
+        const auto& relocs_b = b.sections[section_index].relocs;
+        if (relocs_a.size() != relocs_b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < relocs_a.size(); i++) {
+            if (relocs_a[i].address != relocs_b[i].address ||
+                relocs_a[i].target_section_offset != relocs_b[i].target_section_offset ||
+                relocs_a[i].symbol_index != relocs_b[i].symbol_index ||
+                relocs_a[i].target_section != relocs_b[i].target_section ||
+                relocs_a[i].type != relocs_b[i].type ||
+                relocs_a[i].reference_symbol != relocs_b[i].reference_symbol) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, const char** argv) {
+    if (argc < 2) {
+        fmt::print("Usage: {} <elf file> [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path elf_path = argv[1];
+    size_t iteration_count = argc >= 3 ? std::stoul(argv[2]) : 10;
+    if (iteration_count == 0) {
+        iteration_count = 1;
+    }
+
+    N64Recomp::Context serial_context{};
+    N64Recomp::Context parallel_context{};
+    double serial_time;
+    double parallel_time;
+
+    if (!time_parse(elf_path, 1, iteration_count, serial_context, serial_time) ||
+        !time_parse(elf_path, 0, iteration_count, parallel_context, parallel_time)) {
+        fmt::print(stderr, "Failed to parse elf: {}\n", elf_path.string());
+        return EXIT_FAILURE;
+    }
+
+    size_t reloc_count = 0;
+    for (const auto& section : serial_context.sections) {
+        reloc_count += section.relocs.size();
+    }
+
+    bool matches = contexts_match(serial_context, parallel_context);
+
+    fmt::print("{} sections, {} functions, {} relocs\n", serial_context.sections.size(), serial_context.functions.size(), reloc_count);
+    fmt::print("serial: {:9.3f} ms  parallel: {:9.3f} ms  speedup: {:5.2f}x{}\n",
+        serial_time, parallel_time, serial_time / parallel_time, matches ? "" : "  MISMATCH");
+
+    return matches ? EXIT_SUCCESS : EXIT_FAILURE;
+}
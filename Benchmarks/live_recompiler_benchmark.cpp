@@ -0,0 +1,864 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "recomp.h"
+#include "test_context.h"
+
+#ifndef LIVE_BENCHMARK_AOT
+#include "recompiler/live_recompiler.h"
+#endif
+
+// Benchmark suite for the live recompiler. Each kernel is a small synthetic MIPS program that exercises one class of instructions.
+// The kernels are recompiled with LiveGenerator and run repeatedly, and the codegen time, code size and execution time are recorded.
+//
+// When built with LIVE_BENCHMARK_AOT defined, the same kernels are instead run from C code that was produced by CGenerator
+// (through the --emit-aot mode of the JIT build) and compiled by the host C compiler, which allows comparing JIT and AOT performance
+// for each class of instructions.
+
+constexpr size_t rdram_size = 8 * 1024 * 1024;
+constexpr uint32_t text_vram = 0x80100000;
+constexpr uint32_t data_vram = 0x80200000;
+constexpr size_t data_size = 0x1000;
+
+// Minimal assembler that resolves branch, jump and address references to labels.
+class Assembler {
+public:
+    struct FunctionRange {
+        std::string name;
+        uint32_t vram;
+        uint32_t size;
+    };
+
+    void emit(uint32_t word) {
+        words.push_back(word);
+    }
+    void label(const std::string& name) {
+        labels[name] = cur_vram();
+    }
+    void branch(uint32_t instr, const std::string& target) {
+        add_fixup(FixupType::Branch, target);
+        emit(instr);
+    }
+    void jal(const std::string& target) {
+        add_fixup(FixupType::Jump, target);
+        emit(0x03u << 26);
+    }
+    void hi16(uint32_t instr, const std::string& target) {
+        add_fixup(FixupType::Hi16, target);
+        emit(instr);
+    }
+    void lo16(uint32_t instr, const std::string& target) {
+        add_fixup(FixupType::Lo16, target);
+        emit(instr);
+    }
+    void address_word(const std::string& target) {
+        add_fixup(FixupType::Word, target);
+        emit(0);
+    }
+    void begin_function(const std::string& name) {
+        label(name);
+        functions.emplace_back(FunctionRange{ .name = name, .vram = cur_vram(), .size = 0 });
+    }
+    void end_function() {
+        functions.back().size = cur_vram() - functions.back().vram;
+    }
+
+    // Resolves all the label references. The returned words are in host byte order.
+    std::vector<uint32_t> finish() {
+        for (const Fixup& fixup : fixups) {
+            uint32_t target = labels.at(fixup.target);
+            uint32_t instr_vram = text_vram + static_cast<uint32_t>(fixup.word_index * sizeof(uint32_t));
+            uint32_t& word = words[fixup.word_index];
+            switch (fixup.type) {
+                case FixupType::Branch:
+                    word |= uint16_t((int32_t(target) - int32_t(instr_vram + 4)) / 4);
+                    break;
+                case FixupType::Jump:
+                    word |= (target >> 2) & 0x03FFFFFF;
+                    break;
+                case FixupType::Hi16:
+                    word |= uint16_t((target + 0x8000) >> 16);
+                    break;
+                case FixupType::Lo16:
+                    word |= uint16_t(target & 0xFFFF);
+                    break;
+                case FixupType::Word:
+                    word = target;
+                    break;
+            }
+        }
+        return words;
+    }
+
+    const std::vector<FunctionRange>& get_functions() const { return functions; }
+private:
+    enum class FixupType {
+        Branch,
+        Jump,
+        Hi16,
+        Lo16,
+        Word
+    };
+    struct Fixup {
+        FixupType type;
+        size_t word_index;
+        std::string target;
+    };
+
+    uint32_t cur_vram() const {
+        return text_vram + static_cast<uint32_t>(words.size() * sizeof(uint32_t));
+    }
+    void add_fixup(FixupType type, const std::string& target) {
+        fixups.emplace_back(Fixup{ .type = type, .word_index = words.size(), .target = target });
+    }
+
+    std::vector<uint32_t> words;
+    std::unordered_map<std::string, uint32_t> labels;
+    std::vector<Fixup> fixups;
+    std::vector<FunctionRange> functions;
+};
+
+// Each kernel's entry point takes the iteration count in a0 and the data address in a1, and returns a result in v0.
+// The reference implementation performs the same work in C++ on a separate copy of rdram.
+struct Kernel {
+    std::string name;
+    uint32_t default_iterations;
+    std::function<void(Assembler&)> assemble;
+    std::function<gpr(uint8_t* rdram, uint32_t iterations)> reference;
+};
+
+static void assemble_int_alu(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_int_alu");
+    a.emit(addiu(v0, zero, 0));
+    a.emit(addiu(t0, zero, 1));
+    a.label("int_alu_loop");
+    a.emit(addu(v0, v0, t0));
+    a.emit(sll(t1, v0, 3));
+    a.emit(xor_(v0, v0, t1));
+    a.emit(srl(t1, v0, 5));
+    a.emit(subu(v0, v0, t1));
+    a.emit(or_(t2, v0, t0));
+    a.emit(and_(t2, t2, a0));
+    a.emit(addu(v0, v0, t2));
+    a.emit(slt(t3, v0, t0));
+    a.emit(addu(v0, v0, t3));
+    a.emit(addiu(t0, t0, 3));
+    a.emit(addiu(a0, a0, -1));
+    a.branch(bne(a0, zero), "int_alu_loop");
+    a.emit(nop());
+    a.emit(jr(ra));
+    a.emit(nop());
+    a.end_function();
+}
+
+static gpr reference_int_alu(uint8_t* rdram, uint32_t iterations) {
+    (void)rdram;
+    uint32_t v0 = 0;
+    uint32_t t0 = 1;
+    uint32_t a0 = iterations;
+    do {
+        v0 += t0;
+        v0 ^= v0 << 3;
+        v0 -= v0 >> 5;
+        v0 += (v0 | t0) & a0;
+        v0 += (int32_t)v0 < (int32_t)t0 ? 1 : 0;
+        t0 += 3;
+        a0--;
+    } while (a0 != 0);
+    return (gpr)(int32_t)v0;
+}
+
+static void assemble_load_store(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_load_store");
+    a.emit(addiu(v0, zero, 0));
+    a.label("load_store_outer");
+    a.emit(addu(t0, a1, zero));
+    a.emit(addiu(t1, zero, 256));
+    a.label("load_store_inner");
+    a.emit(lw(t2, 0, t0));
+    a.emit(lh(t3, 6, t0));
+    a.emit(addu(v0, v0, t2));
+    a.emit(addu(t2, t2, t3));
+    a.emit(sw(t2, 0, t0));
+    a.emit(sb(v0, 5, t0));
+    a.emit(addiu(t1, t1, -1));
+    a.branch(bne(t1, zero), "load_store_inner");
+    a.emit(addiu(t0, t0, 8));
+    a.emit(addiu(a0, a0, -1));
+    a.branch(bne(a0, zero), "load_store_outer");
+    a.emit(nop());
+    a.emit(jr(ra));
+    a.emit(nop());
+    a.end_function();
+}
+
+static gpr reference_load_store(uint8_t* rdram, uint32_t iterations) {
+    gpr v0 = 0;
+    for (uint32_t outer = 0; outer < iterations; outer++) {
+        gpr t0 = (gpr)(int32_t)data_vram;
+        for (uint32_t inner = 0; inner < 256; inner++) {
+            gpr t2 = MEM_W(0, t0);
+            gpr t3 = MEM_H(6, t0);
+            v0 = ADD32(v0, t2);
+            t2 = ADD32(t2, t3);
+            MEM_W(0, t0) = (int32_t)t2;
+            MEM_B(5, t0) = (int8_t)v0;
+            t0 = ADD32(t0, 8);
+        }
+    }
+    return v0;
+}
+
+static void assemble_fpu(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_fpu");
+    // f2 = 3.0f, f12 = 2.0f, f4 = 1.0f, f6 = 1.0, f16 = 2.0
+    a.emit(addiu(t0, zero, 3));
+    a.emit(mtc1(t0, 2));
+    a.emit(cvt_s(fmt_w, 2, 2));
+    a.emit(addiu(t0, zero, 2));
+    a.emit(mtc1(t0, 12));
+    a.emit(cvt_s(fmt_w, 12, 12));
+    a.emit(mtc1(t0, 16));
+    a.emit(cvt_d(fmt_w, 16, 16));
+    a.emit(addiu(t0, zero, 1));
+    a.emit(mtc1(t0, 4));
+    a.emit(cvt_s(fmt_w, 4, 4));
+    a.emit(mtc1(t0, 6));
+    a.emit(cvt_d(fmt_w, 6, 6));
+    a.label("fpu_loop");
+    a.emit(add_fmt(fmt_s, 4, 4, 2));
+    a.emit(div_fmt(fmt_s, 4, 4, 12));
+    a.emit(cvt_d(fmt_s, 8, 4));
+    a.emit(add_fmt(fmt_d, 6, 6, 8));
+    a.emit(div_fmt(fmt_d, 6, 6, 16));
+    a.emit(addiu(a0, a0, -1));
+    a.branch(bne(a0, zero), "fpu_loop");
+    a.emit(nop());
+    a.emit(swc1(4, 0, a1));
+    a.emit(sdc1(6, 8, a1));
+    a.emit(addiu(v0, zero, 0));
+    a.emit(jr(ra));
+    a.emit(nop());
+    a.end_function();
+}
+
+static gpr reference_fpu(uint8_t* rdram, uint32_t iterations) {
+    float s = 1.0f;
+    double d = 1.0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        s = (s + 3.0f) / 2.0f;
+        d = (d + (double)s) / 2.0;
+    }
+    uint32_t s_bits;
+    uint64_t d_bits;
+    memcpy(&s_bits, &s, sizeof(s_bits));
+    memcpy(&d_bits, &d, sizeof(d_bits));
+    gpr base = (gpr)(int32_t)data_vram;
+    MEM_W(0, base) = (int32_t)s_bits;
+    MEM_W(8, base) = (int32_t)(d_bits >> 32);
+    MEM_W(12, base) = (int32_t)(d_bits >> 0);
+    return 0;
+}
+
+static void assemble_branches(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_branches");
+    a.emit(addiu(v0, zero, 0));
+    a.emit(addiu(t0, zero, 12345));
+    a.label("branches_loop");
+    // xorshift32 to get unpredictable branch conditions.
+    a.emit(sll(t1, t0, 13));
+    a.emit(xor_(t0, t0, t1));
+    a.emit(srl(t1, t0, 17));
+    a.emit(xor_(t0, t0, t1));
+    a.emit(sll(t1, t0, 5));
+    a.emit(xor_(t0, t0, t1));
+    a.emit(andi(t2, t0, 1));
+    a.branch(beq(t2, zero), "branches_skip");
+    a.emit(nop());
+    a.emit(addiu(v0, v0, 3));
+    a.label("branches_skip");
+    a.branch(bltz(t0), "branches_negative");
+    a.emit(nop());
+    a.emit(addiu(v0, v0, 1));
+    a.branch(beq(zero, zero), "branches_join");
+    a.emit(nop());
+    a.label("branches_negative");
+    a.emit(addiu(v0, v0, -1));
+    a.label("branches_join");
+    a.emit(addiu(a0, a0, -1));
+    a.branch(bgtz(a0), "branches_loop");
+    a.emit(nop());
+    a.emit(jr(ra));
+    a.emit(nop());
+    a.end_function();
+}
+
+static gpr reference_branches(uint8_t* rdram, uint32_t iterations) {
+    (void)rdram;
+    uint32_t v0 = 0;
+    uint32_t t0 = 12345;
+    for (uint32_t i = 0; i < iterations; i++) {
+        t0 ^= t0 << 13;
+        t0 ^= t0 >> 17;
+        t0 ^= t0 << 5;
+        if ((t0 & 1) != 0) {
+            v0 += 3;
+        }
+        if ((int32_t)t0 < 0) {
+            v0 -= 1;
+        }
+        else {
+            v0 += 1;
+        }
+    }
+    return (gpr)(int32_t)v0;
+}
+
+static void assemble_jump_table(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_jump_table");
+    a.emit(addiu(v0, zero, 0));
+    a.emit(addiu(t0, zero, 0));
+    a.label("jump_table_loop");
+    a.emit(andi(t1, t0, 3));
+    a.emit(sll(t1, t1, 2));
+    a.hi16(lui(at, 0), "jump_table_jtbl");
+    a.emit(addu(at, at, t1));
+    a.lo16(lw(t1, 0, at), "jump_table_jtbl");
+    a.emit(jr(t1));
+    a.emit(nop());
+    a.label("jump_table_case0");
+    a.emit(addiu(v0, v0, 1));
+    a.branch(beq(zero, zero), "jump_table_next");
+    a.emit(nop());
+    a.label("jump_table_case1");
+    a.emit(xor_(v0, v0, t0));
+    a.branch(beq(zero, zero), "jump_table_next");
+    a.emit(nop());
+    a.label("jump_table_case2");
+    a.emit(sll(v0, v0, 1));
+    a.branch(beq(zero, zero), "jump_table_next");
+    a.emit(nop());
+    a.label("jump_table_case3");
+    a.emit(addu(v0, v0, t0));
+    a.label("jump_table_next");
+    a.emit(addiu(t0, t0, 1));
+    a.branch(bne(t0, a0), "jump_table_loop");
+    a.emit(nop());
+    a.emit(jr(ra));
+    a.emit(nop());
+    a.end_function();
+    // The jump table is placed after the function, followed by a word outside the function to mark its end.
+    a.label("jump_table_jtbl");
+    a.address_word("jump_table_case0");
+    a.address_word("jump_table_case1");
+    a.address_word("jump_table_case2");
+    a.address_word("jump_table_case3");
+    a.emit(0);
+}
+
+static gpr reference_jump_table(uint8_t* rdram, uint32_t iterations) {
+    (void)rdram;
+    uint32_t v0 = 0;
+    for (uint32_t t0 = 0; t0 != iterations; t0++) {
+        switch (t0 & 3) {
+            case 0: v0 += 1; break;
+            case 1: v0 ^= t0; break;
+            case 2: v0 <<= 1; break;
+            case 3: v0 += t0; break;
+        }
+    }
+    return (gpr)(int32_t)v0;
+}
+
+static void assemble_calls(Assembler& a) {
+    using namespace mips;
+    a.begin_function("kernel_calls");
+    a.emit(addiu(sp, sp, -24));
+    a.emit(sw(ra, 20, sp));
+    a.emit(sw(s0, 16, sp));
+    a.emit(addu(s0, a0, zero));
+    a.emit(addiu(v0, zero, 0));
+    a.emit(addiu(a1, zero, 0));
+    a.label("calls_loop");
+    a.jal("kernel_calls_leaf");
+    a.emit(addu(a0, s0, zero));
+    a.emit(addu(a1, v0, zero));
+    a.emit(addiu(s0, s0, -1));
+    a.branch(bne(s0, zero), "calls_loop");
+    a.emit(nop());
+    a.emit(lw(ra, 20, sp));
+    a.emit(lw(s0, 16, sp));
+    a.emit(jr(ra));
+    a.emit(addiu(sp, sp, 24));
+    a.end_function();
+
+    a.begin_function("kernel_calls_leaf");
+    a.emit(sll(v0, a1, 1));
+    a.emit(addu(v0, v0, a1));
+    a.emit(jr(ra));
+    a.emit(addu(v0, v0, a0));
+    a.end_function();
+}
+
+static gpr reference_calls(uint8_t* rdram, uint32_t iterations) {
+    (void)rdram;
+    uint32_t v0 = 0;
+    uint32_t a1 = 0;
+    for (uint32_t s0 = iterations; s0 != 0; s0--) {
+        v0 = a1 * 3 + s0;
+        a1 = v0;
+    }
+    return (gpr)(int32_t)v0;
+}
+
+static const std::vector<Kernel>& get_kernels() {
+    static const std::vector<Kernel> kernels = {
+        { "int_alu", 1000000, assemble_int_alu, reference_int_alu },
+        { "load_store", 2000, assemble_load_store, reference_load_store },
+        { "fpu", 1000000, assemble_fpu, reference_fpu },
+        { "branches", 1000000, assemble_branches, reference_branches },
+        { "jump_table", 1000000, assemble_jump_table, reference_jump_table },
+        { "calls", 1000000, assemble_calls, reference_calls },
+    };
+    return kernels;
+}
+
+// The assembled kernel along with a recompiler context that contains its functions.
+struct KernelImage {
+    std::vector<uint32_t> words;
+    N64Recomp::Context context;
+};
+
+static void build_kernel_image(const Kernel& kernel, KernelImage& image) {
+    Assembler assembler{};
+    kernel.assemble(assembler);
+    image.words = assembler.finish();
+
+    N64Recomp::Context& context = image.context;
+
+    // The rom holds the kernel's words in big endian, as it would for a real binary.
+    context.rom.resize(image.words.size() * sizeof(uint32_t));
+    write_test_instructions(context.rom, 0, image.words);
+    uint16_t section_index = add_test_section(context, ".text", 0, text_vram, static_cast<uint32_t>(context.rom.size()));
+
+    for (const Assembler::FunctionRange& func : assembler.get_functions()) {
+        add_test_function(context, func.name, section_index, func.vram, func.size);
+    }
+}
+
+static void reset_rdram(uint8_t* rdram, const KernelImage& image) {
+    memcpy(&rdram[text_vram - 0x80000000], image.words.data(), image.words.size() * sizeof(uint32_t));
+    uint32_t* data = reinterpret_cast<uint32_t*>(&rdram[data_vram - 0x80000000]);
+    for (size_t i = 0; i < data_size / sizeof(uint32_t); i++) {
+        data[i] = static_cast<uint32_t>(i * 2654435761u);
+    }
+}
+
+// Combines a kernel's result with the contents of its data so that memory side effects are also checked.
+static uint64_t get_checksum(uint8_t* rdram, gpr result) {
+    uint64_t hash = 0xCBF29CE484222325ULL ^ result;
+    const uint8_t* data = &rdram[data_vram - 0x80000000];
+    for (size_t i = 0; i < data_size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static void run_kernel_once(recomp_func_t* func, uint8_t* rdram, uint32_t iterations, recomp_context& ctx) {
+    ctx = {};
+    ctx.r4 = iterations;
+    ctx.r5 = (gpr)(int32_t)data_vram;
+    ctx.r29 = (gpr)(int32_t)(0x80000000 + rdram_size - 0x10);
+    func(rdram, &ctx);
+}
+
+void switch_error(const char* func, uint32_t vram, uint32_t jtbl) {
+    fmt::print(stderr, "Switch-case out of bounds in {} at 0x{:08X} for jump table at 0x{:08X}\n", func, vram, jtbl);
+}
+
+struct SampleStats {
+    double min;
+    double mean;
+    double p50;
+    double p90;
+    double p99;
+    double max;
+};
+
+static SampleStats get_sample_stats(std::vector<double> samples) {
+    SampleStats ret{};
+    if (samples.empty()) {
+        return ret;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    };
+
+    double total = 0.0;
+    for (double sample : samples) {
+        total += sample;
+    }
+
+    ret.min = samples.front();
+    ret.mean = total / samples.size();
+    ret.p50 = percentile(50.0);
+    ret.p90 = percentile(90.0);
+    ret.p99 = percentile(99.0);
+    ret.max = samples.back();
+    return ret;
+}
+
+static std::string stats_to_json(const SampleStats& stats) {
+    return fmt::format("{{ \"min\": {:.3f}, \"mean\": {:.3f}, \"p50\": {:.3f}, \"p90\": {:.3f}, \"p99\": {:.3f}, \"max\": {:.3f} }}",
+        stats.min, stats.mean, stats.p50, stats.p90, stats.p99, stats.max);
+}
+
+struct KernelResult {
+    std::string name;
+    uint32_t iterations;
+    bool correct;
+    uint64_t checksum;
+    // Only available for JIT runs.
+    bool has_codegen;
+    uint64_t code_size;
+    SampleStats codegen_us;
+    SampleStats execution_us;
+};
+
+struct BenchmarkOptions {
+    size_t runs = 20;
+    size_t warmup = 3;
+    uint32_t iterations = 0;
+    std::string output_path;
+    std::string kernel_filter;
+    std::string emit_aot_path;
+};
+
+using clock_type = std::chrono::high_resolution_clock;
+
+static double elapsed_us(clock_type::time_point start, clock_type::time_point end) {
+    return std::chrono::duration<double, std::micro>(end - start).count();
+}
+
+// Times the given function over the warmup and measured runs and checks its output against the reference.
+static bool measure_execution(recomp_func_t* func, const Kernel& kernel, const KernelImage& image, const BenchmarkOptions& options,
+    uint32_t iterations, std::vector<uint8_t>& rdram, KernelResult& result)
+{
+    std::vector<uint8_t> reference_rdram(rdram_size);
+    reset_rdram(reference_rdram.data(), image);
+    gpr reference_result = kernel.reference(reference_rdram.data(), iterations);
+    uint64_t reference_checksum = get_checksum(reference_rdram.data(), reference_result);
+
+    recomp_context ctx{};
+    std::vector<double> samples{};
+    samples.reserve(options.runs);
+    result.correct = true;
+    for (size_t run = 0; run < options.warmup + options.runs; run++) {
+        reset_rdram(rdram.data(), image);
+        auto start = clock_type::now();
+        run_kernel_once(func, rdram.data(), iterations, ctx);
+        auto end = clock_type::now();
+
+        uint64_t checksum = get_checksum(rdram.data(), ctx.r2);
+        if (checksum != reference_checksum) {
+            result.correct = false;
+        }
+        result.checksum = checksum;
+
+        if (run >= options.warmup) {
+            samples.push_back(elapsed_us(start, end));
+        }
+    }
+    result.execution_us = get_sample_stats(std::move(samples));
+
+    return result.correct;
+}
+
+#ifdef LIVE_BENCHMARK_AOT
+
+extern "C" {
+    extern recomp_func_t* const live_benchmark_aot_functions[];
+    extern const char* const live_benchmark_aot_names[];
+    extern const size_t live_benchmark_aot_count;
+}
+
+static bool run_kernel(const Kernel& kernel, const BenchmarkOptions& options, std::vector<uint8_t>& rdram, KernelResult& result) {
+    KernelImage image{};
+    build_kernel_image(kernel, image);
+
+    // Find the kernel's entry point in the generated code.
+    recomp_func_t* func = nullptr;
+    for (size_t i = 0; i < live_benchmark_aot_count; i++) {
+        if (kernel.name == live_benchmark_aot_names[i]) {
+            func = live_benchmark_aot_functions[i];
+            break;
+        }
+    }
+    if (func == nullptr) {
+        fmt::print(stderr, "Kernel {} is missing from the generated code\n", kernel.name);
+        return false;
+    }
+
+    result.has_codegen = false;
+    return measure_execution(func, kernel, image, options, result.iterations, rdram, result);
+}
+
+static const char* mode_name = "aot";
+
+#else
+
+static recomp_func_t* benchmark_get_function(int32_t vram) {
+    fmt::print(stderr, "Unexpected function lookup for 0x{:08X}\n", (uint32_t)vram);
+    return nullptr;
+}
+
+static bool run_kernel(const Kernel& kernel, const BenchmarkOptions& options, std::vector<uint8_t>& rdram, KernelResult& result) {
+    KernelImage image{};
+    build_kernel_image(kernel, image);
+    const N64Recomp::Context& context = image.context;
+
+    int32_t section_addresses[] = { (int32_t)text_vram };
+    N64Recomp::LiveGeneratorInputs generator_inputs {
+        .switch_error = switch_error,
+        .get_function = benchmark_get_function,
+        .reference_section_addresses = nullptr,
+        .local_section_addresses = section_addresses
+    };
+
+    // Recompile the kernel repeatedly to measure codegen time, keeping the last output to run.
+    std::unique_ptr<N64Recomp::LiveGeneratorOutput> output{};
+    std::vector<double> codegen_samples{};
+    codegen_samples.reserve(options.runs);
+    for (size_t run = 0; run < options.warmup + options.runs; run++) {
+        auto start = clock_type::now();
+        N64Recomp::LiveGenerator generator{ context.functions.size(), generator_inputs };
+        std::vector<std::vector<uint32_t>> static_funcs{};
+        static_funcs.resize(context.sections.size());
+        for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+            std::ostringstream dummy_ostream{};
+            if (!N64Recomp::recompile_function_live(generator, context, func_index, dummy_ostream, static_funcs, false)) {
+                fmt::print(stderr, "Failed to recompile kernel {}\n", kernel.name);
+                return false;
+            }
+        }
+        output = std::make_unique<N64Recomp::LiveGeneratorOutput>(generator.finish());
+        auto end = clock_type::now();
+
+        if (!output->good) {
+            fmt::print(stderr, "Failed to generate code for kernel {}\n", kernel.name);
+            return false;
+        }
+
+        if (run >= options.warmup) {
+            codegen_samples.push_back(elapsed_us(start, end));
+        }
+    }
+
+    result.has_codegen = true;
+    result.code_size = output->code_size;
+    result.codegen_us = get_sample_stats(std::move(codegen_samples));
+
+    return measure_execution(output->functions[0], kernel, image, options, result.iterations, rdram, result);
+}
+
+// Writes every kernel's functions as C code produced by CGenerator, which gets built into the AOT variant of this benchmark.
+static bool emit_aot_kernels(const std::string& output_path) {
+    std::ofstream output_file{ output_path };
+    if (!output_file.good()) {
+        fmt::print(stderr, "Failed to open {} for writing\n", output_path);
+        return false;
+    }
+
+    std::ostringstream declarations{};
+    std::ostringstream bodies{};
+    std::vector<std::string> entry_names{};
+
+    for (const Kernel& kernel : get_kernels()) {
+        KernelImage image{};
+        build_kernel_image(kernel, image);
+        const N64Recomp::Context& context = image.context;
+
+        std::vector<std::vector<uint32_t>> static_funcs{};
+        static_funcs.resize(context.sections.size());
+        for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+            declarations << fmt::format("RECOMP_FUNC void {}(uint8_t* rdram, recomp_context* ctx);\n", context.functions[func_index].name);
+            if (!N64Recomp::recompile_function(context, func_index, bodies, static_funcs, false)) {
+                fmt::print(stderr, "Failed to recompile kernel {} to C\n", kernel.name);
+                return false;
+            }
+            bodies << "\n";
+        }
+        entry_names.emplace_back(context.functions[0].name);
+    }
+
+    output_file << "#include <stddef.h>\n";
+    output_file << "#include \"recomp.h\"\n\n";
+    output_file << declarations.str() << "\n";
+    output_file << bodies.str();
+
+    output_file << "recomp_func_t* const live_benchmark_aot_functions[] = {\n";
+    for (const std::string& entry_name : entry_names) {
+        output_file << fmt::format("    {},\n", entry_name);
+    }
+    output_file << "};\n\n";
+
+    output_file << "const char* const live_benchmark_aot_names[] = {\n";
+    for (const Kernel& kernel : get_kernels()) {
+        output_file << fmt::format("    \"{}\",\n", kernel.name);
+    }
+    output_file << "};\n\n";
+
+    output_file << fmt::format("const size_t live_benchmark_aot_count = {};\n", entry_names.size());
+
+    return output_file.good();
+}
+
+static const char* mode_name = "jit";
+
+#endif
+
+static bool parse_options(int argc, const char** argv, BenchmarkOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto next_value = [&]() -> const char* {
+            if (i + 1 >= argc) {
+                fmt::print(stderr, "Missing value for {}\n", arg);
+                return nullptr;
+            }
+            return argv[++i];
+        };
+
+        const char* value = nullptr;
+        if (arg == "--runs" && (value = next_value()) != nullptr) {
+            options.runs = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+        }
+        else if (arg == "--warmup" && (value = next_value()) != nullptr) {
+            options.warmup = std::strtoull(value, nullptr, 10);
+        }
+        else if (arg == "--iterations" && (value = next_value()) != nullptr) {
+            options.iterations = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        }
+        else if (arg == "--output" && (value = next_value()) != nullptr) {
+            options.output_path = value;
+        }
+        else if (arg == "--kernel" && (value = next_value()) != nullptr) {
+            options.kernel_filter = value;
+        }
+#ifndef LIVE_BENCHMARK_AOT
+        else if (arg == "--emit-aot" && (value = next_value()) != nullptr) {
+            options.emit_aot_path = value;
+        }
+#endif
+        else {
+            if (arg != "--help") {
+                fmt::print(stderr, "Unknown or incomplete option: {}\n", arg);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+static void print_usage(const char* program_name) {
+    fmt::print("Usage: {} [options]\n"
+        "  --runs <count>        Number of measured runs per kernel (default 20)\n"
+        "  --warmup <count>      Number of unmeasured warmup runs per kernel (default 3)\n"
+        "  --iterations <count>  Override the loop iteration count of every kernel\n"
+        "  --kernel <name>       Only run the kernel with the given name\n"
+        "  --output <path>       Write the results as JSON to the given path\n"
+#ifndef LIVE_BENCHMARK_AOT
+        "  --emit-aot <path>     Write the kernels as C code for the AOT benchmark and exit\n"
+#endif
+        , program_name);
+}
+
+int main(int argc, const char** argv) {
+    BenchmarkOptions options{};
+    if (!parse_options(argc, argv, options)) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+#ifndef LIVE_BENCHMARK_AOT
+    N64Recomp::live_recompiler_init();
+
+    if (!options.emit_aot_path.empty()) {
+        return emit_aot_kernels(options.emit_aot_path) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+#endif
+
+    std::vector<uint8_t> rdram(rdram_size);
+    std::vector<KernelResult> results{};
+    bool all_good = true;
+
+    for (const Kernel& kernel : get_kernels()) {
+        if (!options.kernel_filter.empty() && kernel.name != options.kernel_filter) {
+            continue;
+        }
+
+        KernelResult result{};
+        result.name = kernel.name;
+        result.iterations = options.iterations != 0 ? options.iterations : kernel.default_iterations;
+        if (!run_kernel(kernel, options, rdram, result)) {
+            fmt::print(stderr, "Kernel {} failed{}\n", kernel.name, result.correct ? "" : " (result mismatch)");
+            all_good = false;
+        }
+
+        if (result.has_codegen) {
+            fmt::print("{:<12} {} codegen p50: {:9.1f} us  code: {:6} bytes  exec p50: {:10.1f} us  p90: {:10.1f} us  p99: {:10.1f} us{}\n",
+                result.name, mode_name, result.codegen_us.p50, result.code_size,
+                result.execution_us.p50, result.execution_us.p90, result.execution_us.p99, result.correct ? "" : "  MISMATCH");
+        }
+        else {
+            fmt::print("{:<12} {} exec p50: {:10.1f} us  p90: {:10.1f} us  p99: {:10.1f} us{}\n",
+                result.name, mode_name,
+                result.execution_us.p50, result.execution_us.p90, result.execution_us.p99, result.correct ? "" : "  MISMATCH");
+        }
+
+        results.emplace_back(std::move(result));
+    }
+
+    if (!options.output_path.empty()) {
+        std::ofstream output_file{ options.output_path };
+        if (!output_file.good()) {
+            fmt::print(stderr, "Failed to open {} for writing\n", options.output_path);
+            return EXIT_FAILURE;
+        }
+
+        output_file << fmt::format("{{\n  \"mode\": \"{}\",\n  \"runs\": {},\n  \"warmup\": {},\n  \"kernels\": [\n",
+            mode_name, options.runs, options.warmup);
+        for (size_t i = 0; i < results.size(); i++) {
+            const KernelResult& result = results[i];
+            output_file << fmt::format("    {{\n      \"name\": \"{}\",\n      \"iterations\": {},\n      \"correct\": {},\n      \"checksum\": \"{:016X}\",\n",
+                result.name, result.iterations, result.correct, result.checksum);
+            if (result.has_codegen) {
+                output_file << fmt::format("      \"code_size\": {},\n      \"codegen_us\": {},\n", result.code_size, stats_to_json(result.codegen_us));
+            }
+            output_file << fmt::format("      \"execution_us\": {}\n    }}{}\n", stats_to_json(result.execution_us), i + 1 < results.size() ? "," : "");
+        }
+        output_file << "  ]\n}\n";
+    }
+
+    return all_good ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,152 @@
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recomp.h"
+
+// Microbenchmark comparing the 64-bit memory access helpers in recomp.h against the split 32-bit implementations they replaced.
+// The LD and SD rows compare the split and single-access helpers on aligned addresses, with the LD and SD macros on the side
+// they currently use.
+
+constexpr size_t rdram_size = 8 * 1024 * 1024;
+constexpr size_t address_count = 1 << 16;
+constexpr size_t iteration_count = 256;
+
+// The split versions of the unaligned helpers, which are what recomp.h compiles them to when RECOMP_SPLIT_64BIT_ACCESS is defined.
+// These use the header's split doubleword helpers so that they only differ from the header's helpers in the access itself.
+static inline gpr split_do_ldl(uint8_t* rdram, gpr initial_value, gpr offset, gpr reg) {
+    gpr address = (offset + reg);
+    gpr dword_address = address & ~0x7;
+    uint64_t loaded_value = load_doubleword_split(rdram, 0, dword_address);
+    gpr misalignment = address & 0x7;
+    gpr masked_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu << (misalignment * 8));
+    loaded_value <<= (misalignment * 8);
+    return masked_value | loaded_value;
+}
+
+static inline gpr split_do_ldr(uint8_t* rdram, gpr initial_value, gpr offset, gpr reg) {
+    gpr address = (offset + reg);
+    gpr dword_address = address & ~0x7;
+    uint64_t loaded_value = load_doubleword_split(rdram, 0, dword_address);
+    gpr misalignment = address & 0x7;
+    gpr masked_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu >> (56 - misalignment * 8));
+    loaded_value >>= (56 - misalignment * 8);
+    return masked_value | loaded_value;
+}
+
+static inline void split_do_sdl(uint8_t* rdram, gpr offset, gpr reg, gpr val) {
+    gpr address = (offset + reg);
+    gpr dword_address = address & ~0x7;
+    uint64_t initial_value = load_doubleword_split(rdram, 0, dword_address);
+    gpr misalignment = address & 0x7;
+    uint64_t masked_initial_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu >> (misalignment * 8));
+    uint64_t shifted_input_value = val >> (misalignment * 8);
+    store_doubleword_split(rdram, 0, dword_address, masked_initial_value | shifted_input_value);
+}
+
+static inline void split_do_sdr(uint8_t* rdram, gpr offset, gpr reg, gpr val) {
+    gpr address = (offset + reg);
+    gpr dword_address = address & ~0x7;
+    uint64_t initial_value = load_doubleword_split(rdram, 0, dword_address);
+    gpr misalignment = address & 0x7;
+    uint64_t masked_initial_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu << (56 - misalignment * 8));
+    uint64_t shifted_input_value = val << (56 - misalignment * 8);
+    store_doubleword_split(rdram, 0, dword_address, masked_initial_value | shifted_input_value);
+}
+
+struct BenchmarkState {
+    std::vector<uint8_t> rdram_split;
+    std::vector<uint8_t> rdram_native;
+    std::vector<gpr> aligned_addresses;
+    std::vector<gpr> unaligned_addresses;
+};
+
+// Runs the given operation over every address for each iteration and returns the average time per operation in nanoseconds.
+template <typename Func>
+double time_operation(Func&& func, const std::vector<gpr>& addresses) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t iteration = 0; iteration < iteration_count; iteration++) {
+        for (gpr address : addresses) {
+            func(address);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (double)(iteration_count * addresses.size());
+}
+
+template <typename SplitFunc, typename NativeFunc>
+bool run_benchmark(const char* name, BenchmarkState& state, const std::vector<gpr>& addresses, SplitFunc&& split_func, NativeFunc&& native_func) {
+    uint64_t split_result = 0;
+    uint64_t native_result = 0;
+    uint8_t* rdram_split = state.rdram_split.data();
+    uint8_t* rdram_native = state.rdram_native.data();
+
+    double split_time = time_operation([&](gpr address) { split_result = split_func(rdram_split, address, split_result); }, addresses);
+    double native_time = time_operation([&](gpr address) { native_result = native_func(rdram_native, address, native_result); }, addresses);
+
+    // Verify that both implementations produced identical results and left memory in the same state.
+    bool matches = split_result == native_result && state.rdram_split == state.rdram_native;
+
+    fmt::print("{:<8} split: {:7.3f} ns  native: {:7.3f} ns  speedup: {:5.2f}x{}\n",
+        name, split_time, native_time, split_time / native_time, matches ? "" : "  MISMATCH");
+
+    return matches;
+}
+
+int main() {
+    BenchmarkState state{};
+    state.rdram_split.resize(rdram_size);
+    state.rdram_native.resize(rdram_size);
+
+    std::mt19937_64 rng{ 0x4E363452 };
+    for (size_t i = 0; i < rdram_size; i++) {
+        state.rdram_split[i] = (uint8_t)rng();
+    }
+    state.rdram_native = state.rdram_split;
+
+    // Generate the guest addresses to access. Rdram starts at 0x80000000, which maps to the start of the buffer.
+    std::uniform_int_distribution<uint32_t> offset_dist{ 0, rdram_size - 16 };
+    state.aligned_addresses.resize(address_count);
+    state.unaligned_addresses.resize(address_count);
+    for (size_t i = 0; i < address_count; i++) {
+        uint32_t offset = offset_dist(rng);
+        state.aligned_addresses[i] = (gpr)(int32_t)(0x80000000u + (offset & ~7u));
+        state.unaligned_addresses[i] = (gpr)(int32_t)(0x80000000u + offset);
+    }
+
+    bool all_matched = true;
+
+    all_matched &= run_benchmark("LD", state, state.aligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return acc ^ load_doubleword_split(rdram, 0, address); },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return acc ^ (uint64_t)LD(0, address); });
+
+    all_matched &= run_benchmark("SD", state, state.aligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { SD(acc + address, 0, address); return acc + 1; },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { store_doubleword(rdram, 0, address, acc + address); return acc + 1; });
+
+    all_matched &= run_benchmark("LDL", state, state.unaligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return split_do_ldl(rdram, acc, 0, address); },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return do_ldl(rdram, acc, 0, address); });
+
+    all_matched &= run_benchmark("LDR", state, state.unaligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return split_do_ldr(rdram, acc, 0, address); },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { return do_ldr(rdram, acc, 0, address); });
+
+    all_matched &= run_benchmark("SDL", state, state.unaligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { split_do_sdl(rdram, 0, address, acc); return acc * 3 + 1; },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { do_sdl(rdram, 0, address, acc); return acc * 3 + 1; });
+
+    all_matched &= run_benchmark("SDR", state, state.unaligned_addresses,
+        [](uint8_t* rdram, gpr address, uint64_t acc) { split_do_sdr(rdram, 0, address, acc); return acc * 3 + 1; },
+        [](uint8_t* rdram, gpr address, uint64_t acc) { do_sdr(rdram, 0, address, acc); return acc * 3 + 1; });
+
+    if (!all_matched) {
+        fmt::print(stderr, "Native and split implementations produced different results\n");
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
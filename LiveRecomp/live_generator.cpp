@@ -1,7 +1,16 @@
 #include <cassert>
+#include <cstring>
+#include <cstdlib>
 #include <fstream>
 #include <unordered_map>
 #include <cmath>
+#include <array>
+#include <algorithm>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <tuple>
 
 #include "fmt/format.h"
 #include "fmt/ostream.h"
@@ -33,11 +42,33 @@ namespace Registers {
     constexpr int arithmetic_temp2 = SLJIT_R1;
     constexpr int arithmetic_temp3 = SLJIT_R2;
     constexpr int arithmetic_temp4 = SLJIT_R3;
-}
+    // Number of scratch and saved registers used above, not including any registers allocated to MIPS GPRs.
+    constexpr int base_scratch_count = 4;
+    constexpr int base_saved_count = 5;
+}
+
+#if (defined SLJIT_64BIT_ARCHITECTURE && SLJIT_64BIT_ARCHITECTURE)
+constexpr bool inline_long_conversions = true;
+#else
+// Conversions to 64-bit integers need a 64-bit host, so they're performed by host functions on 32-bit hosts instead.
+constexpr bool inline_long_conversions = false;
+#endif
+
+// Rounding modes for float to integer conversions performed inline.
+enum class InlineRounding {
+    Round,
+    Ceil,
+    Floor
+};
+
+// Minimum number of references to a MIPS GPR within a function for it to be allocated a host register.
+constexpr size_t min_gpr_allocation_uses = 3;
 
 struct InnerCall {
     size_t target_func_index;
     sljit_jump* jump;
+    // Whether the call targets the function's internal entry instead of its public one.
+    bool internal_entry;
 };
 
 struct ReferenceSymbolCall {
@@ -51,11 +82,83 @@ struct SwitchErrorJump {
     sljit_jump* jump;
 };
 
+// Host functions that can be called by recompiled code. These are called through rewritable jumps and recorded as fixups
+// so that cached code can be pointed at the current process's copy of each function when it's loaded.
+enum class HostFunction : uint32_t {
+    Cop0StatusWrite,
+    Cop0StatusRead,
+    SwitchError,
+    DoBreak,
+    GetFunction,
+    SyscallHandler,
+    PauseSelf,
+    TriggerEvent,
+    RunHook,
+    GetCop1Cs,
+    SetCop1Cs,
+    SqrtFloat,
+    SqrtDouble,
+    CvtWS,
+    CvtWD,
+    CvtLS,
+    CvtLD,
+    RoundWS,
+    RoundWD,
+    RoundLS,
+    RoundLD,
+    CeilWS,
+    CeilWD,
+    CeilLS,
+    CeilLD,
+    FloorWS,
+    FloorWD,
+    FloorLS,
+    FloorLD,
+    Count
+};
+
+sljit_uw get_host_function(HostFunction func, const N64Recomp::LiveGeneratorInputs& inputs);
+
+// A host address in the recompiled code that will be recorded as a fixup in the output after code generation.
+struct PendingFixup {
+    N64Recomp::LiveCodeFixupType type;
+    uint32_t index;
+    // Only one of these is set, depending on whether the host address is a call target or a constant.
+    sljit_jump* jump;
+    sljit_const* constant;
+};
+
+// Values left behind by the previous instruction that the next instruction can use instead of reloading or recomputing them.
+// Each field is a MIPS GPR, or 0 if the corresponding value isn't available. The GPRs are always written back normally,
+// so fusing an instruction with the previous one never changes the values of any registers.
+struct FusedResult {
+    // Index of the instruction that left these values, which are only valid for the instruction immediately after it.
+    size_t instruction_index;
+    // GPR whose value is in arithmetic_temp1.
+    int temp_value_gpr;
+    // GPR where arithmetic_temp4 holds rdram plus the GPR's value, which stores and loads can use as a base address.
+    int host_address_gpr;
+    // GPR holding a known constant value.
+    int constant_gpr;
+    int64_t constant_value;
+    // GPR holding the result of an integer comparison, along with the comparison's condition and operands.
+    // The operands never include the result GPR, so a branch on the result can perform the comparison directly.
+    int compare_gpr;
+    sljit_s32 compare_condition;
+    sljit_sw compare_src1;
+    sljit_sw compare_src1w;
+    sljit_sw compare_src2;
+    sljit_sw compare_src2w;
+};
+
 struct N64Recomp::LiveGeneratorContext {
     std::string function_name;
     std::unordered_map<std::string, sljit_label*> labels;
     std::unordered_map<std::string, std::vector<sljit_jump*>> pending_jumps;
     std::vector<sljit_label*> func_labels;
+    // Internal entry of each function, which is called by other functions in the same output. It expects the caller to have
+    // rdram (already offset by rdram_offset) and ctx in the rdram and ctx registers, and keeps them instead of saving them.
+    std::vector<sljit_label*> internal_func_labels;
     std::vector<InnerCall> inner_calls;
     std::vector<std::vector<std::string>> switch_jump_labels;
     // See LiveGeneratorOutput::jump_tables for info. Contains sljit labels so they can be linked after recompilation.
@@ -66,17 +169,88 @@ struct N64Recomp::LiveGeneratorContext {
     std::vector<std::pair<ReferenceJumpDetails, sljit_jump*>> reference_symbol_jumps;
     // See LiveGeneratorOutput::import_jumps_by_index for info.
     std::unordered_multimap<size_t, sljit_jump*> import_jumps_by_index;
+    // See LiveGeneratorOutput::function_jumps_by_index for info.
+    std::unordered_multimap<size_t, sljit_jump*> function_jumps_by_index;
+    // Functions recompiled by this generator when it's one shard of a set of generators, or empty if it recompiles all functions.
+    std::vector<bool> shard_functions;
+    // Rewritable jumps at the start of each function and the label of the function's body, used for hot reloading.
+    std::vector<std::tuple<size_t, sljit_jump*, sljit_label*>> function_entry_jumps;
     std::vector<SwitchErrorJump> switch_error_jumps;
+    // Calls to the shared hook stub, which is generated at the end of the code.
+    std::vector<sljit_jump*> hook_stub_calls;
+    // See LiveGeneratorOutput::string_literals for info.
+    std::vector<std::unique_ptr<char[]>> string_literals;
     sljit_jump* cur_branch_jump;
+    // Host register holding each MIPS GPR in the current function, or 0 if the GPR is accessed through the context.
+    std::array<int, 32> gpr_registers;
+    // MIPS GPRs with an allocated host register in the current function.
+    std::vector<int> allocated_gprs;
+    // Number of scratch and saved registers allocated to MIPS GPRs in the current function.
+    int allocated_scratch_count;
+    int allocated_saved_count;
+    // Host addresses used by the recompiled code. See LiveGeneratorOutput::fixups for info.
+    std::vector<PendingFixup> pending_fixups;
+    // See LiveGeneratorOutput::lookup_caches for info.
+    std::vector<std::unique_ptr<N64Recomp::LiveLookupCache>> lookup_caches;
+    // Number of instructions started in the current function, counted by emit_comment as it's called at the start of every instruction.
+    size_t instruction_count;
+    // See FusedResult for info.
+    FusedResult fused_result;
+    // Promoted stack slots of the current function, which are held in the function's sljit locals in this order.
+    std::vector<N64Recomp::StackSlot> stack_slots;
 };
 
+// Current generation of function lookups, which is compared against the generation in each lookup cache by recompiled code.
+// Starts at 1 so that newly created lookup caches are always invalid.
+static std::atomic<uint32_t> live_lookup_generation{ 1 };
+static_assert(sizeof(live_lookup_generation) == sizeof(uint32_t), "Recompiled code reads the lookup generation as a uint32_t");
+
+void N64Recomp::invalidate_live_function_lookups() {
+    live_lookup_generation++;
+}
+
+// Emits a call to the given host function and records it as a fixup.
+void emit_host_call(sljit_compiler* compiler, N64Recomp::LiveGeneratorContext& gen_context, const N64Recomp::LiveGeneratorInputs& inputs,
+    sljit_s32 arg_types, HostFunction func)
+{
+    sljit_jump* call_jump = sljit_emit_call(compiler, SLJIT_CALL | SLJIT_REWRITABLE_JUMP, arg_types);
+    sljit_set_target(call_jump, get_host_function(func, inputs));
+    gen_context.pending_fixups.emplace_back(PendingFixup{
+        .type = N64Recomp::LiveCodeFixupType::HostFunctionCall,
+        .index = static_cast<uint32_t>(func),
+        .jump = call_jump,
+        .constant = nullptr
+    });
+}
+
+// Loads a host address into the given register and records it as a fixup.
+void emit_host_address(sljit_compiler* compiler, N64Recomp::LiveGeneratorContext& gen_context, int reg,
+    N64Recomp::LiveCodeFixupType type, uint32_t index, const void* address)
+{
+    sljit_const* constant = sljit_emit_const(compiler, reg, 0, sljit_sw(address));
+    gen_context.pending_fixups.emplace_back(PendingFixup{
+        .type = type,
+        .index = index,
+        .jump = nullptr,
+        .constant = constant
+    });
+}
+
 N64Recomp::LiveGenerator::LiveGenerator(size_t num_funcs, const LiveGeneratorInputs& inputs) : inputs(inputs) {
     compiler = sljit_create_compiler(nullptr);
     context = std::make_unique<LiveGeneratorContext>();
     context->func_labels.resize(num_funcs);
+    context->internal_func_labels.resize(num_funcs);
+    context->gpr_registers.fill(0);
+    context->allocated_scratch_count = 0;
+    context->allocated_saved_count = 0;
     errored = false;
 }
 
+N64Recomp::LiveGenerator::LiveGenerator(size_t num_funcs, const LiveGeneratorInputs& inputs, std::vector<bool> shard_functions) : LiveGenerator(num_funcs, inputs) {
+    context->shard_functions = std::move(shard_functions);
+}
+
 N64Recomp::LiveGenerator::~LiveGenerator() {
     if (compiler != nullptr) {
         sljit_free_compiler(compiler);
@@ -95,7 +269,9 @@ N64Recomp::LiveGeneratorOutput N64Recomp::LiveGenerator::finish() {
 
     // Populate all the pending inner function calls.
     for (const InnerCall& call : context->inner_calls) {
-        sljit_label* target_func_label = context->func_labels[call.target_func_index];
+        sljit_label* target_func_label = call.internal_entry ?
+            context->internal_func_labels[call.target_func_index] :
+            context->func_labels[call.target_func_index];
 
         // Generation isn't valid if the target function wasn't recompiled.
         if (target_func_label == nullptr) {
@@ -105,46 +281,24 @@ N64Recomp::LiveGeneratorOutput N64Recomp::LiveGenerator::finish() {
         sljit_set_label(call.jump, target_func_label);
     }
 
-    // Generate the switch error jump targets and assign the jump labels.
-    if (!context->switch_error_jumps.empty()) {
-        // Allocate the function name and place it in the literals.
-        char* func_name = new char[context->function_name.size() + 1];
-        memcpy(func_name, context->function_name.c_str(), context->function_name.size());
-        func_name[context->function_name.size()] = '\x00';
-        ret.string_literals.emplace_back(func_name);
-
-        std::vector<sljit_jump*> switch_error_return_jumps{};
-        switch_error_return_jumps.resize(context->switch_error_jumps.size());
-
-        // Generate and assign the labels for the switch error jumps.
-        for (size_t i = 0; i < context->switch_error_jumps.size(); i++) {
-            const auto& cur_error_jump = context->switch_error_jumps[i];
+    // Generate the shared hook stub at the end of the code if any functions call it. Hooked functions call it with the hook index
+    // as the only argument, and the stub keeps the caller's rdram and ctx registers so it can pass them along to run_hook.
+    if (!context->hook_stub_calls.empty()) {
+        sljit_label* hook_stub_label = sljit_emit_label(compiler);
+        sljit_emit_enter(compiler, SLJIT_ENTER_REG_ARG | SLJIT_ENTER_KEEP(2), SLJIT_ARGS1V(W_R), 3, 2, 0);
 
-            // Generate a label and assign it to the jump.
-            sljit_set_label(cur_error_jump.jump, sljit_emit_label(compiler));
-
-            // Load the arguments (function name, vram, jump table address)
-            sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, sljit_sw(func_name));
-            sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R1, 0, SLJIT_IMM, sljit_sw(cur_error_jump.instr_vram));
-            sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R2, 0, SLJIT_IMM, sljit_sw(cur_error_jump.jtbl_vram));
-            
-            // Call switch_error.
-            sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3V(P, 32, 32), SLJIT_IMM, sljit_sw(inputs.switch_error));
-
-            // Jump to the return statement.
-            switch_error_return_jumps[i] = sljit_emit_jump(compiler, SLJIT_JUMP);
-        }
-
-        // Generate the return statement.
-        sljit_label* return_label = sljit_emit_label(compiler);
+        // Move the hook index into R2, then load rdram and ctx into R0 and R1.
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_R0, 0);
+        sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS3V(P, P, W), HostFunction::RunHook);
         sljit_emit_return_void(compiler);
 
-        // Assign the label for all the return jumps.
-        for (sljit_jump* cur_jump : switch_error_return_jumps) {
-            sljit_set_label(cur_jump, return_label);
+        for (sljit_jump* call_jump : context->hook_stub_calls) {
+            sljit_set_label(call_jump, hook_stub_label);
         }
     }
-    context->switch_error_jumps.clear();
+    context->hook_stub_calls.clear();
 
     // Generate the code.
     ret.code = sljit_generate_code(compiler, 0, NULL);
@@ -180,6 +334,22 @@ N64Recomp::LiveGeneratorOutput N64Recomp::LiveGenerator::finish() {
     }
     context->import_jumps_by_index.clear();
 
+    // Get the jump instruction addresses for calls to functions in other shards.
+    ret.function_jumps_by_index.reserve(context->function_jumps_by_index.size());
+    for (auto& [func_index, jump] : context->function_jumps_by_index) {
+        ret.function_jumps_by_index.emplace(func_index, reinterpret_cast<void*>(jump->addr));
+    }
+    context->function_jumps_by_index.clear();
+
+    // Get the entry jump and body addresses for hot reloadable functions.
+    if (!context->function_entry_jumps.empty()) {
+        ret.function_entry_jumps.resize(ret.functions.size());
+        for (auto& [func_index, jump, body_label] : context->function_entry_jumps) {
+            ret.function_entry_jumps[func_index] = { reinterpret_cast<void*>(jump->addr), reinterpret_cast<void*>(sljit_get_label_addr(body_label)) };
+        }
+    }
+    context->function_entry_jumps.clear();
+
     // Populate label addresses for the jump tables and place them in the output.
     for (auto& [labels, jump_table] : context->unlinked_jump_tables) {
         for (size_t entry_index = 0; entry_index < labels.size(); entry_index++) {
@@ -187,21 +357,49 @@ N64Recomp::LiveGeneratorOutput N64Recomp::LiveGenerator::finish() {
             jump_table[entry_index] = reinterpret_cast<void*>(sljit_get_label_addr(cur_label));
         }
         ret.jump_tables.emplace_back(std::move(jump_table));
+        ret.jump_table_sizes.emplace_back(labels.size());
     }
     context->unlinked_jump_tables.clear();
 
+    ret.string_literals = std::move(context->string_literals);
+    context->string_literals.clear();
+
+    ret.lookup_caches = std::move(context->lookup_caches);
+    context->lookup_caches.clear();
+
+    // Get the addresses of the host function calls and host addresses in the code.
+    ret.fixups.reserve(context->pending_fixups.size());
+    for (const PendingFixup& fixup : context->pending_fixups) {
+        void* address = fixup.jump != nullptr ?
+            reinterpret_cast<void*>(fixup.jump->addr) :
+            reinterpret_cast<void*>(sljit_get_const_addr(fixup.constant));
+        ret.fixups.emplace_back(LiveCodeFixup{ .type = fixup.type, .index = fixup.index, .address = address });
+    }
+    context->pending_fixups.clear();
+
     ret.executable_offset = sljit_get_executable_offset(compiler);
 
     sljit_free_compiler(compiler);
     compiler = nullptr;
     errored = false;
 
+    // Move the code into the arena if one was provided. sljit needs the final code size before it can allocate the memory to generate into,
+    // so the code is generated in sljit's own allocation and then copied into the arena, which only has to rebase the recorded addresses.
+    if (inputs.code_arena != nullptr && !ret.move_to_arena(inputs.code_arena, inputs)) {
+        return { };
+    }
+
     return ret;
 }
 
 N64Recomp::LiveGeneratorOutput::~LiveGeneratorOutput() {
     if (code != nullptr) {
-        sljit_free_code(code, nullptr);
+        if (code_arena != nullptr) {
+            code_arena->free(code, code_size);
+        }
+        else {
+            sljit_free_code(code, nullptr);
+        }
         code = nullptr;
     }
 }
@@ -226,6 +424,516 @@ void N64Recomp::LiveGeneratorOutput::populate_import_symbol_jumps(size_t import_
     }
 }
 
+void N64Recomp::LiveGeneratorOutput::populate_function_jumps(size_t function_index, recomp_func_t* func) {
+    auto find_range = function_jumps_by_index.equal_range(function_index);
+    for (auto it = find_range.first; it != find_range.second; ++it) {
+        sljit_set_jump_addr(reinterpret_cast<sljit_uw>(it->second), reinterpret_cast<sljit_uw>(func), executable_offset);
+    }
+}
+
+bool N64Recomp::LiveGeneratorOutput::redirect_function(size_t function_index, recomp_func_t* func) {
+    if (function_index >= function_entry_jumps.size() || function_entry_jumps[function_index].first == nullptr) {
+        return false;
+    }
+
+    sljit_set_jump_addr(reinterpret_cast<sljit_uw>(function_entry_jumps[function_index].first), reinterpret_cast<sljit_uw>(func), executable_offset);
+    return true;
+}
+
+// Identifies serialized outputs. The version must be changed whenever the serialized layout or the generated code changes.
+constexpr uint32_t live_cache_magic = 0x434C3436; // "64LC"
+constexpr uint32_t live_cache_version = 6;
+constexpr uint64_t live_cache_null_offset = UINT64_MAX;
+
+// FNV-1a hash.
+static void hash_bytes(uint64_t& hash, const void* data, size_t size) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+}
+
+template <typename T>
+static void hash_value(uint64_t& hash, const T& value) {
+    hash_bytes(hash, &value, sizeof(T));
+}
+
+static void hash_hooks(uint64_t& hash, const std::unordered_map<size_t, size_t>& hooks) {
+    // Sort the hooks so that the hash doesn't depend on the map's iteration order.
+    std::vector<std::pair<size_t, size_t>> sorted_hooks{ hooks.begin(), hooks.end() };
+    std::sort(sorted_hooks.begin(), sorted_hooks.end());
+    hash_value(hash, sorted_hooks.size());
+    for (const auto& [func_index, hook_index] : sorted_hooks) {
+        hash_value(hash, func_index);
+        hash_value(hash, hook_index);
+    }
+}
+
+template <typename T>
+static void write_value(std::vector<uint8_t>& data, const T& value) {
+    size_t offset = data.size();
+    data.resize(offset + sizeof(T));
+    memcpy(data.data() + offset, &value, sizeof(T));
+}
+
+struct CacheReader {
+    std::span<const uint8_t> data;
+    size_t offset = 0;
+    bool good = true;
+
+    const uint8_t* read_bytes(size_t count) {
+        if (!good || data.size() - offset < count) {
+            good = false;
+            return nullptr;
+        }
+        const uint8_t* ret = data.data() + offset;
+        offset += count;
+        return ret;
+    }
+
+    template <typename T>
+    T read() {
+        T ret{};
+        const uint8_t* bytes = read_bytes(sizeof(T));
+        if (bytes != nullptr) {
+            memcpy(&ret, bytes, sizeof(T));
+        }
+        return ret;
+    }
+
+    // Reads an element count and checks that the remaining data is large enough to hold that many elements of the given size.
+    size_t read_count(size_t element_size) {
+        uint64_t count = read<uint64_t>();
+        if (!good || count > (data.size() - offset) / element_size) {
+            good = false;
+            return 0;
+        }
+        return static_cast<size_t>(count);
+    }
+};
+
+uint64_t N64Recomp::get_live_cache_key(std::span<const uint8_t> binary, std::span<const uint8_t> symbols, const LiveGeneratorInputs& inputs) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    hash_value(hash, live_cache_version);
+
+    // Generated code is only valid on the platform it was generated for.
+    const char* platform_name = sljit_get_platform_name();
+    hash_bytes(hash, platform_name, strlen(platform_name));
+
+    hash_value(hash, binary.size());
+    hash_bytes(hash, binary.data(), binary.size());
+    hash_value(hash, symbols.size());
+    hash_bytes(hash, symbols.data(), symbols.size());
+
+    // Hash the inputs that affect code generation. Host function and section address pointers aren't included,
+    // as those are repopulated when the output is loaded.
+    hash_value(hash, inputs.base_event_index);
+    hash_value(hash, inputs.hot_reloadable);
+    hash_hooks(hash, inputs.entry_func_hooks);
+    hash_hooks(hash, inputs.return_func_hooks);
+    hash_value(hash, inputs.original_section_indices.size());
+    for (size_t section_index : inputs.original_section_indices) {
+        hash_value(hash, section_index);
+    }
+
+    return hash;
+}
+
+bool N64Recomp::serialize_live_output(const LiveGeneratorOutput& output, uint64_t cache_key, std::vector<uint8_t>& data_out) {
+    if (!output.good || output.code == nullptr) {
+        return false;
+    }
+
+    // All addresses in the output are stored as offsets from the start of the code.
+    const uint8_t* code = reinterpret_cast<const uint8_t*>(output.code);
+    auto code_offset = [code](const void* address) {
+        return static_cast<uint64_t>(reinterpret_cast<const uint8_t*>(address) - code);
+    };
+
+    data_out.clear();
+    write_value(data_out, live_cache_magic);
+    write_value(data_out, live_cache_version);
+    write_value(data_out, cache_key);
+
+    // Code
+    write_value<uint64_t>(data_out, output.code_size);
+    data_out.insert(data_out.end(), code, code + output.code_size);
+
+    // Functions
+    write_value<uint64_t>(data_out, output.functions.size());
+    for (recomp_func_t* func : output.functions) {
+        write_value<uint64_t>(data_out, func == nullptr ? live_cache_null_offset : code_offset(reinterpret_cast<const void*>(func)));
+    }
+
+    // Jump tables
+    write_value<uint64_t>(data_out, output.jump_tables.size());
+    for (size_t jump_table_index = 0; jump_table_index < output.jump_tables.size(); jump_table_index++) {
+        size_t jump_table_size = output.jump_table_sizes[jump_table_index];
+        write_value<uint64_t>(data_out, jump_table_size);
+        for (size_t entry_index = 0; entry_index < jump_table_size; entry_index++) {
+            write_value<uint64_t>(data_out, code_offset(output.jump_tables[jump_table_index][entry_index]));
+        }
+    }
+
+    // String literals
+    write_value<uint64_t>(data_out, output.string_literals.size());
+    for (const auto& literal : output.string_literals) {
+        size_t length = strlen(literal.get());
+        write_value<uint64_t>(data_out, length);
+        data_out.insert(data_out.end(), literal.get(), literal.get() + length);
+    }
+
+    // Lookup caches, which start out empty when loaded so only the count is needed.
+    write_value<uint64_t>(data_out, output.lookup_caches.size());
+
+    // Reference symbol jumps
+    write_value<uint64_t>(data_out, output.reference_symbol_jumps.size());
+    for (const auto& [details, jump_address] : output.reference_symbol_jumps) {
+        write_value(data_out, details.section);
+        write_value(data_out, details.section_offset);
+        write_value<uint64_t>(data_out, code_offset(jump_address));
+    }
+
+    // Import jumps
+    write_value<uint64_t>(data_out, output.import_jumps_by_index.size());
+    for (const auto& [import_index, jump_address] : output.import_jumps_by_index) {
+        write_value<uint64_t>(data_out, import_index);
+        write_value<uint64_t>(data_out, code_offset(jump_address));
+    }
+
+    // Function jumps
+    write_value<uint64_t>(data_out, output.function_jumps_by_index.size());
+    for (const auto& [func_index, jump_address] : output.function_jumps_by_index) {
+        write_value<uint64_t>(data_out, func_index);
+        write_value<uint64_t>(data_out, code_offset(jump_address));
+    }
+
+    // Function entry jumps
+    write_value<uint64_t>(data_out, output.function_entry_jumps.size());
+    for (const auto& [jump_address, body_address] : output.function_entry_jumps) {
+        write_value<uint64_t>(data_out, jump_address == nullptr ? live_cache_null_offset : code_offset(jump_address));
+        write_value<uint64_t>(data_out, body_address == nullptr ? live_cache_null_offset : code_offset(body_address));
+    }
+
+    // Fixups
+    write_value<uint64_t>(data_out, output.fixups.size());
+    for (const LiveCodeFixup& fixup : output.fixups) {
+        write_value(data_out, fixup.type);
+        write_value(data_out, fixup.index);
+        write_value<uint64_t>(data_out, code_offset(fixup.address));
+    }
+
+    return true;
+}
+
+// Copies code into executable memory allocated by sljit or a code arena and returns the executable address of the copy.
+static uint8_t* copy_live_code(void* writable_code, const void* code_bytes, size_t code_size, int64_t executable_offset) {
+    SLJIT_UPDATE_WX_FLAGS(writable_code, reinterpret_cast<uint8_t*>(writable_code) + code_size, 0);
+    memcpy(writable_code, code_bytes, code_size);
+    SLJIT_UPDATE_WX_FLAGS(writable_code, reinterpret_cast<uint8_t*>(writable_code) + code_size, 1);
+    uint8_t* code = reinterpret_cast<uint8_t*>(writable_code) + executable_offset;
+    SLJIT_CACHE_FLUSH(code, code + code_size);
+    return code;
+}
+
+bool N64Recomp::LiveGeneratorOutput::apply_fixup(const LiveCodeFixup& fixup, const LiveGeneratorInputs& inputs) {
+    sljit_uw address = reinterpret_cast<sljit_uw>(fixup.address);
+    switch (fixup.type) {
+        case LiveCodeFixupType::HostFunctionCall:
+            if (fixup.index >= static_cast<uint32_t>(HostFunction::Count)) {
+                return false;
+            }
+            sljit_set_jump_addr(address, get_host_function(static_cast<HostFunction>(fixup.index), inputs), executable_offset);
+            break;
+        case LiveCodeFixupType::LocalSectionAddress:
+            sljit_set_const(address, sljit_sw(inputs.local_section_addresses + fixup.index), executable_offset);
+            break;
+        case LiveCodeFixupType::ReferenceSectionAddress:
+            sljit_set_const(address, sljit_sw(inputs.reference_section_addresses + fixup.index), executable_offset);
+            break;
+        case LiveCodeFixupType::JumpTable:
+            if (fixup.index >= jump_tables.size()) {
+                return false;
+            }
+            sljit_set_const(address, sljit_sw(jump_tables[fixup.index].get()), executable_offset);
+            break;
+        case LiveCodeFixupType::StringLiteral:
+            if (fixup.index >= string_literals.size()) {
+                return false;
+            }
+            sljit_set_const(address, sljit_sw(string_literals[fixup.index].get()), executable_offset);
+            break;
+        case LiveCodeFixupType::LookupCache:
+            if (fixup.index >= lookup_caches.size()) {
+                return false;
+            }
+            sljit_set_const(address, sljit_sw(lookup_caches[fixup.index].get()), executable_offset);
+            break;
+        case LiveCodeFixupType::LookupGeneration:
+            sljit_set_const(address, sljit_sw(&live_lookup_generation), executable_offset);
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+bool N64Recomp::LiveGeneratorOutput::move_to_arena(LiveCodeArena* arena, const LiveGeneratorInputs& inputs) {
+    int64_t arena_executable_offset;
+    void* writable_code = arena->allocate(code_size, arena_executable_offset);
+    if (writable_code == nullptr) {
+        return false;
+    }
+
+    uint8_t* old_code = reinterpret_cast<uint8_t*>(code);
+    uint8_t* new_code = copy_live_code(writable_code, old_code, code_size, arena_executable_offset);
+    auto rebase = [old_code, new_code](void* address) -> void* {
+        return address == nullptr ? nullptr : new_code + (reinterpret_cast<uint8_t*>(address) - old_code);
+    };
+
+    // The output now owns the arena copy, so the original can be freed.
+    sljit_free_code(code, nullptr);
+    code = new_code;
+    code_arena = arena;
+    executable_offset = arena_executable_offset;
+
+    for (recomp_func_t*& func : functions) {
+        func = reinterpret_cast<recomp_func_t*>(rebase(reinterpret_cast<void*>(func)));
+    }
+
+    // The jump tables keep their storage, as the code references them by address, so only their entries are rebased.
+    for (size_t jump_table_index = 0; jump_table_index < jump_tables.size(); jump_table_index++) {
+        for (size_t entry_index = 0; entry_index < jump_table_sizes[jump_table_index]; entry_index++) {
+            jump_tables[jump_table_index][entry_index] = rebase(jump_tables[jump_table_index][entry_index]);
+        }
+    }
+
+    for (auto& [details, jump_address] : reference_symbol_jumps) {
+        jump_address = rebase(jump_address);
+    }
+    for (auto& [import_index, jump_address] : import_jumps_by_index) {
+        jump_address = rebase(jump_address);
+    }
+    for (auto& [func_index, jump_address] : function_jumps_by_index) {
+        jump_address = rebase(jump_address);
+    }
+
+    // Entry jumps hold the absolute address of the function body, so they need to be pointed at the body's new address.
+    for (auto& [jump_address, body_address] : function_entry_jumps) {
+        if (jump_address != nullptr) {
+            jump_address = rebase(jump_address);
+            body_address = rebase(body_address);
+            sljit_set_jump_addr(reinterpret_cast<sljit_uw>(jump_address), reinterpret_cast<sljit_uw>(body_address), executable_offset);
+        }
+    }
+
+    // Reapply the fixups at their new addresses so that none of them depend on how the target architecture encodes them.
+    for (LiveCodeFixup& fixup : fixups) {
+        fixup.address = rebase(fixup.address);
+        if (!apply_fixup(fixup, inputs)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool N64Recomp::deserialize_live_output(std::span<const uint8_t> data, uint64_t cache_key, const LiveGeneratorInputs& inputs, LiveGeneratorOutput& output_out) {
+    CacheReader reader{ .data = data };
+
+    uint32_t magic = reader.read<uint32_t>();
+    uint32_t version = reader.read<uint32_t>();
+    uint64_t read_cache_key = reader.read<uint64_t>();
+    if (!reader.good || magic != live_cache_magic || version != live_cache_version || read_cache_key != cache_key) {
+        return false;
+    }
+
+    uint64_t code_size = reader.read<uint64_t>();
+    const uint8_t* code_bytes = reader.read_bytes(code_size);
+    if (!reader.good || code_size == 0) {
+        return false;
+    }
+
+    // Reads a code offset and checks that it's within the code.
+    auto read_code_offset = [&reader, code_size]() {
+        uint64_t offset = reader.read<uint64_t>();
+        if (offset >= code_size) {
+            reader.good = false;
+        }
+        return offset;
+    };
+
+    // Read the rest of the data before allocating any executable memory.
+    std::vector<uint64_t> function_offsets{};
+    function_offsets.resize(reader.read_count(sizeof(uint64_t)));
+    for (uint64_t& offset : function_offsets) {
+        offset = reader.read<uint64_t>();
+        if (offset != live_cache_null_offset && offset >= code_size) {
+            reader.good = false;
+        }
+    }
+
+    std::vector<std::vector<uint64_t>> jump_table_offsets{};
+    jump_table_offsets.resize(reader.read_count(sizeof(uint64_t)));
+    for (std::vector<uint64_t>& cur_offsets : jump_table_offsets) {
+        cur_offsets.resize(reader.read_count(sizeof(uint64_t)));
+        for (uint64_t& offset : cur_offsets) {
+            offset = read_code_offset();
+        }
+    }
+
+    LiveGeneratorOutput ret{};
+
+    ret.string_literals.resize(reader.read_count(sizeof(uint64_t)));
+    for (auto& literal : ret.string_literals) {
+        uint64_t length = reader.read<uint64_t>();
+        const uint8_t* literal_bytes = reader.read_bytes(length);
+        if (!reader.good) {
+            return false;
+        }
+        literal = std::make_unique<char[]>(length + 1);
+        memcpy(literal.get(), literal_bytes, length);
+        literal[length] = '\x00';
+    }
+
+    // Every lookup cache is referenced by code, so there can't be more of them than bytes of code.
+    uint64_t lookup_cache_count = reader.read<uint64_t>();
+    if (!reader.good || lookup_cache_count > code_size) {
+        return false;
+    }
+    ret.lookup_caches.resize(lookup_cache_count);
+    for (auto& lookup_cache : ret.lookup_caches) {
+        lookup_cache = std::make_unique<LiveLookupCache>();
+    }
+
+    std::vector<std::pair<ReferenceJumpDetails, uint64_t>> reference_jump_offsets{};
+    reference_jump_offsets.resize(reader.read_count(sizeof(uint16_t) + sizeof(uint32_t) + sizeof(uint64_t)));
+    for (auto& [details, offset] : reference_jump_offsets) {
+        details.section = reader.read<uint16_t>();
+        details.section_offset = reader.read<uint32_t>();
+        offset = read_code_offset();
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> import_jump_offsets{};
+    import_jump_offsets.resize(reader.read_count(sizeof(uint64_t) + sizeof(uint64_t)));
+    for (auto& [import_index, offset] : import_jump_offsets) {
+        import_index = reader.read<uint64_t>();
+        offset = read_code_offset();
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> function_jump_offsets{};
+    function_jump_offsets.resize(reader.read_count(sizeof(uint64_t) + sizeof(uint64_t)));
+    for (auto& [func_index, offset] : function_jump_offsets) {
+        func_index = reader.read<uint64_t>();
+        offset = read_code_offset();
+    }
+
+    std::vector<std::pair<uint64_t, uint64_t>> entry_jump_offsets{};
+    entry_jump_offsets.resize(reader.read_count(sizeof(uint64_t) + sizeof(uint64_t)));
+    for (auto& [jump_offset, body_offset] : entry_jump_offsets) {
+        jump_offset = reader.read<uint64_t>();
+        body_offset = reader.read<uint64_t>();
+        if ((jump_offset == live_cache_null_offset) != (body_offset == live_cache_null_offset) ||
+            (jump_offset != live_cache_null_offset && (jump_offset >= code_size || body_offset >= code_size)))
+        {
+            reader.good = false;
+        }
+    }
+
+    std::vector<std::pair<LiveCodeFixup, uint64_t>> fixup_offsets{};
+    fixup_offsets.resize(reader.read_count(sizeof(LiveCodeFixupType) + sizeof(uint32_t) + sizeof(uint64_t)));
+    for (auto& [fixup, offset] : fixup_offsets) {
+        fixup.type = reader.read<LiveCodeFixupType>();
+        fixup.index = reader.read<uint32_t>();
+        offset = read_code_offset();
+    }
+
+    // Reject data with anything after the end of the output, as it can't have been created by serialize_live_output.
+    if (!reader.good || reader.offset != data.size()) {
+        return false;
+    }
+
+    // Allocate executable memory and copy the code into it.
+    void* writable_code;
+    if (inputs.code_arena != nullptr) {
+        writable_code = inputs.code_arena->allocate(code_size, ret.executable_offset);
+    }
+    else {
+        writable_code = SLJIT_MALLOC_EXEC(code_size, nullptr);
+        if (writable_code != nullptr) {
+            ret.executable_offset = SLJIT_EXEC_OFFSET(writable_code);
+        }
+    }
+    if (writable_code == nullptr) {
+        return false;
+    }
+    uint8_t* code = copy_live_code(writable_code, code_bytes, code_size, ret.executable_offset);
+
+    // The output now owns the code, so it'll be freed if loading fails past this point.
+    ret.code = code;
+    ret.code_size = code_size;
+    ret.code_arena = inputs.code_arena;
+
+    // Convert the offsets back into addresses.
+    ret.functions.resize(function_offsets.size());
+    for (size_t func_index = 0; func_index < function_offsets.size(); func_index++) {
+        if (function_offsets[func_index] != live_cache_null_offset) {
+            ret.functions[func_index] = reinterpret_cast<recomp_func_t*>(code + function_offsets[func_index]);
+        }
+    }
+
+    ret.jump_tables.reserve(jump_table_offsets.size());
+    for (const std::vector<uint64_t>& cur_offsets : jump_table_offsets) {
+        std::unique_ptr<void*[]> jump_table = std::make_unique<void*[]>(cur_offsets.size());
+        for (size_t entry_index = 0; entry_index < cur_offsets.size(); entry_index++) {
+            jump_table[entry_index] = code + cur_offsets[entry_index];
+        }
+        ret.jump_tables.emplace_back(std::move(jump_table));
+        ret.jump_table_sizes.emplace_back(cur_offsets.size());
+    }
+
+    ret.reference_symbol_jumps.reserve(reference_jump_offsets.size());
+    for (const auto& [details, offset] : reference_jump_offsets) {
+        ret.reference_symbol_jumps.emplace_back(details, code + offset);
+    }
+
+    ret.import_jumps_by_index.reserve(import_jump_offsets.size());
+    for (const auto& [import_index, offset] : import_jump_offsets) {
+        ret.import_jumps_by_index.emplace(import_index, code + offset);
+    }
+
+    ret.function_jumps_by_index.reserve(function_jump_offsets.size());
+    for (const auto& [func_index, offset] : function_jump_offsets) {
+        ret.function_jumps_by_index.emplace(func_index, code + offset);
+    }
+
+    // Entry jumps hold the absolute address of the function body, so they need to be pointed at the body's new address.
+    ret.function_entry_jumps.resize(entry_jump_offsets.size());
+    for (size_t func_index = 0; func_index < entry_jump_offsets.size(); func_index++) {
+        const auto& [jump_offset, body_offset] = entry_jump_offsets[func_index];
+        if (jump_offset != live_cache_null_offset) {
+            ret.function_entry_jumps[func_index] = { code + jump_offset, code + body_offset };
+            sljit_set_jump_addr(reinterpret_cast<sljit_uw>(code + jump_offset), reinterpret_cast<sljit_uw>(code + body_offset), ret.executable_offset);
+        }
+    }
+
+    // Apply the fixups to point the code at this process's host functions, section addresses, jump tables and string literals.
+    ret.fixups.reserve(fixup_offsets.size());
+    for (auto [fixup, offset] : fixup_offsets) {
+        fixup.address = code + offset;
+        if (!ret.apply_fixup(fixup, inputs)) {
+            return false;
+        }
+        ret.fixups.emplace_back(fixup);
+    }
+
+    ret.good = true;
+    output_out = std::move(ret);
+    return true;
+}
+
 constexpr int get_gpr_context_offset(int gpr_index) {
     return offsetof(recomp_context, r0) + sizeof(recomp_context::r0) * gpr_index;
 }
@@ -266,18 +974,22 @@ constexpr int get_fpr_u64_context_offset(int fpr_index) {
     return offsetof(recomp_context, f0.u64) + sizeof(recomp_context::f0) * fpr_index;
 }
 
-void get_gpr_values(int gpr, sljit_sw& out, sljit_sw& outw) {
+void get_gpr_values(const N64Recomp::LiveGeneratorContext& gen_context, int gpr, sljit_sw& out, sljit_sw& outw) {
     if (gpr == 0) {
         out = SLJIT_IMM;
         outw = 0;
     }
+    else if (gen_context.gpr_registers[gpr] != 0) {
+        out = gen_context.gpr_registers[gpr];
+        outw = 0;
+    }
     else {
         out = SLJIT_MEM1(Registers::ctx);
         outw = get_gpr_context_offset(gpr);
     }
 }
 
-bool get_operand_values(N64Recomp::Operand operand, const N64Recomp::InstructionContext& context, sljit_sw& out, sljit_sw& outw,
+bool get_operand_values(const N64Recomp::LiveGeneratorContext& gen_context, N64Recomp::Operand operand, const N64Recomp::InstructionContext& context, sljit_sw& out, sljit_sw& outw,
     sljit_compiler* compiler, int odd_float_address_register
 )
 {
@@ -285,13 +997,13 @@ bool get_operand_values(N64Recomp::Operand operand, const N64Recomp::Instruction
 
     switch (operand) {
         case Operand::Rd:
-            get_gpr_values(context.rd, out, outw);
+            get_gpr_values(gen_context, context.rd, out, outw);
             break;
         case Operand::Rs:
-            get_gpr_values(context.rs, out, outw);
+            get_gpr_values(gen_context, context.rs, out, outw);
             break;
         case Operand::Rt:
-            get_gpr_values(context.rt, out, outw);
+            get_gpr_values(gen_context, context.rt, out, outw);
             break;
         case Operand::Fd:
             out = SLJIT_MEM1(Registers::ctx);
@@ -396,7 +1108,67 @@ bool outputs_to_zero(N64Recomp::Operand output, const N64Recomp::InstructionCont
     return false;
 }
 
+// Returns the GPR that an operand refers to, or 0 if the operand isn't a GPR.
+int get_operand_gpr(N64Recomp::Operand operand, const N64Recomp::InstructionContext& ctx) {
+    switch (operand) {
+        case N64Recomp::Operand::Rd:
+            return ctx.rd;
+        case N64Recomp::Operand::Rs:
+            return ctx.rs;
+        case N64Recomp::Operand::Rt:
+            return ctx.rt;
+        default:
+            return 0;
+    }
+}
+
+// Takes the values left by the previous instruction for fusion. Returns an empty result if they were left by an earlier instruction.
+FusedResult take_fused_result(N64Recomp::LiveGeneratorContext& gen_context) {
+    FusedResult ret = gen_context.fused_result;
+    gen_context.fused_result = {};
+    if (ret.instruction_index + 1 != gen_context.instruction_count) {
+        return {};
+    }
+    return ret;
+}
+
+// Records the values left by the current instruction for the next instruction to fuse with.
+void set_fused_result(N64Recomp::LiveGeneratorContext& gen_context, FusedResult result) {
+    result.instruction_index = gen_context.instruction_count;
+    gen_context.fused_result = result;
+}
+
+sljit_s32 invert_condition(sljit_s32 condition) {
+    switch (condition) {
+        case SLJIT_EQUAL:
+            return SLJIT_NOT_EQUAL;
+        case SLJIT_NOT_EQUAL:
+            return SLJIT_EQUAL;
+        case SLJIT_LESS:
+            return SLJIT_GREATER_EQUAL;
+        case SLJIT_GREATER_EQUAL:
+            return SLJIT_LESS;
+        case SLJIT_GREATER:
+            return SLJIT_LESS_EQUAL;
+        case SLJIT_LESS_EQUAL:
+            return SLJIT_GREATER;
+        case SLJIT_SIG_LESS:
+            return SLJIT_SIG_GREATER_EQUAL;
+        case SLJIT_SIG_GREATER_EQUAL:
+            return SLJIT_SIG_LESS;
+        case SLJIT_SIG_GREATER:
+            return SLJIT_SIG_LESS_EQUAL;
+        case SLJIT_SIG_LESS_EQUAL:
+            return SLJIT_SIG_GREATER;
+        default:
+            assert(false && "Invalid condition");
+            return condition;
+    }
+}
+
 void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const {
+    FusedResult prev_result = take_fused_result(*context);
+
     // Skip instructions that output to $zero
     if (outputs_to_zero(op.output, ctx)) {
         return;
@@ -422,9 +1194,9 @@ void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const Instr
     sljit_sw src1w;
     sljit_sw src2;
     sljit_sw src2w;
-    bool output_good = get_operand_values(op.output, ctx, dst, dstw, compiler, Registers::arithmetic_temp2);
-    bool input0_good = get_operand_values(op.operands.operands[0], ctx, src1, src1w, nullptr, 0);
-    bool input1_good = get_operand_values(op.operands.operands[1], ctx, src2, src2w, nullptr, 0);
+    bool output_good = get_operand_values(*context, op.output, ctx, dst, dstw, compiler, Registers::arithmetic_temp2);
+    bool input0_good = get_operand_values(*context, op.operands.operands[0], ctx, src1, src1w, nullptr, 0);
+    bool input1_good = get_operand_values(*context, op.operands.operands[1], ctx, src2, src2w, nullptr, 0);
 
     if (!output_good || !input0_good || !input1_good) {
         assert(false);
@@ -501,6 +1273,144 @@ void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const Instr
 
     bool cmp_unsigned = op.operands.operand_operations[0] != UnaryOpType::ToS64;
 
+    int output_gpr = get_operand_gpr(op.output, ctx);
+    int input0_gpr = get_operand_gpr(op.operands.operands[0], ctx);
+    int input1_gpr = get_operand_gpr(op.operands.operands[1], ctx);
+    bool has_reloc = ctx.reloc_type != RelocType::R_MIPS_NONE;
+    FusedResult next_result{};
+
+    // Check if this operation reads the constant left by the previous instruction (e.g. lui followed by addiu, ori or a load).
+    if (!has_reloc && prev_result.constant_gpr != 0 && input0_gpr == prev_result.constant_gpr && src2 == SLJIT_IMM) {
+        int64_t constant_value = prev_result.constant_value;
+        int address_xor = -1;
+        sljit_s32 load_op = SLJIT_MOV;
+        switch (op.type) {
+            case BinaryOpType::Add32:
+            case BinaryOpType::Or64:
+            {
+                // Fold the operation into a constant and store it directly.
+                int64_t result = op.type == BinaryOpType::Add32 ?
+                    (int64_t)(int32_t)(constant_value + src2w) :
+                    (constant_value | src2w);
+                sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_IMM, (sljit_sw)result);
+                next_result.constant_gpr = output_gpr;
+                next_result.constant_value = result;
+                set_fused_result(*context, next_result);
+                return;
+            }
+            case BinaryOpType::LW:
+                load_op = SLJIT_MOV_S32;
+                address_xor = 0;
+                break;
+            case BinaryOpType::LWU:
+                load_op = SLJIT_MOV_U32;
+                address_xor = 0;
+                break;
+            case BinaryOpType::LH:
+                load_op = SLJIT_MOV_S16;
+                address_xor = 2;
+                break;
+            case BinaryOpType::LHU:
+                load_op = SLJIT_MOV_U16;
+                address_xor = 2;
+                break;
+            case BinaryOpType::LB:
+                load_op = SLJIT_MOV_S8;
+                address_xor = 3;
+                break;
+            case BinaryOpType::LBU:
+                load_op = SLJIT_MOV_U8;
+                address_xor = 3;
+                break;
+            default:
+                break;
+        }
+
+        // Load directly from the absolute address.
+        if (address_xor != -1) {
+            sljit_sw address_offset = (sljit_sw)((constant_value + src2w) ^ address_xor);
+            sljit_emit_op1(compiler, load_op, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::rdram), address_offset);
+            sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, Registers::arithmetic_temp1, 0);
+            next_result.temp_value_gpr = output_gpr;
+            // The constant is still valid for the next instruction if it wasn't overwritten by the load.
+            if (output_gpr != prev_result.constant_gpr) {
+                next_result.constant_gpr = prev_result.constant_gpr;
+                next_result.constant_value = prev_result.constant_value;
+            }
+            set_fused_result(*context, next_result);
+            return;
+        }
+    }
+
+    // Word and doubleword loads don't need an address xor, so they can use a base address in arithmetic_temp4 plus the immediate offset.
+    // This lets consecutive loads and stores from the same base register (e.g. the stack pointer) reuse the base address.
+    bool aligned_load = op.type == BinaryOpType::LW || op.type == BinaryOpType::LWU || op.type == BinaryOpType::LD;
+    if (!has_reloc && aligned_load && src2 == SLJIT_IMM) {
+        if (prev_result.host_address_gpr == 0 || input0_gpr != prev_result.host_address_gpr) {
+            // Use the base register's value from arithmetic_temp1 if the previous instruction left it there.
+            bool base_in_temp = prev_result.temp_value_gpr != 0 && input0_gpr == prev_result.temp_value_gpr;
+            sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp4, 0, Registers::rdram, 0,
+                base_in_temp ? Registers::arithmetic_temp1 : src1, base_in_temp ? 0 : src1w);
+        }
+
+        if (op.type == BinaryOpType::LD) {
+            // Rotate the loaded doubleword by 32 bits to swap the two words into the right order.
+            sljit_emit_op2(compiler, SLJIT_ROTL, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::arithmetic_temp4), src2w, SLJIT_IMM, 32);
+        }
+        else {
+            sljit_emit_op1(compiler, op.type == BinaryOpType::LW ? SLJIT_MOV_S32 : SLJIT_MOV_U32, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::arithmetic_temp4), src2w);
+        }
+        sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, Registers::arithmetic_temp1, 0);
+
+        next_result.temp_value_gpr = output_gpr;
+        if (output_gpr != input0_gpr) {
+            next_result.host_address_gpr = input0_gpr;
+        }
+        set_fused_result(*context, next_result);
+        return;
+    }
+
+    // Read the inputs from arithmetic_temp1 instead of the context if the previous instruction left one of them there.
+    // This is only done for operations that read both inputs before writing to arithmetic_temp1.
+    if (!has_reloc && prev_result.temp_value_gpr != 0 && context->gpr_registers[prev_result.temp_value_gpr] == 0) {
+        switch (op.type) {
+            case BinaryOpType::Add32:
+            case BinaryOpType::Sub32:
+            case BinaryOpType::Add64:
+            case BinaryOpType::Sub64:
+            case BinaryOpType::And64:
+            case BinaryOpType::Or64:
+            case BinaryOpType::Nor64:
+            case BinaryOpType::Xor64:
+            case BinaryOpType::Sll32:
+            case BinaryOpType::Sll64:
+            case BinaryOpType::Srl32:
+            case BinaryOpType::Srl64:
+            case BinaryOpType::Sra64:
+            case BinaryOpType::Equal:
+            case BinaryOpType::NotEqual:
+            case BinaryOpType::Less:
+            case BinaryOpType::LessEq:
+            case BinaryOpType::Greater:
+            case BinaryOpType::GreaterEq:
+            case BinaryOpType::LH:
+            case BinaryOpType::LHU:
+            case BinaryOpType::LB:
+            case BinaryOpType::LBU:
+                if (input0_gpr == prev_result.temp_value_gpr) {
+                    src1 = Registers::arithmetic_temp1;
+                    src1w = 0;
+                }
+                if (input1_gpr == prev_result.temp_value_gpr) {
+                    src2 = Registers::arithmetic_temp1;
+                    src2w = 0;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
     auto sign_extend_and_store = [dst, dstw, this]() {
         // Sign extend the result.
         sljit_emit_op1(this->compiler, SLJIT_MOV_S32, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0);
@@ -539,7 +1449,7 @@ void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const Instr
         sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, Registers::arithmetic_temp1, 0);
     };
 
-    auto do_compare_op = [cmp_unsigned, dst, dstw, src1, src1w, src2, src2w, this](sljit_s32 op_unsigned, sljit_s32 op_signed) {
+    auto do_compare_op = [cmp_unsigned, dst, dstw, src1, src1w, src2, src2w, output_gpr, &next_result, this](sljit_s32 op_unsigned, sljit_s32 op_signed) {
         // Pick the operation based on the signedness of the comparison.
         sljit_s32 op = cmp_unsigned ? op_unsigned : op_signed;
 
@@ -557,6 +1467,16 @@ void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const Instr
         
         // Move the operation's flag into the destination.
         sljit_emit_op_flags(compiler, SLJIT_MOV, dst, dstw, op);
+
+        // Record the comparison so that a branch on the result can be fused with it, unless the result overwrote one of the operands.
+        if (!(src1 == dst && src1w == dstw) && !(src2 == dst && src2w == dstw)) {
+            next_result.compare_gpr = output_gpr;
+            next_result.compare_condition = op;
+            next_result.compare_src1 = src1;
+            next_result.compare_src1w = src1w;
+            next_result.compare_src2 = src2;
+            next_result.compare_src2w = src2w;
+        }
     };
 
     auto do_float_compare_op = [dst, dstw, src1, src1w, src2, src2w, this](sljit_s32 flag_op, sljit_s32 set_op, bool double_precision) {
@@ -825,6 +1745,27 @@ void N64Recomp::LiveGenerator::process_binary_op(const BinaryOp& op, const Instr
             errored = true;
             return;
     }
+
+    // Record that the result is still in arithmetic_temp1 for operations that leave it there.
+    switch (op.type) {
+        case BinaryOpType::Add32:
+        case BinaryOpType::Sub32:
+        case BinaryOpType::Sll32:
+        case BinaryOpType::Srl32:
+        case BinaryOpType::Sra32:
+        case BinaryOpType::LD:
+        case BinaryOpType::LW:
+        case BinaryOpType::LWU:
+        case BinaryOpType::LH:
+        case BinaryOpType::LHU:
+        case BinaryOpType::LB:
+        case BinaryOpType::LBU:
+            next_result.temp_value_gpr = output_gpr;
+            break;
+        default:
+            break;
+    }
+    set_fused_result(*context, next_result);
 }
 
 // TODO these four operations should use banker's rounding, but roundeven is C23 so it's unavailable here.
@@ -876,12 +1817,81 @@ int64_t do_floor_l_d(double num) {
     return (int64_t)floor(num);
 }
 
+sljit_uw get_host_function(HostFunction func, const N64Recomp::LiveGeneratorInputs& inputs) {
+    switch (func) {
+        case HostFunction::Cop0StatusWrite:
+            return sljit_uw(inputs.cop0_status_write);
+        case HostFunction::Cop0StatusRead:
+            return sljit_uw(inputs.cop0_status_read);
+        case HostFunction::SwitchError:
+            return sljit_uw(inputs.switch_error);
+        case HostFunction::DoBreak:
+            return sljit_uw(inputs.do_break);
+        case HostFunction::GetFunction:
+            return sljit_uw(inputs.get_function);
+        case HostFunction::SyscallHandler:
+            return sljit_uw(inputs.syscall_handler);
+        case HostFunction::PauseSelf:
+            return sljit_uw(inputs.pause_self);
+        case HostFunction::TriggerEvent:
+            return sljit_uw(inputs.trigger_event);
+        case HostFunction::RunHook:
+            return sljit_uw(inputs.run_hook);
+        case HostFunction::GetCop1Cs:
+            return sljit_uw(get_cop1_cs);
+        case HostFunction::SetCop1Cs:
+            return sljit_uw(set_cop1_cs);
+        case HostFunction::SqrtFloat:
+            return sljit_uw(static_cast<float(*)(float)>(sqrtf));
+        case HostFunction::SqrtDouble:
+            return sljit_uw(static_cast<double(*)(double)>(sqrt));
+        case HostFunction::CvtWS:
+            return sljit_uw(do_cvt_w_s);
+        case HostFunction::CvtWD:
+            return sljit_uw(do_cvt_w_d);
+        case HostFunction::CvtLS:
+            return sljit_uw(do_cvt_l_s);
+        case HostFunction::CvtLD:
+            return sljit_uw(do_cvt_l_d);
+        case HostFunction::RoundWS:
+            return sljit_uw(do_round_w_s);
+        case HostFunction::RoundWD:
+            return sljit_uw(do_round_w_d);
+        case HostFunction::RoundLS:
+            return sljit_uw(do_round_l_s);
+        case HostFunction::RoundLD:
+            return sljit_uw(do_round_l_d);
+        case HostFunction::CeilWS:
+            return sljit_uw(do_ceil_w_s);
+        case HostFunction::CeilWD:
+            return sljit_uw(do_ceil_w_d);
+        case HostFunction::CeilLS:
+            return sljit_uw(do_ceil_l_s);
+        case HostFunction::CeilLD:
+            return sljit_uw(do_ceil_l_d);
+        case HostFunction::FloorWS:
+            return sljit_uw(do_floor_w_s);
+        case HostFunction::FloorWD:
+            return sljit_uw(do_floor_w_d);
+        case HostFunction::FloorLS:
+            return sljit_uw(do_floor_l_s);
+        case HostFunction::FloorLD:
+            return sljit_uw(do_floor_l_d);
+        case HostFunction::Count:
+            break;
+    }
+    assert(false && "Invalid host function!");
+    return 0;
+}
+
 void N64Recomp::LiveGenerator::load_relocated_address(const InstructionContext& ctx, int reg) const {
     // Get the pointer to the section address.
     int32_t* section_addr_ptr = (ctx.reloc_tag_as_reference ? inputs.reference_section_addresses : inputs.local_section_addresses) + ctx.reloc_section_index;
+    LiveCodeFixupType fixup_type = ctx.reloc_tag_as_reference ? LiveCodeFixupType::ReferenceSectionAddress : LiveCodeFixupType::LocalSectionAddress;
 
-    // Load the section's address into the target register.
-    sljit_emit_op1(compiler, SLJIT_MOV_S32, reg, 0, SLJIT_MEM0(), sljit_sw(section_addr_ptr));
+    // Load the pointer to the section's address into the target register, then load the section's address through it.
+    emit_host_address(compiler, *context, reg, fixup_type, ctx.reloc_section_index, section_addr_ptr);
+    sljit_emit_op1(compiler, SLJIT_MOV_S32, reg, 0, SLJIT_MEM1(reg), 0);
 
     // Don't emit the add if the offset is zero (small optimization).
     if (ctx.reloc_target_section_offset != 0) {
@@ -891,6 +1901,8 @@ void N64Recomp::LiveGenerator::load_relocated_address(const InstructionContext&
 }
 
 void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const {
+    take_fused_result(*context);
+
     // Skip instructions that output to $zero
     if (outputs_to_zero(op.output, ctx)) {
         return;
@@ -907,8 +1919,8 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
     sljit_sw dstw;
     sljit_sw src;
     sljit_sw srcw;
-    bool output_good = get_operand_values(op.output, ctx, dst, dstw, compiler, Registers::arithmetic_temp3);
-    bool input_good = get_operand_values(op.input, ctx, src, srcw, compiler, Registers::arithmetic_temp3);
+    bool output_good = get_operand_values(*context, op.output, ctx, dst, dstw, compiler, Registers::arithmetic_temp3);
+    bool input_good = get_operand_values(*context, op.input, ctx, src, srcw, compiler, Registers::arithmetic_temp3);
 
     if (!output_good || !input_good) {
         assert(false);
@@ -951,54 +1963,119 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
     bool float_op = false;
     bool func_float_op = false;
 
-    auto emit_s_func = [this, src, srcw, dst, dstw, &func_float_op](float (*func)(float)) {
+    auto emit_s_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F32, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(F32, F32), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(F32, F32), func);
+        load_allocated_gprs();
         sljit_emit_fop1(compiler, SLJIT_MOV_F32, dst, dstw, SLJIT_RETURN_FREG, 0);
     };
 
-    auto emit_d_func = [this, src, srcw, dst, dstw, &func_float_op](double (*func)(double)) {
+    auto emit_d_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F64, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(F64, F64), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(F64, F64), func);
+        load_allocated_gprs();
         sljit_emit_fop1(compiler, SLJIT_MOV_F64, dst, dstw, SLJIT_RETURN_FREG, 0);
     };
 
-    auto emit_l_from_s_func = [this, src, srcw, dst, dstw, &func_float_op](int64_t (*func)(float)) {
+    auto emit_l_from_s_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F32, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(P, F32), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(P, F32), func);
+        load_allocated_gprs();
         sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_RETURN_REG, 0);
     };
 
-    auto emit_w_from_s_func = [this, src, srcw, dst, dstw, &func_float_op](int32_t (*func)(float)) {
+    auto emit_w_from_s_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F32, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(32, F32), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(32, F32), func);
+        load_allocated_gprs();
         sljit_emit_op1(compiler, SLJIT_MOV_S32, dst, dstw, SLJIT_RETURN_REG, 0);
     };
 
-    auto emit_l_from_d_func = [this, src, srcw, dst, dstw, &func_float_op](int64_t (*func)(double)) {
+    auto emit_l_from_d_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F64, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(P, F64), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(P, F64), func);
+        load_allocated_gprs();
         sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_RETURN_REG, 0);
     };
 
-    auto emit_w_from_d_func = [this, src, srcw, dst, dstw, &func_float_op](int32_t (*func)(double)) {
+    auto emit_w_from_d_func = [this, src, srcw, dst, dstw, &func_float_op](HostFunction func) {
         func_float_op = true;
 
         sljit_emit_fop1(compiler, SLJIT_MOV_F64, SLJIT_FR0, 0, src, srcw);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(32, F64), SLJIT_IMM, sljit_sw(func));
+        store_allocated_gprs();
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1(32, F64), func);
+        load_allocated_gprs();
         sljit_emit_op1(compiler, SLJIT_MOV_S32, dst, dstw, SLJIT_RETURN_REG, 0);
     };
 
+    // Performs a round, ceil or floor conversion inline by truncating the input and then adjusting the truncated value.
+    // The truncated value and the input's fractional part are both exactly representable in the input's format,
+    // so the adjustments aren't affected by the current rounding mode.
+    auto emit_inline_rounding = [this, src, srcw, dst, dstw, &func_float_op](InlineRounding rounding, bool double_precision, bool long_result) {
+        func_float_op = true;
+
+        sljit_s32 mov_op = double_precision ? SLJIT_MOV_F64 : SLJIT_MOV_F32;
+        sljit_s32 sub_op = double_precision ? SLJIT_SUB_F64 : SLJIT_SUB_F32;
+        sljit_s32 add_op = double_precision ? SLJIT_ADD_F64 : SLJIT_ADD_F32;
+        sljit_s32 cmp_op = double_precision ? SLJIT_CMP_F64 : SLJIT_CMP_F32;
+        sljit_s32 truncate_op;
+        sljit_s32 from_int_op;
+        if (long_result) {
+            truncate_op = double_precision ? SLJIT_CONV_SW_FROM_F64 : SLJIT_CONV_SW_FROM_F32;
+            from_int_op = double_precision ? SLJIT_CONV_F64_FROM_SW : SLJIT_CONV_F32_FROM_SW;
+        }
+        else {
+            truncate_op = double_precision ? SLJIT_CONV_S32_FROM_F64 : SLJIT_CONV_S32_FROM_F32;
+            from_int_op = double_precision ? SLJIT_CONV_F64_FROM_S32 : SLJIT_CONV_F32_FROM_S32;
+        }
+        sljit_s32 int_add_op = long_result ? SLJIT_ADD : SLJIT_ADD32;
+        sljit_s32 int_sub_op = long_result ? SLJIT_SUB : SLJIT_SUB32;
+
+        // Load the input into FR0, truncate it into temp1 and convert the truncated value back into FR1.
+        sljit_emit_fop1(compiler, mov_op, SLJIT_FR0, 0, src, srcw);
+        sljit_emit_fop1(compiler, truncate_op, Registers::arithmetic_temp1, 0, SLJIT_FR0, 0);
+        sljit_emit_fop1(compiler, from_int_op, SLJIT_FR1, 0, Registers::arithmetic_temp1, 0);
+
+        switch (rounding) {
+            case InlineRounding::Round:
+                // Round half away from zero by adding trunc(2 * (input - truncated)), which is -1, 0 or 1.
+                sljit_emit_fop2(compiler, sub_op, SLJIT_FR0, 0, SLJIT_FR0, 0, SLJIT_FR1, 0);
+                sljit_emit_fop2(compiler, add_op, SLJIT_FR0, 0, SLJIT_FR0, 0, SLJIT_FR0, 0);
+                sljit_emit_fop1(compiler, truncate_op, Registers::arithmetic_temp2, 0, SLJIT_FR0, 0);
+                sljit_emit_op2(compiler, int_add_op, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp2, 0);
+                break;
+            case InlineRounding::Ceil:
+                // Add 1 if the truncated value is less than the input.
+                sljit_emit_fop1(compiler, cmp_op | SLJIT_SET_F_LESS, SLJIT_FR1, 0, SLJIT_FR0, 0);
+                sljit_emit_op_flags(compiler, SLJIT_MOV, Registers::arithmetic_temp2, 0, SLJIT_F_LESS);
+                sljit_emit_op2(compiler, int_add_op, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp2, 0);
+                break;
+            case InlineRounding::Floor:
+                // Subtract 1 if the input is less than the truncated value.
+                sljit_emit_fop1(compiler, cmp_op | SLJIT_SET_F_LESS, SLJIT_FR0, 0, SLJIT_FR1, 0);
+                sljit_emit_op_flags(compiler, SLJIT_MOV, Registers::arithmetic_temp2, 0, SLJIT_F_LESS);
+                sljit_emit_op2(compiler, int_sub_op, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp2, 0);
+                break;
+        }
+
+        sljit_emit_op1(compiler, long_result ? SLJIT_MOV : SLJIT_MOV_S32, dst, dstw, Registers::arithmetic_temp1, 0);
+    };
+
     switch (op.operation) {
         case UnaryOpType::Lui:
             if (src != SLJIT_IMM) {
@@ -1027,24 +2104,24 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
             float_op = true;
             break;
         case UnaryOpType::SqrtFloat:
-            emit_s_func(sqrtf);
+            emit_s_func(HostFunction::SqrtFloat);
             break;
         case UnaryOpType::SqrtDouble:
-            emit_d_func(sqrt);
+            emit_d_func(HostFunction::SqrtDouble);
             break;
         case UnaryOpType::ConvertSFromW:
             jit_op = SLJIT_CONV_F32_FROM_S32;
             float_op = true;
             break;
         case UnaryOpType::ConvertWFromS:
-            emit_w_from_s_func(do_cvt_w_s);
+            emit_w_from_s_func(HostFunction::CvtWS);
             break;
         case UnaryOpType::ConvertDFromW:
             jit_op = SLJIT_CONV_F64_FROM_S32;
             float_op = true;
             break;
         case UnaryOpType::ConvertWFromD:
-            emit_w_from_d_func(do_cvt_w_d);
+            emit_w_from_d_func(HostFunction::CvtWD);
             break;
         case UnaryOpType::ConvertDFromS:
             jit_op = SLJIT_CONV_F64_FROM_F32;
@@ -1060,14 +2137,14 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
             float_op = true;
             break;
         case UnaryOpType::ConvertLFromD:
-            emit_l_from_d_func(do_cvt_l_d);
+            emit_l_from_d_func(HostFunction::CvtLD);
             break;
         case UnaryOpType::ConvertSFromL:
             jit_op = SLJIT_CONV_F32_FROM_SW;
             float_op = true;
             break;
         case UnaryOpType::ConvertLFromS:
-            emit_l_from_s_func(do_cvt_l_s);
+            emit_l_from_s_func(HostFunction::CvtLS);
             break;
         case UnaryOpType::TruncateWFromS:
             // SLJIT_CONV_S32_FROM_F32 rounds towards zero, just as TRUNC_W_S does.
@@ -1090,40 +2167,70 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
             float_op = true;
             break;
         case UnaryOpType::RoundWFromS:
-            emit_w_from_s_func(do_round_w_s);
+            emit_inline_rounding(InlineRounding::Round, false, false);
             break;
         case UnaryOpType::RoundWFromD:
-            emit_w_from_d_func(do_round_w_d);
+            emit_inline_rounding(InlineRounding::Round, true, false);
             break;
         case UnaryOpType::RoundLFromS:
-            emit_l_from_s_func(do_round_l_s);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Round, false, true);
+            }
+            else {
+                emit_l_from_s_func(HostFunction::RoundLS);
+            }
             break;
         case UnaryOpType::RoundLFromD:
-            emit_l_from_d_func(do_round_l_d);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Round, true, true);
+            }
+            else {
+                emit_l_from_d_func(HostFunction::RoundLD);
+            }
             break;
         case UnaryOpType::CeilWFromS:
-            emit_w_from_s_func(do_ceil_w_s);
+            emit_inline_rounding(InlineRounding::Ceil, false, false);
             break;
         case UnaryOpType::CeilWFromD:
-            emit_w_from_d_func(do_ceil_w_d);
+            emit_inline_rounding(InlineRounding::Ceil, true, false);
             break;
         case UnaryOpType::CeilLFromS:
-            emit_l_from_s_func(do_ceil_l_s);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Ceil, false, true);
+            }
+            else {
+                emit_l_from_s_func(HostFunction::CeilLS);
+            }
             break;
         case UnaryOpType::CeilLFromD:
-            emit_l_from_d_func(do_ceil_l_d);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Ceil, true, true);
+            }
+            else {
+                emit_l_from_d_func(HostFunction::CeilLD);
+            }
             break;
         case UnaryOpType::FloorWFromS:
-            emit_w_from_s_func(do_floor_w_s);
+            emit_inline_rounding(InlineRounding::Floor, false, false);
             break;
         case UnaryOpType::FloorWFromD:
-            emit_w_from_d_func(do_floor_w_d);
+            emit_inline_rounding(InlineRounding::Floor, true, false);
             break;
         case UnaryOpType::FloorLFromS:
-            emit_l_from_s_func(do_floor_l_s);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Floor, false, true);
+            }
+            else {
+                emit_l_from_s_func(HostFunction::FloorLS);
+            }
             break;
         case UnaryOpType::FloorLFromD:
-            emit_l_from_d_func(do_floor_l_d);
+            if constexpr (inline_long_conversions) {
+                emit_inline_rounding(InlineRounding::Floor, true, true);
+            }
+            else {
+                emit_l_from_d_func(HostFunction::FloorLD);
+            }
             break;
         case UnaryOpType::None:
             // Only write 32 bits to the output is a fpr u32l operand.
@@ -1164,14 +2271,28 @@ void N64Recomp::LiveGenerator::process_unary_op(const UnaryOp& op, const Instruc
     else {
         sljit_emit_op1(compiler, jit_op, dst, dstw, src, srcw);
     }
+
+    // Record the constant loaded by lui so that the next instruction can use it directly.
+    if (op.operation == UnaryOpType::Lui) {
+        FusedResult next_result{};
+        next_result.constant_gpr = get_operand_gpr(op.output, ctx);
+        next_result.constant_value = (int64_t)srcw;
+        set_fused_result(*context, next_result);
+    }
 }
 
 void N64Recomp::LiveGenerator::process_store_op(const StoreOp& op, const InstructionContext& ctx) const {
+    FusedResult prev_result = take_fused_result(*context);
+
     sljit_sw src;
     sljit_sw srcw;
     sljit_sw imm = (sljit_sw)(int16_t)ctx.imm16;
 
-    get_operand_values(op.value_input, ctx, src, srcw, compiler, Registers::arithmetic_temp2);
+    get_operand_values(*context, op.value_input, ctx, src, srcw, compiler, Registers::arithmetic_temp2);
+
+    sljit_sw base;
+    sljit_sw basew;
+    get_gpr_values(*context, ctx.rs, base, basew);
 
     // Only LO16 relocs are valid on stores.
     if (ctx.reloc_type != RelocType::R_MIPS_NONE && ctx.reloc_type != RelocType::R_MIPS_LO16) {
@@ -1180,19 +2301,101 @@ void N64Recomp::LiveGenerator::process_store_op(const StoreOp& op, const Instruc
         return;
     }
 
+    // Stores don't modify any GPRs, so a constant left by the previous instruction is still valid for the next one.
+    FusedResult next_result{};
+    next_result.constant_gpr = prev_result.constant_gpr;
+    next_result.constant_value = prev_result.constant_value;
+
+    bool has_reloc = ctx.reloc_type != RelocType::R_MIPS_NONE;
+    bool doubleword_store = op.type == StoreOpType::SD || op.type == StoreOpType::SDC1;
+    bool aligned_store = doubleword_store || op.type == StoreOpType::SW || op.type == StoreOpType::SWC1;
+
+    // The fused stores below don't use arithmetic_temp1, so the value can be stored from it if the previous instruction left it there.
+    int value_gpr = get_operand_gpr(op.value_input, ctx);
+    bool value_in_temp = prev_result.temp_value_gpr != 0 && value_gpr == prev_result.temp_value_gpr;
+    sljit_sw fused_src = value_in_temp ? Registers::arithmetic_temp1 : src;
+    sljit_sw fused_srcw = value_in_temp ? 0 : srcw;
+
+    // Store directly to the absolute address if the base register holds a constant left by the previous instruction (e.g. lui followed by a store).
+    if (!has_reloc && prev_result.constant_gpr != 0 && ctx.rs == prev_result.constant_gpr) {
+        int address_xor = -1;
+        sljit_s32 store_op = SLJIT_MOV_U32;
+        switch (op.type) {
+            case StoreOpType::SD:
+            case StoreOpType::SDC1:
+            case StoreOpType::SW:
+            case StoreOpType::SWC1:
+                address_xor = 0;
+                break;
+            case StoreOpType::SH:
+                store_op = SLJIT_MOV_U16;
+                address_xor = 2;
+                break;
+            case StoreOpType::SB:
+                store_op = SLJIT_MOV_U8;
+                address_xor = 3;
+                break;
+            default:
+                break;
+        }
+
+        if (address_xor != -1) {
+            sljit_sw address_offset = (sljit_sw)((prev_result.constant_value + imm) ^ address_xor);
+            if (doubleword_store) {
+                // Rotate the value by 32 bits to swap the words and move it into the destination.
+                sljit_emit_op2(compiler, SLJIT_ROTL, SLJIT_MEM1(Registers::rdram), address_offset, fused_src, fused_srcw, SLJIT_IMM, 32);
+            }
+            else {
+                sljit_emit_op1(compiler, store_op, SLJIT_MEM1(Registers::rdram), address_offset, fused_src, fused_srcw);
+            }
+            next_result.host_address_gpr = prev_result.host_address_gpr;
+            next_result.temp_value_gpr = prev_result.temp_value_gpr;
+            set_fused_result(*context, next_result);
+            return;
+        }
+    }
+
+    // Word and doubleword stores don't need an address xor, so they can use a base address in arithmetic_temp4 plus the immediate offset.
+    // This lets consecutive stores from the same base register (e.g. saving registers to the stack) reuse the base address.
+    if (!has_reloc && aligned_store) {
+        if (prev_result.host_address_gpr == 0 || ctx.rs != prev_result.host_address_gpr) {
+            // Use the base register's value from arithmetic_temp1 if the previous instruction left it there (e.g. addiu sp followed by a store).
+            bool base_in_temp = prev_result.temp_value_gpr != 0 && ctx.rs == prev_result.temp_value_gpr;
+            sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp4, 0, Registers::rdram, 0,
+                base_in_temp ? Registers::arithmetic_temp1 : base, base_in_temp ? 0 : basew);
+        }
+
+        if (doubleword_store) {
+            // Rotate the value by 32 bits to swap the words and move it into the destination.
+            sljit_emit_op2(compiler, SLJIT_ROTL, SLJIT_MEM1(Registers::arithmetic_temp4), imm, fused_src, fused_srcw, SLJIT_IMM, 32);
+        }
+        else {
+            sljit_emit_op1(compiler, SLJIT_MOV_U32, SLJIT_MEM1(Registers::arithmetic_temp4), imm, fused_src, fused_srcw);
+        }
+        next_result.host_address_gpr = ctx.rs;
+        next_result.temp_value_gpr = prev_result.temp_value_gpr;
+        set_fused_result(*context, next_result);
+        return;
+    }
+
+    // The remaining stores only overwrite arithmetic_temp4 if they're unaligned.
+    if (op.type != StoreOpType::SWL && op.type != StoreOpType::SWR && op.type != StoreOpType::SDL && op.type != StoreOpType::SDR) {
+        next_result.host_address_gpr = prev_result.host_address_gpr;
+    }
+
     if (ctx.reloc_type == RelocType::R_MIPS_LO16) {
         // Load the relocated address into temp1.
         load_relocated_address(ctx, Registers::arithmetic_temp1);
         // Extract the LO16 value from the full address (sign extended lower 16 bits).
         sljit_emit_op1(compiler, SLJIT_MOV_S16, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0);
         // Add the base register (rs) to the LO16 immediate.
-        sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(ctx.rs));
+        sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, base, basew);
     }
     else {
         // TODO 0 immediate optimization.
 
         // Add the base register (rs) and the immediate to get the address and store it in the arithemtic temp.
-        sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(ctx.rs), SLJIT_IMM, imm);
+        sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp1, 0, base, basew, SLJIT_IMM, imm);
     }
 
     auto do_unaligned_store_op = [src, srcw, this](bool left, bool doubleword) {
@@ -1301,25 +2504,215 @@ void N64Recomp::LiveGenerator::process_store_op(const StoreOp& op, const Instruc
             sljit_emit_op1(compiler, SLJIT_MOV_U8, SLJIT_MEM2(Registers::rdram, Registers::arithmetic_temp1), 0, src, srcw);
             break;
     }
+
+    set_fused_result(*context, next_result);
+}
+
+void N64Recomp::LiveGenerator::allocate_gprs(const Function& func) const {
+    context->gpr_registers.fill(0);
+    context->allocated_gprs.clear();
+    context->allocated_scratch_count = 0;
+    context->allocated_saved_count = 0;
+
+    // Stubbed functions don't access any GPRs.
+    if (func.stubbed) {
+        return;
+    }
+
+    // Count the number of references to each GPR in the function.
+    std::array<size_t, 32> use_counts{};
+    uint32_t vram = func.vram;
+    for (uint32_t word : func.words) {
+        rabbitizer::InstructionCpu instr{ byteswap(word), vram };
+        if (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rs)) {
+            use_counts[(int)instr.GetO32_rs()]++;
+        }
+        if (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rt)) {
+            use_counts[(int)instr.GetO32_rt()]++;
+        }
+        if (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rd)) {
+            use_counts[(int)instr.GetO32_rd()]++;
+        }
+        vram += 4;
+    }
+
+    // Sort the referenced GPRs by use count, skipping $zero as it's always treated as an immediate.
+    std::vector<int> candidates{};
+    for (int gpr = 1; gpr < 32; gpr++) {
+        if (use_counts[gpr] >= min_gpr_allocation_uses) {
+            candidates.push_back(gpr);
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [&use_counts](int a, int b) {
+        return use_counts[a] > use_counts[b];
+    });
+
+    // Assign the remaining saved registers first, then fill in with the remaining scratch registers.
+    // Every host register allocated to a GPR gets written back to the context before any call and reloaded after,
+    // so scratch registers being clobbered by calls isn't an issue.
+    constexpr int max_allocated_saved = SLJIT_NUMBER_OF_SAVED_REGISTERS - Registers::base_saved_count;
+    constexpr int max_allocated_total = SLJIT_NUMBER_OF_REGISTERS - Registers::base_saved_count - Registers::base_scratch_count;
+    for (int gpr : candidates) {
+        int reg;
+        if (context->allocated_saved_count < max_allocated_saved) {
+            reg = SLJIT_S(Registers::base_saved_count + context->allocated_saved_count);
+            context->allocated_saved_count++;
+        }
+        else if (context->allocated_saved_count + context->allocated_scratch_count < max_allocated_total) {
+            reg = SLJIT_R(Registers::base_scratch_count + context->allocated_scratch_count);
+            context->allocated_scratch_count++;
+        }
+        else {
+            break;
+        }
+        context->gpr_registers[gpr] = reg;
+        context->allocated_gprs.push_back(gpr);
+    }
+}
+
+void N64Recomp::LiveGenerator::store_allocated_gprs() const {
+    // This is done before anything that calls out of the function, which clobbers the temps and may change any GPR,
+    // so nothing from the previous instruction can be fused after it.
+    context->fused_result = {};
+    for (int gpr : context->allocated_gprs) {
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(gpr), context->gpr_registers[gpr], 0);
+    }
+}
+
+void N64Recomp::LiveGenerator::load_allocated_gprs() const {
+    for (int gpr : context->allocated_gprs) {
+        sljit_emit_op1(compiler, SLJIT_MOV, context->gpr_registers[gpr], 0, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(gpr));
+    }
+}
+
+void N64Recomp::LiveGenerator::set_stack_slots(const std::vector<StackSlot>& slots) const {
+    context->stack_slots = slots;
 }
 
 void N64Recomp::LiveGenerator::emit_function_start(const std::string& function_name, size_t func_index) const {
     context->function_name = function_name;
+    context->instruction_count = 0;
+    context->fused_result = {};
     context->func_labels[func_index] = sljit_emit_label(compiler);
-    // sljit_emit_op0(compiler, SLJIT_BREAKPOINT);
-    sljit_emit_enter(compiler, 0, SLJIT_ARGS2V(P, P), 4 | SLJIT_ENTER_FLOAT(1), 5 | SLJIT_ENTER_FLOAT(0), 0);
+    if (inputs.hot_reloadable) {
+        // Jump to the function's body through a rewritable jump, which can be redirected to a reloaded version of the function.
+        sljit_jump* entry_jump = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+        sljit_label* body_label = sljit_emit_label(compiler);
+        sljit_set_label(entry_jump, body_label);
+        context->function_entry_jumps.emplace_back(func_index, entry_jump, body_label);
+    }
+
+    // The public entry follows the recomp_func_t ABI for external callers. It offsets rdram and then calls the internal entry,
+    // which other functions in this output call directly to skip the offset and argument setup.
+    sljit_emit_enter(compiler, 0, SLJIT_ARGS2V(P, P), 2, 2, 0);
     sljit_emit_op2(compiler, SLJIT_SUB, Registers::rdram, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
+    sljit_jump* internal_call = sljit_emit_call(compiler, SLJIT_CALL_REG_ARG, SLJIT_ARGS0V());
+    sljit_emit_return_void(compiler);
+
+    sljit_label* internal_label = sljit_emit_label(compiler);
+    sljit_set_label(internal_call, internal_label);
+    context->internal_func_labels[func_index] = internal_label;
+
+    // sljit_emit_op0(compiler, SLJIT_BREAKPOINT);
+    sljit_emit_enter(compiler, SLJIT_ENTER_REG_ARG | SLJIT_ENTER_KEEP(2), SLJIT_ARGS0V(),
+        (Registers::base_scratch_count + context->allocated_scratch_count) | SLJIT_ENTER_FLOAT(2),
+        (Registers::base_saved_count + context->allocated_saved_count) | SLJIT_ENTER_FLOAT(0),
+        (sljit_s32)(context->stack_slots.size() * sizeof(uint64_t)));
     
     // Check if this function's entry is hooked and emit the hook call if so.
     auto find_hook_it = inputs.entry_func_hooks.find(func_index);
     if (find_hook_it != inputs.entry_func_hooks.end()) {
-        // Load rdram and ctx into R0 and R1.
-        sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
-        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
-        // Load the hook's index into R2.
-        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, find_hook_it->second);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3V(P, P, W), SLJIT_IMM, sljit_sw(inputs.run_hook));
+        emit_hook_stub_call(find_hook_it->second);
+    }
+
+    // Load the allocated GPRs from the context after the entry hook, as the hook may have modified them.
+    load_allocated_gprs();
+}
+
+void N64Recomp::LiveGenerator::emit_hook_stub_call(size_t hook_index) const {
+    // Load the hook's index into R0 and call the shared hook stub.
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, SLJIT_IMM, sljit_sw(hook_index));
+    context->hook_stub_calls.emplace_back(sljit_emit_call(compiler, SLJIT_CALL_REG_ARG, SLJIT_ARGS1V(W_R)));
+}
+
+// Returns the offset of a promoted stack slot in the current function's sljit locals.
+sljit_sw get_stack_slot_offset(const N64Recomp::LiveGeneratorContext& gen_context, const N64Recomp::StackSlot& slot) {
+    auto find_it = std::find_if(gen_context.stack_slots.begin(), gen_context.stack_slots.end(),
+        [&slot](const N64Recomp::StackSlot& cur) {
+            return cur.offset == slot.offset;
+        });
+    assert(find_it != gen_context.stack_slots.end());
+    return (sljit_sw)(std::distance(gen_context.stack_slots.begin(), find_it) * sizeof(uint64_t));
+}
+
+void N64Recomp::LiveGenerator::emit_stack_slot_load(const StackSlot& slot, int reg) const {
+    take_fused_result(*context);
+
+    // Skip loads into $zero.
+    if (reg == 0) {
+        return;
+    }
+
+    sljit_sw dst;
+    sljit_sw dstw;
+    get_gpr_values(*context, reg, dst, dstw);
+
+    // Word slots are sign extended into the register, just like lw.
+    sljit_emit_op1(compiler, slot.doubleword ? SLJIT_MOV : SLJIT_MOV_S32, dst, dstw, SLJIT_MEM1(SLJIT_SP), get_stack_slot_offset(*context, slot));
+}
+
+void N64Recomp::LiveGenerator::emit_stack_slot_store(const StackSlot& slot, int reg) const {
+    take_fused_result(*context);
+
+    sljit_sw src;
+    sljit_sw srcw;
+    get_gpr_values(*context, reg, src, srcw);
+
+    sljit_emit_op1(compiler, slot.doubleword ? SLJIT_MOV : SLJIT_MOV32, SLJIT_MEM1(SLJIT_SP), get_stack_slot_offset(*context, slot), src, srcw);
+}
+
+void N64Recomp::LiveGenerator::emit_switch_errors() const {
+    if (context->switch_error_jumps.empty()) {
+        return;
+    }
+
+    // Allocate the function name and place it in the literals.
+    char* func_name = new char[context->function_name.size() + 1];
+    memcpy(func_name, context->function_name.c_str(), context->function_name.size());
+    func_name[context->function_name.size()] = '\x00';
+    context->string_literals.emplace_back(func_name);
+    uint32_t func_name_index = static_cast<uint32_t>(context->string_literals.size() - 1);
+
+    // Each switch error jump gets a short sequence that loads its vram and jump table vram into R1 and R2, which then
+    // jumps to a single switch_error call shared by the whole function.
+    std::vector<sljit_jump*> shared_call_jumps{};
+    for (size_t i = 0; i < context->switch_error_jumps.size(); i++) {
+        const auto& cur_error_jump = context->switch_error_jumps[i];
+
+        sljit_set_label(cur_error_jump.jump, sljit_emit_label(compiler));
+        sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R1, 0, SLJIT_IMM, sljit_sw(cur_error_jump.instr_vram));
+        sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R2, 0, SLJIT_IMM, sljit_sw(cur_error_jump.jtbl_vram));
+
+        // The last sequence falls through into the shared call.
+        if (i != context->switch_error_jumps.size() - 1) {
+            shared_call_jumps.emplace_back(sljit_emit_jump(compiler, SLJIT_JUMP));
+        }
     }
+
+    sljit_label* shared_call_label = sljit_emit_label(compiler);
+    for (sljit_jump* cur_jump : shared_call_jumps) {
+        sljit_set_label(cur_jump, shared_call_label);
+    }
+
+    // Write the allocated GPRs back to the context before leaving the function.
+    store_allocated_gprs();
+
+    // Load the function name and call switch_error.
+    emit_host_address(compiler, *context, SLJIT_R0, LiveCodeFixupType::StringLiteral, func_name_index, func_name);
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS3V(P, 32, 32), HostFunction::SwitchError);
+    sljit_emit_return_void(compiler);
+
+    context->switch_error_jumps.clear();
 }
 
 void N64Recomp::LiveGenerator::emit_function_end() const {
@@ -1359,21 +2752,80 @@ void N64Recomp::LiveGenerator::emit_function_end() const {
     // Clear the labels to prevent labels from one function being jumped to by another.
     context->labels.clear();
 
+    // Generate the switch error paths after the function's body so that they stay out of the hot path. These use the function's
+    // frame to return, so they must be generated before the next function starts.
+    emit_switch_errors();
+
+    // Clear the GPR allocation so it doesn't carry over to the next function.
+    context->gpr_registers.fill(0);
+    context->allocated_gprs.clear();
+    context->allocated_scratch_count = 0;
+    context->allocated_saved_count = 0;
+
     if (invalid_switch) {
         assert(false);
         errored = true;
     }
 }
 
+// Emits an inline cached lookup of the function at the vram in vram_src and loads the result into R3. The cache is checked first,
+// and get_function is only called if the cache is invalid. Lookups of a constant address only need to check the generation,
+// while lookups of a register's value also need to check that the vram matches. GPRs must be stored to the context beforehand.
+void emit_cached_function_lookup(sljit_compiler* compiler, N64Recomp::LiveGeneratorContext& gen_context, const N64Recomp::LiveGeneratorInputs& inputs,
+    sljit_s32 vram_src, sljit_sw vram_srcw, bool check_vram)
+{
+    using namespace N64Recomp;
+
+    // Allocate the cache for this callsite.
+    uint32_t cache_index = static_cast<uint32_t>(gen_context.lookup_caches.size());
+    gen_context.lookup_caches.emplace_back(std::make_unique<LiveLookupCache>());
+    LiveLookupCache* cache = gen_context.lookup_caches.back().get();
+
+    // Load the vram into R0, the cache address into R2 and the current generation into R3.
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, vram_src, vram_srcw);
+    emit_host_address(compiler, gen_context, SLJIT_R2, LiveCodeFixupType::LookupCache, cache_index, cache);
+    emit_host_address(compiler, gen_context, SLJIT_R3, LiveCodeFixupType::LookupGeneration, 0, &live_lookup_generation);
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R3, 0, SLJIT_MEM1(SLJIT_R3), 0);
+
+    // Check if the cache is valid.
+    sljit_jump* generation_miss_jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL | SLJIT_32,
+        SLJIT_R3, 0, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, generation));
+    sljit_jump* vram_miss_jump = nullptr;
+    if (check_vram) {
+        vram_miss_jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL | SLJIT_32,
+            SLJIT_R0, 0, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, vram));
+    }
+
+    // Cache hit, so load the cached function.
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, func));
+    sljit_jump* hit_jump = sljit_emit_jump(compiler, SLJIT_JUMP);
+
+    // Cache miss, so call get_function with the vram that's already in R0.
+    sljit_label* miss_label = sljit_emit_label(compiler);
+    sljit_set_label(generation_miss_jump, miss_label);
+    if (vram_miss_jump != nullptr) {
+        sljit_set_label(vram_miss_jump, miss_label);
+    }
+    emit_host_call(compiler, gen_context, inputs, SLJIT_ARGS1(P, 32), HostFunction::GetFunction);
+
+    // Copy the return value into R3 so that it can be used for icall and update the cache.
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_RETURN_REG, 0);
+    emit_host_address(compiler, gen_context, SLJIT_R2, LiveCodeFixupType::LookupCache, cache_index, cache);
+    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, func), SLJIT_R3, 0);
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, vram_src, vram_srcw);
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, vram), SLJIT_R0, 0);
+    emit_host_address(compiler, gen_context, SLJIT_R0, LiveCodeFixupType::LookupGeneration, 0, &live_lookup_generation);
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, SLJIT_MEM1(SLJIT_R0), 0);
+    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_MEM1(SLJIT_R2), offsetof(LiveLookupCache, generation), SLJIT_R0, 0);
+
+    sljit_set_label(hit_jump, sljit_emit_label(compiler));
+}
+
 void N64Recomp::LiveGenerator::emit_function_call_lookup(uint32_t addr) const {
-    // Load the address immediate into the first argument. 
-    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, SLJIT_IMM, int32_t(addr));
-    
-    // Call get_function.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(P, 32), SLJIT_IMM, sljit_sw(inputs.get_function));
-    
-    // Copy the return value into R3 so that it can be used for icall
-    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_RETURN_REG, 0);
+    store_allocated_gprs();
+
+    // Look up the function, which places it in R3.
+    emit_cached_function_lookup(compiler, *context, inputs, SLJIT_IMM, int32_t(addr), false);
     
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
@@ -1381,17 +2833,21 @@ void N64Recomp::LiveGenerator::emit_function_call_lookup(uint32_t addr) const {
 
     // Call the function.
     sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS2V(P, P), SLJIT_R3, 0);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_function_call_by_register(int reg) const {
-    // Load the register's value into the first argument. 
-    sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(reg));
-
-    // Call get_function.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1(P, 32), SLJIT_IMM, sljit_sw(inputs.get_function));
+    store_allocated_gprs();
 
-    // Copy the return value into R3 so that it can be used for icall
-    sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R3, 0, SLJIT_RETURN_REG, 0);
+    // Look up the function, which places it in R3. The register's value is read from the context as the
+    // register it was allocated to may not survive the call to get_function.
+    if (reg == 0) {
+        emit_cached_function_lookup(compiler, *context, inputs, SLJIT_IMM, 0, true);
+    }
+    else {
+        emit_cached_function_lookup(compiler, *context, inputs, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(reg), true);
+    }
 
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
@@ -1399,11 +2855,45 @@ void N64Recomp::LiveGenerator::emit_function_call_by_register(int reg) const {
 
     // Call the function.
     sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS2V(P, P), SLJIT_R3, 0);
+
+    load_allocated_gprs();
+}
+
+void N64Recomp::LiveGenerator::emit_function_call_by_register_candidates(const Context& recompiler_context, int reg, const std::vector<size_t>& function_indices) const {
+    if (reg == 0) {
+        emit_function_call_by_register(reg);
+        return;
+    }
+
+    sljit_sw src;
+    sljit_sw srcw;
+    get_gpr_values(*context, reg, src, srcw);
+
+    // Compare the register against each candidate and call the candidate directly on a match. The register's value is only compared on
+    // paths that haven't made a call yet, so it's still in the same place for each comparison.
+    std::vector<sljit_jump*> end_jumps{};
+    end_jumps.reserve(function_indices.size());
+    for (size_t function_index : function_indices) {
+        sljit_jump* miss_jump = sljit_emit_cmp(compiler, SLJIT_NOT_EQUAL | SLJIT_32, src, srcw, SLJIT_IMM, (int32_t)recompiler_context.functions[function_index].vram);
+        emit_function_call(recompiler_context, function_index);
+        end_jumps.push_back(sljit_emit_jump(compiler, SLJIT_JUMP));
+        sljit_set_label(miss_jump, sljit_emit_label(compiler));
+    }
+
+    // Any other address goes through the lookup.
+    emit_function_call_by_register(reg);
+
+    sljit_label* end_label = sljit_emit_label(compiler);
+    for (sljit_jump* jump : end_jumps) {
+        sljit_set_label(jump, end_label);
+    }
 }
 
 void N64Recomp::LiveGenerator::emit_function_call_reference_symbol(const Context&, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const {
     (void)symbol_index;
 
+    store_allocated_gprs();
+
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
@@ -1425,15 +2915,40 @@ void N64Recomp::LiveGenerator::emit_function_call_reference_symbol(const Context
             call_jump
         ));
     }
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_function_call(const Context&, size_t function_index) const {
+    store_allocated_gprs();
+
+    // Call the function's internal entry if it's in this output. Functions in hot reloadable outputs are called through their
+    // public entry instead, as that's where calls get redirected to reloaded versions of the function.
+    if ((context->shard_functions.empty() || context->shard_functions[function_index]) && !inputs.hot_reloadable) {
+        // The internal entry keeps the rdram and ctx registers, so no arguments need to be set up.
+        sljit_jump* call_jump = sljit_emit_call(compiler, SLJIT_CALL_REG_ARG, SLJIT_ARGS0V());
+        context->inner_calls.emplace_back(InnerCall{ .target_func_index = function_index, .jump = call_jump, .internal_entry = true });
+        load_allocated_gprs();
+        return;
+    }
+
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
-    // Call the function and save the jump to set its label later on.
-    sljit_jump* call_jump = sljit_emit_call(compiler, SLJIT_CALL, SLJIT_ARGS2V(P, P));
-    context->inner_calls.emplace_back(InnerCall{ .target_func_index = function_index, .jump = call_jump });
+    if (!context->shard_functions.empty() && !context->shard_functions[function_index]) {
+        // The function is recompiled by a different shard, so call it through a rewritable jump that gets populated
+        // once all the shards are finished.
+        sljit_jump* call_jump = sljit_emit_call(compiler, SLJIT_CALL | SLJIT_REWRITABLE_JUMP, SLJIT_ARGS2V(P, P));
+        sljit_set_target(call_jump, sljit_uw(-3));
+        context->function_jumps_by_index.emplace(function_index, call_jump);
+    }
+    else {
+        // Call the function and save the jump to set its label later on.
+        sljit_jump* call_jump = sljit_emit_call(compiler, SLJIT_CALL, SLJIT_ARGS2V(P, P));
+        context->inner_calls.emplace_back(InnerCall{ .target_func_index = function_index, .jump = call_jump, .internal_entry = false });
+    }
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_named_function_call(const std::string& function_name) const {
@@ -1443,6 +2958,7 @@ void N64Recomp::LiveGenerator::emit_named_function_call(const std::string& funct
 }
 
 void N64Recomp::LiveGenerator::emit_goto(const std::string& target) const {
+    context->fused_result = {};
     sljit_jump* jump = sljit_emit_jump(compiler, SLJIT_JUMP);
     // Check if the label already exists.
     auto find_it = context->labels.find(target);
@@ -1456,6 +2972,8 @@ void N64Recomp::LiveGenerator::emit_goto(const std::string& target) const {
 }
 
 void N64Recomp::LiveGenerator::emit_label(const std::string& label_name) const {
+    // Other paths can reach the label, so values from the previous instruction can't be used after it.
+    context->fused_result = {};
     sljit_label* label = sljit_emit_label(compiler);
 
     // Check if there are any pending jumps for this label and assign them if so.
@@ -1478,99 +2996,132 @@ void N64Recomp::LiveGenerator::emit_jtbl_addend_declaration(const JumpTable& jtb
     // Nothing to do here, the live recompiler performs a subtraction to get the switch's case.
 }
 
-void N64Recomp::LiveGenerator::emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const {
-    // Make sure there's no pending jump.
-    if(context->cur_branch_jump != nullptr) {
-        assert(false);
-        errored = true;
-        return;
-    }
+sljit_jump* N64Recomp::LiveGenerator::emit_branch_compare(const ConditionalBranchOp& op, const InstructionContext& ctx, bool jump_if_met) const {
+    FusedResult prev_result = take_fused_result(*context);
 
     // Branch conditions do not allow unary ops, except for ToS64 on the first operand to indicate the branch comparison is signed.
     if(op.operands.operand_operations[0] != UnaryOpType::None && op.operands.operand_operations[0] != UnaryOpType::ToS64) {
         assert(false);
         errored = true;
-        return;
+        return nullptr;
     }
 
     if (op.operands.operand_operations[1] != UnaryOpType::None) {
         assert(false);
         errored = true;
-        return;
+        return nullptr;
     }
 
     // Branch conditions do not allow float u32l operands.
     if (is_fpr_u32l(op.operands.operands[0]) || is_fpr_u32l(op.operands.operands[1])) {
         assert(false);
         errored = true;
-        return;
+        return nullptr;
+    }
+
+    // Relocations aren't valid on conditional branches.
+    if(ctx.reloc_type != RelocType::R_MIPS_NONE) {
+        assert(false);
+        errored = true;
+        return nullptr;
     }
 
     sljit_s32 condition_type;
+    sljit_s32 inverted_condition_type;
     bool cmp_signed = op.operands.operand_operations[0] == UnaryOpType::ToS64;
-    // Comparisons need to be inverted to account for the fact that the generator is expected to generate a code block that only runs if
-    // the condition is met, meaning the branch should be taken if the condition isn't met.
     switch (op.comparison) {
         case BinaryOpType::Equal:
-            condition_type = SLJIT_NOT_EQUAL;
+            condition_type = SLJIT_EQUAL;
+            inverted_condition_type = SLJIT_NOT_EQUAL;
             break;
         case BinaryOpType::NotEqual:
-            condition_type = SLJIT_EQUAL;
+            condition_type = SLJIT_NOT_EQUAL;
+            inverted_condition_type = SLJIT_EQUAL;
             break;
         case BinaryOpType::GreaterEq:
             if (cmp_signed) {
-                condition_type = SLJIT_SIG_LESS;
+                condition_type = SLJIT_SIG_GREATER_EQUAL;
+                inverted_condition_type = SLJIT_SIG_LESS;
             }
             else {
-                condition_type = SLJIT_LESS;
+                condition_type = SLJIT_GREATER_EQUAL;
+                inverted_condition_type = SLJIT_LESS;
             }
             break;
         case BinaryOpType::Greater:
             if (cmp_signed) {
-                condition_type = SLJIT_SIG_LESS_EQUAL;
+                condition_type = SLJIT_SIG_GREATER;
+                inverted_condition_type = SLJIT_SIG_LESS_EQUAL;
             }
             else {
-                condition_type = SLJIT_LESS_EQUAL;
+                condition_type = SLJIT_GREATER;
+                inverted_condition_type = SLJIT_LESS_EQUAL;
             }
             break;
         case BinaryOpType::LessEq:
             if (cmp_signed) {
-                condition_type = SLJIT_SIG_GREATER;
+                condition_type = SLJIT_SIG_LESS_EQUAL;
+                inverted_condition_type = SLJIT_SIG_GREATER;
             }
             else {
-                condition_type = SLJIT_GREATER;
+                condition_type = SLJIT_LESS_EQUAL;
+                inverted_condition_type = SLJIT_GREATER;
             }
             break;
         case BinaryOpType::Less:
             if (cmp_signed) {
-                condition_type = SLJIT_SIG_GREATER_EQUAL;
+                condition_type = SLJIT_SIG_LESS;
+                inverted_condition_type = SLJIT_SIG_GREATER_EQUAL;
             }
             else {
-                condition_type = SLJIT_GREATER_EQUAL;
+                condition_type = SLJIT_LESS;
+                inverted_condition_type = SLJIT_GREATER_EQUAL;
             }
             break;
         default:
             assert(false && "Invalid branch condition comparison operation!");
             errored = true;
-            return;
+            return nullptr;
     }
     sljit_sw src1;
     sljit_sw src1w;
     sljit_sw src2;
     sljit_sw src2w;
 
-    get_operand_values(op.operands.operands[0], ctx, src1, src1w, nullptr, 0);
-    get_operand_values(op.operands.operands[1], ctx, src2, src2w, nullptr, 0);
+    get_operand_values(*context, op.operands.operands[0], ctx, src1, src1w, nullptr, 0);
+    get_operand_values(*context, op.operands.operands[1], ctx, src2, src2w, nullptr, 0);
+
+    // If this branch compares the result of a comparison from the previous instruction against zero (e.g. slt followed by bnez),
+    // perform the original comparison directly instead of testing its result.
+    if (prev_result.compare_gpr != 0 && (op.comparison == BinaryOpType::Equal || op.comparison == BinaryOpType::NotEqual)) {
+        sljit_sw result;
+        sljit_sw resultw;
+        get_gpr_values(*context, prev_result.compare_gpr, result, resultw);
+        bool tests_result =
+            (src1 == result && src1w == resultw && src2 == SLJIT_IMM && src2w == 0) ||
+            (src2 == result && src2w == resultw && src1 == SLJIT_IMM && src1w == 0);
+        if (tests_result) {
+            // A branch on the result being nonzero is taken if the comparison held.
+            sljit_s32 fused_condition = op.comparison == BinaryOpType::NotEqual ? prev_result.compare_condition : invert_condition(prev_result.compare_condition);
+            return sljit_emit_cmp(compiler, jump_if_met ? fused_condition : invert_condition(fused_condition),
+                prev_result.compare_src1, prev_result.compare_src1w, prev_result.compare_src2, prev_result.compare_src2w);
+        }
+    }
 
-    // Relocations aren't valid on conditional branches.
-    if(ctx.reloc_type != RelocType::R_MIPS_NONE) {
+    return sljit_emit_cmp(compiler, jump_if_met ? condition_type : inverted_condition_type, src1, src1w, src2, src2w);
+}
+
+void N64Recomp::LiveGenerator::emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const {
+    // Make sure there's no pending jump.
+    if(context->cur_branch_jump != nullptr) {
         assert(false);
         errored = true;
         return;
     }
 
-    // Create a compare jump and track it as the pending branch jump.
-    context->cur_branch_jump = sljit_emit_cmp(compiler, condition_type, src1, src1w, src2, src2w);
+    // The generator is expected to generate a code block that only runs if the condition is met, so the jump needs
+    // to be taken if the condition isn't met. Track the jump as the pending branch jump.
+    context->cur_branch_jump = emit_branch_compare(op, ctx, false);
 }
 
 void N64Recomp::LiveGenerator::emit_branch_close() const {
@@ -1584,6 +3135,35 @@ void N64Recomp::LiveGenerator::emit_branch_close() const {
     // Assign a label at this point to the pending branch jump and clear it.
     sljit_set_label(context->cur_branch_jump, sljit_emit_label(compiler));
     context->cur_branch_jump = nullptr;
+    context->fused_result = {};
+}
+
+void N64Recomp::LiveGenerator::emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const {
+    // Compare and jump directly to the target.
+    sljit_jump* jump = emit_branch_compare(op, ctx, true);
+    if (jump == nullptr) {
+        return;
+    }
+
+    // Check if the label already exists.
+    auto find_it = context->labels.find(target);
+    if (find_it != context->labels.end()) {
+        sljit_set_label(jump, find_it->second);
+    }
+    // It doesn't, so queue this as a pending jump to be resolved later.
+    else {
+        context->pending_jumps[target].push_back(jump);
+    }
+}
+
+void N64Recomp::LiveGenerator::emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const {
+    // Jump over the call if the condition isn't met.
+    sljit_jump* skip_jump = emit_branch_compare(op, ctx, false);
+    if (skip_jump == nullptr) {
+        return;
+    }
+    emit_function_call(context, function_index);
+    sljit_set_label(skip_jump, sljit_emit_label(compiler));
 }
 
 void N64Recomp::LiveGenerator::emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const {
@@ -1602,7 +3182,10 @@ void N64Recomp::LiveGenerator::emit_switch(const Context& recompiler_context, co
 
     // Load the jump target register. The lw instruction was patched into an addiu, so this holds
     // the address of the jump table entry instead of the actual jump target.
-    sljit_emit_op1(compiler, SLJIT_MOV, Registers::arithmetic_temp1, 0, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(reg));
+    sljit_sw src;
+    sljit_sw srcw;
+    get_gpr_values(*context, reg, src, srcw);
+    sljit_emit_op1(compiler, SLJIT_MOV, Registers::arithmetic_temp1, 0, src, srcw);
     // Subtract the jump table's address from the jump target to get the jump table addend.
     // Sign extend the jump table address to 64 bits so that the entire register's contents are used instead of just the lower 32 bits.
     const auto& jtbl_section = recompiler_context.sections[jtbl.section_index];
@@ -1637,8 +3220,9 @@ void N64Recomp::LiveGenerator::emit_switch(const Context& recompiler_context, co
 
     // Multiply the jump table addend by 2 to get the addend for the real jump table. (4 bytes per entry to 8 bytes per entry).
     sljit_emit_op2(compiler, SLJIT_ADD, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0, Registers::arithmetic_temp1, 0);
-    // Load the real jump table address.
-    sljit_emit_op1(compiler, SLJIT_MOV, Registers::arithmetic_temp2, 0, SLJIT_IMM, (sljit_sw)cur_jump_table.get());
+    // Load the real jump table address. The jump table will be at this index in the output once the function is finished.
+    uint32_t jump_table_index = static_cast<uint32_t>(context->unlinked_jump_tables.size() + context->pending_jump_tables.size());
+    emit_host_address(compiler, *context, Registers::arithmetic_temp2, LiveCodeFixupType::JumpTable, jump_table_index, cur_jump_table.get());
     // Load the real jump entry.
     sljit_emit_op1(compiler, SLJIT_MOV, Registers::arithmetic_temp1, 0, SLJIT_MEM2(Registers::arithmetic_temp1, Registers::arithmetic_temp2), 0);
     // Jump to the loaded entry.
@@ -1666,16 +3250,14 @@ void N64Recomp::LiveGenerator::emit_switch_close() const {
 
 void N64Recomp::LiveGenerator::emit_return(const Context& context, size_t func_index) const {
     (void)context;
+
+    // Write the allocated GPRs back to the context so they're visible to the caller and the return hook.
+    store_allocated_gprs();
     
     // Check if this function's return is hooked and emit the hook call if so.
     auto find_hook_it = inputs.return_func_hooks.find(func_index);
     if (find_hook_it != inputs.return_func_hooks.end()) {
-        // Load rdram and ctx into R0 and R1.
-        sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
-        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
-        // Load the return hook's index into R2.
-        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, find_hook_it->second);
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3V(P, P, W), SLJIT_IMM, sljit_sw(inputs.run_hook));
+        emit_hook_stub_call(find_hook_it->second);
     }
     sljit_emit_return_void(compiler);
 }
@@ -1694,28 +3276,40 @@ void N64Recomp::LiveGenerator::emit_check_nan(int fpr, bool is_double) const {
 void N64Recomp::LiveGenerator::emit_cop0_status_read(int reg) const {
     // Skip the read if the target is the zero register.
     if (reg != 0) {
+        sljit_sw dst;
+        sljit_sw dstw;
+        get_gpr_values(*context, reg, dst, dstw);
+
+        store_allocated_gprs();
+
         // Load ctx into R0.
         sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, Registers::ctx, 0);
 
         // Call cop0_status_read.
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1V(P), SLJIT_IMM, sljit_sw(inputs.cop0_status_read));
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS1V(P), HostFunction::Cop0StatusRead);
+
+        load_allocated_gprs();
 
         // Store the result in the output register.
-        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_MEM1(Registers::ctx), get_gpr_context_offset(reg), SLJIT_R0, 0);
+        sljit_emit_op1(compiler, SLJIT_MOV, dst, dstw, SLJIT_R0, 0);
     }
 }
 
 void N64Recomp::LiveGenerator::emit_cop0_status_write(int reg) const {
     sljit_sw src;
     sljit_sw srcw;
-    get_gpr_values(reg, src, srcw);
+    get_gpr_values(*context, reg, src, srcw);
+    
+    store_allocated_gprs();
     
     // Load ctx and the input register value into R0 and R1
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, Registers::ctx, 0);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, src, srcw);
 
     // Call cop0_status_write.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS2V(P,32), SLJIT_IMM, sljit_sw(inputs.cop0_status_write));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS2V(P,32), HostFunction::Cop0StatusWrite);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_cop1_cs_read(int reg) const {
@@ -1723,10 +3317,14 @@ void N64Recomp::LiveGenerator::emit_cop1_cs_read(int reg) const {
     if (reg != 0) {
         sljit_sw dst;
         sljit_sw dstw;
-        get_gpr_values(reg, dst, dstw);
+        get_gpr_values(*context, reg, dst, dstw);
+
+        store_allocated_gprs();
 
         // Call get_cop1_cs.
-        sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS0(32), SLJIT_IMM, sljit_sw(get_cop1_cs));
+        emit_host_call(compiler, *context, inputs, SLJIT_ARGS0(32), HostFunction::GetCop1Cs);
+
+        load_allocated_gprs();
 
         // Sign extend the result into a temp register.
         sljit_emit_op1(compiler, SLJIT_MOV_S32, Registers::arithmetic_temp1, 0, SLJIT_RETURN_REG, 0);
@@ -1739,13 +3337,17 @@ void N64Recomp::LiveGenerator::emit_cop1_cs_read(int reg) const {
 void N64Recomp::LiveGenerator::emit_cop1_cs_write(int reg) const {
     sljit_sw src;
     sljit_sw srcw;
-    get_gpr_values(reg, src, srcw);
+    get_gpr_values(*context, reg, src, srcw);
+
+    store_allocated_gprs();
 
     // Load the input register value into R0.
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R0, 0, src, srcw);
 
     // Call set_cop1_cs.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1V(32), SLJIT_IMM, sljit_sw(set_cop1_cs));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS1V(32), HostFunction::SetCop1Cs);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_muldiv(InstrId instr_id, int reg1, int reg2) const {
@@ -1753,8 +3355,8 @@ void N64Recomp::LiveGenerator::emit_muldiv(InstrId instr_id, int reg1, int reg2)
     sljit_sw src1w;
     sljit_sw src2;
     sljit_sw src2w;
-    get_gpr_values(reg1, src1, src1w);
-    get_gpr_values(reg2, src2, src2w);
+    get_gpr_values(*context, reg1, src1, src1w);
+    get_gpr_values(*context, reg2, src2, src2w);
     
     auto do_mul32_op = [src1, src1w, src2, src2w, this](bool is_signed) {
         // Load the two inputs into the multiplication input registers (R0/R1).
@@ -1910,48 +3512,319 @@ void N64Recomp::LiveGenerator::emit_muldiv(InstrId instr_id, int reg1, int reg2)
 }
 
 void N64Recomp::LiveGenerator::emit_syscall(uint32_t instr_vram) const {
+    store_allocated_gprs();
+
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
     // Load the vram into R2.
     sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R2, 0, SLJIT_IMM, instr_vram);
     // Call syscall_handler.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3V(P, P, 32), SLJIT_IMM, sljit_sw(inputs.syscall_handler));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS3V(P, P, 32), HostFunction::SyscallHandler);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_do_break(uint32_t instr_vram) const {
+    store_allocated_gprs();
+
     // Load the vram into R0.
     sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R0, 0, SLJIT_IMM, instr_vram);
     // Call do_break.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1V(32), SLJIT_IMM, sljit_sw(inputs.do_break));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS1V(32), HostFunction::DoBreak);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_pause_self() const {
+    store_allocated_gprs();
+
     // Load rdram into R0.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
     // Call pause_self.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS1V(P), SLJIT_IMM, sljit_sw(inputs.pause_self));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS1V(P), HostFunction::PauseSelf);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_trigger_event(uint32_t event_index) const {
+    store_allocated_gprs();
+
     // Load rdram and ctx into R0 and R1.
     sljit_emit_op2(compiler, SLJIT_ADD, SLJIT_R0, 0, Registers::rdram, 0, SLJIT_IMM, rdram_offset);
     sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R1, 0, Registers::ctx, 0);
     // Load the global event index into R2.
     sljit_emit_op1(compiler, SLJIT_MOV32, SLJIT_R2, 0, SLJIT_IMM, event_index + inputs.base_event_index);
     // Call trigger_event.
-    sljit_emit_icall(compiler, SLJIT_CALL, SLJIT_ARGS3V(P,P,32), SLJIT_IMM, sljit_sw(inputs.trigger_event));
+    emit_host_call(compiler, *context, inputs, SLJIT_ARGS3V(P,P,32), HostFunction::TriggerEvent);
+
+    load_allocated_gprs();
 }
 
 void N64Recomp::LiveGenerator::emit_comment(const std::string& comment) const {
     (void)comment;
-    // Nothing to do here.
+    // A comment is emitted at the start of every instruction, so use it to count instructions for fusion.
+    context->instruction_count++;
 }
 
 bool N64Recomp::recompile_function_live(LiveGenerator& generator, const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs) {
+    generator.allocate_gprs(context.functions[function_index]);
     return recompile_function_custom(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs);
 }
 
+bool N64Recomp::recompile_functions_live_parallel(const Context& context, const LiveGeneratorInputs& inputs, size_t shard_count,
+    std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs, LiveShardedOutput& output_out)
+{
+    size_t num_funcs = context.functions.size();
+    shard_count = std::max<size_t>(1, std::min(shard_count, num_funcs));
+
+    // Partition the functions across the shards, balancing them by instruction count. Functions are assigned from largest
+    // to smallest, with each one going to the shard that has the fewest instructions so far.
+    std::vector<size_t> sorted_funcs(num_funcs);
+    std::iota(sorted_funcs.begin(), sorted_funcs.end(), size_t{0});
+    std::stable_sort(sorted_funcs.begin(), sorted_funcs.end(), [&context](size_t a, size_t b) {
+        return context.functions[a].words.size() > context.functions[b].words.size();
+    });
+
+    std::vector<size_t> shard_instruction_counts(shard_count, 0);
+    std::vector<std::vector<size_t>> shard_func_indices(shard_count);
+    std::vector<size_t> func_shards(num_funcs);
+    for (size_t func_index : sorted_funcs) {
+        size_t shard_index = std::min_element(shard_instruction_counts.begin(), shard_instruction_counts.end()) - shard_instruction_counts.begin();
+        shard_instruction_counts[shard_index] += context.functions[func_index].words.size() + 1;
+        shard_func_indices[shard_index].push_back(func_index);
+        func_shards[func_index] = shard_index;
+    }
+
+    struct ShardResult {
+        LiveGeneratorOutput output;
+        std::vector<std::vector<uint32_t>> static_funcs;
+        bool good = false;
+    };
+    std::vector<ShardResult> results(shard_count);
+
+    // Recompile each shard on its own thread.
+    std::vector<std::thread> threads{};
+    threads.reserve(shard_count);
+    for (size_t shard_index = 0; shard_index < shard_count; shard_index++) {
+        threads.emplace_back([&, shard_index]() {
+            ShardResult& result = results[shard_index];
+            std::vector<size_t>& func_indices = shard_func_indices[shard_index];
+
+            // Recompile the functions in order to keep the code layout deterministic.
+            std::sort(func_indices.begin(), func_indices.end());
+
+            std::vector<bool> shard_functions(num_funcs, false);
+            for (size_t func_index : func_indices) {
+                shard_functions[func_index] = true;
+            }
+
+            LiveGenerator generator{ num_funcs, inputs, std::move(shard_functions) };
+            result.static_funcs.resize(static_funcs_out.size());
+
+            for (size_t func_index : func_indices) {
+                std::ostringstream dummy_ostream{};
+                if (!recompile_function_live(generator, context, func_index, dummy_ostream, result.static_funcs, tag_reference_relocs)) {
+                    return;
+                }
+            }
+
+            result.output = generator.finish();
+            result.good = result.output.good;
+        });
+    }
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (const ShardResult& result : results) {
+        if (!result.good) {
+            return false;
+        }
+    }
+
+    // Merge the static functions found by each shard.
+    for (const ShardResult& result : results) {
+        for (size_t section_index = 0; section_index < static_funcs_out.size(); section_index++) {
+            const std::vector<uint32_t>& shard_statics = result.static_funcs[section_index];
+            static_funcs_out[section_index].insert(static_funcs_out[section_index].end(), shard_statics.begin(), shard_statics.end());
+        }
+    }
+
+    // Gather the function addresses from each shard and link the calls between shards.
+    output_out.functions.assign(num_funcs, nullptr);
+    for (size_t func_index = 0; func_index < num_funcs; func_index++) {
+        output_out.functions[func_index] = results[func_shards[func_index]].output.functions[func_index];
+    }
+
+    for (size_t shard_index = 0; shard_index < shard_count; shard_index++) {
+        for (size_t func_index = 0; func_index < num_funcs; func_index++) {
+            if (func_shards[func_index] != shard_index) {
+                results[shard_index].output.populate_function_jumps(func_index, output_out.functions[func_index]);
+            }
+        }
+    }
+
+    output_out.shards.clear();
+    output_out.shards.reserve(shard_count);
+    for (ShardResult& result : results) {
+        output_out.shards.emplace_back(std::move(result.output));
+    }
+
+    return true;
+}
+
+bool N64Recomp::recompile_function_for_reload(std::span<recomp_func_t* const> functions, const Context& context, size_t function_index,
+    const LiveGeneratorInputs& inputs, bool tag_reference_relocs, LiveGeneratorOutput& output_out)
+{
+    size_t num_funcs = context.functions.size();
+    if (function_index >= num_funcs || functions.size() != num_funcs) {
+        return false;
+    }
+
+    // Recompile the function on its own, which makes calls to every other function go through rewritable jumps.
+    std::vector<bool> shard_functions(num_funcs, false);
+    shard_functions[function_index] = true;
+    LiveGenerator generator{ num_funcs, inputs, std::move(shard_functions) };
+
+    std::vector<std::vector<uint32_t>> static_funcs{};
+    static_funcs.resize(context.sections.size());
+    std::ostringstream dummy_ostream{};
+    if (!recompile_function_live(generator, context, function_index, dummy_ostream, static_funcs, tag_reference_relocs)) {
+        return false;
+    }
+
+    LiveGeneratorOutput output = generator.finish();
+    if (!output.good) {
+        return false;
+    }
+
+    // Point calls to other functions at their existing entries so that they also pick up any later reloads of those functions.
+    for (const auto& [callee_index, jump_address] : output.function_jumps_by_index) {
+        sljit_set_jump_addr(reinterpret_cast<sljit_uw>(jump_address), reinterpret_cast<sljit_uw>(functions[callee_index]), output.executable_offset);
+    }
+
+    output_out = std::move(output);
+    return true;
+}
+
+// Alignment of each allocation in a code arena.
+constexpr size_t code_arena_alignment = 64;
+
+// sljit's mprotect based W^X allocator changes the protection of whole pages while code is written, which isn't safe for pages
+// shared by several outputs. See LiveCodeArena for info.
+#if defined(SLJIT_WX_EXECUTABLE_ALLOCATOR) && SLJIT_WX_EXECUTABLE_ALLOCATOR
+constexpr bool code_arena_supported = false;
+#else
+constexpr bool code_arena_supported = true;
+#endif
+
+N64Recomp::LiveCodeArena::LiveCodeArena(size_t chunk_size) : chunk_size(chunk_size) {
+}
+
+N64Recomp::LiveCodeArena::~LiveCodeArena() {
+    for (Chunk& chunk : chunks) {
+        assert(chunk.allocation_count == 0);
+        SLJIT_FREE_EXEC(chunk.memory, nullptr);
+    }
+    chunks.clear();
+}
+
+void* N64Recomp::LiveCodeArena::allocate(size_t size, int64_t& executable_offset) {
+    if constexpr (!code_arena_supported) {
+        assert(false);
+        return nullptr;
+    }
+
+    std::lock_guard lock{ mutex };
+
+    size_t aligned_size = (size + code_arena_alignment - 1) & ~(code_arena_alignment - 1);
+
+    // Find a chunk with enough space, starting with the most recent chunk as it's the most likely to have space left.
+    Chunk* found_chunk = nullptr;
+    for (auto it = chunks.rbegin(); it != chunks.rend(); ++it) {
+        if (it->size - it->next_offset >= aligned_size) {
+            found_chunk = &*it;
+            break;
+        }
+    }
+
+    // Allocate a new chunk if none had enough space. Outputs larger than the chunk size get a chunk of their own.
+    if (found_chunk == nullptr) {
+        size_t new_chunk_size = std::max(chunk_size, aligned_size);
+        void* memory = SLJIT_MALLOC_EXEC(new_chunk_size, nullptr);
+        if (memory == nullptr) {
+            return nullptr;
+        }
+        found_chunk = &chunks.emplace_back(Chunk{
+            .memory = reinterpret_cast<uint8_t*>(memory),
+            .size = new_chunk_size,
+            .executable_offset = SLJIT_EXEC_OFFSET(memory),
+            .next_offset = 0,
+            .allocation_count = 0,
+            .used_bytes = 0
+        });
+    }
+
+    void* ret = found_chunk->memory + found_chunk->next_offset;
+    found_chunk->next_offset += aligned_size;
+    found_chunk->allocation_count++;
+    found_chunk->used_bytes += aligned_size;
+    executable_offset = found_chunk->executable_offset;
+
+    return ret;
+}
+
+void N64Recomp::LiveCodeArena::free(void* code, size_t size) {
+    std::lock_guard lock{ mutex };
+
+    size_t aligned_size = (size + code_arena_alignment - 1) & ~(code_arena_alignment - 1);
+
+    for (Chunk& chunk : chunks) {
+        uint8_t* writable = reinterpret_cast<uint8_t*>(code) - chunk.executable_offset;
+        if (writable >= chunk.memory && writable < chunk.memory + chunk.size) {
+            assert(chunk.allocation_count != 0);
+            chunk.allocation_count--;
+            chunk.used_bytes -= aligned_size;
+
+            // Reuse the chunk from the start once it's empty.
+            if (chunk.allocation_count == 0) {
+                chunk.next_offset = 0;
+            }
+            return;
+        }
+    }
+
+    // The code wasn't allocated from this arena.
+    assert(false);
+}
+
+void N64Recomp::LiveCodeArena::compact() {
+    std::lock_guard lock{ mutex };
+
+    std::erase_if(chunks, [](const Chunk& chunk) {
+        if (chunk.allocation_count == 0) {
+            SLJIT_FREE_EXEC(chunk.memory, nullptr);
+            return true;
+        }
+        return false;
+    });
+}
+
+N64Recomp::LiveCodeArena::Stats N64Recomp::LiveCodeArena::get_stats() {
+    std::lock_guard lock{ mutex };
+
+    Stats ret{};
+    ret.chunk_count = chunks.size();
+    for (const Chunk& chunk : chunks) {
+        ret.reserved_bytes += chunk.size;
+        ret.used_bytes += chunk.used_bytes;
+        ret.wasted_bytes += chunk.next_offset - chunk.used_bytes;
+    }
+    return ret;
+}
+
 N64Recomp::ShimFunction::ShimFunction(recomp_func_ext_t* to_shim, uintptr_t value) {
     sljit_compiler* compiler = sljit_create_compiler(nullptr);
 
@@ -1978,3 +3851,131 @@ N64Recomp::ShimFunction::~ShimFunction() {
     code = nullptr;
     func = nullptr;
 }
+
+N64Recomp::LiveLazyRecompiler::LiveLazyRecompiler(const Context& context, const LiveGeneratorInputs& inputs, bool tag_reference_relocs, LinkCallback link_output) :
+    context(context), inputs(inputs), tag_reference_relocs(tag_reference_relocs), link_output(std::move(link_output))
+{
+    size_t num_funcs = context.functions.size();
+    recompiled.resize(num_funcs, false);
+
+    // Create a stub for every function, which recompiles the function when it's first called.
+    // The stub data is fully allocated before creating the stubs as each stub holds a pointer to its entry.
+    stub_data.resize(num_funcs);
+    stub_entry_jumps.resize(num_funcs);
+    functions.resize(num_funcs);
+
+    sljit_compiler* compiler = sljit_create_compiler(nullptr);
+    std::vector<sljit_label*> entry_labels(num_funcs);
+    std::vector<sljit_jump*> entry_jumps(num_funcs);
+    for (size_t func_index = 0; func_index < num_funcs; func_index++) {
+        stub_data[func_index] = StubData{ .owner = this, .function_index = func_index };
+
+        // Each stub starts with a rewritable jump, which initially goes to the code that recompiles the function. Once the function
+        // has been recompiled the jump is pointed at it, so callers that hold the stub's address go straight to the recompiled function.
+        entry_labels[func_index] = sljit_emit_label(compiler);
+        entry_jumps[func_index] = sljit_emit_jump(compiler, SLJIT_JUMP | SLJIT_REWRITABLE_JUMP);
+        sljit_set_label(entry_jumps[func_index], sljit_emit_label(compiler));
+
+        // Tail call lazy_entry with the stub's data as the third argument.
+        sljit_emit_enter(compiler, 0, SLJIT_ARGS2V(P_R, P_R), 3, 0, 0);
+        sljit_emit_op1(compiler, SLJIT_MOV, SLJIT_R2, 0, SLJIT_IMM, sljit_sw(&stub_data[func_index]));
+        sljit_emit_icall(compiler, SLJIT_CALL | SLJIT_CALL_RETURN, SLJIT_ARGS3V(P, P, W), SLJIT_IMM, sljit_sw(lazy_entry));
+    }
+
+    stub_code = sljit_generate_code(compiler, 0, nullptr);
+    if (stub_code == nullptr) {
+        fmt::print(stderr, "Failed to generate lazy recompilation stubs\n");
+        assert(false);
+    }
+    else {
+        stub_executable_offset = sljit_get_executable_offset(compiler);
+        for (size_t func_index = 0; func_index < num_funcs; func_index++) {
+            functions[func_index] = reinterpret_cast<recomp_func_t*>(sljit_get_label_addr(entry_labels[func_index]));
+            stub_entry_jumps[func_index] = reinterpret_cast<void*>(entry_jumps[func_index]->addr);
+        }
+    }
+
+    sljit_free_compiler(compiler);
+}
+
+N64Recomp::LiveLazyRecompiler::~LiveLazyRecompiler() {
+    if (stub_code != nullptr) {
+        sljit_free_code(stub_code, nullptr);
+        stub_code = nullptr;
+    }
+}
+
+recomp_func_t* N64Recomp::LiveLazyRecompiler::get_function(size_t function_index) {
+    std::lock_guard lock{ mutex };
+    return functions[function_index];
+}
+
+bool N64Recomp::LiveLazyRecompiler::is_recompiled(size_t function_index) {
+    std::lock_guard lock{ mutex };
+    return recompiled[function_index];
+}
+
+recomp_func_t* N64Recomp::LiveLazyRecompiler::recompile(size_t function_index) {
+    std::lock_guard lock{ mutex };
+
+    if (recompiled[function_index]) {
+        return functions[function_index];
+    }
+
+    // Recompile the function on its own, which makes calls to every other function go through rewritable jumps.
+    size_t num_funcs = context.functions.size();
+    std::vector<bool> shard_functions(num_funcs, false);
+    shard_functions[function_index] = true;
+    LiveGenerator generator{ num_funcs, inputs, std::move(shard_functions) };
+
+    // Static functions aren't recompiled lazily, as every function in the context already has a stub.
+    std::vector<std::vector<uint32_t>> static_funcs{};
+    static_funcs.resize(context.sections.size());
+    std::ostringstream dummy_ostream{};
+    if (!recompile_function_live(generator, context, function_index, dummy_ostream, static_funcs, tag_reference_relocs)) {
+        fmt::print(stderr, "Failed to lazily recompile function {}\n", context.functions[function_index].name);
+        return nullptr;
+    }
+
+    auto output = std::make_unique<LiveGeneratorOutput>(generator.finish());
+    if (!output->good || !link_output(*output)) {
+        fmt::print(stderr, "Failed to generate code for lazily recompiled function {}\n", context.functions[function_index].name);
+        return nullptr;
+    }
+
+    // Point this function's calls at the current entrypoint of each callee, which is either the callee's stub
+    // or the callee itself if it's already been recompiled.
+    for (const auto& [callee_index, jump_address] : output->function_jumps_by_index) {
+        sljit_set_jump_addr(reinterpret_cast<sljit_uw>(jump_address), reinterpret_cast<sljit_uw>(functions[callee_index]), output->executable_offset);
+    }
+
+    // Back-patch any previously recompiled callers to call the recompiled function directly instead of going through the stub.
+    recomp_func_t* func = output->functions[function_index];
+    for (auto& prev_output : outputs) {
+        prev_output->populate_function_jumps(function_index, func);
+    }
+
+    // Point the stub at the recompiled function for callers outside of recompiled code.
+    if (stub_entry_jumps[function_index] != nullptr) {
+        sljit_set_jump_addr(reinterpret_cast<sljit_uw>(stub_entry_jumps[function_index]), reinterpret_cast<sljit_uw>(func), stub_executable_offset);
+    }
+
+    outputs.emplace_back(std::move(output));
+    functions[function_index] = func;
+    recompiled[function_index] = true;
+
+    return func;
+}
+
+void N64Recomp::LiveLazyRecompiler::lazy_entry(uint8_t* rdram, recomp_context* ctx, uintptr_t arg) {
+    StubData* data = reinterpret_cast<StubData*>(arg);
+    recomp_func_t* func = data->owner->recompile(data->function_index);
+
+    // There's no way to recover from a failed recompilation once the function has been called.
+    if (func == nullptr) {
+        assert(false);
+        std::abort();
+    }
+
+    func(rdram, ctx);
+}
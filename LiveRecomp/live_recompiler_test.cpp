@@ -2,10 +2,17 @@
 #include <chrono>
 #include <filesystem>
 #include <cinttypes>
+#include <cstring>
+#include <span>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
 
 #include "sljitLir.h"
 #include "recompiler/live_recompiler.h"
 #include "recomp.h"
+#include "test_context.h"
 
 static std::vector<uint8_t> read_file(const std::filesystem::path& path, bool& found) {
     std::vector<uint8_t> ret;
@@ -55,8 +62,11 @@ enum class TestError {
     Success,
     FailedToOpenInput,
     FailedToRecompile,
+    FailedToLoadFromCache,
+    AcceptedCorruptedCache,
     UnknownStructType,
-    DataDifference
+    DataDifference,
+    WrongResult
 };
 
 struct TestStats {
@@ -82,6 +92,60 @@ void test_switch_error(const char* func, uint32_t vram, uint32_t jtbl) {
     printf("  Switch-case out of bounds in %s at 0x%08X for jump table at 0x%08X\n", func, vram, jtbl);
 }
 
+// Checks that truncated or corrupted cache data is rejected by deserialize_live_output.
+bool check_corrupted_cache_data(const std::vector<uint8_t>& cache_data, uint64_t cache_key, size_t code_size, const N64Recomp::LiveGeneratorInputs& inputs) {
+    auto is_rejected = [&](std::span<const uint8_t> data, uint64_t key) {
+        N64Recomp::LiveGeneratorOutput output{};
+        return !N64Recomp::deserialize_live_output(data, key, inputs, output);
+    };
+
+    // The header is the magic, version and cache key, followed by the code size, the code and the function count.
+    constexpr size_t code_size_offset = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint64_t);
+    size_t function_count_offset = code_size_offset + sizeof(uint64_t) + code_size;
+
+    // Truncated data.
+    const size_t truncated_sizes[] = { 0, 4, code_size_offset, function_count_offset - code_size / 2, function_count_offset, cache_data.size() / 2, cache_data.size() - 1 };
+    for (size_t size : truncated_sizes) {
+        if (!is_rejected(std::span{ cache_data }.first(size), cache_key)) {
+            printf("  Cache data truncated to %zu bytes was accepted\n", size);
+            return false;
+        }
+    }
+
+    // Wrong cache key.
+    if (!is_rejected(cache_data, cache_key + 1)) {
+        printf("  Cache data was accepted with the wrong cache key\n");
+        return false;
+    }
+
+    // Extra data after the end.
+    std::vector<uint8_t> extended = cache_data;
+    extended.push_back(0);
+    if (!is_rejected(extended, cache_key)) {
+        printf("  Cache data with trailing bytes was accepted\n");
+        return false;
+    }
+
+    // Corrupted fields, each of which is written with the given value.
+    auto check_corrupted_field = [&](const char* field_name, size_t offset, auto value) {
+        std::vector<uint8_t> corrupted = cache_data;
+        memcpy(corrupted.data() + offset, &value, sizeof(value));
+        if (!is_rejected(corrupted, cache_key)) {
+            printf("  Cache data with a corrupted %s was accepted\n", field_name);
+            return false;
+        }
+        return true;
+    };
+
+    return
+        check_corrupted_field("magic", 0, ~*reinterpret_cast<const uint32_t*>(cache_data.data())) &&
+        check_corrupted_field("version", sizeof(uint32_t), ~*reinterpret_cast<const uint32_t*>(cache_data.data() + sizeof(uint32_t))) &&
+        check_corrupted_field("code size", code_size_offset, uint64_t{ 0 }) &&
+        check_corrupted_field("code size", code_size_offset, uint64_t{ cache_data.size() }) &&
+        check_corrupted_field("function count", function_count_offset, ~uint64_t{ 0 }) &&
+        check_corrupted_field("function offset", function_count_offset + sizeof(uint64_t), uint64_t{ code_size });
+}
+
 TestStats run_test(const std::filesystem::path& tests_dir, const std::string& test_name) {
     std::filesystem::path input_path = tests_dir / (test_name + "_data.bin");
     std::filesystem::path data_dump_path = tests_dir / (test_name + "_data_out.bin");
@@ -104,10 +168,7 @@ TestStats run_test(const std::filesystem::path& tests_dir, const std::string& te
     uint32_t data_address = read_u32_swap(file_data, 0x18);
     uint32_t next_struct_address = read_u32_swap(file_data, 0x1C);
 
-    recomp_context ctx{};
-
     byteswap_copy(&rdram[text_address - 0x80000000], &file_data[text_offset], text_length);
-    byteswap_copy(&rdram[data_address - 0x80000000], &file_data[init_data_offset], data_length);
 
     // Build recompiler context.
     N64Recomp::Context context{};
@@ -263,28 +324,103 @@ TestStats run_test(const std::filesystem::path& tests_dir, const std::string& te
 
     auto after_codegen = std::chrono::system_clock::now();
 
-    auto before_execution = std::chrono::system_clock::now();
+    if (!output.good) {
+        return { TestError::FailedToRecompile };
+    }
 
-    int old_rounding = fegetround();
+    // Round trip the output through the cache format so that the loaded copy can be run as well.
+    uint64_t cache_key = N64Recomp::get_live_cache_key(context.rom, {}, generator_inputs);
+    std::vector<uint8_t> cache_data{};
+    N64Recomp::LiveGeneratorOutput cached_output{};
+    if (!N64Recomp::serialize_live_output(output, cache_key, cache_data) ||
+        !N64Recomp::deserialize_live_output(cache_data, cache_key, generator_inputs, cached_output))
+    {
+        return { TestError::FailedToLoadFromCache };
+    }
 
-    // Run the generated code.
-    ctx.r29 = 0xFFFFFFFF80000000 + rdram.size() - 0x10; // Set the stack pointer.
-    output.functions[start_func_index](rdram.data(), &ctx);
+    if (!check_corrupted_cache_data(cache_data, cache_key, output.code_size, generator_inputs)) {
+        return { TestError::AcceptedCorruptedCache };
+    }
 
-    fesetround(old_rounding);
+    // Resets the data to its initial state, runs the given function and checks the resulting data.
+    // The data is dumped to a file if it doesn't match.
+    auto run_output = [&](const char* output_name, recomp_func_t* func) {
+        byteswap_copy(&rdram[data_address - 0x80000000], &context.rom[init_data_offset], data_length);
+
+        recomp_context ctx{};
+        ctx.r29 = 0xFFFFFFFF80000000 + rdram.size() - 0x10; // Set the stack pointer.
+
+        int old_rounding = fegetround();
+        func(rdram.data(), &ctx);
+        fesetround(old_rounding);
+
+        bool good = byteswap_compare(&rdram[data_address - 0x80000000], &context.rom[good_data_offset], data_length);
+        if (!good) {
+            printf("  Data from the %s output did not match\n", output_name);
+            std::ofstream data_dump_file{ data_dump_path, std::ios::binary };
+            std::vector<uint8_t> data_swapped;
+            data_swapped.resize(data_length);
+            byteswap_copy(data_swapped.data(), &rdram[data_address - 0x80000000], data_length);
+            data_dump_file.write(reinterpret_cast<char*>(data_swapped.data()), data_length);
+        }
+        return good;
+    };
+
+    auto before_execution = std::chrono::system_clock::now();
+
+    // Run the generated code.
+    if (!run_output("generated", output.functions[start_func_index])) {
+        return { TestError::DataDifference };
+    }
 
     auto after_execution = std::chrono::system_clock::now();
 
-    // Check the result of running the code.
-    bool good = byteswap_compare(&rdram[data_address - 0x80000000], &context.rom[good_data_offset], data_length);
+    // Run the copy loaded from the cache, which has to produce the same data as the generated code.
+    if (!run_output("cached", cached_output.functions[start_func_index])) {
+        return { TestError::DataDifference };
+    }
 
-    // Dump the data if the results don't match.
-    if (!good) {
-        std::ofstream data_dump_file{ data_dump_path, std::ios::binary };
-        std::vector<uint8_t> data_swapped;
-        data_swapped.resize(data_length);
-        byteswap_copy(data_swapped.data(), &rdram[data_address - 0x80000000], data_length);
-        data_dump_file.write(reinterpret_cast<char*>(data_swapped.data()), data_length);
+    // Recompile the functions across multiple shards, which splits calls between functions across separate outputs.
+    // This has to produce the same data as recompiling them serially.
+    N64Recomp::LiveShardedOutput sharded_output{};
+    if (!N64Recomp::recompile_functions_live_parallel(context, generator_inputs, 4, dummy_static_funcs, true, sharded_output)) {
+        return { TestError::FailedToRecompile };
+    }
+
+    if (!run_output("parallel", sharded_output.functions[start_func_index])) {
+        return { TestError::DataDifference };
+    }
+
+    // Generate the code into a code arena, which relocates it into the arena's memory, and load the cached copy into the arena as well.
+    N64Recomp::LiveCodeArena code_arena{};
+    N64Recomp::LiveGeneratorInputs arena_inputs = generator_inputs;
+    arena_inputs.code_arena = &code_arena;
+
+    N64Recomp::LiveGeneratorOutput arena_output{};
+    {
+        N64Recomp::LiveGenerator arena_generator{ context.functions.size(), arena_inputs };
+        for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+            std::ostringstream dummy_ostream{};
+            if (!N64Recomp::recompile_function_live(arena_generator, context, func_index, dummy_ostream, dummy_static_funcs, true)) {
+                return { TestError::FailedToRecompile };
+            }
+        }
+        arena_output = arena_generator.finish();
+    }
+
+    N64Recomp::LiveGeneratorOutput arena_cached_output{};
+    if (!arena_output.good || !N64Recomp::deserialize_live_output(cache_data, cache_key, arena_inputs, arena_cached_output)) {
+        return { TestError::FailedToLoadFromCache };
+    }
+
+    if (code_arena.get_stats().used_bytes < arena_output.code_size + arena_cached_output.code_size) {
+        printf("  Arena outputs weren't allocated from the arena\n");
+        return { TestError::FailedToRecompile };
+    }
+
+    if (!run_output("arena", arena_output.functions[start_func_index]) ||
+        !run_output("arena cached", arena_cached_output.functions[start_func_index]))
+    {
         return { TestError::DataDifference };
     }
 
@@ -298,50 +434,346 @@ TestStats run_test(const std::filesystem::path& tests_dir, const std::string& te
     return ret;
 }
 
-int main(int argc, const char** argv) {
-    if (argc < 3) {
-        printf("Usage: %s [test directory] [test 1] ...\n", argv[0]);
-        return EXIT_SUCCESS;
+// Built-in tests place each function at a fixed stride in a single non-relocatable text section and use a separate data area.
+constexpr uint32_t builtin_text_address = 0x80010000;
+constexpr uint32_t builtin_function_stride = 0x100;
+constexpr uint32_t builtin_data_address = 0x80020000;
+constexpr uint32_t builtin_data_size = 0x100;
+
+constexpr uint32_t builtin_function_address(size_t function_index) {
+    return builtin_text_address + static_cast<uint32_t>(function_index) * builtin_function_stride;
+}
+
+int32_t builtin_section_addresses[] = { static_cast<int32_t>(builtin_text_address) };
+
+N64Recomp::LiveGeneratorInputs make_builtin_inputs() {
+    return N64Recomp::LiveGeneratorInputs {
+        .switch_error = test_switch_error,
+        .get_function = test_get_function,
+        .reference_section_addresses = nullptr,
+        .local_section_addresses = builtin_section_addresses
+    };
+}
+
+bool recompile_builtin(const N64Recomp::Context& context, const N64Recomp::LiveGeneratorInputs& inputs, N64Recomp::LiveGeneratorOutput& output_out) {
+    std::vector<std::vector<uint32_t>> dummy_static_funcs{};
+    N64Recomp::LiveGenerator generator{ context.functions.size(), inputs };
+
+    for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+        std::ostringstream dummy_ostream{};
+        if (!N64Recomp::recompile_function_live(generator, context, func_index, dummy_ostream, dummy_static_funcs, true)) {
+            return false;
+        }
     }
 
-    N64Recomp::live_recompiler_init();
+    output_out = generator.finish();
+    return output_out.good;
+}
 
-    rdram.resize(0x8000000);
+// Clears the built-in test data area and runs the given function with a fresh context.
+recomp_context run_builtin(recomp_func_t* func) {
+    memset(&rdram[builtin_data_address - 0x80000000], 0, builtin_data_size);
 
-    // Skip the first argument (program name) and second argument (test directory).
-    int count = argc - 1 - 1;
-    int passed_count = 0;
+    recomp_context ctx{};
+    ctx.r29 = 0xFFFFFFFF80000000 + rdram.size() - 0x10; // Set the stack pointer.
+    func(rdram.data(), &ctx);
+    return ctx;
+}
+
+int32_t read_builtin_data(uint32_t address) {
+    return *reinterpret_cast<int32_t*>(&rdram[address - 0x80000000]);
+}
 
-    std::vector<size_t> failed_tests{};
+// Checks that each of the given data words has the expected value.
+bool check_builtin_data(std::initializer_list<std::pair<uint32_t, int32_t>> expected) {
+    bool good = true;
+    for (const auto& [address, value] : expected) {
+        int32_t actual = read_builtin_data(address);
+        if (actual != value) {
+            printf("  Expected 0x%08X at 0x%08X, got 0x%08X\n", value, address, actual);
+            good = false;
+        }
+    }
+    return good;
+}
 
-    for (size_t test_index = 0; test_index < count; test_index++) {
-        const char* cur_test_name = argv[2 + test_index];
-        printf("Running test: %s\n", cur_test_name);
-        TestStats stats = run_test(argv[1], cur_test_name);
+// Tests a call made right after a fused lui/ori pair and a comparison fused into the branch that follows it, where the caller
+// keeps values live across the call and saves its return address in a promoted stack slot. The callee clobbers the registers
+// holding the fused values, so the caller has to see the callee's values after the call instead of anything cached from before it.
+TestError test_fusion_across_call() {
+    using namespace mips;
+    N64Recomp::Context context = make_test_context(builtin_text_address, builtin_function_stride, {
+        { "caller", {
+            addiu(sp, sp, -0x18),
+            sw(ra, 0x14, sp),
+            lui(t0, 0x8002),
+            addiu(t1, zero, 1),
+            sw(t1, 0x00, t0),
+            jal(builtin_function_address(1)),
+            addiu(t0, t0, 4),
+            // t0 and t1 hold the callee's values here.
+            sw(t1, 0x04, t0),
+            sltu(t2, t1, t0),
+            beq(t2, zero, 2),
+            nop(),
+            sw(t2, 0x08, t0),
+            lw(ra, 0x14, sp),
+            jr(ra),
+            addiu(sp, sp, 0x18),
+        } },
+        { "callee", {
+            lui(t0, 0x8002),
+            ori(t0, t0, 0x0010),
+            addiu(t1, zero, 7),
+            jr(ra),
+            sw(t1, 0x00, t0),
+        } },
+    });
+
+    N64Recomp::LiveGeneratorOutput output{};
+    if (!recompile_builtin(context, make_builtin_inputs(), output)) {
+        return TestError::FailedToRecompile;
+    }
+
+    recomp_context ctx = run_builtin(output.functions[0]);
+    bool good = check_builtin_data({
+        { 0x80020000, 1 },
+        { 0x80020004, 0 },
+        { 0x80020010, 7 },
+        { 0x80020014, 7 },
+        { 0x80020018, 1 },
+    });
+
+    if (ctx.r8 != static_cast<gpr>(static_cast<int32_t>(0x80020010)) || ctx.r9 != 7 || ctx.r10 != 1 || ctx.r29 != 0xFFFFFFFF80000000 + rdram.size() - 0x10) {
+        printf("  Registers did not match after the call\n");
+        good = false;
+    }
+
+    return good ? TestError::Success : TestError::WrongResult;
+}
+
+// Tests that reloading a function and redirecting the original output to it makes both the function's callers in the original
+// output and external callers of its entry reach the new body, including after a second reload replaces the first one.
+TestError test_reload_redirect() {
+    using namespace mips;
+    // Callee that stores the given value.
+    auto make_callee = [](int32_t value) {
+        return std::vector<uint32_t>{
+            addiu(t1, zero, value),
+            lui(t0, 0x8002),
+            jr(ra),
+            sw(t1, 0x00, t0),
+        };
+    };
+
+    N64Recomp::Context context = make_test_context(builtin_text_address, builtin_function_stride, {
+        { "caller", {
+            addiu(sp, sp, -0x18),
+            sw(ra, 0x14, sp),
+            jal(builtin_function_address(1)),
+            nop(),
+            lw(ra, 0x14, sp),
+            jr(ra),
+            addiu(sp, sp, 0x18),
+        } },
+        { "callee", make_callee(1) },
+    });
+
+    N64Recomp::LiveGeneratorInputs inputs = make_builtin_inputs();
+    inputs.hot_reloadable = true;
+
+    N64Recomp::LiveGeneratorOutput output{};
+    if (!recompile_builtin(context, inputs, output)) {
+        return TestError::FailedToRecompile;
+    }
+
+    // Runs the caller and the callee's entry, both of which should store the given value.
+    auto check_callers = [&](int32_t value) {
+        run_builtin(output.functions[0]);
+        bool good = check_builtin_data({ { 0x80020000, value } });
+        run_builtin(output.functions[1]);
+        return check_builtin_data({ { 0x80020000, value } }) && good;
+    };
+
+    if (!check_callers(1)) {
+        return TestError::WrongResult;
+    }
+
+    // Reloads the callee with a new value and redirects the original output to it.
+    auto reload_callee = [&](int32_t value, N64Recomp::LiveGeneratorOutput& reload_output) {
+        context.functions[1].words.clear();
+        for (uint32_t instr : make_callee(value)) {
+            context.functions[1].words.emplace_back(byteswap(instr));
+        }
+        return N64Recomp::recompile_function_for_reload(output.functions, context, 1, inputs, true, reload_output) &&
+            output.redirect_function(1, reload_output.functions[1]);
+    };
+
+    auto first_reload = std::make_unique<N64Recomp::LiveGeneratorOutput>();
+    if (!reload_callee(2, *first_reload)) {
+        return TestError::FailedToRecompile;
+    }
+    if (!check_callers(2)) {
+        return TestError::WrongResult;
+    }
+
+    // Reload again and free the first reload, which nothing should reach anymore.
+    N64Recomp::LiveGeneratorOutput second_reload{};
+    if (!reload_callee(3, second_reload)) {
+        return TestError::FailedToRecompile;
+    }
+    first_reload.reset();
+    if (!check_callers(3)) {
+        return TestError::WrongResult;
+    }
+
+    return TestError::Success;
+}
+
+// Tests that the lazy recompiler recompiles a function and its callee on the first call, and that calling the function's
+// stub afterwards runs the recompiled code without recompiling anything again.
+TestError test_lazy_recompile() {
+    using namespace mips;
+    N64Recomp::Context context = make_test_context(builtin_text_address, builtin_function_stride, {
+        { "caller", {
+            addiu(sp, sp, -0x18),
+            sw(ra, 0x14, sp),
+            lui(t0, 0x8002),
+            addiu(t1, zero, 1),
+            jal(builtin_function_address(1)),
+            sw(t1, 0x00, t0),
+            lw(ra, 0x14, sp),
+            jr(ra),
+            addiu(sp, sp, 0x18),
+        } },
+        { "callee", {
+            lui(t0, 0x8002),
+            addiu(t1, zero, 2),
+            jr(ra),
+            sw(t1, 0x04, t0),
+        } },
+    });
+
+    size_t link_count = 0;
+    N64Recomp::LiveLazyRecompiler lazy{ context, make_builtin_inputs(), true, [&](N64Recomp::LiveGeneratorOutput&) {
+        link_count++;
+        return true;
+    }};
+
+    recomp_func_t* stub = lazy.get_function(0);
+    if (lazy.is_recompiled(0) || lazy.is_recompiled(1)) {
+        printf("  Functions were recompiled before being called\n");
+        return TestError::WrongResult;
+    }
+
+    // Call the stub twice, where the second call goes through the stub's jump to the recompiled function.
+    for (int call = 0; call < 2; call++) {
+        run_builtin(stub);
+        if (!check_builtin_data({ { 0x80020000, 1 }, { 0x80020004, 2 } })) {
+            return TestError::WrongResult;
+        }
+    }
+
+    if (!lazy.is_recompiled(0) || !lazy.is_recompiled(1) || link_count != 2) {
+        printf("  Expected both functions to be recompiled once, got %zu recompilations\n", link_count);
+        return TestError::WrongResult;
+    }
+
+    if (lazy.get_function(0) == stub || lazy.recompile(0) != lazy.get_function(0)) {
+        printf("  Lazy recompiler didn't return the recompiled function\n");
+        return TestError::WrongResult;
+    }
 
-        switch (stats.error) {
+    return TestError::Success;
+}
+
+struct BuiltinTest {
+    const char* name;
+    TestError (*run)();
+};
+
+// Tests that are built from hand-assembled functions instead of test data files.
+const BuiltinTest builtin_tests[] = {
+    { "builtin_fusion_across_call", test_fusion_across_call },
+    { "builtin_reload_redirect", test_reload_redirect },
+    { "builtin_lazy_recompile", test_lazy_recompile },
+};
+
+// Prints the result of a test and returns whether it passed.
+bool report_test(const TestStats& stats) {
+    switch (stats.error) {
         case TestError::Success:
             printf("  Success\n");
-            printf("  Generated %" PRIu64 " bytes in %" PRIu64 " microseconds and ran in %" PRIu64 " microseconds\n",
-                stats.code_size, stats.codegen_microseconds, stats.execution_microseconds);
-            passed_count++;
-            break;
+            if (stats.code_size != 0) {
+                printf("  Generated %" PRIu64 " bytes in %" PRIu64 " microseconds and ran in %" PRIu64 " microseconds\n",
+                    stats.code_size, stats.codegen_microseconds, stats.execution_microseconds);
+            }
+            return true;
         case TestError::FailedToOpenInput:
             printf("  Failed to open input data file\n");
             break;
         case TestError::FailedToRecompile:
             printf("  Failed to recompile\n");
             break;
+        case TestError::FailedToLoadFromCache:
+            printf("  Failed to load the recompiled code from the cache format\n");
+            break;
+        case TestError::AcceptedCorruptedCache:
+            printf("  Loading corrupted cache data succeeded\n");
+            break;
         case TestError::UnknownStructType:
             printf("  Unknown additional data struct type in test data\n");
             break;
         case TestError::DataDifference:
             printf("  Output data did not match, dumped to file\n");
             break;
+        case TestError::WrongResult:
+            printf("  Output did not match the expected values\n");
+            break;
+    }
+    return false;
+}
+
+int main(int argc, const char** argv) {
+    if (argc == 2) {
+        printf("Usage: %s [test directory] [test 1] ...\n", argv[0]);
+        printf("  Runs only the built-in tests when no test directory is given\n");
+        return EXIT_SUCCESS;
+    }
+
+    N64Recomp::live_recompiler_init();
+
+    rdram.resize(0x8000000);
+
+    int count = 0;
+    int passed_count = 0;
+
+    std::vector<std::string> failed_tests{};
+
+    for (const BuiltinTest& test : builtin_tests) {
+        printf("Running test: %s\n", test.name);
+        count++;
+        if (report_test({ test.run() })) {
+            passed_count++;
+        }
+        else {
+            failed_tests.emplace_back(test.name);
         }
+        printf("\n");
+    }
 
-        if (stats.error != TestError::Success) {
-            failed_tests.emplace_back(test_index);
+    // Skip the first argument (program name) and second argument (test directory).
+    for (int arg_index = 2; arg_index < argc; arg_index++) {
+        const char* cur_test_name = argv[arg_index];
+        printf("Running test: %s\n", cur_test_name);
+        count++;
+        TestStats stats = run_test(argv[1], cur_test_name);
+
+        if (report_test(stats)) {
+            passed_count++;
+        }
+        else {
+            failed_tests.emplace_back(cur_test_name);
         }
 
         printf("\n");
@@ -351,14 +783,12 @@ int main(int argc, const char** argv) {
     if (!failed_tests.empty()) {
         printf("  Failed: ");
         for (size_t i = 0; i < failed_tests.size(); i++) {
-            size_t test_index = failed_tests[i];
-
-            printf("%s", argv[2 + test_index]);
+            printf("%s", failed_tests[i].c_str());
             if (i != failed_tests.size() - 1) {
                 printf(", ");
             }
         }
         printf("\n");
     }
-    return 0;
+    return failed_tests.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "test_context.h"
+
+// Checks the functions that recompile_function reports as called, which are used to write the prototypes in each output file's
+// header. This includes functions that are only called from a function's hooks.
+
+constexpr uint32_t text_address = 0x80000400;
+constexpr uint32_t function_stride = 0x40;
+
+int main() {
+    using namespace mips;
+    N64Recomp::Context context = make_test_context(text_address, function_stride, {
+        { "caller", { jal(text_address + 1 * function_stride), nop(), jr(ra), nop() } },
+        { "callee", { jr(ra), nop() } },
+        { "hook_target", { jr(ra), nop() } },
+        { "other_hook_target", { jr(ra), nop() } },
+        { "unrelated", { jr(ra), nop() } },
+    });
+
+    // Hooks are arbitrary C code, so names that only contain a function's name as part of a longer identifier must not match.
+    context.functions[0].function_hooks[-1] = "hook_target(rdram, ctx);";
+    context.functions[0].function_hooks[2] = "if (MEM_W(0, ctx->r4) == unrelated_value) { other_hook_target(rdram, ctx); }";
+
+    std::vector<std::vector<uint32_t>> static_funcs{};
+    static_funcs.resize(context.sections.size());
+    std::ostringstream output{};
+    std::unordered_set<std::string> called_functions{};
+    if (!N64Recomp::recompile_function(context, 0, output, static_funcs, false, &called_functions)) {
+        fmt::print(stderr, "Failed to recompile function\n");
+        return EXIT_FAILURE;
+    }
+
+    std::unordered_set<std::string> expected_functions{ "callee", "hook_target", "other_hook_target" };
+    if (called_functions != expected_functions) {
+        fmt::print(stderr, "Called functions didn't match, got:\n");
+        for (const std::string& func_name : called_functions) {
+            fmt::print(stderr, "  {}\n", func_name);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // Stubbed functions don't emit their hooks, so they don't call anything.
+    context.functions[0].stubbed = true;
+    called_functions.clear();
+    if (!N64Recomp::recompile_function(context, 0, output, static_funcs, false, &called_functions)) {
+        fmt::print(stderr, "Failed to recompile stubbed function\n");
+        return EXIT_FAILURE;
+    }
+    if (!called_functions.empty()) {
+        fmt::print(stderr, "Stubbed function reported called functions\n");
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("Called functions test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,232 @@
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+
+// Round trip test for binary context files. Loads a symbol file, converts it to a binary context file and checks that loading
+// the binary context gives the same sections, functions and relocs. Also checks that invalid binary context files are rejected.
+
+constexpr size_t rom_size = 0x4000;
+
+const char* symbol_file_text = R"(
+[[section]]
+name = ".text"
+rom = 0x00001000
+vram = 0x80000400
+size = 0x200
+relocs = [
+    { type = "R_MIPS_HI16", vram = 0x80000408, target_vram = 0x80000500 },
+    { type = "R_MIPS_LO16", vram = 0x8000040C, target_vram = 0x80000500 },
+    { type = "R_MIPS_26", vram = 0x80000414, target_vram = 0x80000440 },
+]
+functions = [
+    { name = "func_80000400", vram = 0x80000400, size = 0x40 },
+    { name = "func_80000440", vram = 0x80000440, size = 0x20 },
+    { name = "func_80000460", vram = 0x80000460, size = 0x1A0 },
+]
+
+[[section]]
+name = ".overlay"
+rom = 0x00002000
+vram = 0x80100000
+size = 0x100
+got_address = 0x80108000
+functions = [
+    { name = "overlay_func", vram = 0x80100000, size = 0x100 },
+]
+)";
+
+// A reloc as it appears in a binary context file, used to find and corrupt a reloc's type.
+struct RawReloc {
+    uint32_t vram;
+    uint32_t target_vram;
+    uint32_t type;
+};
+
+std::vector<uint8_t> make_rom() {
+    std::vector<uint8_t> rom(rom_size);
+    for (size_t i = 0; i < rom.size(); i++) {
+        rom[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+    return rom;
+}
+
+bool write_file(const std::filesystem::path& path, const void* data, size_t size) {
+    std::ofstream output_file{ path, std::ios::binary };
+    output_file.write(reinterpret_cast<const char*>(data), size);
+    return output_file.good();
+}
+
+bool contexts_match(const N64Recomp::Context& a, const N64Recomp::Context& b) {
+    if (a.sections.size() != b.sections.size()) {
+        fmt::print(stderr, "Section count differs: {} vs {}\n", a.sections.size(), b.sections.size());
+        return false;
+    }
+    for (size_t section_index = 0; section_index < a.sections.size(); section_index++) {
+        const N64Recomp::Section& section_a = a.sections[section_index];
+        const N64Recomp::Section& section_b = b.sections[section_index];
+        if (section_a.rom_addr != section_b.rom_addr || section_a.ram_addr != section_b.ram_addr || section_a.size != section_b.size ||
+            section_a.name != section_b.name || section_a.got_ram_addr != section_b.got_ram_addr ||
+            section_a.relocatable != section_b.relocatable || section_a.function_addrs != section_b.function_addrs) {
+            fmt::print(stderr, "Section {} differs\n", section_index);
+            return false;
+        }
+        if (a.section_functions[section_index] != b.section_functions[section_index]) {
+            fmt::print(stderr, "Functions in section {} differ\n", section_index);
+            return false;
+        }
+        if (section_a.relocs.size() != section_b.relocs.size()) {
+            fmt::print(stderr, "Reloc count in section {} differs: {} vs {}\n", section_index, section_a.relocs.size(), section_b.relocs.size());
+            return false;
+        }
+        for (size_t reloc_index = 0; reloc_index < section_a.relocs.size(); reloc_index++) {
+            const N64Recomp::Reloc& reloc_a = section_a.relocs[reloc_index];
+            const N64Recomp::Reloc& reloc_b = section_b.relocs[reloc_index];
+            if (reloc_a.address != reloc_b.address || reloc_a.target_section_offset != reloc_b.target_section_offset ||
+                reloc_a.symbol_index != reloc_b.symbol_index || reloc_a.target_section != reloc_b.target_section ||
+                reloc_a.type != reloc_b.type || reloc_a.reference_symbol != reloc_b.reference_symbol) {
+                fmt::print(stderr, "Reloc {} in section {} differs\n", reloc_index, section_index);
+                return false;
+            }
+        }
+    }
+
+    if (a.functions.size() != b.functions.size()) {
+        fmt::print(stderr, "Function count differs: {} vs {}\n", a.functions.size(), b.functions.size());
+        return false;
+    }
+    for (size_t function_index = 0; function_index < a.functions.size(); function_index++) {
+        const N64Recomp::Function& func_a = a.functions[function_index];
+        const N64Recomp::Function& func_b = b.functions[function_index];
+        if (func_a.name != func_b.name || func_a.vram != func_b.vram || func_a.rom != func_b.rom ||
+            func_a.section_index != func_b.section_index || func_a.words != func_b.words) {
+            fmt::print(stderr, "Function {} differs\n", func_a.name);
+            return false;
+        }
+    }
+
+    if (a.functions_by_name != b.functions_by_name || a.functions_by_vram != b.functions_by_vram || a.rom != b.rom) {
+        fmt::print(stderr, "Function lookups or rom differ\n");
+        return false;
+    }
+
+    return true;
+}
+
+int main() {
+    std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "n64recomp_context_bin_test";
+    std::filesystem::create_directories(temp_dir);
+    std::filesystem::path symbol_file_path = temp_dir / "symbols.toml";
+    std::filesystem::path bin_path = temp_dir / "symbols.bin";
+    std::filesystem::path bad_bin_path = temp_dir / "bad_symbols.bin";
+
+    if (!write_file(symbol_file_path, symbol_file_text, strlen(symbol_file_text))) {
+        fmt::print(stderr, "Failed to write {}\n", symbol_file_path.string());
+        return EXIT_FAILURE;
+    }
+
+    N64Recomp::Context toml_context{};
+    if (!N64Recomp::Context::from_symbol_file(symbol_file_path, make_rom(), toml_context, true)) {
+        fmt::print(stderr, "Failed to load symbol file\n");
+        return EXIT_FAILURE;
+    }
+
+    // Data symbols for the first section and an absolute symbol.
+    N64Recomp::DataSymbolMap data_syms{};
+    data_syms[0].emplace_back(0x80000500, "data_80000500");
+    data_syms[0].emplace_back(0x80000580, "data_80000580");
+    data_syms[N64Recomp::SectionAbsolute].emplace_back(0xA4000000, "abs_sym");
+
+    std::vector<uint8_t> context_bin = N64Recomp::context_to_bin_v1(toml_context, data_syms);
+    if (!write_file(bin_path, context_bin.data(), context_bin.size())) {
+        fmt::print(stderr, "Failed to write {}\n", bin_path.string());
+        return EXIT_FAILURE;
+    }
+
+    if (!N64Recomp::is_context_bin_file(bin_path) || N64Recomp::is_context_bin_file(symbol_file_path)) {
+        fmt::print(stderr, "Binary context file detection failed\n");
+        return EXIT_FAILURE;
+    }
+
+    // Loading through from_symbol_file picks the binary loader for the binary context file.
+    N64Recomp::Context bin_context{};
+    if (!N64Recomp::Context::from_symbol_file(bin_path, make_rom(), bin_context, true)) {
+        fmt::print(stderr, "Failed to load binary context file\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!contexts_match(toml_context, bin_context)) {
+        fmt::print(stderr, "Binary context doesn't match the symbol file\n");
+        return EXIT_FAILURE;
+    }
+
+    // Check the data symbols by reading them as reference symbols against the loaded context.
+    N64Recomp::Context ref_context{};
+    if (!ref_context.import_reference_context(bin_context) || !ref_context.read_data_reference_syms(bin_path)) {
+        fmt::print(stderr, "Failed to read data symbols from binary context file\n");
+        return EXIT_FAILURE;
+    }
+
+    for (const auto& [section_index, section_syms] : data_syms) {
+        for (const N64Recomp::DataSymbol& sym : section_syms) {
+            N64Recomp::SymbolReference ref{};
+            if (!ref_context.find_reference_symbol(sym.name, ref)) {
+                fmt::print(stderr, "Data symbol {} is missing\n", sym.name);
+                return EXIT_FAILURE;
+            }
+            const N64Recomp::ReferenceSymbol& ref_sym = ref_context.get_reference_symbol(ref);
+            if (ref_sym.section_index != section_index || ref_sym.section_offset + (section_index == N64Recomp::SectionAbsolute ? 0 : bin_context.sections[section_index].ram_addr) != sym.vram) {
+                fmt::print(stderr, "Data symbol {} differs\n", sym.name);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    // A truncated file must be rejected.
+    if (!write_file(bad_bin_path, context_bin.data(), context_bin.size() / 2)) {
+        fmt::print(stderr, "Failed to write {}\n", bad_bin_path.string());
+        return EXIT_FAILURE;
+    }
+    N64Recomp::Context bad_context{};
+    if (N64Recomp::Context::from_context_bin_file(bad_bin_path, make_rom(), bad_context, true)) {
+        fmt::print(stderr, "Truncated binary context file was accepted\n");
+        return EXIT_FAILURE;
+    }
+
+    // A reloc type that context_to_bin_v1 never emits must be rejected, so replace the R_MIPS_26 reloc's type with R_MIPS_32.
+    RawReloc reloc_26 { 0x80000414, 0x80000440, static_cast<uint32_t>(N64Recomp::RelocType::R_MIPS_26) };
+    std::vector<uint8_t> bad_bin = context_bin;
+    size_t reloc_offset = 0;
+    for (; reloc_offset + sizeof(RawReloc) <= bad_bin.size(); reloc_offset += sizeof(uint32_t)) {
+        if (memcmp(bad_bin.data() + reloc_offset, &reloc_26, sizeof(RawReloc)) == 0) {
+            break;
+        }
+    }
+    if (reloc_offset + sizeof(RawReloc) > bad_bin.size()) {
+        fmt::print(stderr, "Couldn't find the R_MIPS_26 reloc in the binary context file\n");
+        return EXIT_FAILURE;
+    }
+    uint32_t mips32_type = static_cast<uint32_t>(N64Recomp::RelocType::R_MIPS_32);
+    memcpy(bad_bin.data() + reloc_offset + offsetof(RawReloc, type), &mips32_type, sizeof(mips32_type));
+
+    if (!write_file(bad_bin_path, bad_bin.data(), bad_bin.size())) {
+        fmt::print(stderr, "Failed to write {}\n", bad_bin_path.string());
+        return EXIT_FAILURE;
+    }
+    if (N64Recomp::Context::from_context_bin_file(bad_bin_path, make_rom(), bad_context, true)) {
+        fmt::print(stderr, "Binary context file with an R_MIPS_32 reloc was accepted\n");
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::remove_all(temp_dir);
+
+    fmt::print("Context bin test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,168 @@
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "test_context.h"
+
+// Checks function deduplication with two relocatable overlays at the same address that both contain copies of the same functions,
+// the way games link a library object into several overlays. Copies whose relocs only differ in targeting their own overlay share
+// a body, while copies that call a function in their own overlay or reference different data are kept separate.
+
+constexpr uint32_t text_address = 0x80000400;
+constexpr uint32_t overlay_address = 0x80100000;
+constexpr uint32_t function_stride = 0x40;
+constexpr uint32_t overlay_size = 4 * function_stride;
+constexpr uint32_t overlay_data_offset = 0xF0;
+
+// Adds a relocatable overlay section holding the given functions at a fixed stride, along with relocs given as the function index,
+// instruction index and reloc.
+uint16_t add_overlay(N64Recomp::Context& context, const std::string& name, uint32_t rom_addr, const std::vector<TestFunction>& funcs,
+    const std::vector<std::pair<size_t, N64Recomp::Reloc>>& relocs)
+{
+    uint16_t section_index = add_test_section(context, name, rom_addr, overlay_address, overlay_size);
+    context.sections[section_index].relocatable = true;
+
+    for (size_t func_index = 0; func_index < funcs.size(); func_index++) {
+        uint32_t func_offset = static_cast<uint32_t>(func_index) * function_stride;
+        write_test_instructions(context.rom, rom_addr + func_offset, funcs[func_index].instrs);
+        add_test_function(context, funcs[func_index].name, section_index, overlay_address + func_offset,
+            static_cast<uint32_t>(funcs[func_index].instrs.size() * sizeof(uint32_t)));
+    }
+
+    for (const auto& [func_index, reloc] : relocs) {
+        N64Recomp::Reloc& added = context.sections[section_index].relocs.emplace_back(reloc);
+        added.address += overlay_address + static_cast<uint32_t>(func_index) * function_stride;
+    }
+    return section_index;
+}
+
+N64Recomp::Reloc make_reloc(uint32_t instr_index, N64Recomp::RelocType type, uint16_t target_section, uint32_t target_section_offset) {
+    return N64Recomp::Reloc{
+        .address = instr_index * static_cast<uint32_t>(sizeof(uint32_t)),
+        .target_section_offset = target_section_offset,
+        .symbol_index = 0,
+        .target_section = target_section,
+        .type = type,
+        .reference_symbol = false
+    };
+}
+
+bool check_contains(const std::string& text, const std::string& snippet, const std::string& description) {
+    if (text.find(snippet) == std::string::npos) {
+        fmt::print(stderr, "{} is missing \"{}\":\n{}\n", description, snippet, text);
+        return false;
+    }
+    return true;
+}
+
+int main() {
+    using namespace mips;
+    N64Recomp::Context context = make_test_context(text_address, function_stride, {
+        { "helper", { jr(ra), nop() } },
+    });
+    context.rom.resize(context.rom.size() + 2 * overlay_size);
+
+    // Loads the address of the overlay's data and calls the helper in the main section.
+    std::vector<uint32_t> load_data_and_call = { addiu(sp, sp, -0x18), sw(ra, 0x14, sp), lui(a0, 0), addiu(a0, a0, 0), jal(text_address), nop(), lw(ra, 0x14, sp), jr(ra), addiu(sp, sp, 0x18) };
+    // Calls the first function in the overlay.
+    std::vector<uint32_t> call_overlay = { addiu(sp, sp, -0x18), sw(ra, 0x14, sp), jal(overlay_address), nop(), lw(ra, 0x14, sp), jr(ra), addiu(sp, sp, 0x18) };
+    // Doesn't reference anything.
+    std::vector<uint32_t> add_args = { jr(ra), addu(v0, a0, a1) };
+    // Loads a word from the overlay's data.
+    std::vector<uint32_t> load_word = { lui(v0, 0), jr(ra), lw(v0, 0, v0) };
+
+    // Relocs against each overlay's own section, as the copies in the two overlays would have.
+    auto own_section_relocs = [](uint16_t section_index, uint32_t load_word_offset) {
+        return std::vector<std::pair<size_t, N64Recomp::Reloc>>{
+            { 0, make_reloc(2, N64Recomp::RelocType::R_MIPS_HI16, section_index, overlay_data_offset) },
+            { 0, make_reloc(3, N64Recomp::RelocType::R_MIPS_LO16, section_index, overlay_data_offset) },
+            { 1, make_reloc(2, N64Recomp::RelocType::R_MIPS_26, section_index, 0) },
+            { 3, make_reloc(0, N64Recomp::RelocType::R_MIPS_HI16, section_index, load_word_offset) },
+            { 3, make_reloc(2, N64Recomp::RelocType::R_MIPS_LO16, section_index, load_word_offset) },
+        };
+    };
+
+    uint16_t section_a = static_cast<uint16_t>(context.sections.size());
+    add_overlay(context, "ovl_a", function_stride, {
+        { "ovl_a_load_data_and_call", load_data_and_call },
+        { "ovl_a_call_overlay", call_overlay },
+        { "ovl_a_add_args", add_args },
+        { "ovl_a_load_word", load_word },
+    }, own_section_relocs(section_a, overlay_data_offset));
+
+    uint16_t section_b = static_cast<uint16_t>(context.sections.size());
+    add_overlay(context, "ovl_b", function_stride + overlay_size, {
+        { "ovl_b_load_data_and_call", load_data_and_call },
+        { "ovl_b_call_overlay", call_overlay },
+        { "ovl_b_add_args", add_args },
+        { "ovl_b_load_word", load_word },
+    }, own_section_relocs(section_b, overlay_data_offset + 4));
+
+    context.compute_function_reloc_spans();
+
+    auto func_index = [&context](const std::string& name) {
+        return context.functions_by_name.at(name);
+    };
+
+    // The call to the other overlay's function resolves to a different function in each overlay, and the word loads use different offsets.
+    std::unordered_map<size_t, size_t> duplicates = N64Recomp::find_duplicate_functions(context);
+    std::unordered_map<size_t, size_t> expected_duplicates{
+        { func_index("ovl_b_load_data_and_call"), func_index("ovl_a_load_data_and_call") },
+        { func_index("ovl_b_add_args"), func_index("ovl_a_add_args") },
+    };
+    if (duplicates != expected_duplicates) {
+        fmt::print(stderr, "Duplicate functions didn't match, got:\n");
+        for (const auto& [duplicate_index, original_index] : duplicates) {
+            fmt::print(stderr, "  {} -> {}\n", context.functions[duplicate_index].name, context.functions[original_index].name);
+        }
+        return EXIT_FAILURE;
+    }
+
+    // Only the function that references its overlay's data needs a body that takes the section.
+    if (!N64Recomp::function_uses_own_section(context, func_index("ovl_a_load_data_and_call")) ||
+        N64Recomp::function_uses_own_section(context, func_index("ovl_a_add_args")))
+    {
+        fmt::print(stderr, "Incorrect own section usage\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::vector<uint32_t>> static_funcs{};
+    static_funcs.resize(context.sections.size());
+
+    // The shared body uses the section it's called with for the relocs against its own section.
+    std::ostringstream shared_output{};
+    if (!N64Recomp::recompile_shared_function_body(context, func_index("ovl_a_load_data_and_call"), shared_output, static_funcs, false)) {
+        fmt::print(stderr, "Failed to recompile shared body\n");
+        return EXIT_FAILURE;
+    }
+    std::string shared_text = shared_output.str();
+    bool good =
+        check_contains(shared_text, "RECOMP_FUNC void ovl_a_load_data_and_call_shared(uint8_t* rdram, recomp_context* ctx, uint16_t self_section) {", "Shared body") &&
+        check_contains(shared_text, fmt::format("RELOC_HI16(self_section, {:#X})", overlay_data_offset), "Shared body") &&
+        check_contains(shared_text, fmt::format("RELOC_LO16(self_section, {:#X})", overlay_data_offset), "Shared body") &&
+        check_contains(shared_text, "helper(rdram, ctx);", "Shared body");
+    if (!good) {
+        return EXIT_FAILURE;
+    }
+
+    // Recompiling the function normally still uses its own section.
+    std::ostringstream normal_output{};
+    if (!N64Recomp::recompile_function(context, func_index("ovl_a_load_data_and_call"), normal_output, static_funcs, false)) {
+        fmt::print(stderr, "Failed to recompile function\n");
+        return EXIT_FAILURE;
+    }
+    std::string normal_text = normal_output.str();
+    if (!check_contains(normal_text, fmt::format("RELOC_HI16({}, {:#X})", section_a, overlay_data_offset), "Function") ||
+        normal_text.find("self_section") != std::string::npos)
+    {
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("Deduplication test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,89 @@
+#include <cstdlib>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "test_context.h"
+
+// Checks function discovery on hand-assembled code. Covers calls from known functions, functions found by their prologues and
+// calls to an address that's shared by two overlays.
+
+// Checks that a function with the given address and size was discovered in the given section.
+bool check_function(const N64Recomp::Context& context, uint16_t section_index, uint32_t vram, uint32_t size) {
+    for (const N64Recomp::Function& func : context.functions) {
+        if (func.section_index == section_index && func.vram == vram) {
+            uint32_t func_size = func.words.size() * sizeof(func.words[0]);
+            if (func_size != size) {
+                fmt::print(stderr, "Function {} has size 0x{:X}, expected 0x{:X}\n", func.name, func_size, size);
+                return false;
+            }
+            return true;
+        }
+    }
+    fmt::print(stderr, "No function found at 0x{:08X} in section {}\n", vram, section_index);
+    return false;
+}
+
+int main() {
+    using namespace mips;
+    N64Recomp::Context context{};
+    context.rom.resize(0x300);
+
+    // Main code, where the known function calls one function in reachable code and one in code after its first return.
+    // A third function is only found by its prologue.
+    uint16_t text_index = add_test_section(context, ".text", 0x0, 0x80000400, 0x200);
+    write_test_instructions(context.rom, 0x00, { jal(0x80000440), nop(), jr(ra), nop(), jal(0x80000480), nop(), jr(ra), nop() });
+    write_test_instructions(context.rom, 0x40, { jr(ra), nop() });
+    write_test_instructions(context.rom, 0x80, { jr(ra), nop() });
+    write_test_instructions(context.rom, 0xC0, { addiu(sp, sp, -0x18), jr(ra), addiu(sp, sp, 0x18) });
+    add_test_function(context, "known_func", text_index, 0x80000400, 0x20);
+
+    // Two overlays at the same address, each of which calls a function at the same address in its own overlay.
+    uint16_t ovl1_index = add_test_section(context, ".ovl1", 0x200, 0x80100000, 0x40);
+    uint16_t ovl2_index = add_test_section(context, ".ovl2", 0x240, 0x80100000, 0x40);
+    write_test_instructions(context.rom, 0x200, { jal(0x80100020), nop(), jr(ra), nop() });
+    write_test_instructions(context.rom, 0x220, { jr(ra), nop() });
+    write_test_instructions(context.rom, 0x240, { jal(0x80100020), nop(), jr(ra), nop() });
+    write_test_instructions(context.rom, 0x260, { addiu(v0, zero, 1), jr(ra), nop() });
+    add_test_function(context, "ovl1_func", ovl1_index, 0x80100000, 0x10);
+    add_test_function(context, "ovl2_func", ovl2_index, 0x80100000, 0x10);
+
+    if (!context.discover_functions(std::nullopt)) {
+        fmt::print(stderr, "Function discovery failed\n");
+        return EXIT_FAILURE;
+    }
+
+    bool good =
+        // Known functions keep their sizes.
+        check_function(context, text_index, 0x80000400, 0x20) &&
+        check_function(context, text_index, 0x80000440, 0x08) &&
+        // Only reachable by scanning the whole known function instead of tracing it.
+        check_function(context, text_index, 0x80000480, 0x08) &&
+        // Found by its prologue.
+        check_function(context, text_index, 0x800004C0, 0x0C) &&
+        check_function(context, ovl1_index, 0x80100020, 0x08) &&
+        check_function(context, ovl2_index, 0x80100020, 0x0C);
+
+    if (!good) {
+        return EXIT_FAILURE;
+    }
+
+    if (context.functions.size() != 8) {
+        fmt::print(stderr, "Expected 8 functions, found {}\n", context.functions.size());
+        return EXIT_FAILURE;
+    }
+
+    std::unordered_set<std::string> names{};
+    for (const N64Recomp::Function& func : context.functions) {
+        if (!names.insert(func.name).second || context.functions_by_name.at(func.name) != static_cast<size_t>(&func - context.functions.data())) {
+            fmt::print(stderr, "Function name {} isn't unique\n", func.name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fmt::print("Discovery test passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "recompiler/generator.h"
+#include "test_context.h"
+
+// Writes an LLVM IR module for hand-assembled functions covering calls, a conditional branch, loads, stores and the stack frame,
+// and checks that each function contains the expected instructions. The module is written along with a driver module whose main
+// runs the functions and checks their results, so that the build can assemble, link and run them with the LLVM tools.
+
+constexpr uint32_t text_address = 0x80000400;
+constexpr uint32_t function_stride = 0x40;
+
+constexpr uint32_t func_address(size_t func_index) {
+    return text_address + static_cast<uint32_t>(func_index) * function_stride;
+}
+
+bool write_file(const char* path, std::string_view text) {
+    std::ofstream output_file{ path };
+    output_file << text;
+    if (!output_file.good()) {
+        fmt::print(stderr, "Failed to write {}\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Provides the ignored function that the generated module only declares, and runs the generated functions on a small rdram.
+// Returns the number of the first failed check, or 0 if every check passed.
+const char* driver_text = R"(%recomp_context = type { [32 x i64], [32 x i64], i64, i64, ptr, i32, i8 }
+
+declare void @"caller"(ptr, ptr)
+
+define void @"external"(ptr %rdram, ptr %ctx) {
+    %v1 = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 3
+    store i64 4660, ptr %v1
+    ret void
+}
+
+define i32 @main() {
+entry:
+    %rdram = alloca [512 x i8], align 8
+    %ctx = alloca %recomp_context, align 8
+    %a0 = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 4
+    %a1 = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 5
+    %v0 = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 2
+    %v1 = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 3
+    %sp = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 29
+    %ra = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 31
+    %word_10 = getelementptr inbounds i8, ptr %rdram, i64 16
+    %word_14 = getelementptr inbounds i8, ptr %rdram, i64 20
+
+    ; a0 points to 0x80000010, so the callee copies the word there to 0x80000014.
+    store i32 43981, ptr %word_10
+    store i32 0, ptr %word_14
+    store i64 -2147483632, ptr %a0
+    store i64 5, ptr %a1
+    store i64 0, ptr %v1
+    store i64 -2147483392, ptr %sp
+    store i64 0, ptr %ra
+    call void @"caller"(ptr %rdram, ptr %ctx)
+
+    %copied = load i32, ptr %word_14
+    %copied_good = icmp eq i32 %copied, 43981
+    br i1 %copied_good, label %check_sum, label %fail_1
+check_sum:
+    %sum = load i64, ptr %v0
+    %sum_good = icmp eq i64 %sum, -2147483627
+    br i1 %sum_good, label %check_external, label %fail_2
+check_external:
+    %external_result = load i64, ptr %v1
+    %external_good = icmp eq i64 %external_result, 4660
+    br i1 %external_good, label %check_sp, label %fail_3
+check_sp:
+    %sp_value = load i64, ptr %sp
+    %sp_good = icmp eq i64 %sp_value, -2147483392
+    br i1 %sp_good, label %run_zero, label %fail_4
+
+    ; A null a0 takes the branch, which skips the copy.
+run_zero:
+    store i32 0, ptr %word_14
+    store i64 0, ptr %a0
+    call void @"caller"(ptr %rdram, ptr %ctx)
+    %skipped = load i32, ptr %word_14
+    %skipped_good = icmp eq i32 %skipped, 0
+    br i1 %skipped_good, label %check_zero_sum, label %fail_5
+check_zero_sum:
+    %zero_sum = load i64, ptr %v0
+    %zero_sum_good = icmp eq i64 %zero_sum, 5
+    br i1 %zero_sum_good, label %pass, label %fail_6
+
+pass:
+    ret i32 0
+fail_1:
+    ret i32 1
+fail_2:
+    ret i32 2
+fail_3:
+    ret i32 3
+fail_4:
+    ret i32 4
+fail_5:
+    ret i32 5
+fail_6:
+    ret i32 6
+}
+)";
+
+// Checks that the given function in the module contains each of the given snippets in order.
+bool check_function_text(const std::string& module_text, const std::string& func_name, const std::vector<std::string>& snippets) {
+    size_t func_start = module_text.find(fmt::format("define void @\"{}\"", func_name));
+    if (func_start == std::string::npos) {
+        fmt::print(stderr, "Function {} isn't defined in the module\n", func_name);
+        return false;
+    }
+    size_t func_end = module_text.find("\n}\n", func_start);
+    std::string_view func_text = std::string_view{ module_text }.substr(func_start, func_end - func_start);
+
+    size_t pos = 0;
+    for (const std::string& snippet : snippets) {
+        pos = func_text.find(snippet, pos);
+        if (pos == std::string::npos) {
+            fmt::print(stderr, "Function {} is missing \"{}\"\n", func_name, snippet);
+            return false;
+        }
+        pos += snippet.size();
+    }
+    return true;
+}
+
+int main(int argc, const char** argv) {
+    if (argc != 3) {
+        fmt::print("Usage: {} <module output file> <driver output file>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    using namespace mips;
+    N64Recomp::Context context = make_test_context(text_address, function_stride, {
+        { "caller", { addiu(sp, sp, -0x18), sw(ra, 0x14, sp), jal(func_address(1)), nop(), jal(func_address(2)), nop(), lw(ra, 0x14, sp), jr(ra), addiu(sp, sp, 0x18) } },
+        { "callee", { beq(a0, zero, 3), nop(), lw(v0, 0, a0), sw(v0, 4, a0), addu(v0, a0, a1), jr(ra), nop() } },
+        { "external", { jr(ra), nop() } },
+    });
+
+    // Ignored functions aren't defined in the module, so calls to them must be declared at the end of it.
+    context.functions[2].ignored = true;
+
+    std::ostringstream module_stream{};
+    N64Recomp::LLVMGenerator generator{ module_stream };
+    generator.emit_module_start();
+
+    std::vector<std::vector<uint32_t>> static_funcs{};
+    static_funcs.resize(context.sections.size());
+    for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+        if (context.functions[func_index].ignored) {
+            continue;
+        }
+        std::ostringstream scratch_stream{};
+        if (!N64Recomp::recompile_function_custom(generator, context, func_index, scratch_stream, static_funcs, false)) {
+            fmt::print(stderr, "Failed to recompile {}\n", context.functions[func_index].name);
+            return EXIT_FAILURE;
+        }
+    }
+
+    generator.emit_module_end();
+    std::string module_text = module_stream.str();
+
+    bool good =
+        // The stack frame is adjusted and the return address is saved before both calls, then restored after them.
+        check_function_text(module_text, "caller", {
+            "add i64", "-24",
+            "store i32",
+            "call void @\"callee\"(ptr %rdram, ptr %ctx)",
+            "call void @\"external\"(ptr %rdram, ptr %ctx)",
+            "load i32",
+            "add i64", "24",
+            "ret void" }) &&
+        // The branch on a0 skips the load and store into the addition.
+        check_function_text(module_text, "callee", {
+            "icmp eq i64", "br i1", "label %L_80000450",
+            "add i64", "2147483648", "load i32", "align 4", "sext i32",
+            "add i64", "2147483648", "store i32", "align 4",
+            "L_80000450:",
+            "add i64", "trunc i64", "sext i32",
+            "ret void" });
+
+    if (!good) {
+        return EXIT_FAILURE;
+    }
+
+    if (module_text.find("define void @\"external\"") != std::string::npos || module_text.find("declare void @\"external\"(ptr, ptr)") == std::string::npos) {
+        fmt::print(stderr, "The ignored function should only be declared\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!write_file(argv[1], module_text) || !write_file(argv[2], driver_text)) {
+        return EXIT_FAILURE;
+    }
+
+    fmt::print("LLVM IR test passed\n");
+    return EXIT_SUCCESS;
+}
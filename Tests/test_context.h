@@ -0,0 +1,130 @@
+#ifndef __TEST_CONTEXT_H__
+#define __TEST_CONTEXT_H__
+
+#include <cassert>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "recompiler/context.h"
+
+// Helpers shared by the tests and benchmarks for building recompiler contexts out of hand-assembled MIPS code.
+
+// Encoders for the MIPS instructions used by the tests and benchmarks. Instructions are returned in host order.
+namespace mips {
+    constexpr uint32_t zero = 0, at = 1, v0 = 2, v1 = 3, a0 = 4, a1 = 5, a2 = 6, a3 = 7;
+    constexpr uint32_t t0 = 8, t1 = 9, t2 = 10, t3 = 11, s0 = 16, sp = 29, ra = 31;
+
+    constexpr uint32_t fmt_s = 0x10;
+    constexpr uint32_t fmt_d = 0x11;
+    constexpr uint32_t fmt_w = 0x14;
+
+    constexpr uint32_t i_type(uint32_t op, uint32_t rs, uint32_t rt, int32_t imm) {
+        return (op << 26) | (rs << 21) | (rt << 16) | (static_cast<uint32_t>(imm) & 0xFFFF);
+    }
+    constexpr uint32_t r_type(uint32_t funct, uint32_t rs, uint32_t rt, uint32_t rd, uint32_t sa = 0) {
+        return (rs << 21) | (rt << 16) | (rd << 11) | (sa << 6) | funct;
+    }
+    constexpr uint32_t cop1(uint32_t fmt, uint32_t ft, uint32_t fs, uint32_t fd, uint32_t funct) {
+        return (0x11u << 26) | (fmt << 21) | (ft << 16) | (fs << 11) | (fd << 6) | funct;
+    }
+
+    constexpr uint32_t nop() { return 0; }
+    constexpr uint32_t sll(uint32_t rd, uint32_t rt, uint32_t sa) { return r_type(0x00, 0, rt, rd, sa); }
+    constexpr uint32_t srl(uint32_t rd, uint32_t rt, uint32_t sa) { return r_type(0x02, 0, rt, rd, sa); }
+    constexpr uint32_t jr(uint32_t rs) { return r_type(0x08, rs, 0, 0); }
+    constexpr uint32_t addu(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x21, rs, rt, rd); }
+    constexpr uint32_t subu(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x23, rs, rt, rd); }
+    constexpr uint32_t and_(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x24, rs, rt, rd); }
+    constexpr uint32_t or_(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x25, rs, rt, rd); }
+    constexpr uint32_t xor_(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x26, rs, rt, rd); }
+    constexpr uint32_t slt(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x2A, rs, rt, rd); }
+    constexpr uint32_t sltu(uint32_t rd, uint32_t rs, uint32_t rt) { return r_type(0x2B, rs, rt, rd); }
+    constexpr uint32_t addiu(uint32_t rt, uint32_t rs, int32_t imm) { return i_type(0x09, rs, rt, imm); }
+    constexpr uint32_t andi(uint32_t rt, uint32_t rs, uint32_t imm) { return i_type(0x0C, rs, rt, static_cast<int32_t>(imm)); }
+    constexpr uint32_t ori(uint32_t rt, uint32_t rs, uint32_t imm) { return i_type(0x0D, rs, rt, static_cast<int32_t>(imm)); }
+    constexpr uint32_t lui(uint32_t rt, uint32_t imm) { return i_type(0x0F, 0, rt, static_cast<int32_t>(imm)); }
+    constexpr uint32_t lh(uint32_t rt, int32_t offset, uint32_t base) { return i_type(0x21, base, rt, offset); }
+    constexpr uint32_t lw(uint32_t rt, int32_t offset, uint32_t base) { return i_type(0x23, base, rt, offset); }
+    constexpr uint32_t sb(uint32_t rt, int32_t offset, uint32_t base) { return i_type(0x28, base, rt, offset); }
+    constexpr uint32_t sw(uint32_t rt, int32_t offset, uint32_t base) { return i_type(0x2B, base, rt, offset); }
+    constexpr uint32_t swc1(uint32_t ft, int32_t offset, uint32_t base) { return i_type(0x39, base, ft, offset); }
+    constexpr uint32_t sdc1(uint32_t ft, int32_t offset, uint32_t base) { return i_type(0x3D, base, ft, offset); }
+    // Branch offsets are in instructions relative to the delay slot.
+    constexpr uint32_t beq(uint32_t rs, uint32_t rt, int32_t offset = 0) { return i_type(0x04, rs, rt, offset); }
+    constexpr uint32_t bne(uint32_t rs, uint32_t rt, int32_t offset = 0) { return i_type(0x05, rs, rt, offset); }
+    constexpr uint32_t bgtz(uint32_t rs, int32_t offset = 0) { return i_type(0x07, rs, 0, offset); }
+    constexpr uint32_t bltz(uint32_t rs, int32_t offset = 0) { return i_type(0x01, rs, 0, offset); }
+    constexpr uint32_t jal(uint32_t target) { return (0x03 << 26) | ((target >> 2) & 0x3FFFFFF); }
+    constexpr uint32_t mtc1(uint32_t rt, uint32_t fs) { return (0x11u << 26) | (0x04u << 21) | (rt << 16) | (fs << 11); }
+    constexpr uint32_t add_fmt(uint32_t fmt, uint32_t fd, uint32_t fs, uint32_t ft) { return cop1(fmt, ft, fs, fd, 0x00); }
+    constexpr uint32_t div_fmt(uint32_t fmt, uint32_t fd, uint32_t fs, uint32_t ft) { return cop1(fmt, ft, fs, fd, 0x03); }
+    constexpr uint32_t cvt_s(uint32_t fmt, uint32_t fd, uint32_t fs) { return cop1(fmt, 0, fs, fd, 0x20); }
+    constexpr uint32_t cvt_d(uint32_t fmt, uint32_t fd, uint32_t fs) { return cop1(fmt, 0, fs, fd, 0x21); }
+}
+
+// A function for make_test_context, with its instructions in host order.
+struct TestFunction {
+    std::string name;
+    std::vector<uint32_t> instrs;
+};
+
+// Writes instructions given in host order into the rom at the given offset in the rom's byte order.
+inline void write_test_instructions(std::vector<uint8_t>& rom, uint32_t rom_addr, const std::vector<uint32_t>& instrs) {
+    for (uint32_t instr : instrs) {
+        uint32_t word = byteswap(instr);
+        memcpy(&rom[rom_addr], &word, sizeof(word));
+        rom_addr += sizeof(word);
+    }
+}
+
+// Adds an executable, non-relocatable section. The section's contents must already be in the rom.
+inline uint16_t add_test_section(N64Recomp::Context& context, const std::string& name, uint32_t rom_addr, uint32_t vram, uint32_t size) {
+    uint16_t section_index = static_cast<uint16_t>(context.sections.size());
+    N64Recomp::Section& section = context.sections.emplace_back();
+    section.name = name;
+    section.rom_addr = rom_addr;
+    section.ram_addr = vram;
+    section.size = size;
+    section.executable = true;
+    section.relocatable = false;
+    context.section_functions.emplace_back();
+    return section_index;
+}
+
+// Adds a function to the given section, which reads its words from the rom.
+inline size_t add_test_function(N64Recomp::Context& context, const std::string& name, uint16_t section_index, uint32_t vram, uint32_t size) {
+    N64Recomp::Section& section = context.sections[section_index];
+    uint32_t rom_addr = section.rom_addr + vram - section.ram_addr;
+    std::vector<uint32_t> words(size / sizeof(uint32_t));
+    memcpy(words.data(), &context.rom[rom_addr], size);
+
+    size_t function_index = context.functions.size();
+    context.functions.emplace_back(vram, rom_addr, std::move(words), name, section_index);
+    context.functions_by_name[name] = function_index;
+    context.functions_by_vram[vram].push_back(function_index);
+    context.section_functions[section_index].push_back(function_index);
+    section.function_addrs.push_back(vram);
+    return function_index;
+}
+
+// Builds a context with a single ".text" section at the given address, with each function placed at a fixed stride.
+inline N64Recomp::Context make_test_context(uint32_t text_address, uint32_t function_stride, const std::vector<TestFunction>& funcs) {
+    N64Recomp::Context context{};
+    context.rom.resize(funcs.size() * function_stride);
+    uint16_t section_index = add_test_section(context, ".text", 0, text_address, static_cast<uint32_t>(context.rom.size()));
+
+    for (size_t func_index = 0; func_index < funcs.size(); func_index++) {
+        const TestFunction& func = funcs[func_index];
+        uint32_t func_size = static_cast<uint32_t>(func.instrs.size() * sizeof(uint32_t));
+        uint32_t func_offset = static_cast<uint32_t>(func_index) * function_stride;
+        assert(func_size <= function_stride);
+        write_test_instructions(context.rom, func_offset, func.instrs);
+        add_test_function(context, func.name, section_index, text_address + func_offset, func_size);
+    }
+
+    return context;
+}
+
+#endif
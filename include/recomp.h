@@ -3,6 +3,7 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include <fenv.h>
 #include <assert.h>
@@ -107,12 +108,7 @@ typedef uint64_t gpr;
 #define MEM_BU(offset, reg) \
     (*(uint8_t*)(rdram + ((((reg) + (offset)) ^ 3) - 0xFFFFFFFF80000000)))
 
-#define SD(val, offset, reg) { \
-    *(uint32_t*)(rdram + ((((reg) + (offset) + 4)) - 0xFFFFFFFF80000000)) = (uint32_t)((gpr)(val) >> 0); \
-    *(uint32_t*)(rdram + ((((reg) + (offset) + 0)) - 0xFFFFFFFF80000000)) = (uint32_t)((gpr)(val) >> 32); \
-}
-
-static inline uint64_t load_doubleword(uint8_t* rdram, gpr reg, gpr offset) {
+static inline uint64_t load_doubleword_split(uint8_t* rdram, gpr reg, gpr offset) {
     uint64_t ret = 0;
     uint64_t lo = (uint64_t)(uint32_t)MEM_W(reg, offset + 4);
     uint64_t hi = (uint64_t)(uint32_t)MEM_W(reg, offset + 0);
@@ -120,6 +116,51 @@ static inline uint64_t load_doubleword(uint8_t* rdram, gpr reg, gpr offset) {
     return ret;
 }
 
+static inline void store_doubleword_split(uint8_t* rdram, gpr reg, gpr offset, uint64_t val) {
+    MEM_W(reg, offset + 4) = (uint32_t)(val >> 0);
+    MEM_W(reg, offset + 0) = (uint32_t)(val >> 32);
+}
+
+// The doubleword accesses of the unaligned load and store helpers are done as a single host access by default. Rdram is stored as
+// native-endian words, so the two words of a doubleword are swapped relative to a host doubleword, which is fixed up with a 32-bit
+// rotate after loading or before storing. The access goes through memcpy so that it doesn't alias rdram as a uint64_t.
+// Define RECOMP_SPLIT_64BIT_ACCESS to perform them as two separate word accesses instead.
+#ifndef RECOMP_SPLIT_64BIT_ACCESS
+
+static inline uint64_t swap_doubleword_words(uint64_t val) {
+    // Compilers recognize this as a rotate.
+    return (val << 32) | (val >> 32);
+}
+
+static inline uint64_t load_doubleword(uint8_t* rdram, gpr reg, gpr offset) {
+    uint64_t ret;
+    memcpy(&ret, rdram + ((reg + offset) - 0xFFFFFFFF80000000), sizeof(ret));
+    return swap_doubleword_words(ret);
+}
+
+static inline void store_doubleword(uint8_t* rdram, gpr reg, gpr offset, uint64_t val) {
+    val = swap_doubleword_words(val);
+    memcpy(rdram + ((reg + offset) - 0xFFFFFFFF80000000), &val, sizeof(val));
+}
+
+#else
+
+static inline uint64_t load_doubleword(uint8_t* rdram, gpr reg, gpr offset) {
+    return load_doubleword_split(rdram, reg, offset);
+}
+
+static inline void store_doubleword(uint8_t* rdram, gpr reg, gpr offset, uint64_t val) {
+    store_doubleword_split(rdram, reg, offset, val);
+}
+
+#endif
+
+// Aligned doubleword stores keep the split accesses, as a single host access wasn't consistently faster for them in
+// Benchmarks/memory_access_benchmark.cpp (x86-64, GCC -O2): SD measured 0.74x to 1.06x across runs. Aligned doubleword loads use
+// the single access, which measured 1.02x to 1.20x for LD, and the unaligned helpers above measured 1.0x to 1.24x.
+#define SD(val, offset, reg) \
+    store_doubleword_split(rdram, offset, reg, (gpr)(val))
+
 #define LD(offset, reg) \
     load_doubleword(rdram, offset, reg)
 
@@ -232,12 +273,7 @@ static inline void do_sdl(uint8_t* rdram, gpr offset, gpr reg, gpr val) {
     uint64_t masked_initial_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu >> (misalignment * 8));
     uint64_t shifted_input_value = val >> (misalignment * 8);
 
-    uint64_t ret = masked_initial_value | shifted_input_value;
-    uint32_t lo = (uint32_t)ret;
-    uint32_t hi = (uint32_t)(ret >> 32);
-
-    MEM_W(0, dword_address + 4) = lo;
-    MEM_W(0, dword_address + 0) = hi;
+    store_doubleword(rdram, 0, dword_address, masked_initial_value | shifted_input_value);
 }
 
 static inline void do_sdr(uint8_t* rdram, gpr offset, gpr reg, gpr val) {
@@ -253,12 +289,7 @@ static inline void do_sdr(uint8_t* rdram, gpr offset, gpr reg, gpr val) {
     uint64_t masked_initial_value = initial_value & ~(0xFFFFFFFFFFFFFFFFu << (56 - misalignment * 8));
     uint64_t shifted_input_value = val << (56 - misalignment * 8);
     
-    uint64_t ret = masked_initial_value | shifted_input_value;
-    uint32_t lo = (uint32_t)ret;
-    uint32_t hi = (uint32_t)(ret >> 32);
-
-    MEM_W(0, dword_address + 4) = lo;
-    MEM_W(0, dword_address + 0) = hi;
+    store_doubleword(rdram, 0, dword_address, masked_initial_value | shifted_input_value);
 }
 
 static inline uint32_t get_cop1_cs() {
@@ -1,6 +1,8 @@
 #ifndef __RECOMP_PORT__
 #define __RECOMP_PORT__
 
+#include <algorithm>
+#include <cassert>
 #include <span>
 #include <string_view>
 #include <cstdint>
@@ -48,11 +50,21 @@ namespace N64Recomp {
         uint16_t section_index;
         std::optional<uint32_t> got_offset;
         std::vector<uint32_t> entries;
+        // Exclusive upper bound on the entry index, taken from the range check guarding the jump if one was found.
+        std::optional<uint32_t> entry_bound;
 
         JumpTable(uint32_t vram, uint32_t addend_reg, uint32_t rom, uint32_t lw_vram, uint32_t addu_vram, uint32_t jr_vram, uint16_t section_index, std::optional<uint32_t> got_offset, std::vector<uint32_t>&& entries)
                 : vram(vram), addend_reg(addend_reg), rom(rom), lw_vram(lw_vram), addu_vram(addu_vram), jr_vram(jr_vram), section_index(section_index), got_offset(got_offset), entries(std::move(entries)) {}
     };
 
+    // A slot in the stack frame of a function whose frame never escapes, which is held in a local instead of memory.
+    struct StackSlot {
+        // Offset of the slot from $sp after the function's prologue.
+        int32_t offset;
+        // Whether the slot is accessed with ld/sd instead of lw/sw.
+        bool doubleword;
+    };
+
     enum class RelocType : uint8_t {
         R_MIPS_NONE = 0,
         R_MIPS_16,
@@ -73,6 +85,12 @@ namespace N64Recomp {
         bool reference_symbol;
     };
 
+    // A range of indices into a section's relocs.
+    struct RelocSpan {
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
     // Special section indices.
     constexpr uint16_t SectionAbsolute = (uint16_t)-2;
     constexpr uint16_t SectionImport = (uint16_t)-3; // Imported symbols for mods
@@ -142,6 +160,8 @@ namespace N64Recomp {
         bool unpaired_lo16_warnings;
         bool all_sections_relocatable;
         bool use_mdebug;
+        // Number of threads to use for decoding symbols and reading relocations, or 0 to use one per hardware thread.
+        size_t thread_count = 0;
     };
     
     struct DataSymbol {
@@ -226,6 +246,8 @@ namespace N64Recomp {
         std::vector<std::vector<size_t>> section_functions;
         // A mapping of vram address to every function with that address.
         std::unordered_map<uint32_t, std::vector<size_t>> functions_by_vram;
+        // The range of each function's relocs within its section's relocs, indexed by function. Populated by compute_function_reloc_spans.
+        std::vector<RelocSpan> function_reloc_spans;
         // A mapping of bss section index to the corresponding non-bss section index.
         std::unordered_map<uint16_t, uint16_t> bss_section_to_section;
         // The target ROM being recompiled, TODO move this outside of the context to avoid making a copy for mod contexts.
@@ -277,10 +299,72 @@ namespace N64Recomp {
         bool read_data_reference_syms(const std::filesystem::path& data_syms_file_path);
 
         static bool from_symbol_file(const std::filesystem::path& symbol_file_path, std::vector<uint8_t>&& rom, Context& out, bool with_relocs);
+        // Equivalent to from_symbol_file and read_data_reference_syms for binary context files (see context_to_bin_v1).
+        // Those will use these automatically when given a binary context file.
+        static bool from_context_bin_file(const std::filesystem::path& context_bin_path, std::vector<uint8_t>&& rom, Context& out, bool with_relocs);
+        bool read_context_bin_data_reference_syms(const std::filesystem::path& context_bin_path);
         static bool from_elf_file(const std::filesystem::path& elf_file_path, Context& out, const ElfParsingConfig& flags, bool for_dumping_context, DataSymbolMap& data_syms_out, bool& found_entrypoint_out);
-
+        // Finds the functions in the executable sections by following calls from the entrypoint and the already known functions, as well as
+        // by looking for stack frame prologues in unclaimed code. Any new functions get added to this context. Known functions keep their
+        // sizes, and each call target is placed in the calling function's section if that section contains it.
+        bool discover_functions(std::optional<uint32_t> entrypoint);
         Context() = default;
 
+        // Finds the range of relocs in each function's section that fall within the function. This should be called again if functions
+        // or relocs are added or moved afterwards.
+        void compute_function_reloc_spans() {
+            function_reloc_spans.resize(functions.size());
+            for (size_t func_index = 0; func_index < functions.size(); func_index++) {
+                const Function& func = functions[func_index];
+                if (func.section_index < sections.size()) {
+                    function_reloc_spans[func_index] = find_function_reloc_span(sections[func.section_index], func);
+                }
+                else {
+                    function_reloc_spans[func_index] = {};
+                }
+            }
+        }
+
+        // Gets the range of relocs in the given function's section that fall within the function.
+        RelocSpan get_function_reloc_span(size_t function_index) const {
+            const Function& func = functions[function_index];
+            if (func.section_index >= sections.size()) {
+                return {};
+            }
+            const Section& section = sections[func.section_index];
+            // Functions that were added after the spans were computed fall back to searching for their span.
+            if (function_index >= function_reloc_spans.size()) {
+                return find_function_reloc_span(section, func);
+            }
+            RelocSpan span = function_reloc_spans[function_index];
+            // A span that no longer fits in the section's relocs means relocs were removed without recomputing the spans.
+            if (span.end > section.relocs.size()) {
+                assert(false && "Function reloc spans are stale, call compute_function_reloc_spans after changing functions or relocs");
+                return find_function_reloc_span(section, func);
+            }
+#ifndef NDEBUG
+            // Catch spans that went stale because functions or relocs changed after compute_function_reloc_spans was called.
+            RelocSpan expected_span = find_function_reloc_span(section, func);
+            assert(span.begin == expected_span.begin && span.end == expected_span.end &&
+                "Function reloc spans are stale, call compute_function_reloc_spans after changing functions or relocs");
+#endif
+            return span;
+        }
+
+        static RelocSpan find_function_reloc_span(const Section& section, const Function& func) {
+            // Relocs are sorted by address, so the function's relocs can be found with a binary search for its start and end address.
+            uint32_t func_vram_end = func.vram + func.words.size() * sizeof(func.words[0]);
+            auto address_less = [](const Reloc& reloc, uint32_t address) {
+                return reloc.address < address;
+            };
+            auto begin_it = std::lower_bound(section.relocs.begin(), section.relocs.end(), func.vram, address_less);
+            auto end_it = std::lower_bound(begin_it, section.relocs.end(), func_vram_end, address_less);
+            return RelocSpan{
+                .begin = static_cast<size_t>(begin_it - section.relocs.begin()),
+                .end = static_cast<size_t>(end_it - section.relocs.begin())
+            };
+        }
+
         bool add_dependency(const std::string& id) {
             if (dependencies_by_name.contains(id)) {
                 return false;
@@ -590,9 +674,26 @@ namespace N64Recomp {
     };
 
     class Generator;
-    bool recompile_function(const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs, bool tag_reference_relocs);
+    // If called_functions_out is provided, the name of every function that's called directly by the recompiled function is added to it,
+    // along with any function named in the function's hooks.
+    bool recompile_function(const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs, bool tag_reference_relocs, std::unordered_set<std::string>* called_functions_out = nullptr);
     bool recompile_function_custom(Generator& generator, const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs);
 
+    // Finds the functions that recompile to the same code as an earlier function, so that they can share its body instead of being recompiled.
+    // Returns a mapping of each such function's index to the index of the earlier function, which is never a duplicate itself. Relocs against
+    // a function's own section or its bss match across sections, as do calls that resolve to the same function from each function's section.
+    // Requires the function reloc spans to be computed.
+    std::unordered_map<size_t, size_t> find_duplicate_functions(const Context& context);
+    // Checks whether the recompiled function uses the address of its own section, in which case identical functions in other sections
+    // have to share its body through recompile_shared_function_body instead of calling the function.
+    bool function_uses_own_section(const Context& context, size_t function_index);
+    // Recompiles a function into a body that identical functions in other sections can share. The body is named by get_shared_body_name
+    // and takes the calling function's section index as a third argument, which it uses for relocs against the function's own section.
+    bool recompile_shared_function_body(const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs, bool tag_reference_relocs, std::unordered_set<std::string>* called_functions_out = nullptr);
+    inline std::string get_shared_body_name(const std::string& function_name) {
+        return function_name + "_shared";
+    }
+
     enum class ModSymbolsError {
         Good,
         NotASymbolFile,
@@ -603,6 +704,11 @@ namespace N64Recomp {
 
     ModSymbolsError parse_mod_symbols(std::span<const char> data, std::span<const uint8_t> binary, const std::unordered_map<uint32_t, uint16_t>& sections_by_vrom, Context& context_out);
     std::vector<uint8_t> symbols_to_bin_v1(const Context& mod_context);
+
+    // Creates a binary context file, which holds the same function symbols, relocs and data symbols as the symbol files produced by
+    // dumping a context but can be memory mapped and loaded without any parsing.
+    std::vector<uint8_t> context_to_bin_v1(const Context& context, const DataSymbolMap& data_syms);
+    bool is_context_bin_file(const std::filesystem::path& path);
     
     inline bool is_manual_patch_symbol(uint32_t vram) {
         // Zero-sized symbols between 0x8F000000 and 0x90000000 are manually specified symbols for use with patches.
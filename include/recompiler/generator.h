@@ -1,6 +1,9 @@
 #ifndef __GENERATOR_H__
 #define __GENERATOR_H__
 
+#include <memory>
+#include <optional>
+
 #include "recompiler/context.h"
 #include "operations.h"
 
@@ -30,10 +33,19 @@ namespace N64Recomp {
         virtual void process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const = 0;
         virtual void process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const = 0;
         virtual void process_store_op(const StoreOp& op, const InstructionContext& ctx) const = 0;
+        // Sets the stack slots of the next function that are held in locals instead of memory, called before emit_function_start.
+        // Loads and stores of these slots are emitted with emit_stack_slot_load and emit_stack_slot_store.
+        virtual void set_stack_slots(const std::vector<StackSlot>& slots) const = 0;
         virtual void emit_function_start(const std::string& function_name, size_t func_index) const = 0;
         virtual void emit_function_end() const = 0;
+        // Loads a slot into a register. Word slots are sign extended like lw.
+        virtual void emit_stack_slot_load(const StackSlot& slot, int reg) const = 0;
+        virtual void emit_stack_slot_store(const StackSlot& slot, int reg) const = 0;
         virtual void emit_function_call_lookup(uint32_t addr) const = 0;
         virtual void emit_function_call_by_register(int reg) const = 0;
+        // Calls the function whose address is in the register, comparing the register against the addresses of the candidate functions
+        // first so that those can be called directly. Any other address falls back to a lookup like emit_function_call_by_register.
+        virtual void emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const = 0;
         // target_section_offset can each be deduced from symbol_index if the full context is available,
         // but for live recompilation the reference symbol list is unavailable so it's still provided.
         virtual void emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const = 0;
@@ -44,6 +56,10 @@ namespace N64Recomp {
         virtual void emit_jtbl_addend_declaration(const JumpTable& jtbl, int reg) const = 0;
         virtual void emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const = 0;
         virtual void emit_branch_close() const = 0;
+        // Jumps to the target label if the branch condition is met. Equivalent to emit_branch_condition, emit_goto and emit_branch_close.
+        virtual void emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const = 0;
+        // Calls the given function if the branch condition is met. Equivalent to emit_branch_condition, emit_function_call and emit_branch_close.
+        virtual void emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const = 0;
         virtual void emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const = 0;
         virtual void emit_case(int case_index, const std::string& target_label) const = 0;
         virtual void emit_switch_error(uint32_t instr_vram, uint32_t jtbl_vram) const = 0;
@@ -65,14 +81,21 @@ namespace N64Recomp {
 
     class CGenerator final : Generator {
     public:
-        CGenerator(std::ostream& output_file) : output_file(output_file) {};
+        // If shared_section is provided, functions are emitted as bodies shared by identical functions in several sections (see
+        // recompile_shared_function_body), which take the section as an argument and use it for relocs against shared_section.
+        CGenerator(std::ostream& output_file, std::unordered_set<std::string>* called_functions = nullptr, std::optional<uint16_t> shared_section = std::nullopt) :
+            output_file(output_file), called_functions(called_functions), shared_section(shared_section) {};
         void process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const final;
         void process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const final;
         void process_store_op(const StoreOp& op, const InstructionContext& ctx) const final;
+        void set_stack_slots(const std::vector<StackSlot>& slots) const final;
         void emit_function_start(const std::string& function_name, size_t func_index) const final;
         void emit_function_end() const final;
+        void emit_stack_slot_load(const StackSlot& slot, int reg) const final;
+        void emit_stack_slot_store(const StackSlot& slot, int reg) const final;
         void emit_function_call_lookup(uint32_t addr) const final;
         void emit_function_call_by_register(int reg) const final;
+        void emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const final;
         void emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const final;
         void emit_function_call(const Context& context, size_t function_index) const final;
         void emit_named_function_call(const std::string& function_name) const final;
@@ -81,6 +104,8 @@ namespace N64Recomp {
         void emit_jtbl_addend_declaration(const JumpTable& jtbl, int reg) const final;
         void emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const final;
         void emit_branch_close() const final;
+        void emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const final;
+        void emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const final;
         void emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const final;
         void emit_case(int case_index, const std::string& target_label) const final;
         void emit_switch_error(uint32_t instr_vram, uint32_t jtbl_vram) const final;
@@ -102,7 +127,69 @@ namespace N64Recomp {
         void get_operand_string(Operand operand, UnaryOpType operation, const InstructionContext& context, std::string& operand_string) const;
         void get_binary_expr_string(BinaryOpType type, const BinaryOperands& operands, const InstructionContext& ctx, const std::string& output, std::string& expr_string) const;
         void get_notation(BinaryOpType op_type, std::string& func_string, std::string& infix_string) const;
+        void record_called_function(const std::string& function_name) const;
+        std::ostream& output_file;
+        std::unordered_set<std::string>* called_functions;
+        std::optional<uint16_t> shared_section;
+        mutable std::vector<StackSlot> stack_slots;
+    };
+
+    struct LLVMGeneratorContext;
+
+    // Generates LLVM IR text. Function bodies are buffered until emit_function_end, and a single generator
+    // is meant to be used for every function in a module so that external declarations can be emitted once.
+    // Function text hooks and trace mode are C-only features, so recompile_function_custom should be given
+    // a scratch stream as its output file rather than the generator's. Relocs tagged as reference symbol relocs
+    // aren't supported either, so tag_reference_relocs must be false.
+    class LLVMGenerator final : public Generator {
+    public:
+        LLVMGenerator(std::ostream& output_file);
+        ~LLVMGenerator();
+        // Writes the type definitions, runtime declarations and memory helpers used by the generated functions.
+        void emit_module_start() const;
+        // Writes declarations for every function that was called but not defined in this module.
+        void emit_module_end() const;
+        void process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const final;
+        void process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const final;
+        void process_store_op(const StoreOp& op, const InstructionContext& ctx) const final;
+        void set_stack_slots(const std::vector<StackSlot>& slots) const final;
+        void emit_function_start(const std::string& function_name, size_t func_index) const final;
+        void emit_function_end() const final;
+        void emit_stack_slot_load(const StackSlot& slot, int reg) const final;
+        void emit_stack_slot_store(const StackSlot& slot, int reg) const final;
+        void emit_function_call_lookup(uint32_t addr) const final;
+        void emit_function_call_by_register(int reg) const final;
+        void emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const final;
+        void emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const final;
+        void emit_function_call(const Context& context, size_t function_index) const final;
+        void emit_named_function_call(const std::string& function_name) const final;
+        void emit_goto(const std::string& target) const final;
+        void emit_label(const std::string& label_name) const final;
+        void emit_jtbl_addend_declaration(const JumpTable& jtbl, int reg) const final;
+        void emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const final;
+        void emit_branch_close() const final;
+        void emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const final;
+        void emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const final;
+        void emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const final;
+        void emit_case(int case_index, const std::string& target_label) const final;
+        void emit_switch_error(uint32_t instr_vram, uint32_t jtbl_vram) const final;
+        void emit_switch_close() const final;
+        void emit_return(const Context& context, size_t func_index) const final;
+        void emit_check_fr(int fpr) const final;
+        void emit_check_nan(int fpr, bool is_double) const final;
+        void emit_cop0_status_read(int reg) const final;
+        void emit_cop0_status_write(int reg) const final;
+        void emit_cop1_cs_read(int reg) const final;
+        void emit_cop1_cs_write(int reg) const final;
+        void emit_muldiv(InstrId instr_id, int reg1, int reg2) const final;
+        void emit_syscall(uint32_t instr_vram) const final;
+        void emit_do_break(uint32_t instr_vram) const final;
+        void emit_pause_self() const final;
+        void emit_trigger_event(uint32_t event_index) const final;
+        void emit_comment(const std::string& comment) const final;
+    private:
         std::ostream& output_file;
+        mutable std::unique_ptr<LLVMGeneratorContext> context;
     };
 }
 
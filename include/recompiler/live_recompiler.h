@@ -2,17 +2,93 @@
 #define __LIVE_RECOMPILER_H__
 
 #include <unordered_map>
+#include <functional>
+#include <mutex>
 #include "recompiler/generator.h"
 #include "recomp.h"
 
 struct sljit_compiler;
+struct sljit_jump;
 
 namespace N64Recomp {
     struct LiveGeneratorContext;
+    struct LiveGeneratorInputs;
+    // Pool of executable memory that generator outputs can be placed in. Outputs are packed together into large chunks,
+    // which keeps recompiled code in fewer pages than allocating each output separately. Using one arena per mod allows
+    // the mod's code to be released together. All outputs placed in an arena must be destroyed before the arena.
+    // Chunks come from sljit's executable allocator, so code pages are only kept non-writable when sljit is built with its dual mapping
+    // allocator (SLJIT_PROT_EXECUTABLE_ALLOCATOR), where code is written through a separate writable mapping. The default allocator maps
+    // chunks as read, write and execute. Arenas can't be used with the mprotect based allocator (SLJIT_WX_EXECUTABLE_ALLOCATOR), as making
+    // one output's pages writable would fault any code running from the other outputs sharing those pages, so allocation fails with it.
+    class LiveCodeArena {
+    public:
+        struct Stats {
+            // Number of chunks of executable memory allocated by the arena.
+            size_t chunk_count;
+            // Total size of all the chunks.
+            size_t reserved_bytes;
+            // Bytes used by outputs that are still alive.
+            size_t used_bytes;
+            // Bytes that were used by freed outputs and can't be reused until their chunk is empty.
+            size_t wasted_bytes;
+        };
+        static constexpr size_t default_chunk_size = 1024 * 1024;
+
+        LiveCodeArena(size_t chunk_size = default_chunk_size);
+        LiveCodeArena(const LiveCodeArena& rhs) = delete;
+        LiveCodeArena& operator=(const LiveCodeArena& rhs) = delete;
+        ~LiveCodeArena();
+        // Allocates space for code and returns the writable address, with the offset to the executable address placed in executable_offset.
+        void* allocate(size_t size, int64_t& executable_offset);
+        // Frees code previously allocated from the arena, where code is the executable address.
+        void free(void* code, size_t size);
+        // Releases any chunks that don't contain code back to the system.
+        void compact();
+        Stats get_stats();
+    private:
+        struct Chunk {
+            uint8_t* memory;
+            size_t size;
+            int64_t executable_offset;
+            // Offset of the next allocation within the chunk.
+            size_t next_offset;
+            // Number of outputs using this chunk and the bytes they occupy.
+            size_t allocation_count;
+            size_t used_bytes;
+        };
+        size_t chunk_size;
+        std::vector<Chunk> chunks;
+        std::mutex mutex;
+    };
     struct ReferenceJumpDetails {
         uint16_t section;
         uint32_t section_offset;
     };
+    enum class LiveCodeFixupType : uint32_t {
+        HostFunctionCall, // Rewritable call to a host function, index is the host function's id.
+        LocalSectionAddress, // Pointer to an entry in LiveGeneratorInputs::local_section_addresses, index is the section index.
+        ReferenceSectionAddress, // Pointer to an entry in LiveGeneratorInputs::reference_section_addresses, index is the section index.
+        JumpTable, // Pointer to a jump table, index is the index into LiveGeneratorOutput::jump_tables.
+        StringLiteral, // Pointer to a string literal, index is the index into LiveGeneratorOutput::string_literals.
+        LookupCache, // Pointer to a lookup cache, index is the index into LiveGeneratorOutput::lookup_caches.
+        LookupGeneration, // Pointer to the current function lookup generation, index is unused.
+    };
+    struct LiveCodeFixup {
+        LiveCodeFixupType type;
+        uint32_t index;
+        // Address of the rewritable jump or constant in the recompiled code.
+        void* address;
+    };
+    // Cached result of a function lookup at one callsite in recompiled code. The cached function is only used if the generation matches
+    // the current lookup generation and, for lookups of a register's value, the vram matches the looked up address.
+    struct LiveLookupCache {
+        uint32_t generation = 0;
+        uint32_t vram = 0;
+        recomp_func_t* func = nullptr;
+    };
+    // Invalidates the cached function lookups in all recompiled code. This must be called whenever the results of
+    // LiveGeneratorInputs::get_function change, such as when sections are loaded or unloaded.
+    void invalidate_live_function_lookups();
     struct LiveGeneratorOutput {
         LiveGeneratorOutput() = default;
         LiveGeneratorOutput(const LiveGeneratorOutput& rhs) = delete;
@@ -22,18 +98,25 @@ namespace N64Recomp {
             good = rhs.good;
             string_literals = std::move(rhs.string_literals);
             jump_tables = std::move(rhs.jump_tables);
+            jump_table_sizes = std::move(rhs.jump_table_sizes);
+            lookup_caches = std::move(rhs.lookup_caches);
             code = rhs.code;
             code_size = rhs.code_size;
             functions = std::move(rhs.functions);
             reference_symbol_jumps = std::move(rhs.reference_symbol_jumps);
             import_jumps_by_index = std::move(rhs.import_jumps_by_index);
+            function_jumps_by_index = std::move(rhs.function_jumps_by_index);
+            function_entry_jumps = std::move(rhs.function_entry_jumps);
+            fixups = std::move(rhs.fixups);
             executable_offset = rhs.executable_offset;
+            code_arena = rhs.code_arena;
 
             rhs.good = false;
             rhs.code = nullptr;
             rhs.code_size = 0;
             rhs.reference_symbol_jumps.clear();
             rhs.executable_offset = 0;
+            rhs.code_arena = nullptr;
 
             return *this;
         }
@@ -42,6 +125,10 @@ namespace N64Recomp {
         void set_reference_symbol_jump(size_t jump_index, recomp_func_t* func);
         ReferenceJumpDetails get_reference_symbol_jump_details(size_t jump_index);
         void populate_import_symbol_jumps(size_t import_index, recomp_func_t* func);
+        void populate_function_jumps(size_t function_index, recomp_func_t* func);
+        // Redirects the function's entry, and therefore every existing caller of it, to the given function. Requires the output
+        // to have been generated with LiveGeneratorInputs::hot_reloadable set. Returns false if the function's entry can't be redirected.
+        bool redirect_function(size_t function_index, recomp_func_t* func);
         bool good = false;
         // Storage for string literals referenced by recompiled code. These are allocated as unique_ptr arrays
         // to prevent them from moving, as the referenced address is baked into the recompiled code.
@@ -49,10 +136,12 @@ namespace N64Recomp {
         // Storage for jump tables referenced by recompiled code (vector of arrays of pointers). These are also
         // allocated as unique_ptr arrays for the same reason as strings.
         std::vector<std::unique_ptr<void*[]>> jump_tables;
+        // Storage for the function lookup caches used by recompiled code, which are also allocated individually to prevent them from moving.
+        std::vector<std::unique_ptr<LiveLookupCache>> lookup_caches;
         // Recompiled code.
-        void* code;
+        void* code = nullptr;
         // Size of the recompiled code.
-        size_t code_size;
+        size_t code_size = 0;
         // Pointers to each individual function within the recompiled code.
         std::vector<recomp_func_t*> functions;
     private:
@@ -61,10 +150,31 @@ namespace N64Recomp {
         std::vector<std::pair<ReferenceJumpDetails, void*>> reference_symbol_jumps;
         // Mapping of import symbol index to any jumps to that import symbol.
         std::unordered_multimap<size_t, void*> import_jumps_by_index;
+        // Mapping of function index to any jumps to that function when it was recompiled by a different generator shard.
+        std::unordered_multimap<size_t, void*> function_jumps_by_index;
+        // Address of the rewritable jump at each function's entry and the address of the function's body that it originally jumps to,
+        // indexed by function index. Only populated for hot reloadable outputs.
+        std::vector<std::pair<void*, void*>> function_entry_jumps;
+        // Number of entries in each jump table.
+        std::vector<size_t> jump_table_sizes;
+        // Host addresses baked into the recompiled code, which need to be repopulated when the code is loaded from a cache.
+        std::vector<LiveCodeFixup> fixups;
         // sljit executable offset.
         int64_t executable_offset;
+        // Arena that the code was allocated from, or nullptr if it was allocated separately.
+        LiveCodeArena* code_arena = nullptr;
+
+        // Points the fixup's jump or constant at the host address it refers to for the given inputs. Returns false if the fixup is invalid.
+        bool apply_fixup(const LiveCodeFixup& fixup, const LiveGeneratorInputs& inputs);
+        // Moves the code from sljit's allocation into the given arena.
+        bool move_to_arena(LiveCodeArena* arena, const LiveGeneratorInputs& inputs);
 
         friend class LiveGenerator;
+        friend class LiveLazyRecompiler;
+        friend bool serialize_live_output(const LiveGeneratorOutput& output, uint64_t cache_key, std::vector<uint8_t>& data_out);
+        friend bool deserialize_live_output(std::span<const uint8_t> data, uint64_t cache_key, const LiveGeneratorInputs& inputs, LiveGeneratorOutput& output_out);
+        friend bool recompile_function_for_reload(std::span<recomp_func_t* const> functions, const Context& context, size_t function_index,
+            const LiveGeneratorInputs& inputs, bool tag_reference_relocs, LiveGeneratorOutput& output_out);
     };
     struct LiveGeneratorInputs {
         uint32_t base_event_index;
@@ -86,10 +196,18 @@ namespace N64Recomp {
         // Maps section index in the generated code to original section index. Used by regenerated
         // code to relocate using the corresponding original section's address.
         std::vector<size_t> original_section_indices;
+        // Arena to place recompiled code in, or nullptr to allocate each output separately. LiveGenerator::finish generates the code
+        // outside of the arena and then copies it in, which rebases the output's addresses and reapplies its fixups.
+        LiveCodeArena* code_arena = nullptr;
+        // Emits a rewritable jump at the start of every function so that functions can be redirected to a reloaded version.
+        bool hot_reloadable = false;
     };
     class LiveGenerator final : public Generator {
     public:
         LiveGenerator(size_t num_funcs, const LiveGeneratorInputs& inputs);
+        // Creates a generator that recompiles one shard of the functions, where shard_functions marks the function indices in this shard.
+        // Calls to functions outside of the shard are emitted as jumps that get populated with LiveGeneratorOutput::populate_function_jumps.
+        LiveGenerator(size_t num_funcs, const LiveGeneratorInputs& inputs, std::vector<bool> shard_functions);
         ~LiveGenerator();
         // Prevent moving or copying.
         LiveGenerator(const LiveGenerator& rhs) = delete;
@@ -98,13 +216,19 @@ namespace N64Recomp {
         LiveGenerator& operator=(LiveGenerator&& rhs) = delete;
 
         LiveGeneratorOutput finish();
+        // Allocates host registers to the most frequently referenced GPRs in the given function. Must be called before the function is recompiled.
+        void allocate_gprs(const Function& func) const;
         void process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const final;
         void process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const final;
         void process_store_op(const StoreOp& op, const InstructionContext& ctx) const final;
+        void set_stack_slots(const std::vector<StackSlot>& slots) const final;
         void emit_function_start(const std::string& function_name, size_t func_index) const final;
         void emit_function_end() const final;
+        void emit_stack_slot_load(const StackSlot& slot, int reg) const final;
+        void emit_stack_slot_store(const StackSlot& slot, int reg) const final;
         void emit_function_call_lookup(uint32_t addr) const final;
         void emit_function_call_by_register(int reg) const final;
+        void emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const final;
         void emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const final;
         void emit_function_call(const Context& context, size_t function_index) const final;
         void emit_named_function_call(const std::string& function_name) const final;
@@ -113,6 +237,8 @@ namespace N64Recomp {
         void emit_jtbl_addend_declaration(const JumpTable& jtbl, int reg) const final;
         void emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const final;
         void emit_branch_close() const final;
+        void emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const final;
+        void emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const final;
         void emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const final;
         void emit_case(int case_index, const std::string& target_label) const final;
         void emit_switch_error(uint32_t instr_vram, uint32_t jtbl_vram) const final;
@@ -136,6 +262,17 @@ namespace N64Recomp {
         void get_notation(BinaryOpType op_type, std::string& func_string, std::string& infix_string) const;
         // Loads the relocated address specified by the instruction context into the target register.
         void load_relocated_address(const InstructionContext& ctx, int reg) const;
+        // Emits a compare and jump for a branch condition. The jump is taken if the condition is met when jump_if_met is true, or if it isn't otherwise.
+        // Returns nullptr if the branch condition is invalid.
+        sljit_jump* emit_branch_compare(const ConditionalBranchOp& op, const InstructionContext& ctx, bool jump_if_met) const;
+        // Writes the host registers allocated to GPRs back into the context.
+        void store_allocated_gprs() const;
+        // Reloads the host registers allocated to GPRs from the context.
+        void load_allocated_gprs() const;
+        // Emits a call to the shared stub that runs the hook with the given index.
+        void emit_hook_stub_call(size_t hook_index) const;
+        // Emits the out-of-line switch error paths for the current function.
+        void emit_switch_errors() const;
         sljit_compiler* compiler;
         LiveGeneratorInputs inputs;
         mutable std::unique_ptr<LiveGeneratorContext> context;
@@ -145,15 +282,86 @@ namespace N64Recomp {
     void live_recompiler_init();
     bool recompile_function_live(LiveGenerator& generator, const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs);
 
+    struct LiveShardedOutput {
+        // Output of each shard. These own the recompiled code, so they must be kept alive while any of the functions are in use.
+        // Reference and import symbol jumps need to be populated in every shard.
+        std::vector<LiveGeneratorOutput> shards;
+        // Pointers to each recompiled function, indexed by function index in the recompiler context.
+        std::vector<recomp_func_t*> functions;
+    };
+    // Recompiles every function in the context by splitting them across multiple generator shards that run on separate threads,
+    // then links the calls between shards.
+    bool recompile_functions_live_parallel(const Context& context, const LiveGeneratorInputs& inputs, size_t shard_count,
+        std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs, LiveShardedOutput& output_out);
+
+    // Recompiles a single function into its own output so that it can replace the existing version of the function. Calls to other
+    // functions go through their entries in the given function table, which is indexed by function index in the recompiler context.
+    // The caller must populate the new output's reference and import symbol jumps, then call LiveGeneratorOutput::redirect_function
+    // on the original output to switch the function's callers over to the new code. Outputs from earlier reloads of the same function
+    // can be destroyed once the function has been redirected and no thread is executing the earlier output's code.
+    bool recompile_function_for_reload(std::span<recomp_func_t* const> functions, const Context& context, size_t function_index,
+        const LiveGeneratorInputs& inputs, bool tag_reference_relocs, LiveGeneratorOutput& output_out);
+
+    // Computes the key that identifies a cached output for the given mod binary, mod symbol data and generator inputs.
+    uint64_t get_live_cache_key(std::span<const uint8_t> binary, std::span<const uint8_t> symbols, const LiveGeneratorInputs& inputs);
+    // Serializes a generator output so that it can be stored in a cache and loaded with deserialize_live_output.
+    bool serialize_live_output(const LiveGeneratorOutput& output, uint64_t cache_key, std::vector<uint8_t>& data_out);
+    // Loads a generator output from data created by serialize_live_output and relocates it for the given inputs.
+    // Returns false if the data is invalid or was created with a different cache key.
+    bool deserialize_live_output(std::span<const uint8_t> data, uint64_t cache_key, const LiveGeneratorInputs& inputs, LiveGeneratorOutput& output_out);
+
     class ShimFunction {
     private:
-        void* code;
+        void* code = nullptr;
         recomp_func_t* func;
     public:
         ShimFunction(recomp_func_ext_t* to_shim, uintptr_t value);
         ~ShimFunction();
         recomp_func_t* get_func() { return func; }
     };
+
+    // Recompiles functions on demand instead of up front. Each function starts out as a stub that recompiles it on the first call,
+    // after which any recompiled callers are back-patched to call the recompiled function directly and the stub jumps straight to it.
+    // The context must outlive the lazy recompiler.
+    class LiveLazyRecompiler {
+    public:
+        // Called with the output for each newly recompiled function before it runs, which is responsible for populating
+        // the output's reference symbol and import symbol jumps. Returns false if the output couldn't be linked.
+        using LinkCallback = std::function<bool(LiveGeneratorOutput& output)>;
+
+        LiveLazyRecompiler(const Context& context, const LiveGeneratorInputs& inputs, bool tag_reference_relocs, LinkCallback link_output);
+        LiveLazyRecompiler(const LiveLazyRecompiler& rhs) = delete;
+        LiveLazyRecompiler& operator=(const LiveLazyRecompiler& rhs) = delete;
+        ~LiveLazyRecompiler();
+        // Returns the current entrypoint for the given function, which is either its stub or the recompiled function.
+        recomp_func_t* get_function(size_t function_index);
+        bool is_recompiled(size_t function_index);
+        // Recompiles the given function if it hasn't been already and returns the recompiled function, or nullptr on failure.
+        recomp_func_t* recompile(size_t function_index);
+    private:
+        struct StubData {
+            LiveLazyRecompiler* owner;
+            size_t function_index;
+        };
+        static void lazy_entry(uint8_t* rdram, recomp_context* ctx, uintptr_t arg);
+
+        const Context& context;
+        LiveGeneratorInputs inputs;
+        bool tag_reference_relocs;
+        LinkCallback link_output;
+        std::mutex mutex;
+        std::vector<StubData> stub_data;
+        // Code for every function's stub.
+        void* stub_code = nullptr;
+        int64_t stub_executable_offset = 0;
+        // Address of the rewritable jump at the start of each function's stub.
+        std::vector<void*> stub_entry_jumps;
+        // Current entrypoint of each function.
+        std::vector<recomp_func_t*> functions;
+        std::vector<bool> recompiled;
+        // Outputs for every function recompiled so far, which own the recompiled code.
+        std::vector<std::unique_ptr<LiveGeneratorOutput>> outputs;
+    };
 }
 
 #endif
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <limits>
+#include <map>
 #include <set>
 #include <algorithm>
 
@@ -5,6 +7,7 @@
 #include "fmt/format.h"
 
 #include "recompiler/context.h"
+#include "recompiler/operations.h"
 #include "analysis.h"
 
 extern "C" const char* RabbitizerRegister_getNameGpr(uint8_t regValue);
@@ -28,9 +31,21 @@ struct RegState {
     uint8_t loaded_addend_reg;
     bool valid_loaded;
     bool valid_got_loaded; // valid load through the GOT
+    // For tracking the bounds check that guards a jump table
+    uint32_t compare_bound; // this register is nonzero iff compare_reg < compare_bound (sltiu)
+    uint8_t compare_reg;
+    uint32_t value_bound; // exclusive upper bound on this register's value
+    uint32_t addend_bound; // value_bound of the addend register at the time of the addu
+    uint32_t loaded_entry_bound; // exclusive upper bound on the index into the loaded jump table
+    bool valid_compare;
+    bool valid_value_bound;
+    bool valid_addend_bound;
+    bool valid_loaded_entry_bound;
 
     RegState() = default;
 
+    bool operator==(const RegState& rhs) const = default;
+
     void invalidate() {
         prev_lui = 0;
         prev_addiu_vram = 0;
@@ -50,6 +65,26 @@ struct RegState {
 
         valid_loaded = false;
         valid_got_loaded = false;
+
+        compare_bound = 0;
+        compare_reg = 0;
+        value_bound = 0;
+        addend_bound = 0;
+        loaded_entry_bound = 0;
+
+        valid_compare = false;
+        valid_value_bound = false;
+        valid_addend_bound = false;
+        valid_loaded_entry_bound = false;
+    }
+
+    // Clears the state that only holds for this register's exact value, used when the register is derived from another one
+    void invalidate_bounds() {
+        compare_bound = 0;
+        compare_reg = 0;
+        value_bound = 0;
+        valid_compare = false;
+        valid_value_bound = false;
     }
 };
 
@@ -69,6 +104,22 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
 
     uint16_t imm = instr.Get_immediate();
 
+    // Any bounds check made against a register that's being overwritten no longer holds
+    auto clear_compares = [&](int reg) {
+        for (size_t i = 0; i < 32; i++) {
+            if (reg_states[i].valid_compare && reg_states[i].compare_reg == reg) {
+                reg_states[i].valid_compare = false;
+            }
+        }
+    };
+
+    if (instr.modifiesRd()) {
+        clear_compares(rd);
+    }
+    if (instr.modifiesRt()) {
+        clear_compares(rt);
+    }
+
     auto check_move = [&]() {
         if (rs == 0) {
             // rs is zero so copy rt to rd
@@ -92,6 +143,7 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
     case InstrId::cpu_addiu:
         // The target reg is a copy of the source reg plus an immediate, so copy the source reg's state
         reg_states[rt] = reg_states[rs];
+        reg_states[rt].invalidate_bounds();
         // Set the addiu state if and only if there hasn't been an addiu already
         if (!reg_states[rt].valid_addiu) {
             reg_states[rt].prev_addiu_vram = (int16_t)imm;
@@ -111,9 +163,12 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
 
             // Copy the got offset reg's state into the destination reg, then set the destination reg's addend to the other operand
             temp = reg_states[valid_got_offset_reg];
+            temp.invalidate_bounds();
             temp.valid_addend = true;
             temp.prev_addend_reg = addend_reg;
             temp.prev_addu_vram = instr.getVram();
+            temp.valid_addend_bound = reg_states[addend_reg].valid_value_bound;
+            temp.addend_bound = reg_states[addend_reg].value_bound;
         } else if (((rs == (int)RegId::GPR_O32_gp) || (rt == (int)RegId::GPR_O32_gp)) 
                 && reg_states[rs].valid_got_loaded != reg_states[rt].valid_got_loaded) {
             // `addu rd, rs, $gp` or `addu rd, $gp, rt` after valid GOT load, this is the last part of a position independent
@@ -121,6 +176,7 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
             int valid_got_loaded_reg = reg_states[rs].valid_got_loaded ? rs : rt;
 
             temp = reg_states[valid_got_loaded_reg];
+            temp.invalidate_bounds();
         }
         // Exactly one of the two addend register states should have a valid lui at this time
         else if (reg_states[rs].valid_lui != reg_states[rt].valid_lui) {
@@ -130,9 +186,12 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
 
             // Copy the lui reg's state into the destination reg, then set the destination reg's addend to the other operand
             temp = reg_states[valid_lui_reg];
+            temp.invalidate_bounds();
             temp.valid_addend = true;
             temp.prev_addend_reg = addend_reg;
             temp.prev_addu_vram = instr.getVram();
+            temp.valid_addend_bound = reg_states[addend_reg].valid_value_bound;
+            temp.addend_bound = reg_states[addend_reg].value_bound;
         } else {
             // Check if this is a move
             check_move();
@@ -143,6 +202,27 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
     case InstrId::cpu_or:
         check_move();
         break;
+    case InstrId::cpu_sltiu:
+        // rt has been completely overwritten, so invalidate it
+        reg_states[rt].invalidate();
+        // Track the comparison so that a branch on rt can bound rs, such as the range check before a jump table.
+        // This can't be tracked if rs is also rt, as the comparison would refer to the overwritten value.
+        if (rt != rs) {
+            reg_states[rt].valid_compare = true;
+            reg_states[rt].compare_reg = rs;
+            reg_states[rt].compare_bound = (uint32_t)(int16_t)imm;
+        }
+        break;
+    case InstrId::cpu_sll:
+        // rd has been completely overwritten, so invalidate it
+        temp.invalidate();
+        // Carry rt's bound through the shift as long as the shifted bound doesn't overflow
+        if (reg_states[rt].valid_value_bound && ((uint64_t)reg_states[rt].value_bound << sa) <= UINT32_MAX) {
+            temp.valid_value_bound = true;
+            temp.value_bound = reg_states[rt].value_bound << sa;
+        }
+        reg_states[rd] = temp;
+        break;
     case InstrId::cpu_sw:
         // If this is a store to the stack, copy the state of rt into the stack at the given offset
         if (base == (int)RegId::GPR_O32_sp) {
@@ -159,6 +239,8 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
                 stack_states.resize(stack_offset + 1);
             }
             stack_states[stack_offset] = reg_states[rt];
+            // The registers that a comparison refers to won't be tracked until this is loaded back
+            stack_states[stack_offset].valid_compare = false;
         }
         break;
     case InstrId::cpu_lw:
@@ -200,6 +282,9 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
                 temp.loaded_address = address;
                 temp.loaded_addend_reg = reg_states[base].prev_addend_reg;
                 temp.loaded_addu_vram = reg_states[base].prev_addu_vram;
+                // Each entry is a word, so the bound on the byte offset into the table gives a bound on the entry index
+                temp.valid_loaded_entry_bound = reg_states[base].valid_addend_bound;
+                temp.loaded_entry_bound = reg_states[base].addend_bound / 4 + ((reg_states[base].addend_bound & 0b11) != 0);
             }
         }
         // If the base register has a valid GOT offset and a valid addend before this, then this may be a load from a position independent jump table
@@ -212,6 +297,8 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
             temp.loaded_addend_reg = reg_states[base].prev_addend_reg;
             temp.loaded_addu_vram = reg_states[base].prev_addu_vram;
             temp.prev_got_offset = reg_states[base].prev_got_offset;
+            temp.valid_loaded_entry_bound = reg_states[base].valid_addend_bound;
+            temp.loaded_entry_bound = reg_states[base].addend_bound / 4 + ((reg_states[base].addend_bound & 0b11) != 0);
         } else if (base == (int)RegId::GPR_O32_gp && is_got_addr_defined) {
             // lw from the $gp register implies a read from the global offset table
             temp.prev_got_offset = imm;
@@ -237,6 +324,9 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
                 std::nullopt,
                 std::vector<uint32_t>{}
             );
+            if (reg_states[rs].valid_loaded_entry_bound && reg_states[rs].loaded_entry_bound != 0) {
+                stats.jump_tables.back().entry_bound = reg_states[rs].loaded_entry_bound;
+            }
         } else if (reg_states[rs].valid_got_loaded) {
             stats.jump_tables.emplace_back(
                 reg_states[rs].loaded_address,
@@ -249,9 +339,28 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
                 reg_states[rs].prev_got_offset,
                 std::vector<uint32_t>{}
             );
+            if (reg_states[rs].valid_loaded_entry_bound && reg_states[rs].loaded_entry_bound != 0) {
+                stats.jump_tables.back().entry_bound = reg_states[rs].loaded_entry_bound;
+            }
         }
         // TODO stricter validation on tail calls, since not all indirect jumps can be treated as one.
         break;
+    case InstrId::cpu_jalr:
+        // Check if the called function pointer was loaded from a table and record it if so
+        if (reg_states[rs].valid_loaded) {
+            N64Recomp::FunctionPointerTable& table = stats.function_pointer_tables.emplace_back();
+            table.vram = reg_states[rs].loaded_address;
+            table.lw_vram = reg_states[rs].loaded_lw_vram;
+            table.jalr_vram = instr.getVram();
+            if (reg_states[rs].valid_loaded_entry_bound && reg_states[rs].loaded_entry_bound != 0) {
+                table.entry_bound = reg_states[rs].loaded_entry_bound;
+            }
+        }
+        // Like with jal, the call's effects on other registers aren't tracked
+        if (instr.modifiesRd()) {
+            reg_states[rd].invalidate();
+        }
+        break;
     default:
         if (instr.modifiesRd()) {
             reg_states[rd].invalidate();
@@ -264,30 +373,293 @@ bool analyze_instruction(const rabbitizer::InstructionCpu& instr, const N64Recom
     return true;
 }
 
-bool N64Recomp::analyze_function(const N64Recomp::Context& context, const N64Recomp::Function& func,
-    const std::vector<rabbitizer::InstructionCpu>& instructions, N64Recomp::FunctionStats& stats) {
-    const Section* section = &context.sections[func.section_index];
-    std::optional<uint32_t> got_ram_addr = section->got_ram_addr;
+// Narrows the bound of the register checked by a range check (sltiu followed by beq/bne against zero) along the path where the check passed.
+void apply_branch_bounds(const rabbitizer::InstructionCpu& branch, bool taken, RegState reg_states[32]) {
+    bool nonzero_path;
+    switch (branch.getUniqueId()) {
+    case InstrId::cpu_beq:
+    case InstrId::cpu_beql:
+        nonzero_path = !taken;
+        break;
+    case InstrId::cpu_bne:
+    case InstrId::cpu_bnel:
+        nonzero_path = taken;
+        break;
+    default:
+        return;
+    }
+
+    int rs = (int)branch.GetO32_rs();
+    int rt = (int)branch.GetO32_rt();
+    int compare_reg;
+    if (rt == 0) {
+        compare_reg = rs;
+    } else if (rs == 0) {
+        compare_reg = rt;
+    } else {
+        return;
+    }
+
+    if (!nonzero_path || compare_reg == 0 || !reg_states[compare_reg].valid_compare) {
+        return;
+    }
+
+    uint32_t bound = reg_states[compare_reg].compare_bound;
+    RegState& bounded = reg_states[reg_states[compare_reg].compare_reg];
+    if (!bounded.valid_value_bound || bound < bounded.value_bound) {
+        bounded.valid_value_bound = true;
+        bounded.value_bound = bound;
+    }
+}
+
+void N64Recomp::build_control_flow_graph(const N64Recomp::Function& func, const std::vector<rabbitizer::InstructionCpu>& instructions,
+    const std::vector<N64Recomp::JumpTable>& jump_tables, N64Recomp::ControlFlowGraph& cfg) {
+    size_t instruction_count = instructions.size();
+    uint32_t func_vram_end = func.vram + instruction_count * sizeof(uint32_t);
+
+    auto in_function = [&](uint32_t vram) {
+        return vram >= func.vram && vram < func_vram_end && (vram & 0b11) == 0;
+    };
+
+    auto index_of = [&](uint32_t vram) -> size_t {
+        return (vram - func.vram) / sizeof(uint32_t);
+    };
+
+    auto find_jump_table = [&](uint32_t jr_vram) -> const JumpTable* {
+        for (const JumpTable& jtbl : jump_tables) {
+            if (jtbl.jr_vram == jr_vram) {
+                return &jtbl;
+            }
+        }
+        return nullptr;
+    };
+
+    auto is_terminator = [](const rabbitizer::InstructionCpu& instr) {
+        InstrId instr_id = instr.getUniqueId();
+        return instr_id == InstrId::cpu_b || instr_id == InstrId::cpu_j || instr_id == InstrId::cpu_jr ||
+            conditional_branch_ops.contains(instr_id);
+    };
+
+    // Find the first instruction of every block: the function's entrypoint, every branch target and the instruction after every delay slot.
+    std::set<size_t> leaders{ 0 };
+    for (size_t instr_index = 0; instr_index < instruction_count; instr_index++) {
+        const auto& instr = instructions[instr_index];
+        if (!is_terminator(instr)) {
+            continue;
+        }
+        if (instr.getUniqueId() != InstrId::cpu_jr) {
+            uint32_t target = instr.getBranchVramGeneric();
+            if (in_function(target)) {
+                leaders.insert(index_of(target));
+            }
+        }
+        if (instr_index + 2 < instruction_count) {
+            leaders.insert(instr_index + 2);
+        }
+    }
+    for (const JumpTable& jtbl : jump_tables) {
+        for (uint32_t entry : jtbl.entries) {
+            if (in_function(entry)) {
+                leaders.insert(index_of(entry));
+            }
+        }
+    }
+
+    cfg.blocks.clear();
+    cfg.blocks_by_vram.clear();
+    cfg.blocks.reserve(leaders.size());
+
+    // Each block runs until the next leader, or until the delay slot of a branch. A branch into a delay slot means that the delay slot
+    // is both the end of the branch's block and the start of another one, so blocks may overlap by that one instruction.
+    for (size_t leader : leaders) {
+        BasicBlock& block = cfg.blocks.emplace_back();
+        block.start_index = leader;
+        block.branch_index = (size_t)-1;
+        block.reachable = false;
+
+        size_t instr_index = leader;
+        while (true) {
+            if (is_terminator(instructions[instr_index])) {
+                block.branch_index = instr_index;
+                block.end_index = std::min(instr_index + 2, instruction_count);
+                break;
+            }
+            if (instr_index + 1 >= instruction_count || leaders.contains(instr_index + 1)) {
+                block.end_index = instr_index + 1;
+                break;
+            }
+            instr_index++;
+        }
+        cfg.blocks_by_vram.emplace(func.vram + leader * sizeof(uint32_t), cfg.blocks.size() - 1);
+    }
+
+    auto block_at = [&](size_t instr_index) {
+        return cfg.blocks_by_vram.at(func.vram + instr_index * sizeof(uint32_t));
+    };
+
+    for (size_t block_index = 0; block_index < cfg.blocks.size(); block_index++) {
+        BasicBlock& block = cfg.blocks[block_index];
+
+        if (block.branch_index == (size_t)-1) {
+            if (block.end_index < instruction_count) {
+                block.successors.push_back({ block_at(block.end_index), false, false });
+            }
+            continue;
+        }
+
+        const auto& branch = instructions[block.branch_index];
+        InstrId instr_id = branch.getUniqueId();
+        if (instr_id == InstrId::cpu_jr) {
+            // jr $ra returns, and any other jr either goes through a known jump table or is a tail call
+            const JumpTable* jtbl = find_jump_table(branch.getVram());
+            if (jtbl != nullptr) {
+                std::set<size_t> targets{};
+                for (uint32_t entry : jtbl->entries) {
+                    if (in_function(entry)) {
+                        targets.insert(block_at(index_of(entry)));
+                    }
+                }
+                for (size_t target : targets) {
+                    block.successors.push_back({ target, true, false });
+                }
+            }
+            continue;
+        }
+
+        // Branches that leave the function are tail calls, so they don't have an edge
+        uint32_t target = branch.getBranchVramGeneric();
+        if (in_function(target)) {
+            block.successors.push_back({ block_at(index_of(target)), true, false });
+        }
+
+        auto find_it = conditional_branch_ops.find(instr_id);
+        if (find_it != conditional_branch_ops.end() && block.end_index < instruction_count) {
+            block.successors.push_back({ block_at(block.end_index), false, find_it->second.likely });
+        }
+    }
+
+    for (size_t block_index = 0; block_index < cfg.blocks.size(); block_index++) {
+        for (const BlockEdge& edge : cfg.blocks[block_index].successors) {
+            cfg.blocks[edge.block_index].predecessors.push_back(block_index);
+        }
+    }
+}
 
-    // Create a state to track each register (r0 won't be used)
+struct BlockState {
+    bool reached = false;
     RegState reg_states[32] {};
     std::vector<RegState> stack_states{};
+};
 
-    // Look for jump tables
-    // A linear search through the func won't be accurate due to not taking control flow into account, but it'll work for finding jtables
-    for (const auto& instr : instructions) {
-        if (!analyze_instruction(instr, func, stats, reg_states, stack_states, got_ram_addr.has_value())) {
-            return false;
+// Merges the incoming state into a block's state, invalidating any register or stack slot that differs between the two.
+// Returns whether the block's state changed.
+bool merge_block_state(BlockState& state, const BlockState& incoming) {
+    if (!state.reached) {
+        state = incoming;
+        state.reached = true;
+        return true;
+    }
+
+    bool changed = false;
+    auto merge = [&changed](RegState& cur, const RegState& other) {
+        if (cur != other && cur != RegState{}) {
+            cur.invalidate();
+            changed = true;
         }
+    };
+
+    for (size_t reg = 0; reg < 32; reg++) {
+        merge(state.reg_states[reg], incoming.reg_states[reg]);
+    }
+
+    if (state.stack_states.size() < incoming.stack_states.size()) {
+        state.stack_states.resize(incoming.stack_states.size());
+    }
+    for (size_t slot = 0; slot < state.stack_states.size(); slot++) {
+        merge(state.stack_states[slot], slot < incoming.stack_states.size() ? incoming.stack_states[slot] : RegState{});
     }
 
-    // Calculate absolute addresses for position-independent jump tables
+    return changed;
+}
+
+// Propagates register states through the control flow graph until they stop changing.
+bool propagate_block_states(const N64Recomp::Function& func, const std::vector<rabbitizer::InstructionCpu>& instructions, N64Recomp::ControlFlowGraph& cfg,
+    std::vector<BlockState>& block_states, bool is_got_addr_defined) {
+    // Jump tables are collected in a separate pass once the states are final, so any found here are discarded
+    N64Recomp::FunctionStats scratch_stats{};
+    std::set<size_t> worklist{};
+
+    auto run_worklist = [&]() {
+        while (!worklist.empty()) {
+            size_t block_index = *worklist.begin();
+            worklist.erase(worklist.begin());
+
+            const N64Recomp::BasicBlock& block = cfg.blocks[block_index];
+            BlockState state = block_states[block_index];
+            bool has_delay_slot = block.branch_index != (size_t)-1 && block.branch_index + 1 < block.end_index;
+            size_t body_end = has_delay_slot ? block.end_index - 1 : block.end_index;
+
+            for (size_t instr_index = block.start_index; instr_index < body_end; instr_index++) {
+                if (!analyze_instruction(instructions[instr_index], func, scratch_stats, state.reg_states, state.stack_states, is_got_addr_defined)) {
+                    return false;
+                }
+            }
+
+            for (const N64Recomp::BlockEdge& edge : block.successors) {
+                BlockState edge_state = state;
+                if (block.branch_index != (size_t)-1) {
+                    apply_branch_bounds(instructions[block.branch_index], edge.taken, edge_state.reg_states);
+                }
+                if (has_delay_slot && !edge.skips_delay_slot) {
+                    if (!analyze_instruction(instructions[body_end], func, scratch_stats, edge_state.reg_states, edge_state.stack_states, is_got_addr_defined)) {
+                        return false;
+                    }
+                }
+                if (merge_block_state(block_states[edge.block_index], edge_state)) {
+                    worklist.insert(edge.block_index);
+                }
+            }
+        }
+        return true;
+    };
+
+    block_states.clear();
+    block_states.resize(cfg.blocks.size());
+
+    block_states[0].reached = true;
+    worklist.insert(0);
+    if (!run_worklist()) {
+        return false;
+    }
+
+    for (size_t block_index = 0; block_index < cfg.blocks.size(); block_index++) {
+        cfg.blocks[block_index].reachable = block_states[block_index].reached;
+    }
+
+    // Blocks that aren't reachable through known control flow (e.g. only through an unrecognized indirect jump) are still analyzed,
+    // but starting from a state where nothing is known.
+    for (size_t block_index = 0; block_index < cfg.blocks.size(); block_index++) {
+        if (!block_states[block_index].reached) {
+            block_states[block_index].reached = true;
+            worklist.insert(block_index);
+            if (!run_worklist()) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Calculates the absolute addresses of position-independent jump tables.
+void relocate_got_jump_tables(const N64Recomp::Context& context, const N64Recomp::Function& func, std::span<N64Recomp::JumpTable> jump_tables) {
+    const N64Recomp::Section* section = &context.sections[func.section_index];
+    std::optional<uint32_t> got_ram_addr = section->got_ram_addr;
+
     if (got_ram_addr.has_value()) {
         uint32_t got_rom_addr = got_ram_addr.value() + func.rom - func.vram;
 
-        for (size_t i = 0; i < stats.jump_tables.size(); i++) {
-            JumpTable& cur_jtbl = stats.jump_tables[i];
-
+        for (N64Recomp::JumpTable& cur_jtbl : jump_tables) {
             if (cur_jtbl.got_offset.has_value()) {
                 uint32_t got_word = byteswap(*reinterpret_cast<const uint32_t*>(&context.rom[got_rom_addr + cur_jtbl.got_offset.value()]));
 
@@ -295,30 +667,41 @@ bool N64Recomp::analyze_function(const N64Recomp::Context& context, const N64Rec
             }
         }
     }
+}
+
+// Sorts the jump tables by address and reads their entries.
+bool determine_jump_table_entries(const N64Recomp::Context& context, const N64Recomp::Function& func, std::vector<N64Recomp::JumpTable>& jump_tables) {
+    std::optional<uint32_t> got_ram_addr = context.sections[func.section_index].got_ram_addr;
 
     // Sort jump tables by their address
-    std::sort(stats.jump_tables.begin(), stats.jump_tables.end(),
-        [](const JumpTable& a, const JumpTable& b)
+    std::sort(jump_tables.begin(), jump_tables.end(),
+        [](const N64Recomp::JumpTable& a, const N64Recomp::JumpTable& b)
     {
         return a.vram < b.vram;
     });
 
     // Determine jump table sizes
-    for (size_t i = 0; i < stats.jump_tables.size(); i++) {
-        JumpTable& cur_jtbl = stats.jump_tables[i];
+    for (size_t i = 0; i < jump_tables.size(); i++) {
+        N64Recomp::JumpTable& cur_jtbl = jump_tables[i];
         uint32_t end_address = (uint32_t)-1;
         uint32_t entry_count = 0;
         uint32_t vram = cur_jtbl.vram;
 
-        if (i < stats.jump_tables.size() - 1) {
-            end_address = stats.jump_tables[i + 1].vram;
+        if (i < jump_tables.size() - 1) {
+            end_address = jump_tables[i + 1].vram;
         }
 
         // TODO this assumes that the jump table is in the same section as the function itself
         cur_jtbl.rom = cur_jtbl.vram + func.rom - func.vram;
         cur_jtbl.section_index = func.section_index;
+        cur_jtbl.entries.clear();
 
         while (vram < end_address) {
+            // Stop at the bound from the jump's range check if there is one
+            if (cur_jtbl.entry_bound.has_value() && cur_jtbl.entries.size() >= cur_jtbl.entry_bound.value()) {
+                break;
+            }
+
             // Retrieve the current entry of the jump table
             // TODO same as above
             uint32_t rom_addr = vram + func.rom - func.vram;
@@ -349,3 +732,417 @@ bool N64Recomp::analyze_function(const N64Recomp::Context& context, const N64Rec
 
     return true;
 }
+
+// Reads the entries of each function pointer table and finds the functions they point to. Only functions that are the sole function at
+// their address and aren't in a relocatable section are used, as the value of a pointer to any other function can't be matched at runtime.
+void resolve_function_pointer_tables(const N64Recomp::Context& context, const N64Recomp::Function& func, std::vector<N64Recomp::FunctionPointerTable>& tables) {
+    if (context.use_lookup_for_all_function_calls) {
+        tables.clear();
+        return;
+    }
+
+    // Finds the section that holds the given address, preferring the function's own section. Returns nullptr if there's no single match.
+    auto find_section = [&](uint32_t vram) -> const N64Recomp::Section* {
+        auto in_section = [vram](const N64Recomp::Section& section) {
+            return section.rom_addr != (uint32_t)-1 && vram >= section.ram_addr && vram < section.ram_addr + section.size;
+        };
+
+        if (in_section(context.sections[func.section_index])) {
+            return &context.sections[func.section_index];
+        }
+
+        const N64Recomp::Section* ret = nullptr;
+        for (const N64Recomp::Section& section : context.sections) {
+            if (in_section(section)) {
+                if (ret != nullptr) {
+                    return nullptr;
+                }
+                ret = &section;
+            }
+        }
+        return ret;
+    };
+
+    auto find_function = [&](uint32_t vram) -> size_t {
+        auto find_it = context.functions_by_vram.find(vram);
+        if (find_it == context.functions_by_vram.end() || find_it->second.size() != 1) {
+            return (size_t)-1;
+        }
+        size_t func_index = find_it->second[0];
+        const N64Recomp::Function& target_func = context.functions[func_index];
+        if (target_func.words.empty() || context.sections[target_func.section_index].relocatable) {
+            return (size_t)-1;
+        }
+        return func_index;
+    };
+
+    for (N64Recomp::FunctionPointerTable& table : tables) {
+        const N64Recomp::Section* section = find_section(table.vram);
+        if (section == nullptr || (table.vram & 0b11) != 0) {
+            continue;
+        }
+
+        uint32_t max_entries = table.entry_bound.value_or(N64Recomp::max_function_pointer_table_entries);
+        max_entries = std::min(max_entries, N64Recomp::max_function_pointer_table_entries);
+        uint32_t section_end = section->ram_addr + section->size;
+
+        for (uint32_t entry_index = 0; entry_index < max_entries; entry_index++) {
+            uint32_t entry_vram = table.vram + entry_index * sizeof(uint32_t);
+            uint32_t entry_rom = entry_vram - section->ram_addr + section->rom_addr;
+            if (entry_vram + sizeof(uint32_t) > section_end || entry_rom + sizeof(uint32_t) > context.rom.size()) {
+                break;
+            }
+
+            // Stop at the first entry that isn't a usable function, as that's likely the end of the table
+            uint32_t entry_word = byteswap(*reinterpret_cast<const uint32_t*>(&context.rom[entry_rom]));
+            size_t func_index = find_function(entry_word);
+            if (func_index == (size_t)-1) {
+                break;
+            }
+            if (std::find(table.candidates.begin(), table.candidates.end(), func_index) == table.candidates.end()) {
+                table.candidates.push_back(func_index);
+            }
+        }
+    }
+
+    // Drop any tables that had no usable entries
+    std::erase_if(tables, [](const N64Recomp::FunctionPointerTable& table) {
+        return table.candidates.empty();
+    });
+}
+
+// Returns the number of bytes accessed by a load or store, or 0 if the instruction isn't one.
+uint32_t memory_access_size(InstrId instr_id) {
+    switch (instr_id) {
+        case InstrId::cpu_lb:
+        case InstrId::cpu_lbu:
+        case InstrId::cpu_sb:
+            return 1;
+        case InstrId::cpu_lh:
+        case InstrId::cpu_lhu:
+        case InstrId::cpu_sh:
+            return 2;
+        case InstrId::cpu_lw:
+        case InstrId::cpu_lwu:
+        case InstrId::cpu_lwl:
+        case InstrId::cpu_lwr:
+        case InstrId::cpu_lwc1:
+        case InstrId::cpu_sw:
+        case InstrId::cpu_swl:
+        case InstrId::cpu_swr:
+        case InstrId::cpu_swc1:
+            return 4;
+        case InstrId::cpu_ld:
+        case InstrId::cpu_ldl:
+        case InstrId::cpu_ldr:
+        case InstrId::cpu_ldc1:
+        case InstrId::cpu_sd:
+        case InstrId::cpu_sdl:
+        case InstrId::cpu_sdr:
+        case InstrId::cpu_sdc1:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+bool has_delay_slot(const rabbitizer::InstructionCpu& instr) {
+    InstrId instr_id = instr.getUniqueId();
+    return instr.isBranch() || instr_id == InstrId::cpu_j || instr_id == InstrId::cpu_jal || instr_id == InstrId::cpu_jr || instr_id == InstrId::cpu_jalr;
+}
+
+bool uses_gpr(const rabbitizer::InstructionCpu& instr, int reg) {
+    return (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rs) && (int)instr.GetO32_rs() == reg) ||
+        (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rt) && (int)instr.GetO32_rt() == reg) ||
+        (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rd) && (int)instr.GetO32_rd() == reg);
+}
+
+// Finds the stack slots that can be held in locals instead of memory. This requires the function's stack frame to never escape: $sp may only
+// be used as the base of loads and stores, besides a single prologue that allocates the frame and epilogues that free it on the way out of the function.
+// Every stack access then happens with $sp at the same value, so any slot that's only accessed as a whole by lw/sw or ld/sd can be promoted.
+void find_stack_slots(const N64Recomp::Function& func, const std::vector<rabbitizer::InstructionCpu>& instructions, const N64Recomp::ControlFlowGraph& cfg,
+    std::vector<N64Recomp::StackSlot>& slots) {
+    constexpr int sp = (int)RegId::GPR_O32_sp;
+    constexpr int ra = (int)RegId::GPR_O32_ra;
+    slots.clear();
+
+    // Function hooks may access the stack, so don't promote anything in hooked functions.
+    if (!func.function_hooks.empty() || cfg.blocks.empty()) {
+        return;
+    }
+
+    uint32_t func_vram_end = func.vram + instructions.size() * sizeof(uint32_t);
+    const N64Recomp::BasicBlock& entry_block = cfg.blocks[0];
+    size_t entry_body_end = entry_block.branch_index == (size_t)-1 ? entry_block.end_index : entry_block.branch_index;
+
+    auto is_function_exit = [&](size_t instr_index) {
+        const rabbitizer::InstructionCpu& instr = instructions[instr_index];
+        InstrId instr_id = instr.getUniqueId();
+        if (instr_id == InstrId::cpu_jr) {
+            return (int)instr.GetO32_rs() == ra;
+        }
+        if (instr_id == InstrId::cpu_j) {
+            uint32_t target = (uint32_t)instr.getBranchVramGeneric();
+            return target < func.vram || target >= func_vram_end;
+        }
+        return false;
+    };
+
+    // Checks that nothing can run between an epilogue and leaving the function, either because it's in the delay slot of the exit or because
+    // it's directly followed by an exit that isn't a branch target and has a delay slot that doesn't use $sp.
+    auto is_epilogue = [&](size_t instr_index) {
+        if (cfg.blocks_by_vram.contains(instructions[instr_index].getVram())) {
+            return false;
+        }
+        if (instr_index > 0 && has_delay_slot(instructions[instr_index - 1])) {
+            return is_function_exit(instr_index - 1);
+        }
+        if (instr_index + 2 >= instructions.size() || !is_function_exit(instr_index + 1)) {
+            return false;
+        }
+        return !cfg.blocks_by_vram.contains(instructions[instr_index + 1].getVram()) && !uses_gpr(instructions[instr_index + 2], sp);
+    };
+
+    struct SlotUsage {
+        uint32_t size;
+        bool loaded;
+        bool stored;
+        // Whether the slot is only accessed by lw/sw or ld/sd with a consistent size and isn't overlapped by any other access.
+        bool promotable;
+    };
+
+    std::map<int32_t, SlotUsage> usages{};
+    int32_t frame_size = 0;
+    bool makes_calls = false;
+    // Lowest offset that the prologue saves a callee-saved register to, which is the bottom of the register save area.
+    int32_t save_area_start = std::numeric_limits<int32_t>::max();
+    // Callee-saved registers that have been written in the entry block, as storing those isn't saving the caller's value.
+    uint32_t written_saved_regs = 0;
+
+    auto is_callee_saved = [](int reg) {
+        return (reg >= (int)RegId::GPR_O32_s0 && reg <= (int)RegId::GPR_O32_s7) || reg == (int)RegId::GPR_O32_fp || reg == ra;
+    };
+
+    for (size_t instr_index = 0; instr_index < instructions.size(); instr_index++) {
+        const rabbitizer::InstructionCpu& instr = instructions[instr_index];
+        InstrId instr_id = instr.getUniqueId();
+
+        // Track writes to callee-saved registers in the entry block up to the first call, which is where the prologue saves them.
+        if (instr_index < entry_body_end && !makes_calls) {
+            if (instr.modifiesRd() && is_callee_saved((int)instr.GetO32_rd())) {
+                written_saved_regs |= 1u << (int)instr.GetO32_rd();
+            }
+            if (instr.modifiesRt() && is_callee_saved((int)instr.GetO32_rt())) {
+                written_saved_regs |= 1u << (int)instr.GetO32_rt();
+            }
+        }
+
+        if (instr_id == InstrId::cpu_jal || instr_id == InstrId::cpu_jalr) {
+            makes_calls = true;
+        }
+        else {
+            auto find_branch_it = N64Recomp::conditional_branch_ops.find(instr_id);
+            if (find_branch_it != N64Recomp::conditional_branch_ops.end() && find_branch_it->second.link) {
+                makes_calls = true;
+            }
+        }
+
+        if (!uses_gpr(instr, sp)) {
+            continue;
+        }
+
+        uint32_t access_size = memory_access_size(instr_id);
+        if (access_size != 0) {
+            // Storing $sp or loading into it, or accessing the stack before the frame has been allocated.
+            if ((int)instr.GetO32_rs() != sp || (instr.hasOperandAlias(rabbitizer::OperandType::cpu_rt) && (int)instr.GetO32_rt() == sp) || frame_size == 0) {
+                return;
+            }
+
+            bool is_load = instr_id == InstrId::cpu_lw || instr_id == InstrId::cpu_ld;
+            bool is_store = instr_id == InstrId::cpu_sw || instr_id == InstrId::cpu_sd;
+            int32_t offset = (int16_t)instr.Get_immediate();
+
+            if (is_store && instr_index < entry_body_end && !makes_calls) {
+                int stored_reg = (int)instr.GetO32_rt();
+                if (is_callee_saved(stored_reg) && !(written_saved_regs & (1u << stored_reg))) {
+                    save_area_start = std::min(save_area_start, offset);
+                }
+            }
+
+            auto [usage_it, inserted] = usages.emplace(offset, SlotUsage{ access_size, false, false, true });
+            SlotUsage& usage = usage_it->second;
+            usage.loaded |= is_load;
+            usage.stored |= is_store;
+            if ((!is_load && !is_store) || usage.size != access_size) {
+                usage.promotable = false;
+            }
+            continue;
+        }
+
+        if (instr_id == InstrId::cpu_addiu && (int)instr.GetO32_rs() == sp && (int)instr.GetO32_rt() == sp) {
+            int32_t adjust = (int16_t)instr.Get_immediate();
+            // The prologue, which has to be in the entry block before anything that could branch.
+            if (adjust < 0 && frame_size == 0 && instr_index < entry_body_end) {
+                frame_size = -adjust;
+                continue;
+            }
+            if (adjust > 0 && adjust == frame_size && is_epilogue(instr_index)) {
+                continue;
+            }
+        }
+
+        // Any other use of $sp means the frame may escape.
+        return;
+    }
+
+    if (frame_size == 0) {
+        return;
+    }
+
+    // Accesses that overlap can't be promoted, as they'd see different values.
+    for (auto it = usages.begin(); it != usages.end(); ++it) {
+        for (auto next_it = std::next(it); next_it != usages.end() && next_it->first < it->first + (int32_t)it->second.size; ++next_it) {
+            it->second.promotable = false;
+            next_it->second.promotable = false;
+        }
+    }
+
+    // The bottom of the frame holds the argument save area and any stack arguments for calls made by this function, which the callee
+    // may read or write through memory, even for slots that this function loads again after the call. The size of that area isn't known,
+    // but it's always below the register save area, so only the register save area is promoted in functions that make calls.
+    int32_t min_offset = 0;
+    if (makes_calls) {
+        if (save_area_start == std::numeric_limits<int32_t>::max()) {
+            return;
+        }
+        min_offset = std::max(save_area_start, 0x10);
+    }
+
+    for (const auto& [offset, usage] : usages) {
+        if (!usage.promotable || offset < min_offset || offset + (int32_t)usage.size > frame_size || (offset % usage.size) != 0) {
+            continue;
+        }
+        if (makes_calls && !(usage.loaded && usage.stored)) {
+            continue;
+        }
+        slots.push_back({ offset, usage.size == 8 });
+    }
+}
+
+// Tags the instructions that belong to the function's jump tables, function pointer tables and promoted stack slots.
+void annotate_instructions(const N64Recomp::Function& func, const std::vector<rabbitizer::InstructionCpu>& instructions, N64Recomp::FunctionStats& stats) {
+    using N64Recomp::InstructionTag;
+    stats.annotations.assign(instructions.size(), {});
+
+    // The first table that an instruction belongs to is used if there are multiple.
+    auto annotate = [&](uint32_t vram, InstructionTag tag, size_t index) {
+        size_t instr_index = (vram - func.vram) / sizeof(uint32_t);
+        if (vram < func.vram || instr_index >= instructions.size()) {
+            return;
+        }
+        N64Recomp::InstructionAnnotation& annotation = stats.annotations[instr_index];
+        if (annotation.tag == InstructionTag::None) {
+            annotation.tag = tag;
+            annotation.index = (uint32_t)index;
+        }
+    };
+
+    for (size_t i = 0; i < stats.jump_tables.size(); i++) {
+        const N64Recomp::JumpTable& jtbl = stats.jump_tables[i];
+        annotate(jtbl.lw_vram, InstructionTag::JumpTableLoad, i);
+        annotate(jtbl.addu_vram, InstructionTag::JumpTableAddend, i);
+        annotate(jtbl.jr_vram, InstructionTag::JumpTableJump, i);
+    }
+
+    for (size_t i = 0; i < stats.function_pointer_tables.size(); i++) {
+        annotate(stats.function_pointer_tables[i].jalr_vram, InstructionTag::FunctionPointerCall, i);
+    }
+
+    if (stats.stack_slots.empty()) {
+        return;
+    }
+
+    for (const rabbitizer::InstructionCpu& instr : instructions) {
+        InstrId instr_id = instr.getUniqueId();
+        if ((int)instr.GetO32_rs() != (int)RegId::GPR_O32_sp ||
+            (instr_id != InstrId::cpu_lw && instr_id != InstrId::cpu_sw && instr_id != InstrId::cpu_ld && instr_id != InstrId::cpu_sd))
+        {
+            continue;
+        }
+
+        // The slots are sorted by offset.
+        int32_t offset = (int16_t)instr.Get_immediate();
+        auto find_it = std::lower_bound(stats.stack_slots.begin(), stats.stack_slots.end(), offset,
+            [](const N64Recomp::StackSlot& slot, int32_t offset) {
+                return slot.offset < offset;
+            });
+        if (find_it != stats.stack_slots.end() && find_it->offset == offset) {
+            annotate(instr.getVram(), InstructionTag::StackSlotAccess, std::distance(stats.stack_slots.begin(), find_it));
+        }
+    }
+}
+
+bool N64Recomp::analyze_function(const N64Recomp::Context& context, const N64Recomp::Function& func,
+    const std::vector<rabbitizer::InstructionCpu>& instructions, N64Recomp::FunctionStats& stats) {
+    const Section* section = &context.sections[func.section_index];
+    bool is_got_addr_defined = section->got_ram_addr.has_value();
+
+    std::vector<BlockState> block_states{};
+    FunctionStats found_stats{};
+    stats.jump_tables.clear();
+
+    // Look for jump tables by propagating register states through the function's control flow graph. The entries of any jump tables
+    // that are found become edges in the graph, which may lead to more jump tables (e.g. a switch nested in a case of another switch),
+    // so repeat until no new ones are found. Jump tables are kept once found, which guarantees that this terminates.
+    while (true) {
+        build_control_flow_graph(func, instructions, stats.jump_tables, stats.cfg);
+
+        if (!propagate_block_states(func, instructions, stats.cfg, block_states, is_got_addr_defined)) {
+            return false;
+        }
+
+        // Collect the jump tables and function pointer tables from the final state at each indirect jump and call
+        found_stats = {};
+        for (size_t block_index = 0; block_index < stats.cfg.blocks.size(); block_index++) {
+            const BasicBlock& block = stats.cfg.blocks[block_index];
+            size_t body_end = block.branch_index == (size_t)-1 ? block.end_index : block.branch_index + 1;
+
+            BlockState state = block_states[block_index];
+            for (size_t instr_index = block.start_index; instr_index < body_end; instr_index++) {
+                if (!analyze_instruction(instructions[instr_index], func, found_stats, state.reg_states, state.stack_states, is_got_addr_defined)) {
+                    return false;
+                }
+            }
+        }
+
+        size_t prev_count = stats.jump_tables.size();
+        for (JumpTable& jtbl : found_stats.jump_tables) {
+            bool known = std::any_of(stats.jump_tables.begin(), stats.jump_tables.end(),
+                [&jtbl](const JumpTable& cur) {
+                    return cur.jr_vram == jtbl.jr_vram;
+                });
+            if (!known) {
+                stats.jump_tables.emplace_back(std::move(jtbl));
+            }
+        }
+
+        if (stats.jump_tables.size() == prev_count) {
+            break;
+        }
+
+        relocate_got_jump_tables(context, func, std::span{ stats.jump_tables }.subspan(prev_count));
+
+        if (!determine_jump_table_entries(context, func, stats.jump_tables)) {
+            return false;
+        }
+    }
+
+    stats.function_pointer_tables = std::move(found_stats.function_pointer_tables);
+    resolve_function_pointer_tables(context, func, stats.function_pointer_tables);
+
+    find_stack_slots(func, instructions, stats.cfg, stats.stack_slots);
+
+    annotate_instructions(func, instructions, stats);
+
+    return true;
+}
@@ -2,6 +2,7 @@
 #define __RECOMP_ANALYSIS_H__
 
 #include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include "recompiler/context.h"
@@ -14,10 +15,74 @@ namespace N64Recomp {
         AbsoluteJump(uint32_t jump_target, uint32_t instruction_vram) : jump_target(jump_target), instruction_vram(instruction_vram) {}
     };
 
+    struct BlockEdge {
+        size_t block_index;
+        // Whether this edge is taken when the block's terminating branch is taken, as opposed to falling through.
+        bool taken;
+        // Whether this edge bypasses the delay slot of the block's terminating branch (the fallthrough of a likely branch).
+        bool skips_delay_slot;
+    };
+
+    struct BasicBlock {
+        // Index of the first instruction in the block.
+        size_t start_index;
+        // One past the index of the last instruction in the block, including the delay slot of the terminating branch if any.
+        size_t end_index;
+        // Index of the branch or jump that terminates this block, or (size_t)-1 if the block falls through into the next one.
+        size_t branch_index;
+        // Whether this block can be reached from the start of the function through known control flow.
+        bool reachable;
+        std::vector<BlockEdge> successors;
+        std::vector<size_t> predecessors;
+    };
+
+    struct ControlFlowGraph {
+        std::vector<BasicBlock> blocks;
+        // Maps the vram of the first instruction of each block to the block's index.
+        std::unordered_map<uint32_t, size_t> blocks_by_vram;
+    };
+
+    // The most entries that are read from a function pointer table, which limits the number of direct calls emitted for a jalr.
+    constexpr uint32_t max_function_pointer_table_entries = 64;
+
+    // A table of function pointers that a jalr calls through (e.g. a vtable or state machine table).
+    struct FunctionPointerTable {
+        uint32_t vram;
+        uint32_t lw_vram;
+        uint32_t jalr_vram;
+        // Exclusive upper bound on the entry index, taken from a range check on the index if one was found.
+        std::optional<uint32_t> entry_bound;
+        // Indices of the functions that the table's entries point to.
+        std::vector<size_t> candidates;
+    };
+
+    enum class InstructionTag : uint8_t {
+        None,
+        JumpTableLoad, // lw of a jump table entry
+        JumpTableAddend, // addu of a jump table's address and the entry offset
+        JumpTableJump, // jr through a jump table
+        FunctionPointerCall, // jalr through a function pointer table
+        StackSlotAccess, // lw/sw/ld/sd of a promoted stack slot
+    };
+
+    struct InstructionAnnotation {
+        InstructionTag tag = InstructionTag::None;
+        // Index into the jump tables, function pointer tables or stack slots depending on the tag.
+        uint32_t index = 0;
+    };
+
     struct FunctionStats {
         std::vector<JumpTable> jump_tables;
+        std::vector<FunctionPointerTable> function_pointer_tables;
+        // Stack slots that are promoted to locals, sorted by offset. Empty if the function's stack frame escapes.
+        std::vector<StackSlot> stack_slots;
+        // The role of each instruction in the above, indexed by instruction, so that recompilation doesn't need to search for them.
+        std::vector<InstructionAnnotation> annotations;
+        ControlFlowGraph cfg;
     };
 
+    // Splits the function into basic blocks, using the entries of the given jump tables as the targets of their jumps.
+    void build_control_flow_graph(const Function& function, const std::vector<rabbitizer::InstructionCpu>& instructions, const std::vector<JumpTable>& jump_tables, ControlFlowGraph& cfg);
     bool analyze_function(const Context& context, const Function& function, const std::vector<rabbitizer::InstructionCpu>& instructions, FunctionStats& stats);
 }
 
@@ -106,21 +106,24 @@ static std::string fpr_u64_to_string(int fpr_index) {
     return fmt::format("ctx->f{}.u64", fpr_index);
 }
 
-static std::string unsigned_reloc(const N64Recomp::InstructionContext& context) {
+static std::string unsigned_reloc(const N64Recomp::InstructionContext& context, std::optional<uint16_t> shared_section) {
+    // Shared bodies use the section they were called with in place of the section they were recompiled from.
+    std::string section_string = !context.reloc_tag_as_reference && shared_section.has_value() && context.reloc_section_index == shared_section.value() ?
+        "self_section" : std::to_string(context.reloc_section_index);
     switch (context.reloc_type) {
         case N64Recomp::RelocType::R_MIPS_HI16:
             return fmt::format("{}RELOC_HI16({}, {:#X})",
-                context.reloc_tag_as_reference ? "REF_" : "", context.reloc_section_index, context.reloc_target_section_offset);
+                context.reloc_tag_as_reference ? "REF_" : "", section_string, context.reloc_target_section_offset);
         case N64Recomp::RelocType::R_MIPS_LO16:
             return fmt::format("{}RELOC_LO16({}, {:#X})",
-                context.reloc_tag_as_reference ? "REF_" : "", context.reloc_section_index, context.reloc_target_section_offset);
+                context.reloc_tag_as_reference ? "REF_" : "", section_string, context.reloc_target_section_offset);
         default:
             throw std::runtime_error(fmt::format("Unexpected reloc type {}\n", static_cast<int>(context.reloc_type)));
     }
 }
 
-static std::string signed_reloc(const N64Recomp::InstructionContext& context) {
-    return "(int16_t)" + unsigned_reloc(context);
+static std::string signed_reloc(const N64Recomp::InstructionContext& context, std::optional<uint16_t> shared_section) {
+    return "(int16_t)" + unsigned_reloc(context, shared_section);
 }
 
 void N64Recomp::CGenerator::get_operand_string(Operand operand, UnaryOpType operation, const InstructionContext& context, std::string& operand_string) const {
@@ -181,7 +184,7 @@ void N64Recomp::CGenerator::get_operand_string(Operand operand, UnaryOpType oper
             break;
         case Operand::ImmU16:
             if (context.reloc_type != N64Recomp::RelocType::R_MIPS_NONE) {
-                operand_string = unsigned_reloc(context);
+                operand_string = unsigned_reloc(context, shared_section);
             }
             else {
                 operand_string = fmt::format("{:#X}", context.imm16);
@@ -189,7 +192,7 @@ void N64Recomp::CGenerator::get_operand_string(Operand operand, UnaryOpType oper
             break;
         case Operand::ImmS16:
             if (context.reloc_type != N64Recomp::RelocType::R_MIPS_NONE) {
-                operand_string = signed_reloc(context);
+                operand_string = signed_reloc(context, shared_section);
             }
             else {
                 operand_string = fmt::format("{:#X}", (int16_t)context.imm16);
@@ -392,20 +395,51 @@ void N64Recomp::CGenerator::get_binary_expr_string(BinaryOpType type, const Bina
     }
 }
 
+static std::string stack_slot_name(const N64Recomp::StackSlot& slot) {
+    return fmt::format("sp_{:04X}", slot.offset);
+}
+
+void N64Recomp::CGenerator::set_stack_slots(const std::vector<StackSlot>& slots) const {
+    stack_slots = slots;
+}
+
 void N64Recomp::CGenerator::emit_function_start(const std::string& function_name, size_t func_index) const {
     (void)func_index;
     fmt::print(output_file,
-        "RECOMP_FUNC void {}(uint8_t* rdram, recomp_context* ctx) {{\n"
+        "RECOMP_FUNC void {}(uint8_t* rdram, recomp_context* ctx{}) {{\n"
         // these variables shouldn't need to be preserved across function boundaries, so make them local for more efficient output
         "    uint64_t hi = 0, lo = 0, result = 0;\n"
         "    int c1cs = 0;\n", // cop1 conditional signal
-        function_name);
+        shared_section.has_value() ? get_shared_body_name(function_name) : function_name,
+        shared_section.has_value() ? ", uint16_t self_section" : "");
+    // promoted stack slots, which the compiler can keep in registers instead of going through rdram
+    for (const StackSlot& slot : stack_slots) {
+        fmt::print(output_file, "    {} {} = 0;\n", slot.doubleword ? "gpr" : "int32_t", stack_slot_name(slot));
+    }
 }
 
 void N64Recomp::CGenerator::emit_function_end() const {
     fmt::print(output_file, ";}}\n");
 }
 
+void N64Recomp::CGenerator::emit_stack_slot_load(const StackSlot& slot, int reg) const {
+    // Loads into $zero are discarded.
+    if (reg == 0) {
+        fmt::print(output_file, "\n");
+        return;
+    }
+    fmt::print(output_file, "{} = {};\n", gpr_to_string(reg), stack_slot_name(slot));
+}
+
+void N64Recomp::CGenerator::emit_stack_slot_store(const StackSlot& slot, int reg) const {
+    if (slot.doubleword) {
+        fmt::print(output_file, "{} = {};\n", stack_slot_name(slot), gpr_to_string(reg));
+    }
+    else {
+        fmt::print(output_file, "{} = (int32_t){};\n", stack_slot_name(slot), gpr_to_string(reg));
+    }
+}
+
 void N64Recomp::CGenerator::emit_function_call_lookup(uint32_t addr) const {
     fmt::print(output_file, "LOOKUP_FUNC(0x{:08X})(rdram, ctx);\n", addr);
 }
@@ -414,20 +448,39 @@ void N64Recomp::CGenerator::emit_function_call_by_register(int reg) const {
     fmt::print(output_file, "LOOKUP_FUNC({})(rdram, ctx);\n", gpr_to_string(reg));
 }
 
+void N64Recomp::CGenerator::emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const {
+    fmt::print(output_file, "switch ((uint32_t){}) {{\n", gpr_to_string(reg));
+    for (size_t function_index : function_indices) {
+        const Function& func = context.functions[function_index];
+        record_called_function(func.name);
+        fmt::print(output_file, "        case 0x{:08X}u: {}(rdram, ctx); break;\n", func.vram, func.name);
+    }
+    fmt::print(output_file, "        default: LOOKUP_FUNC({})(rdram, ctx); break;\n    }}\n", gpr_to_string(reg));
+}
+
 void N64Recomp::CGenerator::emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const {
     (void)target_section_offset;
     const N64Recomp::ReferenceSymbol& sym = context.get_reference_symbol(section_index, symbol_index);
+    record_called_function(sym.name);
     fmt::print(output_file, "{}(rdram, ctx);\n", sym.name);
 }
 
 void N64Recomp::CGenerator::emit_function_call(const Context& context, size_t function_index) const {
+    record_called_function(context.functions[function_index].name);
     fmt::print(output_file, "{}(rdram, ctx);\n", context.functions[function_index].name);
 }
 
 void N64Recomp::CGenerator::emit_named_function_call(const std::string& function_name) const {
+    record_called_function(function_name);
     fmt::print(output_file, "{}(rdram, ctx);\n", function_name);
 }
 
+void N64Recomp::CGenerator::record_called_function(const std::string& function_name) const {
+    if (called_functions != nullptr) {
+        called_functions->insert(function_name);
+    }
+}
+
 void N64Recomp::CGenerator::emit_goto(const std::string& target) const {
     fmt::print(output_file,
         "    goto {};\n", target);
@@ -455,6 +508,20 @@ void N64Recomp::CGenerator::emit_branch_close() const {
     fmt::print(output_file, "}}\n");
 }
 
+void N64Recomp::CGenerator::emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const {
+    thread_local std::string expr_string{};
+    get_binary_expr_string(op.comparison, op.operands, ctx, "", expr_string);
+    fmt::print(output_file, "if ({}) goto {};\n", expr_string, target);
+}
+
+void N64Recomp::CGenerator::emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const {
+    thread_local std::string expr_string{};
+    get_binary_expr_string(op.comparison, op.operands, ctx, "", expr_string);
+    const std::string& function_name = context.functions[function_index].name;
+    record_called_function(function_name);
+    fmt::print(output_file, "if ({}) {}(rdram, ctx);\n", expr_string, function_name);
+}
+
 void N64Recomp::CGenerator::emit_switch_close() const {
     fmt::print(output_file, "}}\n");
 }
@@ -516,6 +516,15 @@ N64Recomp::Config::Config(const char* path) {
             // Default to strict patch mode if a function reference symbol file was provided.
             strict_patch_mode = !func_reference_syms_file_path.empty();
         }
+
+        // Replace functions that recompile to the same code as an earlier function with a call to that function (optional, defaults to false).
+        std::optional<bool> deduplicate_functions_opt = input_data["deduplicate_functions"].value<bool>();
+        if (deduplicate_functions_opt.has_value()) {
+            deduplicate_functions = deduplicate_functions_opt.value();
+        }
+        else {
+            deduplicate_functions = false;
+        }
     }
     catch (const toml::parse_error& err) {
         std::cerr << "Syntax error parsing toml: " << *err.source().path << " (" << err.source().begin <<  "):\n" << err.description() << std::endl;
@@ -546,6 +555,11 @@ N64Recomp::RelocType reloc_type_from_name(const std::string& reloc_type_name) {
 }
 
 bool N64Recomp::Context::from_symbol_file(const std::filesystem::path& symbol_file_path, std::vector<uint8_t>&& rom, N64Recomp::Context& out, bool with_relocs) {
+    // Binary context files can be used in place of a symbol file.
+    if (is_context_bin_file(symbol_file_path)) {
+        return from_context_bin_file(symbol_file_path, std::move(rom), out, with_relocs);
+    }
+
     N64Recomp::Context ret{};
 
     try {
@@ -729,6 +743,11 @@ bool N64Recomp::Context::import_reference_context(const N64Recomp::Context& refe
 
 // Reads a data symbol file and adds its contents into this context's reference data symbols.
 bool N64Recomp::Context::read_data_reference_syms(const std::filesystem::path& data_syms_file_path) {
+    // Binary context files can be used in place of a data symbol file.
+    if (is_context_bin_file(data_syms_file_path)) {
+        return read_context_bin_data_reference_syms(data_syms_file_path);
+    }
+
     try {
         const toml::table data_syms_file_data = toml::parse_file(data_syms_file_path.u8string());
         const toml::node_view data_sections_value = data_syms_file_data["section"];
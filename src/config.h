@@ -47,6 +47,7 @@ namespace N64Recomp {
         bool trace_mode;
         bool allow_exports;
         bool strict_patch_mode;
+        bool deduplicate_functions;
         std::filesystem::path elf_path;
         std::filesystem::path symbols_file_path;
         std::filesystem::path func_reference_syms_file_path;
@@ -0,0 +1,624 @@
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+
+// Binary context files hold the same information as the function and data symbol files produced by dumping a context, i.e. every section
+// with functions along with its functions and relocs, and every section with data symbols along with its symbols.
+// Every field is a 32-bit value and every array is a multiple of 4 bytes in size, so the file can be memory mapped and its arrays
+// used in place without any copying or parsing.
+//
+// Layout:
+//   FileHeader
+//   SubHeaderV1
+//   String data (string_data_size bytes)
+//   SectionV1[num_sections]
+//   FuncV1[num_functions] (grouped by section, in section order)
+//   RelocV1[num_relocs] (grouped by section, in section order)
+//   DataSectionV1[num_data_sections]
+//   DataSymbolV1[num_data_symbols] (grouped by data section, in data section order)
+
+namespace {
+    struct FileHeader {
+        char magic[8]; // N64RCTXB
+        uint32_t version;
+    };
+
+    struct SubHeaderV1 {
+        uint32_t num_sections;
+        uint32_t num_functions;
+        uint32_t num_relocs;
+        uint32_t num_data_sections;
+        uint32_t num_data_symbols;
+        uint32_t string_data_size;
+    };
+
+    enum class SectionFlagsV1 : uint32_t {
+        HasGotAddress = 1 << 0,
+        Relocatable = 1 << 1,
+    };
+
+    struct SectionV1 {
+        uint32_t rom_addr;
+        uint32_t vram;
+        uint32_t size;
+        uint32_t got_ram_addr; // Only valid if HasGotAddress is set.
+        uint32_t flags;
+        uint32_t name_start; // offset into the string data
+        uint32_t name_size;
+        uint32_t num_funcs;
+        uint32_t num_relocs;
+    };
+
+    struct FuncV1 {
+        uint32_t vram;
+        uint32_t size;
+        uint32_t name_start;
+        uint32_t name_size;
+    };
+
+    struct RelocV1 {
+        uint32_t vram;
+        uint32_t target_vram;
+        uint32_t type;
+    };
+
+    enum class DataSectionFlagsV1 : uint32_t {
+        HasRomAddress = 1 << 0,
+    };
+
+    struct DataSectionV1 {
+        uint32_t rom_addr; // Only valid if HasRomAddress is set, otherwise the section holds absolute symbols.
+        uint32_t vram;
+        uint32_t size;
+        uint32_t flags;
+        uint32_t name_start;
+        uint32_t name_size;
+        uint32_t num_symbols;
+    };
+
+    struct DataSymbolV1 {
+        uint32_t vram;
+        uint32_t name_start;
+        uint32_t name_size;
+    };
+
+    constexpr char context_bin_magic[] = {'N','6','4','R','C','T','X','B'};
+    static_assert(sizeof(context_bin_magic) == sizeof(FileHeader::magic));
+
+    // Views of the arrays in a binary context file.
+    struct ContextBinV1 {
+        std::string_view string_data;
+        std::span<const SectionV1> sections;
+        std::span<const FuncV1> funcs;
+        std::span<const RelocV1> relocs;
+        std::span<const DataSectionV1> data_sections;
+        std::span<const DataSymbolV1> data_symbols;
+
+        bool get_string(uint32_t start, uint32_t size, std::string_view& out) const {
+            if (static_cast<size_t>(start) + size > string_data.size()) {
+                return false;
+            }
+            out = string_data.substr(start, size);
+            return true;
+        }
+    };
+
+    // Read-only mapping of a file into memory.
+    class MappedFile {
+    public:
+        MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+            file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (file_handle == INVALID_HANDLE_VALUE) {
+                return;
+            }
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file_handle, &file_size)) {
+                return;
+            }
+            size = static_cast<size_t>(file_size.QuadPart);
+            // Empty files can't be mapped.
+            if (size == 0) {
+                good_ = true;
+                return;
+            }
+            mapping_handle = CreateFileMappingW(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+            if (mapping_handle == NULL) {
+                return;
+            }
+            mapped = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+            good_ = mapped != nullptr;
+#else
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd == -1) {
+                return;
+            }
+            struct stat file_stat;
+            if (fstat(fd, &file_stat) != 0) {
+                return;
+            }
+            size = static_cast<size_t>(file_stat.st_size);
+            // Empty files can't be mapped.
+            if (size == 0) {
+                good_ = true;
+                return;
+            }
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                return;
+            }
+            mapped = static_cast<const char*>(mapping);
+            good_ = true;
+#endif
+        }
+
+        ~MappedFile() {
+#ifdef _WIN32
+            if (mapped != nullptr) {
+                UnmapViewOfFile(mapped);
+            }
+            if (mapping_handle != NULL) {
+                CloseHandle(mapping_handle);
+            }
+            if (file_handle != INVALID_HANDLE_VALUE) {
+                CloseHandle(file_handle);
+            }
+#else
+            if (mapped != nullptr) {
+                munmap(const_cast<char*>(mapped), size);
+            }
+            if (fd != -1) {
+                close(fd);
+            }
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool good() const {
+            return good_;
+        }
+
+        std::span<const char> data() const {
+            if (mapped == nullptr) {
+                return {};
+            }
+            return std::span<const char>{ mapped, size };
+        }
+    private:
+#ifdef _WIN32
+        HANDLE file_handle = INVALID_HANDLE_VALUE;
+        HANDLE mapping_handle = NULL;
+#else
+        int fd = -1;
+#endif
+        const char* mapped = nullptr;
+        size_t size = 0;
+        bool good_ = false;
+    };
+
+    template <typename T>
+    bool read_array(std::span<const char> data, size_t& offset, size_t count, std::span<const T>& out) {
+        if (offset + (sizeof(T) * count) > data.size()) {
+            return false;
+        }
+
+        out = std::span<const T>{ reinterpret_cast<const T*>(data.data() + offset), count };
+        offset += sizeof(T) * count;
+        return true;
+    }
+
+    bool parse_context_bin(std::span<const char> data, ContextBinV1& out) {
+        if (data.size() < sizeof(FileHeader)) {
+            fmt::print(stderr, "Binary context file is too small\n");
+            return false;
+        }
+
+        const FileHeader* header = reinterpret_cast<const FileHeader*>(data.data());
+        if (memcmp(header->magic, context_bin_magic, sizeof(context_bin_magic)) != 0) {
+            fmt::print(stderr, "Not a binary context file\n");
+            return false;
+        }
+
+        if (header->version != 1) {
+            fmt::print(stderr, "Unsupported binary context file version {}\n", header->version);
+            return false;
+        }
+
+        size_t offset = sizeof(FileHeader);
+        std::span<const SubHeaderV1> subheader;
+        if (!read_array(data, offset, 1, subheader)) {
+            fmt::print(stderr, "Binary context file is missing its sub-header\n");
+            return false;
+        }
+
+        if (subheader[0].string_data_size & 0b11) {
+            fmt::print(stderr, "Binary context file string data size of {} is not a multiple of 4\n", subheader[0].string_data_size);
+            return false;
+        }
+
+        std::span<const char> string_data;
+        if (!read_array(data, offset, subheader[0].string_data_size, string_data) ||
+            !read_array(data, offset, subheader[0].num_sections, out.sections) ||
+            !read_array(data, offset, subheader[0].num_functions, out.funcs) ||
+            !read_array(data, offset, subheader[0].num_relocs, out.relocs) ||
+            !read_array(data, offset, subheader[0].num_data_sections, out.data_sections) ||
+            !read_array(data, offset, subheader[0].num_data_symbols, out.data_symbols))
+        {
+            fmt::print(stderr, "Binary context file is truncated\n");
+            return false;
+        }
+        out.string_data = std::string_view{ string_data.data(), string_data.size() };
+
+        // Make sure the per-section counts add up to the array sizes, as they're used to find each section's entries.
+        size_t total_funcs = 0;
+        size_t total_relocs = 0;
+        for (const SectionV1& section : out.sections) {
+            total_funcs += section.num_funcs;
+            total_relocs += section.num_relocs;
+        }
+        size_t total_data_symbols = 0;
+        for (const DataSectionV1& data_section : out.data_sections) {
+            total_data_symbols += data_section.num_symbols;
+        }
+
+        if (total_funcs != out.funcs.size() || total_relocs != out.relocs.size() || total_data_symbols != out.data_symbols.size()) {
+            fmt::print(stderr, "Binary context file section entry counts don't match the file's contents\n");
+            return false;
+        }
+
+        return true;
+    }
+
+    uint32_t add_string(std::string& string_data, const std::string& str) {
+        uint32_t start = static_cast<uint32_t>(string_data.size());
+        string_data += str;
+        return start;
+    }
+
+    template <typename T>
+    void vec_put_array(std::vector<uint8_t>& vec, const std::vector<T>& data) {
+        size_t start_size = vec.size();
+        vec.resize(vec.size() + data.size() * sizeof(T));
+        if (!data.empty()) {
+            memcpy(vec.data() + start_size, data.data(), data.size() * sizeof(T));
+        }
+    }
+}
+
+bool N64Recomp::is_context_bin_file(const std::filesystem::path& path) {
+    std::ifstream file{ path, std::ios::binary };
+    char magic[sizeof(context_bin_magic)];
+    if (!file.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return memcmp(magic, context_bin_magic, sizeof(magic)) == 0;
+}
+
+std::vector<uint8_t> N64Recomp::context_to_bin_v1(const Context& context, const DataSymbolMap& data_syms) {
+    std::string string_data{};
+    std::vector<SectionV1> sections{};
+    std::vector<FuncV1> funcs{};
+    std::vector<RelocV1> relocs{};
+    std::vector<DataSectionV1> data_sections{};
+    std::vector<DataSymbolV1> data_symbols{};
+
+    auto add_data_section = [&](const std::vector<DataSymbol>& section_syms, const std::string& name, uint32_t rom_addr, uint32_t vram, uint32_t size) {
+        uint32_t flags = 0;
+        if (rom_addr != (uint32_t)-1) {
+            flags |= static_cast<uint32_t>(DataSectionFlagsV1::HasRomAddress);
+        }
+        data_sections.emplace_back(DataSectionV1{
+            .rom_addr = rom_addr,
+            .vram = vram,
+            .size = size,
+            .flags = flags,
+            .name_start = add_string(string_data, name),
+            .name_size = static_cast<uint32_t>(name.size()),
+            .num_symbols = static_cast<uint32_t>(section_syms.size())
+        });
+
+        for (const DataSymbol& cur_sym : section_syms) {
+            data_symbols.emplace_back(DataSymbolV1{
+                .vram = cur_sym.vram,
+                .name_start = add_string(string_data, cur_sym.name),
+                .name_size = static_cast<uint32_t>(cur_sym.name.size())
+            });
+        }
+    };
+
+    // Only sections with functions or data symbols are recorded, matching the symbol files that are produced when dumping a context.
+    for (size_t section_index = 0; section_index < context.sections.size(); section_index++) {
+        const Section& section = context.sections[section_index];
+        const std::vector<size_t>& section_funcs = context.section_functions[section_index];
+        if (!section_funcs.empty()) {
+            uint32_t section_flags = 0;
+            if (section.got_ram_addr.has_value()) {
+                section_flags |= static_cast<uint32_t>(SectionFlagsV1::HasGotAddress);
+            }
+            if (!section.relocs.empty()) {
+                section_flags |= static_cast<uint32_t>(SectionFlagsV1::Relocatable);
+            }
+
+            // Only relocs that target this section are recorded, as the symbol file format only holds relocs within a section.
+            size_t relocs_start = relocs.size();
+            for (const Reloc& reloc : section.relocs) {
+                if (reloc.target_section == section_index || reloc.target_section == section.bss_section_index) {
+                    if (reloc.type == RelocType::R_MIPS_HI16 || reloc.type == RelocType::R_MIPS_LO16 || reloc.type == RelocType::R_MIPS_26) {
+                        relocs.emplace_back(RelocV1{
+                            .vram = reloc.address,
+                            .target_vram = reloc.target_section_offset + section.ram_addr,
+                            .type = static_cast<uint32_t>(reloc.type)
+                        });
+                    }
+                }
+            }
+
+            for (size_t function_index : section_funcs) {
+                const Function& func = context.functions[function_index];
+                funcs.emplace_back(FuncV1{
+                    .vram = func.vram,
+                    .size = static_cast<uint32_t>(func.words.size() * sizeof(func.words[0])),
+                    .name_start = add_string(string_data, func.name),
+                    .name_size = static_cast<uint32_t>(func.name.size())
+                });
+            }
+
+            sections.emplace_back(SectionV1{
+                .rom_addr = section.rom_addr,
+                .vram = section.ram_addr,
+                .size = section.size,
+                .got_ram_addr = section.got_ram_addr.value_or(0),
+                .flags = section_flags,
+                .name_start = add_string(string_data, section.name),
+                .name_size = static_cast<uint32_t>(section.name.size()),
+                .num_funcs = static_cast<uint32_t>(section_funcs.size()),
+                .num_relocs = static_cast<uint32_t>(relocs.size() - relocs_start)
+            });
+        }
+
+        const auto find_syms_it = data_syms.find((uint16_t)section_index);
+        if (find_syms_it != data_syms.end() && !find_syms_it->second.empty()) {
+            add_data_section(find_syms_it->second, section.name, section.rom_addr, section.ram_addr, section.size);
+        }
+    }
+
+    const auto find_abs_syms_it = data_syms.find(SectionAbsolute);
+    if (find_abs_syms_it != data_syms.end() && !find_abs_syms_it->second.empty()) {
+        add_data_section(find_abs_syms_it->second, "ABSOLUTE_SYMS", (uint32_t)-1, 0, 0);
+    }
+
+    // Align the data after the strings to 4 bytes.
+    string_data.resize((string_data.size() + 3) & ~3);
+
+    const FileHeader header {
+        .magic = {'N','6','4','R','C','T','X','B'},
+        .version = 1
+    };
+
+    const SubHeaderV1 sub_header {
+        .num_sections = static_cast<uint32_t>(sections.size()),
+        .num_functions = static_cast<uint32_t>(funcs.size()),
+        .num_relocs = static_cast<uint32_t>(relocs.size()),
+        .num_data_sections = static_cast<uint32_t>(data_sections.size()),
+        .num_data_symbols = static_cast<uint32_t>(data_symbols.size()),
+        .string_data_size = static_cast<uint32_t>(string_data.size())
+    };
+
+    std::vector<uint8_t> ret{};
+    ret.reserve(sizeof(header) + sizeof(sub_header) + string_data.size() +
+        sections.size() * sizeof(SectionV1) + funcs.size() * sizeof(FuncV1) + relocs.size() * sizeof(RelocV1) +
+        data_sections.size() * sizeof(DataSectionV1) + data_symbols.size() * sizeof(DataSymbolV1));
+
+    ret.insert(ret.end(), reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header + 1));
+    ret.insert(ret.end(), reinterpret_cast<const uint8_t*>(&sub_header), reinterpret_cast<const uint8_t*>(&sub_header + 1));
+    ret.insert(ret.end(), string_data.begin(), string_data.end());
+    vec_put_array(ret, sections);
+    vec_put_array(ret, funcs);
+    vec_put_array(ret, relocs);
+    vec_put_array(ret, data_sections);
+    vec_put_array(ret, data_symbols);
+
+    return ret;
+}
+
+bool N64Recomp::Context::from_context_bin_file(const std::filesystem::path& context_bin_path, std::vector<uint8_t>&& rom, Context& out, bool with_relocs) {
+    MappedFile file{ context_bin_path };
+    if (!file.good()) {
+        fmt::print(stderr, "Failed to open binary context file: {}\n", context_bin_path.string());
+        return false;
+    }
+
+    ContextBinV1 bin{};
+    if (!parse_context_bin(file.data(), bin)) {
+        return false;
+    }
+
+    Context ret{};
+    ret.sections.resize(bin.sections.size());
+    ret.section_functions.resize(bin.sections.size());
+    ret.functions.reserve(bin.funcs.size());
+    ret.functions_by_name.reserve(bin.funcs.size());
+
+    size_t func_offset = 0;
+    size_t reloc_offset = 0;
+    for (size_t section_index = 0; section_index < bin.sections.size(); section_index++) {
+        const SectionV1& section_in = bin.sections[section_index];
+        Section& section = ret.sections[section_index];
+
+        std::string_view section_name;
+        if (!bin.get_string(section_in.name_start, section_in.name_size, section_name)) {
+            fmt::print(stderr, "Section {} in binary context file has an invalid name\n", section_index);
+            return false;
+        }
+
+        section.rom_addr = section_in.rom_addr;
+        section.ram_addr = section_in.vram;
+        section.size = section_in.size;
+        section.name = section_name;
+        if (section_in.flags & static_cast<uint32_t>(SectionFlagsV1::HasGotAddress)) {
+            section.got_ram_addr = section_in.got_ram_addr;
+        }
+        section.executable = true;
+        section.relocatable = (section_in.flags & static_cast<uint32_t>(SectionFlagsV1::Relocatable)) != 0;
+
+        // Read functions for the section.
+        ret.section_functions[section_index].reserve(section_in.num_funcs);
+        section.function_addrs.reserve(section_in.num_funcs);
+        for (const FuncV1& func_in : bin.funcs.subspan(func_offset, section_in.num_funcs)) {
+            size_t function_index = ret.functions.size();
+
+            std::string_view func_name;
+            if (!bin.get_string(func_in.name_start, func_in.name_size, func_name)) {
+                fmt::print(stderr, "Function {} in binary context file has an invalid name\n", function_index);
+                return false;
+            }
+
+            Function cur_func{};
+            cur_func.name = func_name;
+            cur_func.vram = func_in.vram;
+            cur_func.rom = cur_func.vram - section.ram_addr + section.rom_addr;
+            cur_func.section_index = static_cast<uint16_t>(section_index);
+
+            if (cur_func.vram & 0b11) {
+                fmt::print(stderr, "Function {}'s vram address isn't word aligned\n", cur_func.name);
+                return false;
+            }
+
+            if (cur_func.rom & 0b11) {
+                fmt::print(stderr, "Function {}'s rom address isn't word aligned\n", cur_func.name);
+                return false;
+            }
+
+            // Read the function's words if a rom was provided.
+            if (!rom.empty()) {
+                if (static_cast<size_t>(cur_func.rom) + func_in.size > rom.size()) {
+                    fmt::print(stderr, "Function {} is out of bounds of the provided rom\n", cur_func.name);
+                    return false;
+                }
+
+                const uint32_t* func_words = reinterpret_cast<const uint32_t*>(rom.data() + cur_func.rom);
+                cur_func.words.assign(func_words, func_words + func_in.size / sizeof(uint32_t));
+            }
+
+            section.function_addrs.push_back(cur_func.vram);
+            ret.functions_by_name[cur_func.name] = function_index;
+            ret.functions_by_vram[cur_func.vram].push_back(function_index);
+            ret.section_functions[section_index].push_back(function_index);
+
+            ret.functions.emplace_back(std::move(cur_func));
+        }
+        func_offset += section_in.num_funcs;
+
+        // Read relocs for the section.
+        if (with_relocs) {
+            section.relocs.reserve(section_in.num_relocs);
+            for (const RelocV1& reloc_in : bin.relocs.subspan(reloc_offset, section_in.num_relocs)) {
+                RelocType reloc_type = static_cast<RelocType>(reloc_in.type);
+
+                // Only the reloc types that context_to_bin_v1 emits are valid.
+                if (reloc_type != RelocType::R_MIPS_HI16 && reloc_type != RelocType::R_MIPS_LO16 && reloc_type != RelocType::R_MIPS_26) {
+                    fmt::print(stderr, "Invalid reloc type {} at 0x{:08X} in binary context file\n", reloc_in.type, reloc_in.vram);
+                    return false;
+                }
+
+                Reloc cur_reloc{};
+                cur_reloc.address = reloc_in.vram;
+                cur_reloc.target_section_offset = reloc_in.target_vram - section.ram_addr;
+                cur_reloc.symbol_index = (uint32_t)-1;
+                cur_reloc.target_section = static_cast<uint16_t>(section_index);
+                cur_reloc.type = reloc_type;
+
+                section.relocs.emplace_back(cur_reloc);
+            }
+        }
+        reloc_offset += section_in.num_relocs;
+    }
+
+    ret.rom = std::move(rom);
+    out = std::move(ret);
+    return true;
+}
+
+bool N64Recomp::Context::read_context_bin_data_reference_syms(const std::filesystem::path& context_bin_path) {
+    MappedFile file{ context_bin_path };
+    if (!file.good()) {
+        fmt::print(stderr, "Failed to open binary context file: {}\n", context_bin_path.string());
+        return false;
+    }
+
+    ContextBinV1 bin{};
+    if (!parse_context_bin(file.data(), bin)) {
+        return false;
+    }
+
+    // Create a mapping of rom address to section to ensure that the same section indexes are used for both function and data reference symbols.
+    std::unordered_map<uint32_t, uint16_t> ref_section_indices_by_vrom;
+
+    for (uint16_t section_index = 0; section_index < reference_sections.size(); section_index++) {
+        ref_section_indices_by_vrom.emplace(reference_sections[section_index].rom_addr, section_index);
+    }
+
+    reference_symbols.reserve(reference_symbols.size() + bin.data_symbols.size());
+    reference_symbols_by_name.reserve(reference_symbols_by_name.size() + bin.data_symbols.size());
+
+    size_t symbol_offset = 0;
+    for (size_t data_section_index = 0; data_section_index < bin.data_sections.size(); data_section_index++) {
+        const DataSectionV1& section_in = bin.data_sections[data_section_index];
+
+        uint16_t ref_section_index = N64Recomp::SectionAbsolute;
+        // Sections without a rom address are non-relocatable bss sections or absolute symbols, so mark their symbols as absolute.
+        if (section_in.flags & static_cast<uint32_t>(DataSectionFlagsV1::HasRomAddress)) {
+            // Find the matching section from the function reference symbol file. If there isn't one then this section can be treated as non-relocatable.
+            auto find_section_it = ref_section_indices_by_vrom.find(section_in.rom_addr);
+            if (find_section_it != ref_section_indices_by_vrom.end()) {
+                ref_section_index = find_section_it->second;
+            }
+        }
+
+        // Sanity check this section against the matching one in the function reference symbol file if one exists.
+        if (ref_section_index != N64Recomp::SectionAbsolute) {
+            const ReferenceSection& ref_section = reference_sections[ref_section_index];
+            if (ref_section.ram_addr != section_in.vram) {
+                fmt::print(stderr, "Data section {} vram address differs from matching ROM address section in the function symbol reference file\n", data_section_index);
+                return false;
+            }
+
+            if (ref_section.size != section_in.size) {
+                fmt::print(stderr, "Data section {} size differs from matching ROM address section in the function symbol reference file\n", data_section_index);
+                return false;
+            }
+        }
+
+        for (const DataSymbolV1& symbol_in : bin.data_symbols.subspan(symbol_offset, section_in.num_symbols)) {
+            std::string_view symbol_name;
+            if (!bin.get_string(symbol_in.name_start, symbol_in.name_size, symbol_name)) {
+                fmt::print(stderr, "Data symbol at 0x{:08X} in binary context file has an invalid name\n", symbol_in.vram);
+                return false;
+            }
+
+            if (!add_reference_symbol(std::string{ symbol_name }, ref_section_index, symbol_in.vram, false)) {
+                fmt::print(stderr, "Internal error: Failed to add reference symbol to context. Please report this issue.\n");
+                return false;
+            }
+        }
+        symbol_offset += section_in.num_symbols;
+    }
+
+    return true;
+}
@@ -0,0 +1,422 @@
+#include <set>
+#include <map>
+#include <thread>
+#include <algorithm>
+#include <optional>
+
+#include "rabbitizer.hpp"
+#include "fmt/format.h"
+
+#include "recompiler/context.h"
+#include "recompiler/operations.h"
+#include "analysis.h"
+
+using InstrId = rabbitizer::InstrId::UniqueId;
+using RegId = rabbitizer::Registers::Cpu::GprO32;
+
+namespace {
+    struct SectionDiscovery {
+        uint16_t section_index;
+        // Every known function start in the section, mapped to the function's size (or 0 if it hasn't been traced yet).
+        std::map<uint32_t, uint32_t> functions;
+        // Function starts that need to be traced in the current round.
+        std::vector<uint32_t> pending;
+        // Targets of the jals found during the current round, which may be in any section.
+        std::vector<uint32_t> call_targets;
+    };
+
+    class SectionReader {
+    public:
+        SectionReader(const N64Recomp::Context& context, const N64Recomp::Section& section) : context(context), section(section) {}
+
+        bool contains(uint32_t vram) const {
+            return vram >= section.ram_addr && vram < section.ram_addr + section.size && (vram & 0b11) == 0 &&
+                section.rom_addr + (vram - section.ram_addr) + sizeof(uint32_t) <= context.rom.size();
+        }
+
+        uint32_t rom_addr(uint32_t vram) const {
+            return section.rom_addr + (vram - section.ram_addr);
+        }
+
+        // Returns the word at the given address as it's stored in the rom.
+        uint32_t raw_word(uint32_t vram) const {
+            return *reinterpret_cast<const uint32_t*>(context.rom.data() + rom_addr(vram));
+        }
+
+        rabbitizer::InstructionCpu instruction(uint32_t vram) const {
+            return rabbitizer::InstructionCpu{ byteswap(raw_word(vram)), vram };
+        }
+
+        uint32_t end() const {
+            return section.ram_addr + section.size;
+        }
+    private:
+        const N64Recomp::Context& context;
+        const N64Recomp::Section& section;
+    };
+
+    // Runs jump table analysis over [start, end) and returns any jump tables used by the given indirect jumps.
+    std::vector<N64Recomp::JumpTable> find_jump_tables(const N64Recomp::Context& context, const SectionReader& reader, uint16_t section_index,
+        uint32_t start, uint32_t end, const std::set<uint32_t>& jr_vrams) {
+        std::vector<uint32_t> words{};
+        std::vector<rabbitizer::InstructionCpu> instructions{};
+        words.reserve((end - start) / sizeof(uint32_t));
+        instructions.reserve((end - start) / sizeof(uint32_t));
+
+        for (uint32_t vram = start; vram < end; vram += sizeof(uint32_t)) {
+            words.push_back(reader.raw_word(vram));
+            instructions.emplace_back(reader.instruction(vram));
+        }
+
+        N64Recomp::Function func{ start, reader.rom_addr(start), std::move(words), fmt::format("func_{:08X}", start), section_index };
+        N64Recomp::FunctionStats stats{};
+        if (!N64Recomp::analyze_function(context, func, instructions, stats)) {
+            return {};
+        }
+
+        std::vector<N64Recomp::JumpTable> ret{};
+        for (N64Recomp::JumpTable& jtbl : stats.jump_tables) {
+            if (jr_vrams.contains(jtbl.jr_vram)) {
+                ret.emplace_back(std::move(jtbl));
+            }
+        }
+        return ret;
+    }
+
+    // Follows the control flow of the function at the given address to find its size. Tracing stops at returns, tail calls and
+    // the next known function. Any jals that are found get recorded as call targets.
+    uint32_t trace_function(const N64Recomp::Context& context, const SectionReader& reader, SectionDiscovery& discovery, uint32_t start) {
+        auto next_func_it = discovery.functions.upper_bound(start);
+        uint32_t limit = next_func_it == discovery.functions.end() ? reader.end() : next_func_it->first;
+
+        auto in_function = [&](uint32_t vram) {
+            return vram >= start && vram < limit && reader.contains(vram);
+        };
+
+        std::set<uint32_t> visited{};
+        // Indirect jumps that haven't been matched to a jump table yet.
+        std::set<uint32_t> indirect_jumps{};
+        bool found_indirect_jump = false;
+        std::vector<uint32_t> worklist{ start };
+        uint32_t end = start;
+
+        auto visit = [&](uint32_t vram) {
+            visited.insert(vram);
+            end = std::max(end, vram + (uint32_t)sizeof(uint32_t));
+        };
+
+        while (true) {
+            while (!worklist.empty()) {
+                uint32_t vram = worklist.back();
+                worklist.pop_back();
+
+                while (in_function(vram) && !visited.contains(vram)) {
+                    visit(vram);
+                    rabbitizer::InstructionCpu instr = reader.instruction(vram);
+                    InstrId instr_id = instr.getUniqueId();
+                    bool ends_path = false;
+
+                    if (instr_id == InstrId::cpu_jal) {
+                        discovery.call_targets.push_back((uint32_t)instr.getBranchVramGeneric());
+                    }
+                    else if (N64Recomp::conditional_branch_ops.contains(instr_id)) {
+                        uint32_t target = (uint32_t)instr.getBranchVramGeneric();
+                        if (in_function(target)) {
+                            worklist.push_back(target);
+                        }
+                    }
+                    else if (instr_id == InstrId::cpu_b || instr_id == InstrId::cpu_j) {
+                        // A jump to an address within this function continues it, anything else is a tail call
+                        uint32_t target = (uint32_t)instr.getBranchVramGeneric();
+                        if (in_function(target)) {
+                            worklist.push_back(target);
+                        }
+                        ends_path = true;
+                    }
+                    else if (instr_id == InstrId::cpu_jr) {
+                        if ((int)instr.GetO32_rs() != (int)RegId::GPR_O32_ra) {
+                            found_indirect_jump |= indirect_jumps.insert(vram).second;
+                        }
+                        ends_path = true;
+                    }
+
+                    if (ends_path) {
+                        // Include the delay slot
+                        if (in_function(vram + 4)) {
+                            visit(vram + 4);
+                        }
+                        break;
+                    }
+                    vram += 4;
+                }
+            }
+
+            // Only analyze the function again if new indirect jumps were reached, as the analysis only covers the code traced so far.
+            if (!found_indirect_jump) {
+                break;
+            }
+            found_indirect_jump = false;
+
+            // Continue tracing through the cases of any jump tables
+            for (const N64Recomp::JumpTable& jtbl : find_jump_tables(context, reader, discovery.section_index, start, end, indirect_jumps)) {
+                indirect_jumps.erase(jtbl.jr_vram);
+                for (uint32_t entry : jtbl.entries) {
+                    if (in_function(entry) && !visited.contains(entry)) {
+                        worklist.push_back(entry);
+                    }
+                }
+            }
+
+            if (worklist.empty()) {
+                break;
+            }
+        }
+
+        return end - start;
+    }
+
+    // Records the targets of the jals in a function whose size is already known, which doesn't need to be traced.
+    void find_call_targets(const SectionReader& reader, SectionDiscovery& discovery, uint32_t start, uint32_t size) {
+        for (uint32_t vram = start; vram < start + size && reader.contains(vram); vram += sizeof(uint32_t)) {
+            rabbitizer::InstructionCpu instr = reader.instruction(vram);
+            if (instr.getUniqueId() == InstrId::cpu_jal) {
+                discovery.call_targets.push_back((uint32_t)instr.getBranchVramGeneric());
+            }
+        }
+    }
+
+    // Checks if the instruction is a stack frame allocation (addiu $sp, $sp, -N).
+    bool is_prologue(const rabbitizer::InstructionCpu& instr) {
+        return instr.getUniqueId() == InstrId::cpu_addiu &&
+            (int)instr.GetO32_rs() == (int)RegId::GPR_O32_sp &&
+            (int)instr.GetO32_rt() == (int)RegId::GPR_O32_sp &&
+            (int16_t)instr.Get_immediate() < 0;
+    }
+
+    // Looks for functions in the parts of the section that haven't been claimed by any traced function. A stack frame allocation
+    // is treated as the start of a function if it's the first instruction of the gap (after any padding) or directly follows a return.
+    std::vector<uint32_t> scan_gaps(const SectionReader& reader, const SectionDiscovery& discovery, uint32_t section_start) {
+        std::vector<uint32_t> ret{};
+
+        auto scan = [&](uint32_t gap_start, uint32_t gap_end) {
+            bool at_boundary = true;
+            bool after_return = false;
+            for (uint32_t vram = gap_start; vram < gap_end && reader.contains(vram); vram += 4) {
+                if (reader.raw_word(vram) == 0) {
+                    // Padding between functions
+                    continue;
+                }
+                rabbitizer::InstructionCpu instr = reader.instruction(vram);
+                if (at_boundary && is_prologue(instr)) {
+                    ret.push_back(vram);
+                    return;
+                }
+                at_boundary = false;
+                if (after_return) {
+                    // This was the delay slot of the return, so the next instruction may start a function
+                    at_boundary = true;
+                    after_return = false;
+                }
+                else if (instr.getUniqueId() == InstrId::cpu_jr && (int)instr.GetO32_rs() == (int)RegId::GPR_O32_ra) {
+                    after_return = true;
+                }
+            }
+        };
+
+        uint32_t cur = section_start;
+        for (const auto& [func_vram, func_size] : discovery.functions) {
+            if (func_vram > cur) {
+                scan(cur, func_vram);
+            }
+            cur = std::max(cur, func_vram + func_size);
+        }
+        scan(cur, reader.end());
+
+        return ret;
+    }
+}
+
+bool N64Recomp::Context::discover_functions(std::optional<uint32_t> entrypoint) {
+    std::vector<SectionDiscovery> discoveries{};
+    std::vector<SectionReader> readers{};
+
+    for (uint16_t section_index = 0; section_index < sections.size(); section_index++) {
+        const Section& section = sections[section_index];
+        if (!section.executable || section.size == 0) {
+            continue;
+        }
+        if (section.rom_addr + section.size > rom.size()) {
+            fmt::print(stderr, "Section {} is out of bounds of the rom\n", section.name);
+            return false;
+        }
+
+        SectionDiscovery& discovery = discoveries.emplace_back();
+        discovery.section_index = section_index;
+        readers.emplace_back(*this, section);
+    }
+
+    std::vector<size_t> discovery_by_section(sections.size(), (size_t)-1);
+    for (size_t i = 0; i < discoveries.size(); i++) {
+        discovery_by_section[discoveries[i].section_index] = i;
+    }
+
+    // Adds a function start to the given section's discovery. Returns whether it was new.
+    auto add_to_discovery = [&](size_t discovery_index, uint32_t vram) {
+        if (discoveries[discovery_index].functions.emplace(vram, 0).second) {
+            discoveries[discovery_index].pending.push_back(vram);
+            return true;
+        }
+        return false;
+    };
+
+    // Adds a function start referenced from the given section, or from outside of any section if no section is given. Overlays can
+    // share addresses with other sections, so the referencing section is used if it contains the address. Otherwise the address
+    // is added to the only section that contains it, and skipped if more than one section does. Returns whether it was new.
+    auto add_function_start = [&](std::optional<size_t> referencing_index, uint32_t vram) {
+        if (referencing_index.has_value() && readers[referencing_index.value()].contains(vram)) {
+            return add_to_discovery(referencing_index.value(), vram);
+        }
+
+        std::optional<size_t> found_index{};
+        for (size_t i = 0; i < discoveries.size(); i++) {
+            if (readers[i].contains(vram)) {
+                if (found_index.has_value()) {
+                    return false;
+                }
+                found_index = i;
+            }
+        }
+        return found_index.has_value() && add_to_discovery(found_index.value(), vram);
+    };
+
+    // Seed the search with the entrypoint and any functions that are already known. Known functions keep their sizes and only
+    // need to be scanned for calls, unless they have no size in which case they're traced like any other function.
+    for (const Function& func : functions) {
+        size_t discovery_index = func.section_index < discovery_by_section.size() ? discovery_by_section[func.section_index] : (size_t)-1;
+        if (discovery_index == (size_t)-1) {
+            continue;
+        }
+        if (func.words.empty()) {
+            add_to_discovery(discovery_index, func.vram);
+            continue;
+        }
+        uint32_t func_size = func.words.size() * sizeof(func.words[0]);
+        SectionDiscovery& discovery = discoveries[discovery_index];
+        if (discovery.functions.insert_or_assign(func.vram, func_size).second) {
+            find_call_targets(readers[discovery_index], discovery, func.vram, func_size);
+        }
+    }
+    if (entrypoint.has_value()) {
+        add_function_start(std::nullopt, entrypoint.value());
+    }
+
+    while (true) {
+        // Trace every pending function, with each section on its own thread.
+        std::vector<std::thread> threads{};
+        threads.reserve(discoveries.size());
+        for (size_t i = 0; i < discoveries.size(); i++) {
+            threads.emplace_back([this, &discoveries, &readers, i]() {
+                SectionDiscovery& discovery = discoveries[i];
+                for (uint32_t start : discovery.pending) {
+                    discovery.functions[start] = trace_function(*this, readers[i], discovery, start);
+                }
+                discovery.pending.clear();
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        // Every jal target is the start of a function.
+        bool found_new = false;
+        for (size_t i = 0; i < discoveries.size(); i++) {
+            for (uint32_t target : discoveries[i].call_targets) {
+                found_new |= add_function_start(i, target);
+            }
+            discoveries[i].call_targets.clear();
+        }
+
+        if (found_new) {
+            continue;
+        }
+
+        // Once calls have been exhausted, look for functions that are never called directly by their prologues.
+        threads.clear();
+        std::vector<std::vector<uint32_t>> gap_functions(discoveries.size());
+        for (size_t i = 0; i < discoveries.size(); i++) {
+            threads.emplace_back([this, &discoveries, &readers, &gap_functions, i]() {
+                gap_functions[i] = scan_gaps(readers[i], discoveries[i], sections[discoveries[i].section_index].ram_addr);
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        for (size_t i = 0; i < discoveries.size(); i++) {
+            for (uint32_t vram : gap_functions[i]) {
+                found_new |= add_to_discovery(i, vram);
+            }
+        }
+
+        if (!found_new) {
+            break;
+        }
+    }
+
+    // Add the discovered functions into the context. Functions that were discovered after a function containing them was traced
+    // cut that function short.
+    for (size_t i = 0; i < discoveries.size(); i++) {
+        const SectionDiscovery& discovery = discoveries[i];
+        const SectionReader& reader = readers[i];
+        uint16_t section_index = discovery.section_index;
+        Section& section = sections[section_index];
+
+        for (auto it = discovery.functions.begin(); it != discovery.functions.end(); ++it) {
+            uint32_t vram = it->first;
+            auto find_vram_it = functions_by_vram.find(vram);
+            if (find_vram_it != functions_by_vram.end() &&
+                std::any_of(find_vram_it->second.begin(), find_vram_it->second.end(), [&](size_t func_index) { return functions[func_index].section_index == section_index; }))
+            {
+                continue;
+            }
+
+            uint32_t end = vram + it->second;
+            auto next_it = std::next(it);
+            if (next_it != discovery.functions.end()) {
+                end = std::min(end, next_it->first);
+            }
+            if (end == vram) {
+                continue;
+            }
+
+            std::vector<uint32_t> words{};
+            words.reserve((end - vram) / sizeof(uint32_t));
+            for (uint32_t cur_vram = vram; cur_vram < end; cur_vram += sizeof(uint32_t)) {
+                words.push_back(reader.raw_word(cur_vram));
+            }
+
+            // Functions at the same address in different overlays need the section in their names to keep them unique.
+            std::string name = fmt::format("func_{:08X}", vram);
+            if (functions_by_name.contains(name)) {
+                name = fmt::format("func_{}_{:08X}", section_index, vram);
+            }
+
+            size_t function_index = functions.size();
+            Function& func = functions.emplace_back(vram, reader.rom_addr(vram), std::move(words), std::move(name), section_index);
+
+            section.function_addrs.push_back(func.vram);
+            functions_by_name[func.name] = function_index;
+            functions_by_vram[func.vram].push_back(function_index);
+            section_functions[section_index].push_back(function_index);
+        }
+
+        // Keep each section's functions ordered by address.
+        std::sort(section_functions[section_index].begin(), section_functions[section_index].end(),
+            [this](size_t a, size_t b) {
+                return functions[a].vram < functions[b].vram;
+            });
+        std::sort(section.function_addrs.begin(), section.function_addrs.end());
+    }
+
+    return true;
+}
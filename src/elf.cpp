@@ -1,4 +1,7 @@
 #include <optional>
+#include <thread>
+#include <atomic>
+#include <algorithm>
 
 #include "fmt/format.h"
 // #include "fmt/ostream.h"
@@ -8,9 +11,76 @@
 
 #include "mdebug.h"
 
-bool read_symbols(N64Recomp::Context& context, const ELFIO::elfio& elf_file, ELFIO::section* symtab_section, const N64Recomp::ElfParsingConfig& elf_config, bool dumping_context, std::unordered_map<uint16_t, std::vector<N64Recomp::DataSymbol>>& data_syms) {
+// A symbol from the elf's symbol table. The symbol table is decoded into these up front so that relocations
+// can look up symbols by index from multiple threads.
+struct ElfSymbol {
+    std::string name;
+    ELFIO::Elf64_Addr value;
+    ELFIO::Elf_Xword size;
+    unsigned char bind;
+    unsigned char type;
+    ELFIO::Elf_Half section_index;
+    unsigned char other;
+};
+
+// Runs func(i) for every i in [0, count), spread across the given number of threads or one per hardware thread if thread_count is 0.
+template <typename Func>
+void parallel_for(size_t count, size_t thread_count, Func&& func) {
+    if (thread_count == 0) {
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    thread_count = std::min(thread_count, count);
+
+    if (thread_count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index{ 0 };
+    std::vector<std::thread> threads{};
+    threads.reserve(thread_count);
+    for (size_t thread_index = 0; thread_index < thread_count; thread_index++) {
+        threads.emplace_back([&]() {
+            size_t i;
+            while ((i = next_index++) < count) {
+                func(i);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+std::vector<ElfSymbol> decode_symbols(const ELFIO::elfio& elf_file, ELFIO::section* symtab_section, const N64Recomp::ElfParsingConfig& elf_config) {
+    // ELFIO can load section data lazily on the first call to get_data, so load the symbol table and its string table here
+    // before any threads read them.
+    symtab_section->get_data();
+    if (symtab_section->get_link() < elf_file.sections.size()) {
+        elf_file.sections[symtab_section->get_link()]->get_data();
+    }
+
+    const ELFIO::symbol_section_accessor symbols{ elf_file, symtab_section };
+    std::vector<ElfSymbol> ret(symbols.get_symbols_num());
+
+    // Decode the symbols in chunks, as decoding a single symbol is too little work to hand to a thread.
+    constexpr size_t chunk_size = 4096;
+    size_t chunk_count = (ret.size() + chunk_size - 1) / chunk_size;
+    parallel_for(chunk_count, elf_config.thread_count, [&](size_t chunk_index) {
+        size_t chunk_end = std::min(ret.size(), (chunk_index + 1) * chunk_size);
+        for (size_t sym_index = chunk_index * chunk_size; sym_index < chunk_end; sym_index++) {
+            ElfSymbol& sym = ret[sym_index];
+            symbols.get_symbol(sym_index, sym.name, sym.value, sym.size, sym.bind, sym.type, sym.section_index, sym.other);
+        }
+    });
+
+    return ret;
+}
+
+bool read_symbols(N64Recomp::Context& context, const ELFIO::elfio& elf_file, const std::vector<ElfSymbol>& symbols, const N64Recomp::ElfParsingConfig& elf_config, bool dumping_context, std::unordered_map<uint16_t, std::vector<N64Recomp::DataSymbol>>& data_syms) {
     bool found_entrypoint_func = false;
-    ELFIO::symbol_section_accessor symbols{ elf_file, symtab_section };
 
     std::unordered_map<uint16_t, uint16_t> bss_section_to_target_section{};
 
@@ -27,22 +97,19 @@ bool read_symbols(N64Recomp::Context& context, const ELFIO::elfio& elf_file, ELF
         }
     }
 
-    for (int sym_index = 0; sym_index < symbols.get_symbols_num(); sym_index++) {
-        std::string   name;
-        ELFIO::Elf64_Addr    value;
-        ELFIO::Elf_Xword     size;
-        unsigned char bind;
-        unsigned char type;
-        ELFIO::Elf_Half      section_index;
-        unsigned char other;
+    for (const ElfSymbol& symbol : symbols) {
+        // Read symbol properties
+        std::string   name = symbol.name;
+        ELFIO::Elf64_Addr    value = symbol.value;
+        ELFIO::Elf_Xword     size = symbol.size;
+        unsigned char bind = symbol.bind;
+        unsigned char type = symbol.type;
+        ELFIO::Elf_Half      section_index = symbol.section_index;
+        unsigned char other = symbol.other;
         bool ignored = false;
         bool reimplemented = false;
         bool recorded_symbol = false;
 
-        // Read symbol properties
-        symbols.get_symbol(sym_index, name, value, size, bind, type,
-            section_index, other);
-
         if (section_index == ELFIO::SHN_ABS && elf_config.use_absolute_symbols) {
             uint32_t vram = static_cast<uint32_t>(value);
             context.functions_by_vram[vram].push_back(context.functions.size());
@@ -220,7 +287,251 @@ std::optional<size_t> get_segment(const std::vector<SegmentEntry>& segments, ELF
     return std::nullopt;
 }
 
-ELFIO::section* read_sections(N64Recomp::Context& context, ELFIO::section*& mdebug_section_out, const N64Recomp::ElfParsingConfig& elf_config, const ELFIO::elfio& elf_file) {
+// Reads the relocations of a section from its reloc section if it has one, then sorts them. This only modifies the given section
+// and its own part of the ROM, so it can be run for multiple sections in parallel.
+bool read_section_relocs(N64Recomp::Context& context, size_t section_index, const ELFIO::elfio& elf_file, ELFIO::section* reloc_section,
+    const std::vector<ElfSymbol>& symbols, const N64Recomp::ElfParsingConfig& elf_config) {
+    N64Recomp::Section& section_out = context.sections[section_index];
+
+    if (reloc_section != nullptr) {
+        // Create an accessor for the reloc section
+        ELFIO::relocation_section_accessor rel_accessor{ elf_file, reloc_section };
+        // Allocate space for the relocs in this section
+        section_out.relocs.resize(rel_accessor.get_entries_num());
+        // Track consecutive identical HI16 relocs to handle the GNU extension to the o32 ABI.
+        int prev_hi_count = 0;
+        // Track whether the previous reloc was a LO16
+        bool prev_lo = false;
+        uint32_t prev_hi_immediate = 0;
+        uint32_t prev_hi_symbol = std::numeric_limits<uint32_t>::max();
+
+        for (size_t i = 0; i < section_out.relocs.size(); i++) {
+            // Get the current reloc
+            ELFIO::Elf64_Addr rel_offset;
+            ELFIO::Elf_Word rel_symbol;
+            unsigned int rel_type;
+            ELFIO::Elf_Sxword bad_rel_addend; // Addends aren't encoded in the reloc, so ignore this one
+            rel_accessor.get_entry(i, rel_offset, rel_symbol, rel_type, bad_rel_addend);
+
+            N64Recomp::Reloc& reloc_out = section_out.relocs[i];
+
+            // Get the real full_immediate by extracting the immediate from the instruction
+            uint32_t reloc_rom_addr = section_out.rom_addr + rel_offset - section_out.ram_addr;
+            uint32_t reloc_rom_word = byteswap(*reinterpret_cast<const uint32_t*>(context.rom.data() + reloc_rom_addr));
+            //context.rom section_out.rom_addr;
+
+            reloc_out.address = rel_offset;
+            reloc_out.symbol_index = rel_symbol;
+            reloc_out.type = static_cast<N64Recomp::RelocType>(rel_type);
+
+            if (rel_symbol >= symbols.size()) {
+                fmt::print(stderr, "Reloc {} in section {} references invalid symbol index {}\n", i, section_out.name, rel_symbol);
+                return false;
+            }
+            const std::string& rel_symbol_name = symbols[rel_symbol].name;
+            ELFIO::Elf_Half rel_symbol_section_index = symbols[rel_symbol].section_index;
+
+            uint32_t rel_section_vram = 0;
+            uint32_t rel_symbol_offset = 0;
+
+            // Remap relocations from the current section's bss section to itself.
+            // TODO Do this for any bss section and not just the current section's bss section?
+            if (rel_symbol_section_index == section_out.bss_section_index) {
+                rel_symbol_section_index = section_index;
+            }
+
+            // Check if the symbol is undefined and to know whether to look for it in the reference symbols.
+            if (rel_symbol_section_index == ELFIO::SHN_UNDEF) {
+                // Undefined sym, check the reference symbols.
+                N64Recomp::SymbolReference sym_ref;
+                if (!context.find_reference_symbol(rel_symbol_name, sym_ref)) {
+                    fmt::print(stderr, "Undefined symbol: {}, not found in input or reference symbols!\n",
+                        rel_symbol_name);
+                    return false;
+                }
+
+                reloc_out.reference_symbol = true;
+                // Replace the reloc's symbol index with the index into the reference symbol array.
+                rel_section_vram = 0;
+                reloc_out.target_section = sym_ref.section_index;
+                reloc_out.symbol_index = sym_ref.symbol_index;
+                const auto& reference_symbol = context.get_reference_symbol(reloc_out.target_section, reloc_out.symbol_index);
+                rel_symbol_offset = reference_symbol.section_offset;
+
+                bool target_section_relocatable = context.is_reference_section_relocatable(reloc_out.target_section);
+
+                if (reloc_out.type == N64Recomp::RelocType::R_MIPS_32 && target_section_relocatable) {
+                    fmt::print(stderr, "Cannot reference {} in a statically initialized variable as it's defined in a relocatable section!\n",
+                        rel_symbol_name);
+                    return false;
+                }
+            }
+            else if (rel_symbol_section_index == ELFIO::SHN_ABS) {
+                reloc_out.reference_symbol = false;
+                reloc_out.target_section = N64Recomp::SectionAbsolute;
+                rel_section_vram = 0;
+            }
+            else {
+                reloc_out.reference_symbol = false;
+                reloc_out.target_section = rel_symbol_section_index;
+                // Handle special sections.
+                if (rel_symbol_section_index >= context.sections.size()) {
+                    fmt::print(stderr, "Reloc {} references symbol {} which is in an unknown section 0x{:04X}!\n",
+                        i, rel_symbol_name, rel_symbol_section_index);
+                    return false;
+                }
+                rel_section_vram = context.sections[rel_symbol_section_index].ram_addr;
+            }
+
+            // Reloc pairing, see MIPS System V ABI documentation page 4-18 (https://refspecs.linuxfoundation.org/elf/mipsabi.pdf)
+            if (reloc_out.type == N64Recomp::RelocType::R_MIPS_LO16) {
+                uint32_t rel_immediate = reloc_rom_word & 0xFFFF;
+                uint32_t full_immediate = (prev_hi_immediate << 16) + (int16_t)rel_immediate;
+                reloc_out.target_section_offset = full_immediate + rel_symbol_offset - rel_section_vram;
+                if (prev_hi_count != 0) {
+                    if (prev_hi_symbol != rel_symbol) {
+                        fmt::print(stderr, "Paired HI16 and LO16 relocations have different symbols\n"
+                                            "  LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
+                            i, section_out.name, reloc_out.symbol_index, reloc_out.address);
+                        return false;
+                    }
+
+                    // Set the previous HI16 relocs' relocated addresses.
+                    for (size_t paired_index = i - prev_hi_count; paired_index < i; paired_index++) {
+                        uint32_t hi_immediate = section_out.relocs[paired_index].target_section_offset;
+                        uint32_t paired_full_immediate = hi_immediate + (int16_t)rel_immediate;
+                        section_out.relocs[paired_index].target_section_offset = paired_full_immediate + rel_symbol_offset - rel_section_vram;
+                    }
+                }
+                else {
+                    // Orphaned LO16 reloc warnings.
+                    if (elf_config.unpaired_lo16_warnings) {
+                        if (prev_lo) {
+                            // Don't warn if multiple LO16 in a row reference the same symbol, as some linkers will use this behavior.
+                            if (prev_hi_symbol != rel_symbol) {
+                                fmt::print(stderr, "[WARN] LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X} follows LO16 with different symbol\n",
+                                    i, section_out.name, reloc_out.symbol_index, reloc_out.address);
+                            }
+                        }
+                        else {
+                            fmt::print(stderr, "[WARN] Unpaired LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
+                                i, section_out.name, reloc_out.symbol_index, reloc_out.address);
+                        }
+                    }
+                    // Even though this is an orphaned LO16 reloc, the previous calculation for the addend still follows the MIPS System V ABI documentation:
+                    // "R_MIPS_LO16 entries without an R_MIPS_HI16 entry immediately preceding are orphaned and the previously defined
+                    // R_MIPS_HI16 is used for computing the addend."
+                    // Therefore, nothing needs to be done to the section_offset member.
+                }
+                prev_lo = true;
+            } else {
+                // Allow a HI16 to follow another HI16 for the GNU ABI extension.
+                if (reloc_out.type != N64Recomp::RelocType::R_MIPS_HI16 && prev_hi_count != 0) {
+                    // This is an invalid elf as the MIPS System V ABI documentation states:
+                    // "Each relocation type of R_MIPS_HI16 must have an associated R_MIPS_LO16 entry
+                    // immediately following it in the list of relocations."
+                    fmt::print(stderr, "Unpaired HI16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
+                        i - 1, section_out.name, section_out.relocs[i - 1].symbol_index, section_out.relocs[i - 1].address);
+                    return false;
+                }
+                prev_lo = false;
+            }
+
+            if (reloc_out.type == N64Recomp::RelocType::R_MIPS_HI16) {
+                uint32_t rel_immediate = reloc_rom_word & 0xFFFF;
+                // First HI16, store its immediate.
+                if (prev_hi_count == 0) {
+                    prev_hi_immediate = rel_immediate;
+                    prev_hi_symbol = rel_symbol;
+                }
+                // HI16 that follows another HI16, ensure they reference the same symbol.
+                else {
+                    if (prev_hi_symbol != rel_symbol) {
+                        fmt::print(stderr, "HI16 reloc (index {} symbol {} offset 0x{:08X}) follows another HI16 reloc with a different symbol (index {} symbol {} offset 0x{:08X}) in section {}\n",
+                            i, rel_symbol, section_out.relocs[i].address,
+                            i - 1, prev_hi_symbol, section_out.relocs[i - 1].address,
+                            section_out.name);
+                        return false;
+                    }
+                }
+                // Populate the reloc temporarily, the full offset will be calculated upon pairing.
+                reloc_out.target_section_offset = rel_immediate << 16;
+                prev_hi_count++;
+            } else {
+                prev_hi_count = 0;
+            }
+
+            if (reloc_out.type == N64Recomp::RelocType::R_MIPS_32) {
+                // The reloc addend is just the existing word before relocation, so the section offset can just be the symbol's section offset.
+                // Incorporating the addend will be handled at load-time.
+                reloc_out.target_section_offset = rel_symbol_offset;
+                // TODO set section_out.has_mips32_relocs to true if this section should emit its mips32 relocs (mainly for TLB mapping).
+
+                if (reloc_out.reference_symbol) {
+                    uint32_t reloc_target_section_addr = context.get_reference_section_vram(reloc_out.target_section);
+                    // Patch the word in the ROM to incorporate the symbol's value.
+                    uint32_t updated_reloc_word = reloc_rom_word + reloc_target_section_addr + reloc_out.target_section_offset;
+                    *reinterpret_cast<uint32_t*>(context.rom.data() + reloc_rom_addr) = byteswap(updated_reloc_word);
+                }
+            }
+
+            if (reloc_out.type == N64Recomp::RelocType::R_MIPS_26) {
+                uint32_t rel_immediate = (reloc_rom_word & 0x3FFFFFF) << 2;
+                if (reloc_out.reference_symbol) {
+                    // Reference symbol relocs have their section offset already calculated, so don't apply the R_MIPS26 rule for the upper 4 bits.
+                    // TODO Find a way to unify this with the else case.
+                    reloc_out.target_section_offset = rel_immediate + rel_symbol_offset - rel_section_vram;
+                }
+                else {
+                    reloc_out.target_section_offset = rel_immediate + rel_symbol_offset + (section_out.ram_addr & 0xF0000000) - rel_section_vram;
+                }
+            }
+        }
+    }
+
+    // Sort this section's relocs by address, which allows for binary searching and more efficient iteration during recompilation.
+    // This is safe to do as the entire full_immediate in present in relocs due to the pairing that was done earlier, so the HI16 does not
+    // need to directly preceed the matching LO16 anymore.
+    std::sort(section_out.relocs.begin(), section_out.relocs.end(),
+        [](const N64Recomp::Reloc& a, const N64Recomp::Reloc& b) {
+            return a.address < b.address;
+        }
+    );
+
+    // Patch the ROM word for HI16 and LO16 reference symbol relocs to non-relocatable sections.
+    for (size_t i = 0; i < section_out.relocs.size(); i++) {
+        auto& reloc = section_out.relocs[i];
+        if (reloc.reference_symbol && (reloc.type == N64Recomp::RelocType::R_MIPS_HI16 || reloc.type == N64Recomp::RelocType::R_MIPS_LO16)) {
+            bool target_section_relocatable = context.is_reference_section_relocatable(reloc.target_section);
+            if (!target_section_relocatable) {
+                uint32_t reloc_rom_addr = reloc.address - section_out.ram_addr + section_out.rom_addr;
+                uint32_t reloc_rom_word = byteswap(*reinterpret_cast<const uint32_t*>(context.rom.data() + reloc_rom_addr));
+
+                uint32_t ref_section_vram = context.get_reference_section_vram(reloc.target_section);
+                uint32_t full_immediate = reloc.target_section_offset + ref_section_vram;
+
+                uint32_t imm;
+
+                if (reloc.type == N64Recomp::RelocType::R_MIPS_HI16) {
+                    imm = (full_immediate >> 16) + ((full_immediate >> 15) & 1);
+                }
+                else {
+                    imm = full_immediate & 0xFFFF;
+                }
+
+                *reinterpret_cast<uint32_t*>(context.rom.data() + reloc_rom_addr) = byteswap(reloc_rom_word | imm);
+                // Remove the reloc by setting it to a type of NONE.
+                reloc.type = N64Recomp::RelocType::R_MIPS_NONE;
+                reloc.reference_symbol = false;
+                reloc.symbol_index = (uint32_t)-1;
+            }
+        }
+    }
+
+    return true;
+}
+
+ELFIO::section* read_sections(N64Recomp::Context& context, ELFIO::section*& mdebug_section_out, std::vector<ElfSymbol>& symbols_out, const N64Recomp::ElfParsingConfig& elf_config, const ELFIO::elfio& elf_file) {
     ELFIO::section* symtab_section = nullptr;
     std::vector<SegmentEntry> segments{};
     segments.resize(elf_file.segments.size());
@@ -349,12 +660,9 @@ ELFIO::section* read_sections(N64Recomp::Context& context, ELFIO::section*& mdeb
         return nullptr;
     }
 
-    ELFIO::symbol_section_accessor symbol_accessor{ elf_file, symtab_section };
-    auto num_syms = symbol_accessor.get_symbols_num();
-
     // TODO make sure that a reloc section was found for every section marked as relocatable
 
-    // Process bss and reloc sections
+    // Process bss sections
     for (size_t section_index = 0; section_index < context.sections.size(); section_index++) {
         N64Recomp::Section& section_out = context.sections[section_index];
         // Check if a bss section was found that corresponds with this section
@@ -364,6 +672,21 @@ ELFIO::section* read_sections(N64Recomp::Context& context, ELFIO::section*& mdeb
             section_out.bss_size = bss_find->second->get_size();
             context.bss_section_to_section[section_out.bss_section_index] = section_index;
         }
+    }
+
+    // Decode the symbol table up front so that relocations can be read for each section in parallel. Reloc pairing only involves
+    // the relocs of a single section, so every section can be processed independently.
+    symbols_out = decode_symbols(elf_file, symtab_section, elf_config);
+
+    // The parallel reloc reads below rely on every reloc section's data already being loaded, as ELFIO may otherwise load it
+    // lazily from several threads at once.
+    for (const auto& [reloc_target_section, reloc_section] : reloc_sections_by_name) {
+        reloc_section->get_data();
+    }
+
+    std::vector<char> sections_good(context.sections.size(), true);
+    parallel_for(context.sections.size(), elf_config.thread_count, [&](size_t section_index) {
+        const N64Recomp::Section& section_out = context.sections[section_index];
 
         // Check if this section is in the ROM and relocatable.
         const ELFIO::section* elf_section = elf_file.sections[section_index];
@@ -372,245 +695,13 @@ ELFIO::section* read_sections(N64Recomp::Context& context, ELFIO::section*& mdeb
         if (in_rom && is_relocatable) {
             // Check if a reloc section was found that corresponds with this section
             auto reloc_find = reloc_sections_by_name.find(section_out.name);
-            if (reloc_find != reloc_sections_by_name.end()) {
-                // Create an accessor for the reloc section
-                ELFIO::relocation_section_accessor rel_accessor{ elf_file, reloc_find->second };
-                // Allocate space for the relocs in this section
-                section_out.relocs.resize(rel_accessor.get_entries_num());
-                // Track consecutive identical HI16 relocs to handle the GNU extension to the o32 ABI.
-                int prev_hi_count = 0;
-                // Track whether the previous reloc was a LO16
-                bool prev_lo = false;
-                uint32_t prev_hi_immediate = 0;
-                uint32_t prev_hi_symbol = std::numeric_limits<uint32_t>::max();
-
-                for (size_t i = 0; i < section_out.relocs.size(); i++) {
-                    // Get the current reloc
-                    ELFIO::Elf64_Addr rel_offset;
-                    ELFIO::Elf_Word rel_symbol;
-                    unsigned int rel_type;
-                    ELFIO::Elf_Sxword bad_rel_addend; // Addends aren't encoded in the reloc, so ignore this one
-                    rel_accessor.get_entry(i, rel_offset, rel_symbol, rel_type, bad_rel_addend);
-
-                    N64Recomp::Reloc& reloc_out = section_out.relocs[i];
-
-                    // Get the real full_immediate by extracting the immediate from the instruction
-                    uint32_t reloc_rom_addr = section_out.rom_addr + rel_offset - section_out.ram_addr;
-                    uint32_t reloc_rom_word = byteswap(*reinterpret_cast<const uint32_t*>(context.rom.data() + reloc_rom_addr));
-                    //context.rom section_out.rom_addr;
-
-                    reloc_out.address = rel_offset;
-                    reloc_out.symbol_index = rel_symbol;
-                    reloc_out.type = static_cast<N64Recomp::RelocType>(rel_type);
-
-                    std::string       rel_symbol_name;
-                    ELFIO::Elf64_Addr rel_symbol_value;
-                    ELFIO::Elf_Xword  rel_symbol_size;
-                    unsigned char     rel_symbol_bind;
-                    unsigned char     rel_symbol_type;
-                    ELFIO::Elf_Half   rel_symbol_section_index;
-                    unsigned char     rel_symbol_other;
-
-                    bool found_rel_symbol = symbol_accessor.get_symbol(
-                        rel_symbol, rel_symbol_name, rel_symbol_value, rel_symbol_size, rel_symbol_bind, rel_symbol_type, rel_symbol_section_index, rel_symbol_other);
-
-                    uint32_t rel_section_vram = 0;
-                    uint32_t rel_symbol_offset = 0;
-
-                    // Remap relocations from the current section's bss section to itself.
-                    // TODO Do this for any bss section and not just the current section's bss section?
-                    if (rel_symbol_section_index == section_out.bss_section_index) {
-                        rel_symbol_section_index = section_index;
-                    }
-
-                    // Check if the symbol is undefined and to know whether to look for it in the reference symbols.
-                    if (rel_symbol_section_index == ELFIO::SHN_UNDEF) {
-                        // Undefined sym, check the reference symbols.
-                        N64Recomp::SymbolReference sym_ref;
-                        if (!context.find_reference_symbol(rel_symbol_name, sym_ref)) {
-                            fmt::print(stderr, "Undefined symbol: {}, not found in input or reference symbols!\n",
-                                rel_symbol_name);
-                            return nullptr;
-                        }
-
-                        reloc_out.reference_symbol = true;
-                        // Replace the reloc's symbol index with the index into the reference symbol array.
-                        rel_section_vram = 0;
-                        reloc_out.target_section = sym_ref.section_index;
-                        reloc_out.symbol_index = sym_ref.symbol_index;
-                        const auto& reference_symbol = context.get_reference_symbol(reloc_out.target_section, reloc_out.symbol_index);
-                        rel_symbol_offset = reference_symbol.section_offset;
-
-                        bool target_section_relocatable = context.is_reference_section_relocatable(reloc_out.target_section);
-
-                        if (reloc_out.type == N64Recomp::RelocType::R_MIPS_32 && target_section_relocatable) {
-                            fmt::print(stderr, "Cannot reference {} in a statically initialized variable as it's defined in a relocatable section!\n",
-                                rel_symbol_name);
-                            return nullptr;
-                        }
-                    }
-                    else if (rel_symbol_section_index == ELFIO::SHN_ABS) {
-                        reloc_out.reference_symbol = false;
-                        reloc_out.target_section = N64Recomp::SectionAbsolute;
-                        rel_section_vram = 0;
-                    }
-                    else {
-                        reloc_out.reference_symbol = false;
-                        reloc_out.target_section = rel_symbol_section_index;
-                        // Handle special sections.
-                        if (rel_symbol_section_index >= context.sections.size()) {
-                            fmt::print(stderr, "Reloc {} references symbol {} which is in an unknown section 0x{:04X}!\n",
-                                i, rel_symbol_name, rel_symbol_section_index);
-                            return nullptr;
-                        }
-                        rel_section_vram = context.sections[rel_symbol_section_index].ram_addr;
-                    }
-
-                    // Reloc pairing, see MIPS System V ABI documentation page 4-18 (https://refspecs.linuxfoundation.org/elf/mipsabi.pdf)
-                    if (reloc_out.type == N64Recomp::RelocType::R_MIPS_LO16) {
-                        uint32_t rel_immediate = reloc_rom_word & 0xFFFF;
-                        uint32_t full_immediate = (prev_hi_immediate << 16) + (int16_t)rel_immediate;
-                        reloc_out.target_section_offset = full_immediate + rel_symbol_offset - rel_section_vram;
-                        if (prev_hi_count != 0) {
-                            if (prev_hi_symbol != rel_symbol) {
-                                fmt::print(stderr, "Paired HI16 and LO16 relocations have different symbols\n"
-                                                    "  LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
-                                    i, section_out.name, reloc_out.symbol_index, reloc_out.address);
-                                return nullptr;
-                            }
-
-                            // Set the previous HI16 relocs' relocated addresses.
-                            for (size_t paired_index = i - prev_hi_count; paired_index < i; paired_index++) {
-                                uint32_t hi_immediate = section_out.relocs[paired_index].target_section_offset;
-                                uint32_t paired_full_immediate = hi_immediate + (int16_t)rel_immediate;
-                                section_out.relocs[paired_index].target_section_offset = paired_full_immediate + rel_symbol_offset - rel_section_vram;
-                            }
-                        }
-                        else {
-                            // Orphaned LO16 reloc warnings.
-                            if (elf_config.unpaired_lo16_warnings) {
-                                if (prev_lo) {
-                                    // Don't warn if multiple LO16 in a row reference the same symbol, as some linkers will use this behavior.
-                                    if (prev_hi_symbol != rel_symbol) {
-                                        fmt::print(stderr, "[WARN] LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X} follows LO16 with different symbol\n",
-                                            i, section_out.name, reloc_out.symbol_index, reloc_out.address);
-                                    }
-                                }
-                                else {
-                                    fmt::print(stderr, "[WARN] Unpaired LO16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
-                                        i, section_out.name, reloc_out.symbol_index, reloc_out.address);
-                                }
-                            }
-                            // Even though this is an orphaned LO16 reloc, the previous calculation for the addend still follows the MIPS System V ABI documentation:
-                            // "R_MIPS_LO16 entries without an R_MIPS_HI16 entry immediately preceding are orphaned and the previously defined
-                            // R_MIPS_HI16 is used for computing the addend."
-                            // Therefore, nothing needs to be done to the section_offset member.
-                        }
-                        prev_lo = true;
-                    } else {
-                        // Allow a HI16 to follow another HI16 for the GNU ABI extension.
-                        if (reloc_out.type != N64Recomp::RelocType::R_MIPS_HI16 && prev_hi_count != 0) {
-                            // This is an invalid elf as the MIPS System V ABI documentation states:
-                            // "Each relocation type of R_MIPS_HI16 must have an associated R_MIPS_LO16 entry
-                            // immediately following it in the list of relocations."
-                            fmt::print(stderr, "Unpaired HI16 reloc index {} in section {} referencing symbol {} with offset 0x{:08X}\n",
-                                i - 1, section_out.name, section_out.relocs[i - 1].symbol_index, section_out.relocs[i - 1].address);
-                            return nullptr;
-                        }
-                        prev_lo = false;
-                    }
-
-                    if (reloc_out.type == N64Recomp::RelocType::R_MIPS_HI16) {
-                        uint32_t rel_immediate = reloc_rom_word & 0xFFFF;
-                        // First HI16, store its immediate.
-                        if (prev_hi_count == 0) {
-                            prev_hi_immediate = rel_immediate;
-                            prev_hi_symbol = rel_symbol;
-                        }
-                        // HI16 that follows another HI16, ensure they reference the same symbol.
-                        else {
-                            if (prev_hi_symbol != rel_symbol) {
-                                fmt::print(stderr, "HI16 reloc (index {} symbol {} offset 0x{:08X}) follows another HI16 reloc with a different symbol (index {} symbol {} offset 0x{:08X}) in section {}\n",
-                                    i, rel_symbol, section_out.relocs[i].address,
-                                    i - 1, prev_hi_symbol, section_out.relocs[i - 1].address,
-                                    section_out.name);
-                                return nullptr;
-                            }
-                        }
-                        // Populate the reloc temporarily, the full offset will be calculated upon pairing.
-                        reloc_out.target_section_offset = rel_immediate << 16;
-                        prev_hi_count++;
-                    } else {
-                        prev_hi_count = 0;
-                    }
-
-                    if (reloc_out.type == N64Recomp::RelocType::R_MIPS_32) {
-                        // The reloc addend is just the existing word before relocation, so the section offset can just be the symbol's section offset.
-                        // Incorporating the addend will be handled at load-time.
-                        reloc_out.target_section_offset = rel_symbol_offset;
-                        // TODO set section_out.has_mips32_relocs to true if this section should emit its mips32 relocs (mainly for TLB mapping).
-
-                        if (reloc_out.reference_symbol) {
-                            uint32_t reloc_target_section_addr = context.get_reference_section_vram(reloc_out.target_section);
-                            // Patch the word in the ROM to incorporate the symbol's value.
-                            uint32_t updated_reloc_word = reloc_rom_word + reloc_target_section_addr + reloc_out.target_section_offset;
-                            *reinterpret_cast<uint32_t*>(context.rom.data() + reloc_rom_addr) = byteswap(updated_reloc_word);
-                        }
-                    }
-
-                    if (reloc_out.type == N64Recomp::RelocType::R_MIPS_26) {
-                        uint32_t rel_immediate = (reloc_rom_word & 0x3FFFFFF) << 2;
-                        if (reloc_out.reference_symbol) {
-                            // Reference symbol relocs have their section offset already calculated, so don't apply the R_MIPS26 rule for the upper 4 bits.
-                            // TODO Find a way to unify this with the else case.
-                            reloc_out.target_section_offset = rel_immediate + rel_symbol_offset - rel_section_vram;
-                        }
-                        else {
-                            reloc_out.target_section_offset = rel_immediate + rel_symbol_offset + (section_out.ram_addr & 0xF0000000) - rel_section_vram;
-                        }
-                    }
-                }
-            }
-
-            // Sort this section's relocs by address, which allows for binary searching and more efficient iteration during recompilation.
-            // This is safe to do as the entire full_immediate in present in relocs due to the pairing that was done earlier, so the HI16 does not
-            // need to directly preceed the matching LO16 anymore.
-            std::sort(section_out.relocs.begin(), section_out.relocs.end(),
-                [](const N64Recomp::Reloc& a, const N64Recomp::Reloc& b) {
-                    return a.address < b.address;
-                }
-            );
-
-            // Patch the ROM word for HI16 and LO16 reference symbol relocs to non-relocatable sections.
-            for (size_t i = 0; i < section_out.relocs.size(); i++) {
-                auto& reloc = section_out.relocs[i];
-                if (reloc.reference_symbol && (reloc.type == N64Recomp::RelocType::R_MIPS_HI16 || reloc.type == N64Recomp::RelocType::R_MIPS_LO16)) {
-                    bool target_section_relocatable = context.is_reference_section_relocatable(reloc.target_section);
-                    if (!target_section_relocatable) {
-                        uint32_t reloc_rom_addr = reloc.address - section_out.ram_addr + section_out.rom_addr;
-                        uint32_t reloc_rom_word = byteswap(*reinterpret_cast<const uint32_t*>(context.rom.data() + reloc_rom_addr));
-
-                        uint32_t ref_section_vram = context.get_reference_section_vram(reloc.target_section);
-                        uint32_t full_immediate = reloc.target_section_offset + ref_section_vram;
-
-                        uint32_t imm;
-
-                        if (reloc.type == N64Recomp::RelocType::R_MIPS_HI16) {
-                            imm = (full_immediate >> 16) + ((full_immediate >> 15) & 1);
-                        }
-                        else {
-                            imm = full_immediate & 0xFFFF;
-                        }
-
-                        *reinterpret_cast<uint32_t*>(context.rom.data() + reloc_rom_addr) = byteswap(reloc_rom_word | imm);
-                        // Remove the reloc by setting it to a type of NONE.
-                        reloc.type = N64Recomp::RelocType::R_MIPS_NONE;
-                        reloc.reference_symbol = false;
-                        reloc.symbol_index = (uint32_t)-1;
-                    }
-                }
-            }
+            ELFIO::section* reloc_section = reloc_find != reloc_sections_by_name.end() ? reloc_find->second : nullptr;
+            sections_good[section_index] = read_section_relocs(context, section_index, elf_file, reloc_section, symbols_out, elf_config);
         }
+    });
+
+    if (std::find(sections_good.begin(), sections_good.end(), false) != sections_good.end()) {
+        return nullptr;
     }
 
     return symtab_section;
@@ -647,7 +738,8 @@ bool N64Recomp::Context::from_elf_file(const std::filesystem::path& elf_file_pat
 
     // Read all of the sections in the elf and look for the symbol table section
     ELFIO::section* mdebug_section = nullptr;
-    ELFIO::section* symtab_section = read_sections(out, mdebug_section, elf_config, elf_file);
+    std::vector<ElfSymbol> symbols{};
+    ELFIO::section* symtab_section = read_sections(out, mdebug_section, symbols, elf_config, elf_file);
 
     // If no symbol table was found then exit
     if (symtab_section == nullptr) {
@@ -655,7 +747,7 @@ bool N64Recomp::Context::from_elf_file(const std::filesystem::path& elf_file_pat
     }
 
     // Read all of the symbols in the elf and look for the entrypoint function
-    found_entrypoint_out = read_symbols(out, elf_file, symtab_section, elf_config, for_dumping_context, data_syms_out);
+    found_entrypoint_out = read_symbols(out, elf_file, symbols, elf_config, for_dumping_context, data_syms_out);
 
     // Process an mdebug section for static symbols. The presence of an mdebug section in the input is optional.
     if (elf_config.use_mdebug) {
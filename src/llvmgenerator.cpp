@@ -0,0 +1,1594 @@
+#include <cassert>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "fmt/format.h"
+#include "fmt/ostream.h"
+
+#include "recompiler/generator.h"
+
+// Every floating point operation is emitted as a constrained intrinsic with a dynamic rounding mode. This is the IR
+// equivalent of the C output's fenv access, and is needed for the game's cop1 rounding mode to be respected.
+static const char round_dynamic[] = "metadata !\"round.dynamic\"";
+static const char except_ignore[] = "metadata !\"fpexcept.ignore\"";
+
+// Type definitions, runtime declarations and helpers shared by all generated functions.
+// The unaligned memory helpers mirror the do_lwl/do_swl family of functions in recomp.h.
+static const char module_prologue[] = R"(%recomp_context = type { [32 x i64], [32 x i64], i64, i64, ptr, i32, i8 }
+
+@section_addresses = external global ptr
+@base_event_index = external global i32
+
+declare ptr @get_function(i32)
+declare void @switch_error(ptr, i32, i32)
+declare void @do_break(i32)
+declare void @cop0_status_write(ptr, i64)
+declare i64 @cop0_status_read(ptr)
+declare void @recomp_syscall_handler(ptr, ptr, i32)
+declare void @pause_self(ptr)
+declare void @recomp_trigger_event(ptr, ptr, i32)
+
+declare float @llvm.fabs.f32(float)
+declare double @llvm.fabs.f64(double)
+declare i64 @llvm.fshl.i64(i64, i64, i64)
+declare i32 @llvm.get.rounding()
+declare void @llvm.set.rounding(i32)
+declare float @llvm.experimental.constrained.fadd.f32(float, float, metadata, metadata)
+declare double @llvm.experimental.constrained.fadd.f64(double, double, metadata, metadata)
+declare float @llvm.experimental.constrained.fsub.f32(float, float, metadata, metadata)
+declare double @llvm.experimental.constrained.fsub.f64(double, double, metadata, metadata)
+declare float @llvm.experimental.constrained.fmul.f32(float, float, metadata, metadata)
+declare double @llvm.experimental.constrained.fmul.f64(double, double, metadata, metadata)
+declare float @llvm.experimental.constrained.fdiv.f32(float, float, metadata, metadata)
+declare double @llvm.experimental.constrained.fdiv.f64(double, double, metadata, metadata)
+declare float @llvm.experimental.constrained.sqrt.f32(float, metadata, metadata)
+declare double @llvm.experimental.constrained.sqrt.f64(double, metadata, metadata)
+declare float @llvm.experimental.constrained.rint.f32(float, metadata, metadata)
+declare double @llvm.experimental.constrained.rint.f64(double, metadata, metadata)
+declare float @llvm.experimental.constrained.round.f32(float, metadata)
+declare double @llvm.experimental.constrained.round.f64(double, metadata)
+declare float @llvm.experimental.constrained.ceil.f32(float, metadata)
+declare double @llvm.experimental.constrained.ceil.f64(double, metadata)
+declare float @llvm.experimental.constrained.floor.f32(float, metadata)
+declare double @llvm.experimental.constrained.floor.f64(double, metadata)
+declare i32 @llvm.experimental.constrained.fptosi.i32.f32(float, metadata)
+declare i32 @llvm.experimental.constrained.fptosi.i32.f64(double, metadata)
+declare i64 @llvm.experimental.constrained.fptosi.i64.f32(float, metadata)
+declare i64 @llvm.experimental.constrained.fptosi.i64.f64(double, metadata)
+declare float @llvm.experimental.constrained.sitofp.f32.i32(i32, metadata, metadata)
+declare double @llvm.experimental.constrained.sitofp.f64.i32(i32, metadata, metadata)
+declare float @llvm.experimental.constrained.sitofp.f32.i64(i64, metadata, metadata)
+declare double @llvm.experimental.constrained.sitofp.f64.i64(i64, metadata, metadata)
+declare double @llvm.experimental.constrained.fpext.f64.f32(float, metadata)
+declare float @llvm.experimental.constrained.fptrunc.f32.f64(double, metadata, metadata)
+declare i1 @llvm.experimental.constrained.fcmp.f32(float, float, metadata, metadata)
+declare i1 @llvm.experimental.constrained.fcmp.f64(double, double, metadata, metadata)
+
+define internal i64 @recomp_do_lwl(ptr %rdram, i64 %initial_value, i64 %offset, i64 %reg) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %word_address = and i64 %address, -4
+    %rdram_offset = add i64 %word_address, 2147483648
+    %word_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %loaded_value = load i32, ptr %word_ptr, align 4
+    %misalignment = and i64 %address, 3
+    %shift64 = shl i64 %misalignment, 3
+    %shift = trunc i64 %shift64 to i32
+    %mask = shl i32 -1, %shift
+    %inverted_mask = xor i32 %mask, -1
+    %inverted_mask64 = zext i32 %inverted_mask to i64
+    %masked_value = and i64 %initial_value, %inverted_mask64
+    %shifted_value = shl i32 %loaded_value, %shift
+    %shifted_value64 = zext i32 %shifted_value to i64
+    %combined = or i64 %masked_value, %shifted_value64
+    %combined32 = trunc i64 %combined to i32
+    %result = sext i32 %combined32 to i64
+    ret i64 %result
+}
+
+define internal i64 @recomp_do_lwr(ptr %rdram, i64 %initial_value, i64 %offset, i64 %reg) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %word_address = and i64 %address, -4
+    %rdram_offset = add i64 %word_address, 2147483648
+    %word_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %loaded_value = load i32, ptr %word_ptr, align 4
+    %misalignment = and i64 %address, 3
+    %misalignment_bits64 = shl i64 %misalignment, 3
+    %misalignment_bits = trunc i64 %misalignment_bits64 to i32
+    %shift = sub i32 24, %misalignment_bits
+    %mask = lshr i32 -1, %shift
+    %inverted_mask = xor i32 %mask, -1
+    %inverted_mask64 = zext i32 %inverted_mask to i64
+    %masked_value = and i64 %initial_value, %inverted_mask64
+    %shifted_value = lshr i32 %loaded_value, %shift
+    %shifted_value64 = zext i32 %shifted_value to i64
+    %combined = or i64 %masked_value, %shifted_value64
+    %combined32 = trunc i64 %combined to i32
+    %result = sext i32 %combined32 to i64
+    ret i64 %result
+}
+
+define internal void @recomp_do_swl(ptr %rdram, i64 %offset, i64 %reg, i64 %val) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %word_address = and i64 %address, -4
+    %rdram_offset = add i64 %word_address, 2147483648
+    %word_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %initial_value = load i32, ptr %word_ptr, align 4
+    %misalignment = and i64 %address, 3
+    %shift64 = shl i64 %misalignment, 3
+    %shift = trunc i64 %shift64 to i32
+    %mask = lshr i32 -1, %shift
+    %inverted_mask = xor i32 %mask, -1
+    %masked_initial_value = and i32 %initial_value, %inverted_mask
+    %val32 = trunc i64 %val to i32
+    %shifted_input_value = lshr i32 %val32, %shift
+    %result = or i32 %masked_initial_value, %shifted_input_value
+    store i32 %result, ptr %word_ptr, align 4
+    ret void
+}
+
+define internal void @recomp_do_swr(ptr %rdram, i64 %offset, i64 %reg, i64 %val) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %word_address = and i64 %address, -4
+    %rdram_offset = add i64 %word_address, 2147483648
+    %word_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %initial_value = load i32, ptr %word_ptr, align 4
+    %misalignment = and i64 %address, 3
+    %misalignment_bits64 = shl i64 %misalignment, 3
+    %misalignment_bits = trunc i64 %misalignment_bits64 to i32
+    %shift = sub i32 24, %misalignment_bits
+    %mask = shl i32 -1, %shift
+    %inverted_mask = xor i32 %mask, -1
+    %masked_initial_value = and i32 %initial_value, %inverted_mask
+    %val32 = trunc i64 %val to i32
+    %shifted_input_value = shl i32 %val32, %shift
+    %result = or i32 %masked_initial_value, %shifted_input_value
+    store i32 %result, ptr %word_ptr, align 4
+    ret void
+}
+
+define internal i64 @recomp_do_ldl(ptr %rdram, i64 %initial_value, i64 %offset, i64 %reg) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %dword_address = and i64 %address, -8
+    %rdram_offset = add i64 %dword_address, 2147483648
+    %dword_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %swapped_value = load i64, ptr %dword_ptr, align 4
+    %loaded_value = call i64 @llvm.fshl.i64(i64 %swapped_value, i64 %swapped_value, i64 32)
+    %misalignment = and i64 %address, 7
+    %shift = shl i64 %misalignment, 3
+    %mask = shl i64 -1, %shift
+    %inverted_mask = xor i64 %mask, -1
+    %masked_value = and i64 %initial_value, %inverted_mask
+    %shifted_value = shl i64 %loaded_value, %shift
+    %result = or i64 %masked_value, %shifted_value
+    ret i64 %result
+}
+
+define internal i64 @recomp_do_ldr(ptr %rdram, i64 %initial_value, i64 %offset, i64 %reg) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %dword_address = and i64 %address, -8
+    %rdram_offset = add i64 %dword_address, 2147483648
+    %dword_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %swapped_value = load i64, ptr %dword_ptr, align 4
+    %loaded_value = call i64 @llvm.fshl.i64(i64 %swapped_value, i64 %swapped_value, i64 32)
+    %misalignment = and i64 %address, 7
+    %misalignment_bits = shl i64 %misalignment, 3
+    %shift = sub i64 56, %misalignment_bits
+    %mask = lshr i64 -1, %shift
+    %inverted_mask = xor i64 %mask, -1
+    %masked_value = and i64 %initial_value, %inverted_mask
+    %shifted_value = lshr i64 %loaded_value, %shift
+    %result = or i64 %masked_value, %shifted_value
+    ret i64 %result
+}
+
+define internal void @recomp_do_sdl(ptr %rdram, i64 %offset, i64 %reg, i64 %val) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %dword_address = and i64 %address, -8
+    %rdram_offset = add i64 %dword_address, 2147483648
+    %dword_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %swapped_value = load i64, ptr %dword_ptr, align 4
+    %initial_value = call i64 @llvm.fshl.i64(i64 %swapped_value, i64 %swapped_value, i64 32)
+    %misalignment = and i64 %address, 7
+    %shift = shl i64 %misalignment, 3
+    %mask = lshr i64 -1, %shift
+    %inverted_mask = xor i64 %mask, -1
+    %masked_initial_value = and i64 %initial_value, %inverted_mask
+    %shifted_input_value = lshr i64 %val, %shift
+    %result = or i64 %masked_initial_value, %shifted_input_value
+    %swapped_result = call i64 @llvm.fshl.i64(i64 %result, i64 %result, i64 32)
+    store i64 %swapped_result, ptr %dword_ptr, align 4
+    ret void
+}
+
+define internal void @recomp_do_sdr(ptr %rdram, i64 %offset, i64 %reg, i64 %val) alwaysinline strictfp {
+    %address = add i64 %offset, %reg
+    %dword_address = and i64 %address, -8
+    %rdram_offset = add i64 %dword_address, 2147483648
+    %dword_ptr = getelementptr i8, ptr %rdram, i64 %rdram_offset
+    %swapped_value = load i64, ptr %dword_ptr, align 4
+    %initial_value = call i64 @llvm.fshl.i64(i64 %swapped_value, i64 %swapped_value, i64 32)
+    %misalignment = and i64 %address, 7
+    %misalignment_bits = shl i64 %misalignment, 3
+    %shift = sub i64 56, %misalignment_bits
+    %mask = shl i64 -1, %shift
+    %inverted_mask = xor i64 %mask, -1
+    %masked_initial_value = and i64 %initial_value, %inverted_mask
+    %shifted_input_value = shl i64 %val, %shift
+    %result = or i64 %masked_initial_value, %shifted_input_value
+    %swapped_result = call i64 @llvm.fshl.i64(i64 %result, i64 %result, i64 32)
+    store i64 %swapped_result, ptr %dword_ptr, align 4
+    ret void
+}
+
+)";
+
+// C type that a value would have in the equivalent C output. Tracking this allows the same implicit conversions
+// (sign or zero extension, usual arithmetic conversions) to be applied as the C compiler would.
+enum class ValueKind {
+    S32,
+    U32,
+    S64,
+    U64,
+    Float,
+    Double,
+};
+
+struct LLVMValue {
+    std::string name;
+    ValueKind kind;
+    std::optional<int64_t> constant;
+};
+
+struct N64Recomp::LLVMGeneratorContext {
+    // The body of the function being generated. This is buffered so that allocas can be placed in the entry block.
+    std::string body;
+    std::string function_name;
+    std::vector<std::string> jtbl_addends;
+    std::vector<N64Recomp::StackSlot> stack_slots;
+    size_t next_value = 0;
+    size_t next_block = 0;
+    bool block_terminated = false;
+    bool uses_function_name_string = false;
+    std::string cur_branch_end;
+    // The switch currently being built. The switch instruction can only be written once all of its cases are known.
+    std::string switch_index;
+    std::string switch_end;
+    std::vector<std::pair<int, std::string>> switch_cases;
+    bool switch_written = false;
+    // Functions defined and called in the module, used to determine which declarations are needed.
+    std::set<std::string> defined_functions;
+    std::set<std::string> called_functions;
+
+    std::string new_value() {
+        return fmt::format("%v{}", next_value++);
+    }
+
+    size_t new_block_index() {
+        return next_block++;
+    }
+
+    void instruction(const std::string& text) {
+        // Anything following a terminator is unreachable, but it still needs to be placed in a block.
+        if (block_terminated) {
+            label(fmt::format("dead_{}", new_block_index()));
+        }
+        body += "    ";
+        body += text;
+        body += '\n';
+    }
+
+    void terminator(const std::string& text) {
+        instruction(text);
+        block_terminated = true;
+    }
+
+    void label(const std::string& name) {
+        // Blocks must end in a terminator, so fall through into the label explicitly.
+        if (!block_terminated) {
+            body += fmt::format("    br label %{}\n", name);
+        }
+        body += name;
+        body += ":\n";
+        block_terminated = false;
+    }
+};
+
+static bool is_signed(ValueKind kind) {
+    return kind == ValueKind::S32 || kind == ValueKind::S64;
+}
+
+static bool is_64bit(ValueKind kind) {
+    return kind == ValueKind::S64 || kind == ValueKind::U64;
+}
+
+static bool is_float(ValueKind kind) {
+    return kind == ValueKind::Float || kind == ValueKind::Double;
+}
+
+static const char* llvm_type(ValueKind kind) {
+    switch (kind) {
+        case ValueKind::S32:
+        case ValueKind::U32:
+            return "i32";
+        case ValueKind::S64:
+        case ValueKind::U64:
+            return "i64";
+        case ValueKind::Float:
+            return "float";
+        case ValueKind::Double:
+            return "double";
+    }
+    assert(false);
+    return "";
+}
+
+static const char* float_suffix(ValueKind kind) {
+    return kind == ValueKind::Float ? "f32" : "f64";
+}
+
+static std::string global_name(const std::string& name) {
+    return fmt::format("@\"{}\"", name);
+}
+
+static LLVMValue constant_value(ValueKind kind, int64_t value) {
+    // Normalize the constant to the range of its type.
+    switch (kind) {
+        case ValueKind::S32:
+            value = (int32_t)value;
+            break;
+        case ValueKind::U32:
+            value = (uint32_t)value;
+            break;
+        default:
+            break;
+    }
+    // LLVM parses integer literals as signed values, so 32-bit constants are printed as int32_t.
+    std::string text = is_64bit(kind) ? std::to_string(value) : std::to_string((int32_t)value);
+    return { text, kind, value };
+}
+
+// Converts an integer value to another integer type in the same way that C would.
+static LLVMValue convert_int(N64Recomp::LLVMGeneratorContext& ctx, const LLVMValue& value, ValueKind kind) {
+    assert(!is_float(value.kind) && !is_float(kind));
+    if (value.constant.has_value()) {
+        return constant_value(kind, value.constant.value());
+    }
+    if (is_64bit(value.kind) == is_64bit(kind)) {
+        return { value.name, kind, std::nullopt };
+    }
+
+    std::string result = ctx.new_value();
+    if (is_64bit(kind)) {
+        ctx.instruction(fmt::format("{} = {} i32 {} to i64", result, is_signed(value.kind) ? "sext" : "zext", value.name));
+    }
+    else {
+        ctx.instruction(fmt::format("{} = trunc i64 {} to i32", result, value.name));
+    }
+    return { result, kind, std::nullopt };
+}
+
+// Determines the resulting type of C's usual arithmetic conversions for two integer operands.
+static ValueKind common_kind(ValueKind a, ValueKind b) {
+    if (a == ValueKind::U64 || b == ValueKind::U64) {
+        return ValueKind::U64;
+    }
+    if (a == ValueKind::S64 || b == ValueKind::S64) {
+        return ValueKind::S64;
+    }
+    if (a == ValueKind::U32 || b == ValueKind::U32) {
+        return ValueKind::U32;
+    }
+    return ValueKind::S32;
+}
+
+static std::string gpr_pointer(N64Recomp::LLVMGeneratorContext& ctx, int gpr) {
+    std::string ptr = ctx.new_value();
+    ctx.instruction(fmt::format("{} = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 0, i32 {}", ptr, gpr));
+    return ptr;
+}
+
+static std::string fpr_pointer(N64Recomp::LLVMGeneratorContext& ctx, int fpr) {
+    std::string ptr = ctx.new_value();
+    ctx.instruction(fmt::format("{} = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 1, i32 {}", ptr, fpr));
+    return ptr;
+}
+
+static std::string fpr_u32l_pointer(N64Recomp::LLVMGeneratorContext& ctx, int fpr) {
+    if (fpr & 1) {
+        // Odd float registers are accessed through f_odd to handle mips3 float mode, matching the C output.
+        std::string f_odd_ptr = ctx.new_value();
+        std::string f_odd = ctx.new_value();
+        std::string ptr = ctx.new_value();
+        ctx.instruction(fmt::format("{} = getelementptr inbounds %recomp_context, ptr %ctx, i32 0, i32 4", f_odd_ptr));
+        ctx.instruction(fmt::format("{} = load ptr, ptr {}", f_odd, f_odd_ptr));
+        ctx.instruction(fmt::format("{} = getelementptr inbounds i32, ptr {}, i64 {}", ptr, f_odd, (fpr - 1) * 2));
+        return ptr;
+    }
+    return fpr_pointer(ctx, fpr);
+}
+
+static LLVMValue load_value(N64Recomp::LLVMGeneratorContext& ctx, const std::string& ptr, ValueKind kind) {
+    std::string result = ctx.new_value();
+    ctx.instruction(fmt::format("{} = load {}, ptr {}", result, llvm_type(kind), ptr));
+    return { result, kind, std::nullopt };
+}
+
+static void store_value(N64Recomp::LLVMGeneratorContext& ctx, const std::string& ptr, const LLVMValue& value) {
+    ctx.instruction(fmt::format("store {} {}, ptr {}", llvm_type(value.kind), value.name, ptr));
+}
+
+static LLVMValue load_gpr(N64Recomp::LLVMGeneratorContext& ctx, int gpr) {
+    if (gpr == 0) {
+        return constant_value(ValueKind::U64, 0);
+    }
+    return load_value(ctx, gpr_pointer(ctx, gpr), ValueKind::U64);
+}
+
+static void store_gpr(N64Recomp::LLVMGeneratorContext& ctx, int gpr, const LLVMValue& value) {
+    // Writes to r0 are discarded.
+    if (gpr == 0) {
+        return;
+    }
+    LLVMValue converted = convert_int(ctx, value, ValueKind::U64);
+    store_value(ctx, gpr_pointer(ctx, gpr), converted);
+}
+
+// Calculates the host pointer for a guest address, equivalent to the address calculation in the MEM_ macros.
+static std::string memory_pointer(N64Recomp::LLVMGeneratorContext& ctx, const LLVMValue& base, const LLVMValue& offset, int xor_mask) {
+    LLVMValue base64 = convert_int(ctx, base, ValueKind::U64);
+    LLVMValue offset64 = convert_int(ctx, offset, ValueKind::U64);
+    std::string address = ctx.new_value();
+    ctx.instruction(fmt::format("{} = add i64 {}, {}", address, base64.name, offset64.name));
+    if (xor_mask != 0) {
+        std::string swizzled = ctx.new_value();
+        ctx.instruction(fmt::format("{} = xor i64 {}, {}", swizzled, address, xor_mask));
+        address = swizzled;
+    }
+    // Subtract 0xFFFFFFFF80000000 to get the offset into rdram.
+    std::string rdram_offset = ctx.new_value();
+    std::string ptr = ctx.new_value();
+    ctx.instruction(fmt::format("{} = add i64 {}, 2147483648", rdram_offset, address));
+    ctx.instruction(fmt::format("{} = getelementptr i8, ptr %rdram, i64 {}", ptr, rdram_offset));
+    return ptr;
+}
+
+// Rotates a doubleword by 32 bits, which converts between the host's view of two consecutive words and the guest's doubleword.
+static std::string swap_words(N64Recomp::LLVMGeneratorContext& ctx, const std::string& value) {
+    std::string result = ctx.new_value();
+    ctx.instruction(fmt::format("{0} = call i64 @llvm.fshl.i64(i64 {1}, i64 {1}, i64 32)", result, value));
+    return result;
+}
+
+static LLVMValue get_reloc_value(N64Recomp::LLVMGeneratorContext& ctx, const N64Recomp::InstructionContext& context) {
+    // There's no reference section address table for a module to link against, so relocs against reference symbols can only be
+    // emitted by the C and live backends.
+    if (context.reloc_tag_as_reference) {
+        throw std::runtime_error("Relocs tagged as reference symbol relocs aren't supported by the LLVM IR generator\n");
+    }
+    std::string table_ptr = ctx.new_value();
+    std::string entry_ptr = ctx.new_value();
+    std::string section_address = ctx.new_value();
+    std::string address = ctx.new_value();
+    ctx.instruction(fmt::format("{} = load ptr, ptr @section_addresses", table_ptr));
+    ctx.instruction(fmt::format("{} = getelementptr inbounds i32, ptr {}, i64 {}", entry_ptr, table_ptr, context.reloc_section_index));
+    ctx.instruction(fmt::format("{} = load i32, ptr {}", section_address, entry_ptr));
+    ctx.instruction(fmt::format("{} = add i32 {}, {}", address, section_address, (int32_t)context.reloc_target_section_offset));
+
+    std::string result = ctx.new_value();
+    switch (context.reloc_type) {
+        case N64Recomp::RelocType::R_MIPS_HI16:
+            {
+                // Equivalent to the HI16 macro: (x >> 16) + ((x >> 15) & 1)
+                std::string upper = ctx.new_value();
+                std::string carry_shifted = ctx.new_value();
+                std::string carry = ctx.new_value();
+                ctx.instruction(fmt::format("{} = ashr i32 {}, 16", upper, address));
+                ctx.instruction(fmt::format("{} = ashr i32 {}, 15", carry_shifted, address));
+                ctx.instruction(fmt::format("{} = and i32 {}, 1", carry, carry_shifted));
+                ctx.instruction(fmt::format("{} = add i32 {}, {}", result, upper, carry));
+            }
+            break;
+        case N64Recomp::RelocType::R_MIPS_LO16:
+            ctx.instruction(fmt::format("{} = and i32 {}, 65535", result, address));
+            break;
+        default:
+            throw std::runtime_error(fmt::format("Unexpected reloc type {}\n", static_cast<int>(context.reloc_type)));
+    }
+    return { result, ValueKind::S32, std::nullopt };
+}
+
+static LLVMValue float_to_int(N64Recomp::LLVMGeneratorContext& ctx, const LLVMValue& value, const char* rounding, ValueKind kind) {
+    const char* type = llvm_type(value.kind);
+    const char* suffix = float_suffix(value.kind);
+    std::string input = value.name;
+    // Round the input first if requested, then truncate it to an integer.
+    if (rounding != nullptr) {
+        std::string rounded = ctx.new_value();
+        // rint is the only one of the rounding operations that depends on the current rounding mode.
+        if (std::string_view{rounding} == "rint") {
+            ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.rint.{}({} {}, {}, {}) strictfp",
+                rounded, type, suffix, type, input, round_dynamic, except_ignore));
+        }
+        else {
+            ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.{}.{}({} {}, {}) strictfp",
+                rounded, type, rounding, suffix, type, input, except_ignore));
+        }
+        input = rounded;
+    }
+    std::string result = ctx.new_value();
+    const char* int_type = llvm_type(kind);
+    ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.fptosi.{}.{}({} {}, {}) strictfp",
+        result, int_type, int_type, suffix, type, input, except_ignore));
+    return { result, kind, std::nullopt };
+}
+
+static LLVMValue int_to_float(N64Recomp::LLVMGeneratorContext& ctx, const LLVMValue& value, ValueKind int_kind, ValueKind kind) {
+    LLVMValue input = convert_int(ctx, value, int_kind);
+    std::string result = ctx.new_value();
+    ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.sitofp.{}.{}({} {}, {}, {}) strictfp",
+        result, llvm_type(kind), float_suffix(kind), llvm_type(int_kind), llvm_type(int_kind), input.name, round_dynamic, except_ignore));
+    return { result, kind, std::nullopt };
+}
+
+static LLVMValue get_operand(N64Recomp::LLVMGeneratorContext& ctx, N64Recomp::Operand operand, N64Recomp::UnaryOpType operation, const N64Recomp::InstructionContext& context) {
+    using namespace N64Recomp;
+    LLVMValue value{};
+    switch (operand) {
+        case Operand::Rd:
+            value = load_gpr(ctx, context.rd);
+            break;
+        case Operand::Rs:
+            value = load_gpr(ctx, context.rs);
+            break;
+        case Operand::Rt:
+            value = load_gpr(ctx, context.rt);
+            break;
+        case Operand::Fd:
+            value = load_value(ctx, fpr_pointer(ctx, context.fd), ValueKind::Float);
+            break;
+        case Operand::Fs:
+            value = load_value(ctx, fpr_pointer(ctx, context.fs), ValueKind::Float);
+            break;
+        case Operand::Ft:
+            value = load_value(ctx, fpr_pointer(ctx, context.ft), ValueKind::Float);
+            break;
+        case Operand::FdDouble:
+            value = load_value(ctx, fpr_pointer(ctx, context.fd), ValueKind::Double);
+            break;
+        case Operand::FsDouble:
+            value = load_value(ctx, fpr_pointer(ctx, context.fs), ValueKind::Double);
+            break;
+        case Operand::FtDouble:
+            value = load_value(ctx, fpr_pointer(ctx, context.ft), ValueKind::Double);
+            break;
+        case Operand::FdU32L:
+            value = load_value(ctx, fpr_u32l_pointer(ctx, context.fd), ValueKind::U32);
+            break;
+        case Operand::FsU32L:
+            value = load_value(ctx, fpr_u32l_pointer(ctx, context.fs), ValueKind::U32);
+            break;
+        case Operand::FtU32L:
+            value = load_value(ctx, fpr_u32l_pointer(ctx, context.ft), ValueKind::U32);
+            break;
+        case Operand::FdU32H:
+        case Operand::FsU32H:
+        case Operand::FtU32H:
+            assert(false);
+            value = constant_value(ValueKind::U32, 0);
+            break;
+        case Operand::FdU64:
+            value = load_value(ctx, fpr_pointer(ctx, context.fd), ValueKind::U64);
+            break;
+        case Operand::FsU64:
+            value = load_value(ctx, fpr_pointer(ctx, context.fs), ValueKind::U64);
+            break;
+        case Operand::FtU64:
+            value = load_value(ctx, fpr_pointer(ctx, context.ft), ValueKind::U64);
+            break;
+        case Operand::ImmU16:
+            if (context.reloc_type != N64Recomp::RelocType::R_MIPS_NONE) {
+                value = get_reloc_value(ctx, context);
+            }
+            else {
+                value = constant_value(ValueKind::S32, context.imm16);
+            }
+            break;
+        case Operand::ImmS16:
+            if (context.reloc_type != N64Recomp::RelocType::R_MIPS_NONE) {
+                LLVMValue reloc_value = get_reloc_value(ctx, context);
+                std::string truncated = ctx.new_value();
+                std::string extended = ctx.new_value();
+                ctx.instruction(fmt::format("{} = trunc i32 {} to i16", truncated, reloc_value.name));
+                ctx.instruction(fmt::format("{} = sext i16 {} to i32", extended, truncated));
+                value = { extended, ValueKind::S32, std::nullopt };
+            }
+            else {
+                value = constant_value(ValueKind::S32, (int16_t)context.imm16);
+            }
+            break;
+        case Operand::Sa:
+            value = constant_value(ValueKind::S32, context.sa);
+            break;
+        case Operand::Sa32:
+            value = constant_value(ValueKind::S32, context.sa + 32);
+            break;
+        case Operand::Cop1cs:
+            value = load_value(ctx, "%c1cs", ValueKind::S32);
+            break;
+        case Operand::Hi:
+            value = load_value(ctx, "%hi", ValueKind::U64);
+            break;
+        case Operand::Lo:
+            value = load_value(ctx, "%lo", ValueKind::U64);
+            break;
+        case Operand::Zero:
+            value = constant_value(ValueKind::S32, 0);
+            break;
+    }
+
+    std::string result{};
+    switch (operation) {
+        case UnaryOpType::None:
+            break;
+        case UnaryOpType::ToS32:
+        case UnaryOpType::ToInt32:
+            value = convert_int(ctx, value, ValueKind::S32);
+            break;
+        case UnaryOpType::ToU32:
+            value = convert_int(ctx, value, ValueKind::U32);
+            break;
+        case UnaryOpType::ToS64:
+            value = convert_int(ctx, value, ValueKind::S64);
+            break;
+        case UnaryOpType::ToU64:
+            // Nothing to do here, they're already U64
+            break;
+        case UnaryOpType::Lui:
+            value = convert_int(ctx, value, ValueKind::S32);
+            if (value.constant.has_value()) {
+                value = constant_value(ValueKind::S32, (uint32_t)value.constant.value() << 16);
+            }
+            else {
+                result = ctx.new_value();
+                ctx.instruction(fmt::format("{} = shl i32 {}, 16", result, value.name));
+                value = { result, ValueKind::S32, std::nullopt };
+            }
+            break;
+        case UnaryOpType::Mask5:
+        case UnaryOpType::Mask6:
+            {
+                int mask = operation == UnaryOpType::Mask5 ? 31 : 63;
+                result = ctx.new_value();
+                ctx.instruction(fmt::format("{} = and {} {}, {}", result, llvm_type(value.kind), value.name, mask));
+                value = { result, value.kind, std::nullopt };
+            }
+            break;
+        case UnaryOpType::NegateFloat:
+        case UnaryOpType::NegateDouble:
+            result = ctx.new_value();
+            ctx.instruction(fmt::format("{} = fneg {} {}", result, llvm_type(value.kind), value.name));
+            value = { result, value.kind, std::nullopt };
+            break;
+        case UnaryOpType::AbsFloat:
+        case UnaryOpType::AbsDouble:
+            result = ctx.new_value();
+            ctx.instruction(fmt::format("{} = call {} @llvm.fabs.{}({} {}) strictfp", result, llvm_type(value.kind), float_suffix(value.kind), llvm_type(value.kind), value.name));
+            value = { result, value.kind, std::nullopt };
+            break;
+        case UnaryOpType::SqrtFloat:
+        case UnaryOpType::SqrtDouble:
+            result = ctx.new_value();
+            ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.sqrt.{}({} {}, {}, {}) strictfp",
+                result, llvm_type(value.kind), float_suffix(value.kind), llvm_type(value.kind), value.name, round_dynamic, except_ignore));
+            value = { result, value.kind, std::nullopt };
+            break;
+        case UnaryOpType::ConvertSFromW:
+            value = int_to_float(ctx, value, ValueKind::S32, ValueKind::Float);
+            break;
+        case UnaryOpType::ConvertDFromW:
+            value = int_to_float(ctx, value, ValueKind::S32, ValueKind::Double);
+            break;
+        case UnaryOpType::ConvertSFromL:
+            value = int_to_float(ctx, value, ValueKind::S64, ValueKind::Float);
+            break;
+        case UnaryOpType::ConvertDFromL:
+            value = int_to_float(ctx, value, ValueKind::S64, ValueKind::Double);
+            break;
+        case UnaryOpType::ConvertWFromS:
+        case UnaryOpType::ConvertWFromD:
+            value = float_to_int(ctx, value, "rint", ValueKind::S32);
+            break;
+        case UnaryOpType::ConvertLFromS:
+        case UnaryOpType::ConvertLFromD:
+            value = float_to_int(ctx, value, "rint", ValueKind::S64);
+            break;
+        case UnaryOpType::ConvertDFromS:
+            result = ctx.new_value();
+            ctx.instruction(fmt::format("{} = call double @llvm.experimental.constrained.fpext.f64.f32(float {}, {}) strictfp",
+                result, value.name, except_ignore));
+            value = { result, ValueKind::Double, std::nullopt };
+            break;
+        case UnaryOpType::ConvertSFromD:
+            result = ctx.new_value();
+            ctx.instruction(fmt::format("{} = call float @llvm.experimental.constrained.fptrunc.f32.f64(double {}, {}, {}) strictfp",
+                result, value.name, round_dynamic, except_ignore));
+            value = { result, ValueKind::Float, std::nullopt };
+            break;
+        case UnaryOpType::TruncateWFromS:
+        case UnaryOpType::TruncateWFromD:
+            value = float_to_int(ctx, value, nullptr, ValueKind::S32);
+            break;
+        case UnaryOpType::TruncateLFromS:
+        case UnaryOpType::TruncateLFromD:
+            value = float_to_int(ctx, value, nullptr, ValueKind::S64);
+            break;
+        // TODO these four operations should use banker's rounding (roundeven), but they use round for parity with the C output.
+        case UnaryOpType::RoundWFromS:
+        case UnaryOpType::RoundWFromD:
+            value = float_to_int(ctx, value, "round", ValueKind::S32);
+            break;
+        case UnaryOpType::RoundLFromS:
+        case UnaryOpType::RoundLFromD:
+            value = float_to_int(ctx, value, "round", ValueKind::S64);
+            break;
+        case UnaryOpType::CeilWFromS:
+        case UnaryOpType::CeilWFromD:
+            value = float_to_int(ctx, value, "ceil", ValueKind::S32);
+            break;
+        case UnaryOpType::CeilLFromS:
+        case UnaryOpType::CeilLFromD:
+            value = float_to_int(ctx, value, "ceil", ValueKind::S64);
+            break;
+        case UnaryOpType::FloorWFromS:
+        case UnaryOpType::FloorWFromD:
+            value = float_to_int(ctx, value, "floor", ValueKind::S32);
+            break;
+        case UnaryOpType::FloorLFromS:
+        case UnaryOpType::FloorLFromD:
+            value = float_to_int(ctx, value, "floor", ValueKind::S64);
+            break;
+    }
+    return value;
+}
+
+static void store_operand(N64Recomp::LLVMGeneratorContext& ctx, N64Recomp::Operand operand, const N64Recomp::InstructionContext& context, const LLVMValue& value) {
+    using namespace N64Recomp;
+    switch (operand) {
+        case Operand::Rd:
+            store_gpr(ctx, context.rd, value);
+            break;
+        case Operand::Rs:
+            store_gpr(ctx, context.rs, value);
+            break;
+        case Operand::Rt:
+            store_gpr(ctx, context.rt, value);
+            break;
+        case Operand::Fd:
+        case Operand::FdDouble:
+            assert(is_float(value.kind));
+            store_value(ctx, fpr_pointer(ctx, context.fd), value);
+            break;
+        case Operand::Fs:
+        case Operand::FsDouble:
+            assert(is_float(value.kind));
+            store_value(ctx, fpr_pointer(ctx, context.fs), value);
+            break;
+        case Operand::Ft:
+        case Operand::FtDouble:
+            assert(is_float(value.kind));
+            store_value(ctx, fpr_pointer(ctx, context.ft), value);
+            break;
+        case Operand::FdU32L:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U32);
+                store_value(ctx, fpr_u32l_pointer(ctx, context.fd), converted);
+            }
+            break;
+        case Operand::FsU32L:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U32);
+                store_value(ctx, fpr_u32l_pointer(ctx, context.fs), converted);
+            }
+            break;
+        case Operand::FtU32L:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U32);
+                store_value(ctx, fpr_u32l_pointer(ctx, context.ft), converted);
+            }
+            break;
+        case Operand::FdU64:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U64);
+                store_value(ctx, fpr_pointer(ctx, context.fd), converted);
+            }
+            break;
+        case Operand::FsU64:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U64);
+                store_value(ctx, fpr_pointer(ctx, context.fs), converted);
+            }
+            break;
+        case Operand::FtU64:
+            {
+                LLVMValue converted = convert_int(ctx, value, ValueKind::U64);
+                store_value(ctx, fpr_pointer(ctx, context.ft), converted);
+            }
+            break;
+        case Operand::Cop1cs:
+            store_value(ctx, "%c1cs", convert_int(ctx, value, ValueKind::S32));
+            break;
+        case Operand::Hi:
+            store_value(ctx, "%hi", convert_int(ctx, value, ValueKind::U64));
+            break;
+        case Operand::Lo:
+            store_value(ctx, "%lo", convert_int(ctx, value, ValueKind::U64));
+            break;
+        default:
+            assert(false && "Invalid output operand");
+            break;
+    }
+}
+
+// Evaluates a comparison and returns the name of the resulting i1 value.
+static std::string get_comparison(N64Recomp::LLVMGeneratorContext& ctx, N64Recomp::BinaryOpType type, const N64Recomp::BinaryOperands& operands, const N64Recomp::InstructionContext& context) {
+    using namespace N64Recomp;
+    if (type == BinaryOpType::True) {
+        return "true";
+    }
+    if (type == BinaryOpType::False) {
+        return "false";
+    }
+
+    LLVMValue input_a = get_operand(ctx, operands.operands[0], operands.operand_operations[0], context);
+    LLVMValue input_b = get_operand(ctx, operands.operands[1], operands.operand_operations[1], context);
+    std::string result = ctx.new_value();
+
+    const char* fcmp_predicate = nullptr;
+    switch (type) {
+        case BinaryOpType::EqualFloat:
+        case BinaryOpType::EqualDouble:
+            fcmp_predicate = "oeq";
+            break;
+        case BinaryOpType::LessFloat:
+        case BinaryOpType::LessDouble:
+            fcmp_predicate = "olt";
+            break;
+        case BinaryOpType::LessEqFloat:
+        case BinaryOpType::LessEqDouble:
+            fcmp_predicate = "ole";
+            break;
+        default:
+            break;
+    }
+
+    if (fcmp_predicate != nullptr) {
+        const char* float_type = llvm_type(input_a.kind);
+        ctx.instruction(fmt::format("{} = call i1 @llvm.experimental.constrained.fcmp.{}({} {}, {} {}, metadata !\"{}\", {}) strictfp",
+            result, float_suffix(input_a.kind), float_type, input_a.name, float_type, input_b.name, fcmp_predicate, except_ignore));
+        return result;
+    }
+
+    ValueKind kind = common_kind(input_a.kind, input_b.kind);
+    input_a = convert_int(ctx, input_a, kind);
+    input_b = convert_int(ctx, input_b, kind);
+    bool signed_compare = is_signed(kind);
+
+    const char* predicate = nullptr;
+    switch (type) {
+        case BinaryOpType::Equal:
+            predicate = "eq";
+            break;
+        case BinaryOpType::NotEqual:
+            predicate = "ne";
+            break;
+        case BinaryOpType::Less:
+            predicate = signed_compare ? "slt" : "ult";
+            break;
+        case BinaryOpType::LessEq:
+            predicate = signed_compare ? "sle" : "ule";
+            break;
+        case BinaryOpType::Greater:
+            predicate = signed_compare ? "sgt" : "ugt";
+            break;
+        case BinaryOpType::GreaterEq:
+            predicate = signed_compare ? "sge" : "uge";
+            break;
+        default:
+            assert(false && "Invalid comparison type");
+            return "false";
+    }
+
+    ctx.instruction(fmt::format("{} = icmp {} {} {}, {}", result, predicate, llvm_type(kind), input_a.name, input_b.name));
+    return result;
+}
+
+static LLVMValue get_binary_expr(N64Recomp::LLVMGeneratorContext& ctx, N64Recomp::BinaryOpType type, const N64Recomp::BinaryOperands& operands, const N64Recomp::InstructionContext& context, N64Recomp::Operand output) {
+    using namespace N64Recomp;
+
+    switch (type) {
+        case BinaryOpType::Equal:
+        case BinaryOpType::NotEqual:
+        case BinaryOpType::Less:
+        case BinaryOpType::LessEq:
+        case BinaryOpType::Greater:
+        case BinaryOpType::GreaterEq:
+        case BinaryOpType::EqualFloat:
+        case BinaryOpType::LessFloat:
+        case BinaryOpType::LessEqFloat:
+        case BinaryOpType::EqualDouble:
+        case BinaryOpType::LessDouble:
+        case BinaryOpType::LessEqDouble:
+            {
+                // Comparisons produce an int in C.
+                std::string condition = get_comparison(ctx, type, operands, context);
+                std::string result = ctx.new_value();
+                ctx.instruction(fmt::format("{} = zext i1 {} to i32", result, condition));
+                return { result, ValueKind::S32, std::nullopt };
+            }
+        case BinaryOpType::True:
+            return constant_value(ValueKind::S32, 1);
+        case BinaryOpType::False:
+            return constant_value(ValueKind::S32, 0);
+        default:
+            break;
+    }
+
+    LLVMValue input_a = get_operand(ctx, operands.operands[0], operands.operand_operations[0], context);
+    LLVMValue input_b = get_operand(ctx, operands.operands[1], operands.operand_operations[1], context);
+    std::string result = ctx.new_value();
+
+    auto int_op = [&](const char* opcode) -> LLVMValue {
+        ValueKind kind = common_kind(input_a.kind, input_b.kind);
+        LLVMValue a = convert_int(ctx, input_a, kind);
+        LLVMValue b = convert_int(ctx, input_b, kind);
+        ctx.instruction(fmt::format("{} = {} {} {}, {}", result, opcode, llvm_type(kind), a.name, b.name));
+        return { result, kind, std::nullopt };
+    };
+
+    auto float_op = [&](const char* opcode) -> LLVMValue {
+        const char* float_type = llvm_type(input_a.kind);
+        ctx.instruction(fmt::format("{} = call {} @llvm.experimental.constrained.{}.{}({} {}, {} {}, {}, {}) strictfp",
+            result, float_type, opcode, float_suffix(input_a.kind), float_type, input_a.name, float_type, input_b.name, round_dynamic, except_ignore));
+        return { result, input_a.kind, std::nullopt };
+    };
+
+    // The result of a shift has the type of the left operand, and right shifts are arithmetic when that type is signed.
+    auto shift_op = [&](bool left) -> LLVMValue {
+        LLVMValue amount = convert_int(ctx, input_b, input_a.kind);
+        const char* opcode = left ? "shl" : (is_signed(input_a.kind) ? "ashr" : "lshr");
+        ctx.instruction(fmt::format("{} = {} {} {}, {}", result, opcode, llvm_type(input_a.kind), input_a.name, amount.name));
+        return { result, input_a.kind, std::nullopt };
+    };
+
+    auto load_op = [&](ValueKind loaded_kind, const char* loaded_type, int xor_mask, int alignment, ValueKind kind) -> LLVMValue {
+        std::string ptr = memory_pointer(ctx, input_a, input_b, xor_mask);
+        ctx.instruction(fmt::format("{} = load {}, ptr {}, align {}", result, loaded_type, ptr, alignment));
+        if (std::string_view{loaded_type} == llvm_type(kind)) {
+            return { result, kind, std::nullopt };
+        }
+        std::string extended = ctx.new_value();
+        ctx.instruction(fmt::format("{} = {} {} {} to {}", extended, is_signed(loaded_kind) ? "sext" : "zext", loaded_type, result, llvm_type(kind)));
+        return { extended, kind, std::nullopt };
+    };
+
+    auto unaligned_load_op = [&](const char* helper) -> LLVMValue {
+        LLVMValue initial_value = convert_int(ctx, get_operand(ctx, output, UnaryOpType::None, context), ValueKind::U64);
+        LLVMValue a = convert_int(ctx, input_a, ValueKind::U64);
+        LLVMValue b = convert_int(ctx, input_b, ValueKind::U64);
+        ctx.instruction(fmt::format("{} = call i64 @{}(ptr %rdram, i64 {}, i64 {}, i64 {}) strictfp", result, helper, initial_value.name, a.name, b.name));
+        return { result, ValueKind::U64, std::nullopt };
+    };
+
+    switch (type) {
+        case BinaryOpType::Add32:
+            return convert_int(ctx, int_op("add"), ValueKind::S32);
+        case BinaryOpType::Sub32:
+            return convert_int(ctx, int_op("sub"), ValueKind::S32);
+        case BinaryOpType::Add64:
+            return int_op("add");
+        case BinaryOpType::Sub64:
+            return int_op("sub");
+        case BinaryOpType::And64:
+            return int_op("and");
+        case BinaryOpType::Or64:
+            return int_op("or");
+        case BinaryOpType::Xor64:
+            return int_op("xor");
+        case BinaryOpType::Nor64:
+            {
+                LLVMValue or_value = int_op("or");
+                std::string inverted = ctx.new_value();
+                ctx.instruction(fmt::format("{} = xor {} {}, -1", inverted, llvm_type(or_value.kind), or_value.name));
+                return { inverted, or_value.kind, std::nullopt };
+            }
+        case BinaryOpType::AddFloat:
+        case BinaryOpType::AddDouble:
+            return float_op("fadd");
+        case BinaryOpType::SubFloat:
+        case BinaryOpType::SubDouble:
+            return float_op("fsub");
+        case BinaryOpType::MulFloat:
+        case BinaryOpType::MulDouble:
+            return float_op("fmul");
+        case BinaryOpType::DivFloat:
+        case BinaryOpType::DivDouble:
+            return float_op("fdiv");
+        case BinaryOpType::Sll32:
+            return convert_int(ctx, shift_op(true), ValueKind::S32);
+        case BinaryOpType::Srl32:
+        case BinaryOpType::Sra32:
+            return convert_int(ctx, shift_op(false), ValueKind::S32);
+        case BinaryOpType::Sll64:
+            return shift_op(true);
+        case BinaryOpType::Srl64:
+        case BinaryOpType::Sra64:
+            return shift_op(false);
+        case BinaryOpType::LD:
+            {
+                std::string ptr = memory_pointer(ctx, input_a, input_b, 0);
+                ctx.instruction(fmt::format("{} = load i64, ptr {}, align 4", result, ptr));
+                return { swap_words(ctx, result), ValueKind::U64, std::nullopt };
+            }
+        case BinaryOpType::LW:
+            return load_op(ValueKind::S32, "i32", 0, 4, ValueKind::S32);
+        case BinaryOpType::LWU:
+            return load_op(ValueKind::U32, "i32", 0, 4, ValueKind::U32);
+        case BinaryOpType::LH:
+            return load_op(ValueKind::S32, "i16", 2, 2, ValueKind::S32);
+        case BinaryOpType::LHU:
+            return load_op(ValueKind::U32, "i16", 2, 2, ValueKind::S32);
+        case BinaryOpType::LB:
+            return load_op(ValueKind::S32, "i8", 3, 1, ValueKind::S32);
+        case BinaryOpType::LBU:
+            return load_op(ValueKind::U32, "i8", 3, 1, ValueKind::S32);
+        case BinaryOpType::LDL:
+            return unaligned_load_op("recomp_do_ldl");
+        case BinaryOpType::LDR:
+            return unaligned_load_op("recomp_do_ldr");
+        case BinaryOpType::LWL:
+            return unaligned_load_op("recomp_do_lwl");
+        case BinaryOpType::LWR:
+            return unaligned_load_op("recomp_do_lwr");
+        default:
+            assert(false && "Unhandled binary operation");
+            return constant_value(ValueKind::S32, 0);
+    }
+}
+
+// Divides two values of the given type while avoiding the cases that are undefined in LLVM IR. Division by zero
+// produces the values that the VR4300 does, and the overflowing signed division of the minimum value by -1
+// is replaced with a division by one to produce the same results as DDIV.
+static void emit_division(N64Recomp::LLVMGeneratorContext& ctx, const char* type, const std::string& a, const std::string& b, bool is_signed, std::string& quotient, std::string& remainder) {
+    std::string is_zero = ctx.new_value();
+    ctx.instruction(fmt::format("{} = icmp eq {} {}, 0", is_zero, type, b));
+    std::string use_one = is_zero;
+    if (is_signed) {
+        const char* min_value = std::string_view{type} == "i64" ? "-9223372036854775808" : "-2147483648";
+        std::string is_min = ctx.new_value();
+        std::string is_negative_one = ctx.new_value();
+        std::string overflow = ctx.new_value();
+        use_one = ctx.new_value();
+        ctx.instruction(fmt::format("{} = icmp eq {} {}, {}", is_min, type, a, min_value));
+        ctx.instruction(fmt::format("{} = icmp eq {} {}, -1", is_negative_one, type, b));
+        ctx.instruction(fmt::format("{} = and i1 {}, {}", overflow, is_min, is_negative_one));
+        ctx.instruction(fmt::format("{} = or i1 {}, {}", use_one, is_zero, overflow));
+    }
+
+    std::string divisor = ctx.new_value();
+    std::string raw_quotient = ctx.new_value();
+    std::string raw_remainder = ctx.new_value();
+    ctx.instruction(fmt::format("{} = select i1 {}, {} 1, {} {}", divisor, use_one, type, type, b));
+    ctx.instruction(fmt::format("{} = {} {} {}, {}", raw_quotient, is_signed ? "sdiv" : "udiv", type, a, divisor));
+    ctx.instruction(fmt::format("{} = {} {} {}, {}", raw_remainder, is_signed ? "srem" : "urem", type, a, divisor));
+
+    std::string zero_quotient = "-1";
+    if (is_signed) {
+        std::string is_negative = ctx.new_value();
+        zero_quotient = ctx.new_value();
+        ctx.instruction(fmt::format("{} = icmp slt {} {}, 0", is_negative, type, a));
+        ctx.instruction(fmt::format("{} = select i1 {}, {} 1, {} -1", zero_quotient, is_negative, type, type));
+    }
+
+    quotient = ctx.new_value();
+    remainder = ctx.new_value();
+    ctx.instruction(fmt::format("{} = select i1 {}, {} {}, {} {}", quotient, is_zero, type, zero_quotient, type, raw_quotient));
+    ctx.instruction(fmt::format("{} = select i1 {}, {} {}, {} {}", remainder, is_zero, type, a, type, raw_remainder));
+}
+
+// Escapes a string for use in an LLVM IR c"" string constant.
+static std::string escape_string(const std::string& str) {
+    std::string ret{};
+    ret.reserve(str.size());
+    for (char c : str) {
+        if (c >= ' ' && c <= '~' && c != '"' && c != '\\') {
+            ret += c;
+        }
+        else {
+            ret += fmt::format("\\{:02X}", (uint8_t)c);
+        }
+    }
+    return ret;
+}
+
+static void call_function(N64Recomp::LLVMGeneratorContext& ctx, const std::string& name) {
+    ctx.called_functions.insert(name);
+    ctx.instruction(fmt::format("call void {}(ptr %rdram, ptr %ctx) strictfp", global_name(name)));
+}
+
+static void write_switch(N64Recomp::LLVMGeneratorContext& ctx, const std::string& default_label) {
+    std::string text = fmt::format("switch i64 {}, label %{} [", ctx.switch_index, default_label);
+    for (const auto& [case_index, target_label] : ctx.switch_cases) {
+        text += fmt::format(" i64 {}, label %{}", case_index, target_label);
+    }
+    text += " ]";
+    ctx.terminator(text);
+    ctx.switch_written = true;
+}
+
+N64Recomp::LLVMGenerator::LLVMGenerator(std::ostream& output_file) : output_file(output_file), context(std::make_unique<LLVMGeneratorContext>()) {}
+
+N64Recomp::LLVMGenerator::~LLVMGenerator() = default;
+
+void N64Recomp::LLVMGenerator::emit_module_start() const {
+    output_file << module_prologue;
+}
+
+void N64Recomp::LLVMGenerator::emit_module_end() const {
+    for (const std::string& name : context->called_functions) {
+        if (!context->defined_functions.contains(name)) {
+            fmt::print(output_file, "declare void {}(ptr, ptr)\n", global_name(name));
+        }
+    }
+}
+
+static std::string stack_slot_pointer(const N64Recomp::StackSlot& slot) {
+    return fmt::format("%sp_{:04X}", slot.offset);
+}
+
+static ValueKind stack_slot_kind(const N64Recomp::StackSlot& slot) {
+    return slot.doubleword ? ValueKind::U64 : ValueKind::S32;
+}
+
+void N64Recomp::LLVMGenerator::set_stack_slots(const std::vector<StackSlot>& slots) const {
+    context->stack_slots = slots;
+}
+
+void N64Recomp::LLVMGenerator::emit_function_start(const std::string& function_name, size_t func_index) const {
+    (void)func_index;
+    context->function_name = function_name;
+    context->defined_functions.insert(function_name);
+}
+
+void N64Recomp::LLVMGenerator::emit_function_end() const {
+    // Return if the end of the function is reachable, just like falling off the end of the C function would.
+    if (!context->block_terminated) {
+        context->terminator("ret void");
+    }
+
+    fmt::print(output_file,
+        "define void {}(ptr noalias %rdram, ptr noalias %ctx) strictfp {{\n"
+        "entry:\n"
+        // these variables shouldn't need to be preserved across function boundaries, so make them locals that can be promoted to registers
+        "    %hi = alloca i64\n"
+        "    %lo = alloca i64\n"
+        "    %c1cs = alloca i32\n", // cop1 conditional signal
+        global_name(context->function_name));
+    for (const std::string& addend : context->jtbl_addends) {
+        fmt::print(output_file, "    {} = alloca i64\n", addend);
+    }
+    for (const StackSlot& slot : context->stack_slots) {
+        fmt::print(output_file, "    {} = alloca {}\n", stack_slot_pointer(slot), llvm_type(stack_slot_kind(slot)));
+    }
+    fmt::print(output_file,
+        "    store i64 0, ptr %hi\n"
+        "    store i64 0, ptr %lo\n"
+        "    store i32 0, ptr %c1cs\n");
+    for (const StackSlot& slot : context->stack_slots) {
+        fmt::print(output_file, "    store {} 0, ptr {}\n", llvm_type(stack_slot_kind(slot)), stack_slot_pointer(slot));
+    }
+    fmt::print(output_file,
+        "    br label %start\n"
+        "start:\n"
+        "{}"
+        "}}\n\n",
+        context->body);
+
+    if (context->uses_function_name_string) {
+        fmt::print(output_file, "{} = private unnamed_addr constant [{} x i8] c\"{}\\00\"\n\n",
+            global_name(context->function_name + ".name"), context->function_name.size() + 1, escape_string(context->function_name));
+    }
+
+    // Reset the per-function state.
+    context->body.clear();
+    context->function_name.clear();
+    context->jtbl_addends.clear();
+    context->stack_slots.clear();
+    context->next_value = 0;
+    context->next_block = 0;
+    context->block_terminated = false;
+    context->uses_function_name_string = false;
+}
+
+void N64Recomp::LLVMGenerator::emit_stack_slot_load(const StackSlot& slot, int reg) const {
+    if (reg == 0) {
+        return;
+    }
+    LLVMValue value = load_value(*context, stack_slot_pointer(slot), stack_slot_kind(slot));
+    store_gpr(*context, reg, value);
+}
+
+void N64Recomp::LLVMGenerator::emit_stack_slot_store(const StackSlot& slot, int reg) const {
+    LLVMValue value = convert_int(*context, load_gpr(*context, reg), stack_slot_kind(slot));
+    store_value(*context, stack_slot_pointer(slot), value);
+}
+
+void N64Recomp::LLVMGenerator::emit_function_call_lookup(uint32_t addr) const {
+    std::string func = context->new_value();
+    context->instruction(fmt::format("{} = call ptr @get_function(i32 {}) strictfp", func, (int32_t)addr));
+    context->instruction(fmt::format("call void {}(ptr %rdram, ptr %ctx) strictfp", func));
+}
+
+void N64Recomp::LLVMGenerator::emit_function_call_by_register(int reg) const {
+    LLVMValue addr = convert_int(*context, load_gpr(*context, reg), ValueKind::S32);
+    std::string func = context->new_value();
+    context->instruction(fmt::format("{} = call ptr @get_function(i32 {}) strictfp", func, addr.name));
+    context->instruction(fmt::format("call void {}(ptr %rdram, ptr %ctx) strictfp", func));
+}
+
+void N64Recomp::LLVMGenerator::emit_function_call_by_register_candidates(const Context& context, int reg, const std::vector<size_t>& function_indices) const {
+    LLVMValue addr = convert_int(*this->context, load_gpr(*this->context, reg), ValueKind::S32);
+    size_t dispatch_index = this->context->new_block_index();
+    std::string default_label = fmt::format("dispatch_{}_default", dispatch_index);
+    std::string end_label = fmt::format("dispatch_{}_end", dispatch_index);
+
+    std::string text = fmt::format("switch i32 {}, label %{} [", addr.name, default_label);
+    for (size_t i = 0; i < function_indices.size(); i++) {
+        text += fmt::format(" i32 {}, label %dispatch_{}_case_{}", (int32_t)context.functions[function_indices[i]].vram, dispatch_index, i);
+    }
+    text += " ]";
+    this->context->terminator(text);
+
+    for (size_t i = 0; i < function_indices.size(); i++) {
+        this->context->label(fmt::format("dispatch_{}_case_{}", dispatch_index, i));
+        call_function(*this->context, context.functions[function_indices[i]].name);
+        this->context->terminator(fmt::format("br label %{}", end_label));
+    }
+
+    // Any other address goes through the lookup.
+    this->context->label(default_label);
+    std::string func = this->context->new_value();
+    this->context->instruction(fmt::format("{} = call ptr @get_function(i32 {}) strictfp", func, addr.name));
+    this->context->instruction(fmt::format("call void {}(ptr %rdram, ptr %ctx) strictfp", func));
+    this->context->label(end_label);
+}
+
+void N64Recomp::LLVMGenerator::emit_function_call_reference_symbol(const Context& context, uint16_t section_index, size_t symbol_index, uint32_t target_section_offset) const {
+    (void)target_section_offset;
+    const N64Recomp::ReferenceSymbol& sym = context.get_reference_symbol(section_index, symbol_index);
+    call_function(*this->context, sym.name);
+}
+
+void N64Recomp::LLVMGenerator::emit_function_call(const Context& context, size_t function_index) const {
+    call_function(*this->context, context.functions[function_index].name);
+}
+
+void N64Recomp::LLVMGenerator::emit_named_function_call(const std::string& function_name) const {
+    call_function(*context, function_name);
+}
+
+void N64Recomp::LLVMGenerator::emit_goto(const std::string& target) const {
+    context->terminator(fmt::format("br label %{}", target));
+}
+
+void N64Recomp::LLVMGenerator::emit_label(const std::string& label_name) const {
+    context->label(label_name);
+}
+
+void N64Recomp::LLVMGenerator::emit_jtbl_addend_declaration(const JumpTable& jtbl, int reg) const {
+    std::string jump_variable = fmt::format("%jr_addend_{:08X}", jtbl.jr_vram);
+    context->jtbl_addends.push_back(jump_variable);
+    store_value(*context, jump_variable, load_gpr(*context, reg));
+}
+
+void N64Recomp::LLVMGenerator::emit_branch_condition(const ConditionalBranchOp& op, const InstructionContext& ctx) const {
+    std::string condition = get_comparison(*context, op.comparison, op.operands, ctx);
+    size_t branch_index = context->new_block_index();
+    std::string taken_label = fmt::format("branch_{}_taken", branch_index);
+    context->cur_branch_end = fmt::format("branch_{}_end", branch_index);
+    context->terminator(fmt::format("br i1 {}, label %{}, label %{}", condition, taken_label, context->cur_branch_end));
+    context->label(taken_label);
+}
+
+void N64Recomp::LLVMGenerator::emit_branch_close() const {
+    context->label(context->cur_branch_end);
+}
+
+void N64Recomp::LLVMGenerator::emit_conditional_goto(const ConditionalBranchOp& op, const InstructionContext& ctx, const std::string& target) const {
+    std::string condition = get_comparison(*context, op.comparison, op.operands, ctx);
+    std::string not_taken_label = fmt::format("branch_{}_end", context->new_block_index());
+    context->terminator(fmt::format("br i1 {}, label %{}, label %{}", condition, target, not_taken_label));
+    context->label(not_taken_label);
+}
+
+void N64Recomp::LLVMGenerator::emit_conditional_call(const ConditionalBranchOp& op, const InstructionContext& ctx, const Context& context, size_t function_index) const {
+    emit_branch_condition(op, ctx);
+    emit_function_call(context, function_index);
+    emit_branch_close();
+}
+
+void N64Recomp::LLVMGenerator::emit_switch(const Context& recompiler_context, const JumpTable& jtbl, int reg) const {
+    (void)recompiler_context;
+    (void)reg;
+    // TODO generate code to subtract the jump table address from the register's value instead.
+    // Once that's done, the addend temp can be deleted to simplify the generator interface.
+    std::string jump_variable = fmt::format("%jr_addend_{:08X}", jtbl.jr_vram);
+    LLVMValue addend = load_value(*context, jump_variable, ValueKind::U64);
+    context->switch_index = context->new_value();
+    context->instruction(fmt::format("{} = lshr i64 {}, 2", context->switch_index, addend.name));
+    context->switch_end = fmt::format("switch_{}_end", context->new_block_index());
+    context->switch_cases.clear();
+    context->switch_written = false;
+}
+
+void N64Recomp::LLVMGenerator::emit_case(int case_index, const std::string& target_label) const {
+    context->switch_cases.emplace_back(case_index, target_label);
+}
+
+void N64Recomp::LLVMGenerator::emit_switch_error(uint32_t instr_vram, uint32_t jtbl_vram) const {
+    std::string default_label = fmt::format("switch_{}_default", context->new_block_index());
+    write_switch(*context, default_label);
+    context->label(default_label);
+    context->uses_function_name_string = true;
+    context->instruction(fmt::format("call void @switch_error(ptr {}, i32 {}, i32 {}) strictfp",
+        global_name(context->function_name + ".name"), (int32_t)instr_vram, (int32_t)jtbl_vram));
+}
+
+void N64Recomp::LLVMGenerator::emit_switch_close() const {
+    if (!context->switch_written) {
+        write_switch(*context, context->switch_end);
+    }
+    context->label(context->switch_end);
+}
+
+void N64Recomp::LLVMGenerator::emit_return(const Context& context, size_t func_index) const {
+    (void)context;
+    (void)func_index;
+    this->context->terminator("ret void");
+}
+
+void N64Recomp::LLVMGenerator::emit_check_fr(int fpr) const {
+    (void)fpr;
+    // Nothing to do here, this is a debug assertion in the C output.
+}
+
+void N64Recomp::LLVMGenerator::emit_check_nan(int fpr, bool is_double) const {
+    (void)fpr;
+    (void)is_double;
+    // Nothing to do here, this is a debug assertion in the C output.
+}
+
+void N64Recomp::LLVMGenerator::emit_cop0_status_read(int reg) const {
+    std::string result = context->new_value();
+    context->instruction(fmt::format("{} = call i64 @cop0_status_read(ptr %ctx) strictfp", result));
+    store_gpr(*context, reg, { result, ValueKind::U64, std::nullopt });
+}
+
+void N64Recomp::LLVMGenerator::emit_cop0_status_write(int reg) const {
+    LLVMValue value = load_gpr(*context, reg);
+    context->instruction(fmt::format("call void @cop0_status_write(ptr %ctx, i64 {}) strictfp", value.name));
+}
+
+// The mapping between the MIPS rounding mode and the FLT_ROUNDS encoding used by llvm.get.rounding and llvm.set.rounding
+// is to swap the values for round to nearest (0 in MIPS, 1 in FLT_ROUNDS) and round to zero (1 in MIPS, 0 in FLT_ROUNDS),
+// which is its own inverse. This is done as x ^ (~(x >> 1) & 1).
+static std::string swap_rounding_mode_encoding(N64Recomp::LLVMGeneratorContext& ctx, const std::string& mode) {
+    std::string high_bit = ctx.new_value();
+    std::string flip = ctx.new_value();
+    std::string result = ctx.new_value();
+    ctx.instruction(fmt::format("{} = lshr i32 {}, 1", high_bit, mode));
+    ctx.instruction(fmt::format("{} = xor i32 {}, 1", flip, high_bit));
+    ctx.instruction(fmt::format("{} = xor i32 {}, {}", result, mode, flip));
+    return result;
+}
+
+void N64Recomp::LLVMGenerator::emit_cop1_cs_read(int reg) const {
+    std::string rounding = context->new_value();
+    std::string masked = context->new_value();
+    context->instruction(fmt::format("{} = call i32 @llvm.get.rounding() strictfp", rounding));
+    context->instruction(fmt::format("{} = and i32 {}, 3", masked, rounding));
+    std::string mips_mode = swap_rounding_mode_encoding(*context, masked);
+    store_gpr(*context, reg, { mips_mode, ValueKind::U32, std::nullopt });
+}
+
+void N64Recomp::LLVMGenerator::emit_cop1_cs_write(int reg) const {
+    LLVMValue value = convert_int(*context, load_gpr(*context, reg), ValueKind::U32);
+    std::string masked = context->new_value();
+    context->instruction(fmt::format("{} = and i32 {}, 3", masked, value.name));
+    std::string rounding = swap_rounding_mode_encoding(*context, masked);
+    context->instruction(fmt::format("call void @llvm.set.rounding(i32 {}) strictfp", rounding));
+}
+
+void N64Recomp::LLVMGenerator::emit_muldiv(InstrId instr_id, int reg1, int reg2) const {
+    LLVMGeneratorContext& ctx = *context;
+    LLVMValue input_a = load_gpr(ctx, reg1);
+    LLVMValue input_b = load_gpr(ctx, reg2);
+
+    // Stores the low 32 bits of a 64-bit value into hi or lo, sign extended.
+    auto store_s32 = [&ctx](const char* target, const std::string& value) {
+        LLVMValue truncated = convert_int(ctx, { value, ValueKind::U64, std::nullopt }, ValueKind::S32);
+        store_value(ctx, target, convert_int(ctx, truncated, ValueKind::U64));
+    };
+
+    switch (instr_id) {
+        case InstrId::cpu_mult:
+        case InstrId::cpu_multu:
+            {
+                bool is_signed = instr_id == InstrId::cpu_mult;
+                LLVMValue a32 = convert_int(ctx, input_a, is_signed ? ValueKind::S32 : ValueKind::U32);
+                LLVMValue b32 = convert_int(ctx, input_b, is_signed ? ValueKind::S32 : ValueKind::U32);
+                LLVMValue a64 = convert_int(ctx, a32, ValueKind::U64);
+                LLVMValue b64 = convert_int(ctx, b32, ValueKind::U64);
+                std::string product = ctx.new_value();
+                std::string product_hi = ctx.new_value();
+                ctx.instruction(fmt::format("{} = mul i64 {}, {}", product, a64.name, b64.name));
+                ctx.instruction(fmt::format("{} = lshr i64 {}, 32", product_hi, product));
+                store_s32("%lo", product);
+                store_s32("%hi", product_hi);
+            }
+            break;
+        case InstrId::cpu_dmult:
+        case InstrId::cpu_dmultu:
+            {
+                const char* extend = instr_id == InstrId::cpu_dmult ? "sext" : "zext";
+                std::string a128 = ctx.new_value();
+                std::string b128 = ctx.new_value();
+                std::string product = ctx.new_value();
+                std::string product_hi = ctx.new_value();
+                std::string lo = ctx.new_value();
+                std::string hi = ctx.new_value();
+                ctx.instruction(fmt::format("{} = {} i64 {} to i128", a128, extend, input_a.name));
+                ctx.instruction(fmt::format("{} = {} i64 {} to i128", b128, extend, input_b.name));
+                ctx.instruction(fmt::format("{} = mul i128 {}, {}", product, a128, b128));
+                ctx.instruction(fmt::format("{} = lshr i128 {}, 64", product_hi, product));
+                ctx.instruction(fmt::format("{} = trunc i128 {} to i64", lo, product));
+                ctx.instruction(fmt::format("{} = trunc i128 {} to i64", hi, product_hi));
+                ctx.instruction(fmt::format("store i64 {}, ptr %lo", lo));
+                ctx.instruction(fmt::format("store i64 {}, ptr %hi", hi));
+            }
+            break;
+        case InstrId::cpu_div:
+            {
+                // Divide in 64 bits to prevent an overflow for s32(0x80000000) / -1, as the C output does.
+                LLVMValue a64 = convert_int(ctx, convert_int(ctx, input_a, ValueKind::S32), ValueKind::S64);
+                LLVMValue b64 = convert_int(ctx, convert_int(ctx, input_b, ValueKind::S32), ValueKind::S64);
+                std::string quotient;
+                std::string remainder;
+                emit_division(ctx, "i64", a64.name, b64.name, true, quotient, remainder);
+                store_s32("%lo", quotient);
+                store_s32("%hi", remainder);
+            }
+            break;
+        case InstrId::cpu_divu:
+            {
+                LLVMValue a32 = convert_int(ctx, input_a, ValueKind::U32);
+                LLVMValue b32 = convert_int(ctx, input_b, ValueKind::U32);
+                std::string quotient;
+                std::string remainder;
+                emit_division(ctx, "i32", a32.name, b32.name, false, quotient, remainder);
+                store_value(ctx, "%lo", convert_int(ctx, { quotient, ValueKind::S32, std::nullopt }, ValueKind::U64));
+                store_value(ctx, "%hi", convert_int(ctx, { remainder, ValueKind::S32, std::nullopt }, ValueKind::U64));
+            }
+            break;
+        case InstrId::cpu_ddiv:
+        case InstrId::cpu_ddivu:
+            {
+                std::string quotient;
+                std::string remainder;
+                emit_division(ctx, "i64", input_a.name, input_b.name, instr_id == InstrId::cpu_ddiv, quotient, remainder);
+                ctx.instruction(fmt::format("store i64 {}, ptr %lo", quotient));
+                ctx.instruction(fmt::format("store i64 {}, ptr %hi", remainder));
+            }
+            break;
+        default:
+            assert(false);
+            break;
+    }
+}
+
+void N64Recomp::LLVMGenerator::emit_syscall(uint32_t instr_vram) const {
+    context->instruction(fmt::format("call void @recomp_syscall_handler(ptr %rdram, ptr %ctx, i32 {}) strictfp", (int32_t)instr_vram));
+}
+
+void N64Recomp::LLVMGenerator::emit_do_break(uint32_t instr_vram) const {
+    context->instruction(fmt::format("call void @do_break(i32 {}) strictfp", (int32_t)instr_vram));
+}
+
+void N64Recomp::LLVMGenerator::emit_pause_self() const {
+    context->instruction("call void @pause_self(ptr %rdram) strictfp");
+}
+
+void N64Recomp::LLVMGenerator::emit_trigger_event(uint32_t event_index) const {
+    std::string base_index = context->new_value();
+    std::string global_index = context->new_value();
+    context->instruction(fmt::format("{} = load i32, ptr @base_event_index", base_index));
+    context->instruction(fmt::format("{} = add i32 {}, {}", global_index, base_index, event_index));
+    context->instruction(fmt::format("call void @recomp_trigger_event(ptr %rdram, ptr %ctx, i32 {}) strictfp", global_index));
+}
+
+void N64Recomp::LLVMGenerator::emit_comment(const std::string& comment) const {
+    context->body += fmt::format("    ; {}\n", comment);
+}
+
+void N64Recomp::LLVMGenerator::process_binary_op(const BinaryOp& op, const InstructionContext& ctx) const {
+    LLVMValue value = get_binary_expr(*context, op.type, op.operands, ctx, op.output);
+    store_operand(*context, op.output, ctx, value);
+}
+
+void N64Recomp::LLVMGenerator::process_unary_op(const UnaryOp& op, const InstructionContext& ctx) const {
+    LLVMValue value = get_operand(*context, op.input, op.operation, ctx);
+    store_operand(*context, op.output, ctx, value);
+}
+
+void N64Recomp::LLVMGenerator::process_store_op(const StoreOp& op, const InstructionContext& ctx) const {
+    LLVMGeneratorContext& gen_ctx = *context;
+    LLVMValue base = get_operand(gen_ctx, Operand::Base, UnaryOpType::None, ctx);
+    LLVMValue imm = get_operand(gen_ctx, Operand::ImmS16, UnaryOpType::None, ctx);
+    LLVMValue value_input = get_operand(gen_ctx, op.value_input, UnaryOpType::None, ctx);
+
+    auto narrow_store = [&](const char* store_type, int xor_mask, int alignment) {
+        std::string ptr = memory_pointer(gen_ctx, base, imm, xor_mask);
+        LLVMValue value32 = convert_int(gen_ctx, value_input, ValueKind::U32);
+        std::string stored = value32.name;
+        if (std::string_view{store_type} != "i32") {
+            stored = gen_ctx.new_value();
+            gen_ctx.instruction(fmt::format("{} = trunc i32 {} to {}", stored, value32.name, store_type));
+        }
+        gen_ctx.instruction(fmt::format("store {} {}, ptr {}, align {}", store_type, stored, ptr, alignment));
+    };
+
+    auto unaligned_store = [&](const char* helper) {
+        LLVMValue imm64 = convert_int(gen_ctx, imm, ValueKind::U64);
+        LLVMValue base64 = convert_int(gen_ctx, base, ValueKind::U64);
+        LLVMValue value64 = convert_int(gen_ctx, value_input, ValueKind::U64);
+        gen_ctx.instruction(fmt::format("call void @{}(ptr %rdram, i64 {}, i64 {}, i64 {}) strictfp", helper, imm64.name, base64.name, value64.name));
+    };
+
+    switch (op.type) {
+        case StoreOpType::SD:
+        case StoreOpType::SDC1:
+            {
+                std::string ptr = memory_pointer(gen_ctx, base, imm, 0);
+                LLVMValue value64 = convert_int(gen_ctx, value_input, ValueKind::U64);
+                std::string swapped = swap_words(gen_ctx, value64.name);
+                gen_ctx.instruction(fmt::format("store i64 {}, ptr {}, align 4", swapped, ptr));
+            }
+            break;
+        case StoreOpType::SDL:
+            unaligned_store("recomp_do_sdl");
+            break;
+        case StoreOpType::SDR:
+            unaligned_store("recomp_do_sdr");
+            break;
+        case StoreOpType::SW:
+        case StoreOpType::SWC1:
+            narrow_store("i32", 0, 4);
+            break;
+        case StoreOpType::SWL:
+            unaligned_store("recomp_do_swl");
+            break;
+        case StoreOpType::SWR:
+            unaligned_store("recomp_do_swr");
+            break;
+        case StoreOpType::SH:
+            narrow_store("i16", 2, 2);
+            break;
+        case StoreOpType::SB:
+            narrow_store("i8", 3, 1);
+            break;
+        default:
+            throw std::runtime_error("Unhandled store op");
+    }
+}
@@ -4,12 +4,15 @@
 #include <span>
 #include <filesystem>
 #include <optional>
+#include <sstream>
+#include <string_view>
 
 #include "rabbitizer.hpp"
 #include "fmt/format.h"
 #include "fmt/ostream.h"
 
 #include "recompiler/context.h"
+#include "recompiler/generator.h"
 #include "config.h"
 #include <set>
 
@@ -111,7 +114,7 @@ bool compare_files(const std::filesystem::path& file1_path, const std::filesyste
     return std::equal(begin1, std::istreambuf_iterator<char>(), begin2); //Second argument is end-of-range iterator
 }
 
-bool recompile_single_function(const N64Recomp::Context& context, size_t func_index, const std::string& recomp_include, const std::filesystem::path& output_path, std::span<std::vector<uint32_t>> static_funcs_out) {
+bool write_single_function(const std::string& func_text, const std::string& recomp_include, const std::filesystem::path& output_path) {
     // Open the temporary output file
     std::filesystem::path temp_path = output_path;
     temp_path.replace_extension(".tmp");
@@ -127,9 +130,7 @@ bool recompile_single_function(const N64Recomp::Context& context, size_t func_in
         "\n",
         recomp_include);
 
-    if (!N64Recomp::recompile_function(context, func_index, output_file, static_funcs_out, false)) {
-        return false;
-    }
+    output_file << func_text;
     
     output_file.close();
 
@@ -157,40 +158,39 @@ std::vector<std::string> reloc_names {
     "R_MIPS_GPREL16",
 };
 
-void dump_context(const N64Recomp::Context& context, const std::unordered_map<uint16_t, std::vector<N64Recomp::DataSymbol>>& data_syms, const std::filesystem::path& func_path, const std::filesystem::path& data_path) {
+void print_context_section(std::ofstream& output_file, const std::string& name, uint32_t rom_addr, uint32_t ram_addr, uint32_t size) {
+    if (rom_addr == (uint32_t)-1) {
+        fmt::print(output_file,
+            "[[section]]\n"
+            "name = \"{}\"\n"
+            "vram = 0x{:08X}\n"
+            "size = 0x{:X}\n"
+            "\n",
+            name, ram_addr, size);
+    }
+    else {
+        fmt::print(output_file,
+            "[[section]]\n"
+            "name = \"{}\"\n"
+            "rom = 0x{:08X}\n"
+            "vram = 0x{:08X}\n"
+            "size = 0x{:X}\n"
+            "\n",
+            name, rom_addr, ram_addr, size);
+    }
+}
+
+// Writes the sections, relocs and functions of the context to a symbol file. The source describes where the context came from.
+void dump_function_context(const N64Recomp::Context& context, const std::filesystem::path& func_path, std::string_view source) {
     std::ofstream func_context_file {func_path};
-    std::ofstream data_context_file {data_path};
-    
-    fmt::print(func_context_file, "# Autogenerated from an ELF via N64Recomp\n");
-    fmt::print(data_context_file, "# Autogenerated from an ELF via N64Recomp\n");
 
-    auto print_section = [](std::ofstream& output_file, const std::string& name, uint32_t rom_addr, uint32_t ram_addr, uint32_t size) {
-        if (rom_addr == (uint32_t)-1) {
-            fmt::print(output_file,
-                "[[section]]\n"
-                "name = \"{}\"\n"
-                "vram = 0x{:08X}\n"
-                "size = 0x{:X}\n"
-                "\n",
-                name, ram_addr, size);
-        }
-        else {
-            fmt::print(output_file,
-                "[[section]]\n"
-                "name = \"{}\"\n"
-                "rom = 0x{:08X}\n"
-                "vram = 0x{:08X}\n"
-                "size = 0x{:X}\n"
-                "\n",
-                name, rom_addr, ram_addr, size);
-        }
-    };
+    fmt::print(func_context_file, "# Autogenerated from {} via N64Recomp\n", source);
 
     for (size_t section_index = 0; section_index < context.sections.size(); section_index++) {
         const N64Recomp::Section& section = context.sections[section_index];
         const std::vector<size_t>& section_funcs = context.section_functions[section_index];
         if (!section_funcs.empty()) {
-            print_section(func_context_file, section.name, section.rom_addr, section.ram_addr, section.size);
+            print_context_section(func_context_file, section.name, section.rom_addr, section.ram_addr, section.size);
 
             // Dump relocs into the function context file.
             if (!section.relocs.empty()) {
@@ -220,10 +220,21 @@ void dump_context(const N64Recomp::Context& context, const std::unordered_map<ui
 
             fmt::print(func_context_file, "]\n\n");
         }
-        
+    }
+}
+
+void dump_context(const N64Recomp::Context& context, const std::unordered_map<uint16_t, std::vector<N64Recomp::DataSymbol>>& data_syms, const std::filesystem::path& func_path, const std::filesystem::path& data_path) {
+    dump_function_context(context, func_path, "an ELF");
+
+    std::ofstream data_context_file {data_path};
+    
+    fmt::print(data_context_file, "# Autogenerated from an ELF via N64Recomp\n");
+
+    for (size_t section_index = 0; section_index < context.sections.size(); section_index++) {
+        const N64Recomp::Section& section = context.sections[section_index];
         const auto find_syms_it = data_syms.find((uint16_t)section_index);
         if (find_syms_it != data_syms.end() && !find_syms_it->second.empty()) {
-            print_section(data_context_file, section.name, section.rom_addr, section.ram_addr, section.size);
+            print_context_section(data_context_file, section.name, section.rom_addr, section.ram_addr, section.size);
 
             // Dump other symbols into the data context file.
             fmt::print(data_context_file, "symbols = [\n");
@@ -239,7 +250,7 @@ void dump_context(const N64Recomp::Context& context, const std::unordered_map<ui
     const auto find_abs_syms_it = data_syms.find(N64Recomp::SectionAbsolute);
     if (find_abs_syms_it != data_syms.end() && !find_abs_syms_it->second.empty()) {
         // Dump absolute symbols into the data context file.
-        print_section(data_context_file, "ABSOLUTE_SYMS", (uint32_t)-1, 0, 0);
+        print_context_section(data_context_file, "ABSOLUTE_SYMS", (uint32_t)-1, 0, 0);
         fmt::print(data_context_file, "symbols = [\n");
 
         for (const N64Recomp::DataSymbol& cur_sym : find_abs_syms_it->second) {
@@ -250,6 +261,19 @@ void dump_context(const N64Recomp::Context& context, const std::unordered_map<ui
     }
 }
 
+bool write_context_bin(const N64Recomp::Context& context, const N64Recomp::DataSymbolMap& data_syms, const std::filesystem::path& output_path) {
+    std::vector<uint8_t> context_bin = N64Recomp::context_to_bin_v1(context, data_syms);
+
+    std::ofstream output_file{ output_path, std::ios::binary };
+    if (!output_file.good()) {
+        fmt::print(stderr, "Failed to open file for writing: {}\n", output_path.string());
+        return false;
+    }
+
+    output_file.write(reinterpret_cast<const char*>(context_bin.data()), context_bin.size());
+    return output_file.good();
+}
+
 static std::vector<uint8_t> read_file(const std::filesystem::path& path) {
     std::vector<uint8_t> ret;
 
@@ -273,9 +297,12 @@ int main(int argc, char** argv) {
     };
 
     bool dumping_context = false;
+    bool discovering_functions = false;
+    std::filesystem::path context_bin_path{};
+    std::filesystem::path llvm_ir_path{};
 
     if (argc < 2) {
-        fmt::print("Usage: {} <config file> [--dump-context]\n", argv[0]);
+        fmt::print("Usage: {} <config file> [--dump-context] [--discover-functions] [--emit-context-bin <output file>] [--emit-llvm <output file>]\n", argv[0]);
         return EXIT_SUCCESS;
     }
 
@@ -286,6 +313,23 @@ int main(int argc, char** argv) {
         if (cur_arg == "--dump-context") {
             dumping_context = true;
         }
+        else if (cur_arg == "--discover-functions") {
+            discovering_functions = true;
+        }
+        else if (cur_arg == "--emit-context-bin") {
+            if (i + 1 >= argc) {
+                fmt::print("Missing output file for \"{}\"\n", cur_arg);
+                return EXIT_FAILURE;
+            }
+            context_bin_path = argv[++i];
+        }
+        else if (cur_arg == "--emit-llvm") {
+            if (i + 1 >= argc) {
+                fmt::print("Missing output file for \"{}\"\n", cur_arg);
+                return EXIT_FAILURE;
+            }
+            llvm_ir_path = argv[++i];
+        }
         else {
             fmt::print("Unknown argument \"{}\"\n", cur_arg);
             return EXIT_FAILURE;
@@ -297,6 +341,11 @@ int main(int argc, char** argv) {
         exit_failure(fmt::format("Failed to load config file: {}\n", config_path));
     }
 
+    // Function hooks and trace mode insert C code into the output, so they can't be used when emitting LLVM IR.
+    if (!llvm_ir_path.empty() && (config.trace_mode || !config.function_hooks.empty())) {
+        exit_failure("Function hooks and trace mode can't be used with --emit-llvm\n");
+    }
+
     RabbitizerConfig_Cfg.pseudos.pseudoMove = false;
     RabbitizerConfig_Cfg.pseudos.pseudoBeqz = false;
     RabbitizerConfig_Cfg.pseudos.pseudoBnez = false;
@@ -372,7 +421,8 @@ int main(int argc, char** argv) {
         }
 
         bool found_entrypoint_func;
-        if (!N64Recomp::Context::from_elf_file(config.elf_path, context, elf_config, dumping_context, data_syms, found_entrypoint_func)) {
+        bool emitting_context_bin = !context_bin_path.empty();
+        if (!N64Recomp::Context::from_elf_file(config.elf_path, context, elf_config, dumping_context || emitting_context_bin, data_syms, found_entrypoint_func)) {
             exit_failure("Failed to parse elf\n");
         }
 
@@ -382,9 +432,12 @@ int main(int argc, char** argv) {
         if (config.has_entrypoint && !found_entrypoint_func) {
             exit_failure("Could not find entrypoint function\n");
         }
+
+        if (discovering_functions) {
+            exit_failure("Cannot discover functions when using an elf\n");
+        }
         
-        if (dumping_context) {
-            fmt::print("Dumping context\n");
+        if (dumping_context || emitting_context_bin) {
             // Sort the data syms by address so the output is nicer.
             for (auto& [section_index, section_syms] : data_syms) {
                 std::sort(section_syms.begin(), section_syms.end(),
@@ -394,7 +447,18 @@ int main(int argc, char** argv) {
                 );
             }
 
-            dump_context(context, data_syms, "dump.toml", "data_dump.toml");
+            if (dumping_context) {
+                fmt::print("Dumping context\n");
+                dump_context(context, data_syms, "dump.toml", "data_dump.toml");
+            }
+
+            // The binary context holds the contents of both dumped files, so it can be used as either reference symbol file.
+            if (emitting_context_bin) {
+                fmt::print("Emitting binary context\n");
+                if (!write_context_bin(context, data_syms, context_bin_path)) {
+                    exit_failure(fmt::format("Failed to write binary context file: {}\n", context_bin_path.string()));
+                }
+            }
             return 0;
         }
     }
@@ -417,6 +481,42 @@ int main(int argc, char** argv) {
             exit_failure("Failed to load symbols file\n");
         }
 
+        // Convert the symbols file into a binary context file. Symbol files don't have data symbols, so only the functions and relocs are emitted.
+        if (!context_bin_path.empty()) {
+            // Binary context files only hold the reloc types that are emitted when dumping a context, so refuse to drop any other relocs.
+            for (const auto& section : context.sections) {
+                for (const auto& reloc : section.relocs) {
+                    if (reloc.type == N64Recomp::RelocType::R_MIPS_32) {
+                        exit_failure(fmt::format("Symbols file has an R_MIPS_32 reloc at 0x{:08X} in section {}, which can't be stored in a binary context file\n", reloc.address, section.name));
+                    }
+                }
+            }
+
+            fmt::print("Emitting binary context\n");
+            if (!write_context_bin(context, {}, context_bin_path)) {
+                exit_failure(fmt::format("Failed to write binary context file: {}\n", context_bin_path.string()));
+            }
+            return 0;
+        }
+
+        // Fill in the functions that are missing from the symbols file and write out the result as a new symbols file.
+        if (discovering_functions) {
+            fmt::print("Discovering functions\n");
+            std::optional<uint32_t> entrypoint{};
+            if (config.has_entrypoint) {
+                entrypoint = static_cast<uint32_t>(config.entrypoint);
+            }
+
+            size_t known_function_count = context.functions.size();
+            if (!context.discover_functions(entrypoint)) {
+                exit_failure("Failed to discover functions\n");
+            }
+            fmt::print("Discovered {} functions\n", context.functions.size() - known_function_count);
+
+            dump_function_context(context, "discovered.toml", "function discovery");
+            return 0;
+        }
+
         auto rename_function = [&context](size_t func_index, const std::string& new_name) {
             N64Recomp::Function& func = context.functions[func_index];
 
@@ -588,15 +688,48 @@ int main(int argc, char** argv) {
     std::ofstream current_output_file;
     size_t output_file_count = 0;
     size_t cur_file_function_count = 0;
+    // Functions called from the current output file, which are the only ones it needs prototypes for.
+    std::unordered_set<std::string> cur_file_called_functions{};
+
+    // Writes the header for the most recently opened output file. This declares only the functions called in that file
+    // instead of every function like funcs.h does, which greatly reduces the amount of code each output file has to parse.
+    auto write_output_file_header = [&config, &output_file_count, &cur_file_called_functions]() {
+        std::ofstream output_file_header{config.output_func_path / fmt::format("funcs_{}.h", output_file_count - 1)};
+        std::vector<std::string> called_functions{ cur_file_called_functions.begin(), cur_file_called_functions.end() };
+        std::sort(called_functions.begin(), called_functions.end());
+
+        fmt::print(output_file_header,
+            "#ifdef __cplusplus\n"
+            "extern \"C\" {{\n"
+            "#endif\n"
+            "\n");
+
+        for (const std::string& func_name : called_functions) {
+            fmt::print(output_file_header,
+                "void {}(uint8_t* rdram, recomp_context* ctx);\n", func_name);
+        }
+
+        fmt::print(output_file_header,
+            "\n"
+            "#ifdef __cplusplus\n"
+            "}}\n"
+            "#endif\n");
+
+        cur_file_called_functions.clear();
+    };
     
-    auto open_new_output_file = [&config, &current_output_file, &output_file_count, &cur_file_function_count]() {
+    auto open_new_output_file = [&config, &current_output_file, &output_file_count, &cur_file_function_count, &write_output_file_header]() {
+        // Write the header for the previous output file now that all of its functions are known.
+        if (output_file_count != 0) {
+            write_output_file_header();
+        }
         current_output_file = std::ofstream{config.output_func_path / fmt::format("funcs_{}.c", output_file_count)};
         // Write the file header
         fmt::print(current_output_file,
             "{}\n"
-            "#include \"funcs.h\"\n"
+            "#include \"funcs_{}.h\"\n"
             "\n",
-            config.recomp_include);
+            config.recomp_include, output_file_count);
 
         // Print the extern for the base event index and the define to rename it if exports are allowed.
         if (config.allow_exports) {
@@ -704,6 +837,96 @@ int main(int argc, char** argv) {
         }
     }
 
+    // The functions and relocs are final at this point, so find the relocs for each function ahead of recompiling them.
+    context.compute_function_reloc_spans();
+
+    // Maps the index of each function that's identical to an earlier one to the index of the earlier function.
+    std::unordered_map<size_t, size_t> deduplicated_functions{};
+    // Functions whose body is shared with identical functions in other sections and uses the address of its own section. These are
+    // recompiled into a body that takes the section as an argument, and each function in the group forwards to it with its own section.
+    std::unordered_set<size_t> shared_body_functions{};
+    if (config.deduplicate_functions) {
+        deduplicated_functions = N64Recomp::find_duplicate_functions(context);
+        for (const auto& [func_index, original_index] : deduplicated_functions) {
+            if (context.functions[func_index].section_index != context.functions[original_index].section_index &&
+                N64Recomp::function_uses_own_section(context, original_index))
+            {
+                shared_body_functions.insert(original_index);
+            }
+        }
+    }
+
+    // Checks whether a deduplicated function can be replaced by the function it duplicates, which is the case unless it has to pass its own section to a shared body.
+    auto is_replaceable_duplicate = [&](size_t func_index, size_t original_index) {
+        return !shared_body_functions.contains(original_index) || context.functions[func_index].section_index == context.functions[original_index].section_index;
+    };
+
+    // Creates a function that calls the shared body of the given function with the function's own section.
+    auto make_shared_body_wrapper = [&](const N64Recomp::Function& func, const N64Recomp::Function& original_func) {
+        return fmt::format(
+            "void {0}(uint8_t* rdram, recomp_context* ctx, uint16_t self_section);\n"
+            "\n"
+            "RECOMP_FUNC void {1}(uint8_t* rdram, recomp_context* ctx) {{\n"
+            "    // Shares the body of {2}\n"
+            "    {0}(rdram, ctx, {3});\n"
+            "}}\n",
+            N64Recomp::get_shared_body_name(original_func.name), func.name, original_func.name, func.section_index);
+    };
+
+    // Recompiles a function and writes it to the current output file, or to its own file if there's one file per function.
+    // If the function is identical to an earlier one, a wrapper that calls the earlier function (or the body they share) is written instead.
+    auto write_function = [&](size_t func_index) {
+        const auto& func = context.functions[func_index];
+        std::string func_text{};
+        std::unordered_set<std::string> called_functions{};
+
+        auto dedup_find = deduplicated_functions.find(func_index);
+        if (dedup_find != deduplicated_functions.end()) {
+            const auto& original_func = context.functions[dedup_find->second];
+            if (is_replaceable_duplicate(func_index, dedup_find->second)) {
+                called_functions = { original_func.name };
+                func_text = fmt::format(
+                    "RECOMP_FUNC void {}(uint8_t* rdram, recomp_context* ctx) {{\n"
+                    "    // Identical to {}\n"
+                    "    {}(rdram, ctx);\n"
+                    "}}\n",
+                    func.name, original_func.name, original_func.name);
+            }
+            else {
+                func_text = make_shared_body_wrapper(func, original_func);
+            }
+        }
+        else if (shared_body_functions.contains(func_index)) {
+            std::ostringstream func_stream{};
+            if (!N64Recomp::recompile_shared_function_body(context, func_index, func_stream, static_funcs_by_section, false, &called_functions)) {
+                return false;
+            }
+            func_text = func_stream.str() + "\n" + make_shared_body_wrapper(func, func);
+        }
+        else {
+            std::ostringstream func_stream{};
+            if (!N64Recomp::recompile_function(context, func_index, func_stream, static_funcs_by_section, false, &called_functions)) {
+                return false;
+            }
+            func_text = func_stream.str();
+        }
+
+        if (config.single_file_output || config.functions_per_output_file > 1) {
+            current_output_file << func_text;
+            if (!config.single_file_output) {
+                cur_file_called_functions.insert(called_functions.begin(), called_functions.end());
+                cur_file_function_count++;
+                if (cur_file_function_count >= config.functions_per_output_file) {
+                    open_new_output_file();
+                }
+            }
+            return true;
+        }
+        else {
+            return write_single_function(func_text, config.recomp_include, config.output_func_path / (func.name + ".c"));
+        }
+    };
+
     std::vector<size_t> export_function_indices{};
 
     bool failed_strict_mode = false;
@@ -744,18 +967,7 @@ int main(int argc, char** argv) {
             }
 
             // Recompile the function.
-            if (config.single_file_output || config.functions_per_output_file > 1) {
-                result = N64Recomp::recompile_function(context, i, current_output_file, static_funcs_by_section, false);
-                if (!config.single_file_output) {
-                    cur_file_function_count++;
-                    if (cur_file_function_count >= config.functions_per_output_file) {
-                        open_new_output_file();
-                    }
-                }
-            }
-            else {
-                result = recompile_single_function(context, i, config.recomp_include, config.output_func_path / (func.name + ".c"), static_funcs_by_section);
-            }
+            result = write_function(i);
             if (result == false) {
                 fmt::print(stderr, "Error recompiling {}\n", func.name);
                 std::exit(EXIT_FAILURE);
@@ -834,18 +1046,7 @@ int main(int argc, char** argv) {
 
             bool result;
             size_t prev_num_statics = static_funcs_by_section[new_func.section_index].size();
-            if (config.single_file_output || config.functions_per_output_file > 1) {
-                result = N64Recomp::recompile_function(context, new_func_index, current_output_file, static_funcs_by_section, false);
-                if (!config.single_file_output) {
-                    cur_file_function_count++;
-                    if (cur_file_function_count >= config.functions_per_output_file) {
-                        open_new_output_file();
-                    }
-                }
-            }
-            else {
-                result = recompile_single_function(context, new_func_index, config.recomp_include, config.output_func_path / (new_func.name + ".c"), static_funcs_by_section);
-            }
+            result = write_function(new_func_index);
 
             // Add any new static functions that were found while recompiling this one.
             size_t cur_num_statics = static_funcs_by_section[new_func.section_index].size();
@@ -867,6 +1068,43 @@ int main(int argc, char** argv) {
         }
     }
 
+    // Write the header for the last output file.
+    if (!config.single_file_output && config.functions_per_output_file > 1) {
+        write_output_file_header();
+    }
+
+    // Write every recompiled function as LLVM IR into a single module, including any statics found above.
+    // Deduplicated functions are recompiled in full, since the module doesn't include the C wrappers.
+    if (!llvm_ir_path.empty()) {
+        std::ofstream llvm_ir_file{ llvm_ir_path };
+        if (!llvm_ir_file.good()) {
+            exit_failure(fmt::format("Failed to open LLVM IR output file: {}\n", llvm_ir_path.string()));
+        }
+
+        N64Recomp::LLVMGenerator generator{ llvm_ir_file };
+        generator.emit_module_start();
+
+        // Static functions were already found while writing the C output, so the statics found here can be discarded.
+        std::vector<std::vector<uint32_t>> llvm_static_funcs{};
+        llvm_static_funcs.resize(context.sections.size());
+        for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+            const auto& func = context.functions[func_index];
+            if (func.ignored || func.words.empty()) {
+                continue;
+            }
+            std::ostringstream scratch_stream{};
+            if (!N64Recomp::recompile_function_custom(generator, context, func_index, scratch_stream, llvm_static_funcs, false)) {
+                exit_failure(fmt::format("Error recompiling {} to LLVM IR\n", func.name));
+            }
+        }
+
+        generator.emit_module_end();
+    }
+
+    if (config.deduplicate_functions) {
+        fmt::print("Deduplicated functions: {} ({} shared bodies)\n", deduplicated_functions.size(), shared_body_functions.size());
+    }
+
     if (config.has_entrypoint) {
         std::ofstream lookup_file{ config.output_func_path / "lookup.cpp" };
         
@@ -934,8 +1172,13 @@ int main(int argc, char** argv) {
                     size_t func_size = func.reimplemented ? 0 : func.words.size() * sizeof(func.words[0]);
 
                     if (func.reimplemented || (!func.name.empty() && !func.ignored && func.words.size() != 0)) {
+                        // Point deduplicated functions directly at the identical function instead of at their wrapper, unless the wrapper
+                        // passes the function's own section to a shared body.
+                        auto dedup_find = deduplicated_functions.find(func_index);
+                        bool use_original = dedup_find != deduplicated_functions.end() && is_replaceable_duplicate(func_index, dedup_find->second);
+                        const std::string& table_func_name = use_original ? context.functions[dedup_find->second].name : func.name;
                         fmt::print(overlay_file, "    {{ .func = {}, .offset = 0x{:08X}, .rom_size = 0x{:08X} }},\n",
-                            func.name, func.rom - section.rom_addr, func_size);
+                            table_func_name, func.rom - section.rom_addr, func_size);
                     }
                 }
 
@@ -520,6 +520,8 @@ N64Recomp::ModSymbolsError N64Recomp::parse_mod_symbols(std::span<const char> da
         }
     }
 
+    mod_context_out.compute_function_reloc_spans();
+
     return ModSymbolsError::Good;
 }
 
@@ -3,6 +3,9 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <cassert>
+#include <cctype>
+#include <string_view>
+#include <algorithm>
 
 #include "rabbitizer.hpp"
 #include "fmt/format.h"
@@ -112,15 +115,15 @@ std::string_view ctx_gpr_prefix(int reg) {
 }
 
 template <typename GeneratorType>
-bool process_instruction(GeneratorType& generator, const N64Recomp::Context& context, const N64Recomp::Function& func, size_t func_index, const N64Recomp::FunctionStats& stats, const std::unordered_set<uint32_t>& jtbl_lw_instructions, size_t instr_index, const std::vector<rabbitizer::InstructionCpu>& instructions, std::ostream& output_file, bool indent, bool emit_link_branch, int link_branch_index, size_t reloc_index, bool& needs_link_branch, bool& is_branch_likely, bool tag_reference_relocs, std::span<std::vector<uint32_t>> static_funcs_out) {
+bool process_instruction(GeneratorType& generator, const N64Recomp::Context& context, const N64Recomp::Function& func, size_t func_index, const N64Recomp::FunctionStats& stats, size_t instr_index, const std::vector<rabbitizer::InstructionCpu>& instructions, std::ostream& output_file, bool indent, bool emit_link_branch, int link_branch_index, std::span<const N64Recomp::Reloc> relocs, bool& needs_link_branch, bool& is_branch_likely, bool tag_reference_relocs, std::span<std::vector<uint32_t>> static_funcs_out) {
     using namespace N64Recomp;
 
-    const auto& section = context.sections[func.section_index];
     const auto& instr = instructions[instr_index];
     needs_link_branch = false;
     is_branch_likely = false;
     uint32_t instr_vram = instr.getVram();
     InstrId instr_id = instr.getUniqueId();
+    const InstructionAnnotation& annotation = stats.annotations[instr_index];
 
     auto print_indent = [&]() {
         fmt::print(output_file, "    ");
@@ -146,7 +149,7 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
 
     // Replace loads for jump table entries into addiu. This leaves the jump table entry's address in the output register
     // instead of the entry's value, which can then be used to determine the offset from the start of the jump table.
-    if (jtbl_lw_instructions.contains(instr_vram)) {
+    if (annotation.tag == InstructionTag::JumpTableLoad) {
         assert(instr_id == InstrId::cpu_lw);
         instr_id = InstrId::cpu_addiu;
     }
@@ -162,10 +165,10 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
     uint16_t imm = instr.Get_immediate();
 
     // Check if this instruction has a reloc.
-    if (section.relocs.size() > 0 && section.relocs[reloc_index].address == instr_vram) {
+    if (!relocs.empty() && relocs.front().address == instr_vram) {
         has_reloc = true;
         // Get the reloc data for this instruction
-        const auto& reloc = section.relocs[reloc_index];
+        const auto& reloc = relocs.front();
         reloc_section = reloc.target_section;
 
         // Check if the relocation references a relocatable section.
@@ -210,12 +213,13 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
         if (instr_index < instructions.size() - 1) {
             bool dummy_needs_link_branch;
             bool dummy_is_branch_likely;
-            size_t next_reloc_index = reloc_index;
+            // Skip this instruction's reloc if it has one.
+            std::span<const N64Recomp::Reloc> next_relocs = relocs;
             uint32_t next_vram = instr_vram + 4;
-            if (reloc_index + 1 < section.relocs.size() && next_vram > section.relocs[reloc_index].address) {
-                next_reloc_index++;
+            while (!next_relocs.empty() && next_relocs.front().address < next_vram) {
+                next_relocs = next_relocs.subspan(1);
             }
-            if (!process_instruction(generator, context, func, func_index, stats, jtbl_lw_instructions, instr_index + 1, instructions, output_file, use_indent, false, link_branch_index, next_reloc_index, dummy_needs_link_branch, dummy_is_branch_likely, tag_reference_relocs, static_funcs_out)) {
+            if (!process_instruction(generator, context, func, func_index, stats, instr_index + 1, instructions, output_file, use_indent, false, link_branch_index, next_relocs, dummy_needs_link_branch, dummy_is_branch_likely, tag_reference_relocs, static_funcs_out)) {
                 return false;
             }
         }
@@ -249,12 +253,17 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
         return true;
     };
 
-    auto print_func_call_by_register = [&](int reg) {
+    auto print_func_call_by_register = [&](int reg, const std::vector<size_t>* candidates = nullptr) {
         if (!process_delay_slot(false)) {
             return false;
         }
         print_indent();
-        generator.emit_function_call_by_register(reg);
+        if (candidates != nullptr) {
+            generator.emit_function_call_by_register_candidates(context, reg, *candidates);
+        }
+        else {
+            generator.emit_function_call_by_register(reg);
+        }
         print_link_branch();
         return true;
     };
@@ -408,6 +417,24 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
 
     int cop1_cs = (int)instr.Get_cop1cs();
 
+    // Loads and stores of promoted stack slots access the slot's local instead of memory.
+    if (annotation.tag == InstructionTag::StackSlotAccess) {
+        const StackSlot& slot = stats.stack_slots[annotation.index];
+        print_indent();
+        if (instr_id == InstrId::cpu_lw || instr_id == InstrId::cpu_ld) {
+            generator.emit_stack_slot_load(slot, rt);
+        }
+        else {
+            generator.emit_stack_slot_store(slot, rt);
+        }
+
+        if (emit_link_branch) {
+            print_indent();
+            generator.emit_label(fmt::format("after_{}", link_branch_index));
+        }
+        return true;
+    }
+
     bool handled = true;
 
     switch (instr_id) {
@@ -446,18 +473,11 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
     // Arithmetic
     case InstrId::cpu_add:
     case InstrId::cpu_addu:
-        {
-            // Check if this addu belongs to a jump table load
-            auto find_result = std::find_if(stats.jump_tables.begin(), stats.jump_tables.end(),
-                [instr_vram](const N64Recomp::JumpTable& jtbl) {
-                return jtbl.addu_vram == instr_vram;
-            });
-            // If so, create a temp to preserve the addend register's value
-            if (find_result != stats.jump_tables.end()) {
-                const N64Recomp::JumpTable& cur_jtbl = *find_result;
-                print_indent();
-                generator.emit_jtbl_addend_declaration(cur_jtbl, cur_jtbl.addend_reg);
-            }
+        // Check if this addu belongs to a jump table load, and if so create a temp to preserve the addend register's value
+        if (annotation.tag == InstructionTag::JumpTableAddend) {
+            const N64Recomp::JumpTable& cur_jtbl = stats.jump_tables[annotation.index];
+            print_indent();
+            generator.emit_jtbl_addend_declaration(cur_jtbl, cur_jtbl.addend_reg);
         }
         break;
     case InstrId::cpu_mult:
@@ -484,7 +504,15 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
             return false;
         }
         needs_link_branch = true;
-        print_func_call_by_register(rs);
+        // If the function pointer was loaded from a known table, call the table's functions directly when they match.
+        if (annotation.tag == InstructionTag::FunctionPointerCall) {
+            if (!print_func_call_by_register(rs, &stats.function_pointer_tables[annotation.index].candidates)) {
+                return false;
+            }
+        }
+        else {
+            print_func_call_by_register(rs);
+        }
         break;
     case InstrId::cpu_j:
     case InstrId::cpu_b:
@@ -528,13 +556,8 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
         if (rs == (int)rabbitizer::Registers::Cpu::GprO32::GPR_O32_ra) {
             print_return_with_delay_slot();
         } else {
-            auto jtbl_find_result = std::find_if(stats.jump_tables.begin(), stats.jump_tables.end(),
-                [instr_vram](const N64Recomp::JumpTable& jtbl) {
-                    return jtbl.jr_vram == instr_vram;
-                });
-
-            if (jtbl_find_result != stats.jump_tables.end()) {
-                const N64Recomp::JumpTable& cur_jtbl = *jtbl_find_result;
+            if (annotation.tag == InstructionTag::JumpTableJump) {
+                const N64Recomp::JumpTable& cur_jtbl = stats.jump_tables[annotation.index];
                 if (!process_delay_slot(false)) {
                     return false;
                 }
@@ -708,27 +731,53 @@ bool process_instruction(GeneratorType& generator, const N64Recomp::Context& con
 
     auto find_conditional_branch_it = conditional_branch_ops.find(instr_id);
     if (find_conditional_branch_it != conditional_branch_ops.end()) {
-        print_indent();
-        // TODO combining the branch condition and branch target into one generator call would allow better optimization in the runtime's JIT generator.
-        // This would require splitting into a conditional jump method and conditional function call method.
-        generator.emit_branch_condition(find_conditional_branch_it->second, instruction_context);
-
-        print_indent();
-        if (find_conditional_branch_it->second.link) {
-            if (!print_func_call_by_address(instr.getBranchVramGeneric())) {
-                return false;
+        const ConditionalBranchOp& branch_op = find_conditional_branch_it->second;
+        uint32_t branch_target = (uint32_t)instr.getBranchVramGeneric();
+
+        // Check if the delay slot produces any code. If it doesn't, the branch condition and the branch target can be emitted
+        // with a single generator call. Executing an empty delay slot again after returning from a call is harmless, so this also
+        // removes the need for a link branch.
+        bool empty_delay_slot = instr_index + 1 >= instructions.size() ||
+            (instructions[instr_index + 1].getUniqueId() == InstrId::cpu_nop && !func.function_hooks.contains(instr_index + 1));
+
+        // Check if the branch is a call to a known function that can be fused with its condition.
+        size_t fused_call_func_index = (size_t)-1;
+        if (branch_op.link && empty_delay_slot && !has_reloc) {
+            size_t matched_func_index;
+            if (resolve_jal(context, func.section_index, branch_target, matched_func_index) == JalResolutionResult::Match) {
+                fused_call_func_index = matched_func_index;
             }
         }
+
+        if (fused_call_func_index != (size_t)-1) {
+            print_indent();
+            generator.emit_conditional_call(branch_op, instruction_context, context, fused_call_func_index);
+        }
+        else if (!branch_op.link && empty_delay_slot && branch_target >= func.vram && branch_target < func_vram_end) {
+            print_indent();
+            generator.emit_conditional_goto(branch_op, instruction_context, fmt::format("L_{:08X}", branch_target));
+        }
         else {
-            if (!print_branch((uint32_t)instr.getBranchVramGeneric())) {
-                return false;
+            print_indent();
+            generator.emit_branch_condition(branch_op, instruction_context);
+
+            print_indent();
+            if (branch_op.link) {
+                if (!print_func_call_by_address(branch_target)) {
+                    return false;
+                }
+            }
+            else {
+                if (!print_branch(branch_target)) {
+                    return false;
+                }
             }
-        }
 
-        print_indent();
-        generator.emit_branch_close();
+            print_indent();
+            generator.emit_branch_close();
+        }
         
-        is_branch_likely = find_conditional_branch_it->second.likely;
+        is_branch_likely = branch_op.likely;
         handled = true;
     }
 
@@ -764,26 +813,15 @@ bool recompile_function_impl(GeneratorType& generator, const N64Recomp::Context&
     const N64Recomp::Function& func = context.functions[func_index];
     //fmt::print("Recompiling {}\n", func.name);
     std::vector<rabbitizer::InstructionCpu> instructions;
-
-    generator.emit_function_start(func.name, func_index);
-
-    if (context.trace_mode) {
-        fmt::print(output_file,
-            "    TRACE_ENTRY()\n",
-            func.name);
-    }
+    // Use a set to sort and deduplicate labels
+    std::set<uint32_t> branch_labels;
+    N64Recomp::FunctionStats stats{};
 
     // Skip analysis and recompilation of this function is stubbed.
+    // The analysis is done before starting the function, as the generator needs to know which stack slots are promoted.
     if (!func.stubbed) {
-        // Use a set to sort and deduplicate labels
-        std::set<uint32_t> branch_labels;
         instructions.reserve(func.words.size());
 
-        auto hook_find = func.function_hooks.find(-1);
-        if (hook_find != func.function_hooks.end()) {
-            fmt::print(output_file, "    {}\n", hook_find->second);
-        }
-
         // First pass, disassemble each instruction and collect branch labels
         uint32_t vram = func.vram;
         for (uint32_t word : func.words) {
@@ -799,18 +837,30 @@ bool recompile_function_impl(GeneratorType& generator, const N64Recomp::Context&
         }
 
         // Analyze function
-        N64Recomp::FunctionStats stats{};
         if (!N64Recomp::analyze_function(context, func, instructions, stats)) {
             fmt::print(stderr, "Failed to analyze {}\n", func.name);
             output_file.clear();
             return false;
         }
+    }
+
+    generator.set_stack_slots(stats.stack_slots);
+    generator.emit_function_start(func.name, func_index);
+
+    if (context.trace_mode) {
+        fmt::print(output_file,
+            "    TRACE_ENTRY()\n",
+            func.name);
+    }
 
-        std::unordered_set<uint32_t> jtbl_lw_instructions{};
+    if (!func.stubbed) {
+        auto hook_find = func.function_hooks.find(-1);
+        if (hook_find != func.function_hooks.end()) {
+            fmt::print(output_file, "    {}\n", hook_find->second);
+        }
 
         // Add jump table labels into function
         for (const auto& jtbl : stats.jump_tables) {
-            jtbl_lw_instructions.insert(jtbl.lw_vram);
             for (uint32_t jtbl_entry : jtbl.entries) {
                 branch_labels.insert(jtbl_entry);
             }
@@ -818,13 +868,15 @@ bool recompile_function_impl(GeneratorType& generator, const N64Recomp::Context&
 
         // Second pass, emit code for each instruction and emit labels
         auto cur_label = branch_labels.cbegin();
-        vram = func.vram;
+        uint32_t vram = func.vram;
         int num_link_branches = 0;
         int num_likely_branches = 0;
         bool needs_link_branch = false;
         bool in_likely_delay_slot = false;
+        // The relocs within this function, which are advanced past as each instruction is processed.
         const auto& section = context.sections[func.section_index];
-        size_t reloc_index = 0;
+        N64Recomp::RelocSpan reloc_span = context.get_function_reloc_span(func_index);
+        std::span<const N64Recomp::Reloc> relocs{ section.relocs.data() + reloc_span.begin, section.relocs.data() + reloc_span.end };
         for (size_t instr_index = 0; instr_index < instructions.size(); ++instr_index) {
             bool had_link_branch = needs_link_branch;
             bool is_branch_likely = false;
@@ -838,13 +890,13 @@ bool recompile_function_impl(GeneratorType& generator, const N64Recomp::Context&
                 ++cur_label;
             }
 
-            // Advance the reloc index until we reach the last one or until we get to/pass the current instruction
-            while ((reloc_index + 1) < section.relocs.size() && section.relocs[reloc_index].address < vram) {
-                reloc_index++;
+            // Skip any relocs that come before the current instruction
+            while (!relocs.empty() && relocs.front().address < vram) {
+                relocs = relocs.subspan(1);
             }
 
             // Process the current instruction and check for errors
-            if (process_instruction(generator, context, func, func_index, stats, jtbl_lw_instructions, instr_index, instructions, output_file, false, needs_link_branch, num_link_branches, reloc_index, needs_link_branch, is_branch_likely, tag_reference_relocs, static_funcs_out) == false) {
+            if (process_instruction(generator, context, func, func_index, stats, instr_index, instructions, output_file, false, needs_link_branch, num_link_branches, relocs, needs_link_branch, is_branch_likely, tag_reference_relocs, static_funcs_out) == false) {
                 fmt::print(stderr, "Error in recompiling {}, clearing output file\n", func.name);
                 output_file.clear();
                 return false;
@@ -872,12 +924,354 @@ bool recompile_function_impl(GeneratorType& generator, const N64Recomp::Context&
     return true;
 }
 
+// Adds the functions in the context that are named in the given hook text. Hooks are arbitrary C code, so any identifier that
+// matches a function's name is treated as a call to that function.
+void add_hook_called_functions(const N64Recomp::Context& context, std::string_view hook_text, std::unordered_set<std::string>& called_functions_out) {
+    auto is_identifier_char = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    size_t pos = 0;
+    while (pos < hook_text.size()) {
+        if (!is_identifier_char(hook_text[pos])) {
+            pos++;
+            continue;
+        }
+        size_t identifier_start = pos;
+        while (pos < hook_text.size() && is_identifier_char(hook_text[pos])) {
+            pos++;
+        }
+        std::string identifier{ hook_text.substr(identifier_start, pos - identifier_start) };
+        if (context.functions_by_name.contains(identifier)) {
+            called_functions_out.emplace(std::move(identifier));
+        }
+    }
+}
+
+// Recompiles the function with the given C generator and adds any functions called from the function's hooks to the called functions.
+static bool recompile_function_c(N64Recomp::CGenerator& generator, const N64Recomp::Context& context, size_t function_index, std::ostream& output_file,
+    std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs, std::unordered_set<std::string>* called_functions_out)
+{
+    if (!recompile_function_impl(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs)) {
+        return false;
+    }
+
+    // The generator only sees the calls made by recompiled instructions, so add any functions called from the function's hooks.
+    const auto& func = context.functions[function_index];
+    if (called_functions_out != nullptr && !func.stubbed) {
+        for (const auto& [instr_index, hook_text] : func.function_hooks) {
+            add_hook_called_functions(context, hook_text, *called_functions_out);
+        }
+    }
+    return true;
+}
+
 // Wrap the templated function with CGenerator as the template parameter.
-bool N64Recomp::recompile_function(const N64Recomp::Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs) {
-    CGenerator generator{output_file};
-    return recompile_function_impl(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs);
+bool N64Recomp::recompile_function(const N64Recomp::Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs, std::unordered_set<std::string>* called_functions_out) {
+    CGenerator generator{output_file, called_functions_out};
+    return recompile_function_c(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs, called_functions_out);
+}
+
+bool N64Recomp::recompile_shared_function_body(const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs, std::unordered_set<std::string>* called_functions_out) {
+    CGenerator generator{output_file, called_functions_out, context.functions[function_index].section_index};
+    return recompile_function_c(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs, called_functions_out);
 }
 
 bool N64Recomp::recompile_function_custom(Generator& generator, const Context& context, size_t function_index, std::ostream& output_file, std::span<std::vector<uint32_t>> static_funcs_out, bool tag_reference_relocs) {
     return recompile_function_impl(generator, context, function_index, output_file, static_funcs_out, tag_reference_relocs);
 }
+
+// Placeholder for the target section of relocs against a function's own section, which is outside the range of section indices.
+constexpr uint32_t own_section_placeholder = 0xFFFFFFFF;
+
+// Gets the relocs that fall within the given function.
+static std::span<const N64Recomp::Reloc> get_function_relocs(const N64Recomp::Context& context, size_t func_index) {
+    const auto& func = context.functions[func_index];
+    N64Recomp::RelocSpan span = context.get_function_reloc_span(func_index);
+    if (span.begin == span.end) {
+        return {};
+    }
+    return std::span{ context.sections[func.section_index].relocs }.subspan(span.begin, span.end - span.begin);
+}
+
+// Gets the reloc for the instruction at the given address, or nullptr if the instruction doesn't have one.
+static const N64Recomp::Reloc* find_instruction_reloc(std::span<const N64Recomp::Reloc> relocs, uint32_t instr_vram) {
+    for (const N64Recomp::Reloc& reloc : relocs) {
+        if (reloc.address == instr_vram) {
+            return &reloc;
+        }
+    }
+    return nullptr;
+}
+
+// Gets the section that a reloc in the given function targets, with relocs against the function's own section or its bss replaced by
+// own_section_placeholder so that they match between identical functions in different sections.
+static uint32_t get_normalized_reloc_section(const N64Recomp::Context& context, const N64Recomp::Function& func, const N64Recomp::Reloc& reloc) {
+    if (reloc.reference_symbol) {
+        return reloc.target_section;
+    }
+    uint16_t target_section = reloc.target_section;
+    auto find_bss_it = context.bss_section_to_section.find(target_section);
+    if (find_bss_it != context.bss_section_to_section.end()) {
+        target_section = find_bss_it->second;
+    }
+    return target_section == func.section_index ? own_section_placeholder : target_section;
+}
+
+// Checks whether the function's behavior depends on its address, in which case it can't be replaced with an identical function
+// at a different address. This is the case for any relative branch that leaves the function, as the branch's target moves with it.
+static bool is_position_dependent(const N64Recomp::Function& func) {
+    uint32_t func_vram_end = func.vram + func.words.size() * sizeof(func.words[0]);
+    uint32_t vram = func.vram;
+    for (uint32_t word : func.words) {
+        rabbitizer::InstructionCpu instr{ byteswap(word), vram };
+        if (instr.isBranch()) {
+            uint32_t branch_target = instr.getBranchVramGeneric();
+            if (branch_target < func.vram || branch_target >= func_vram_end) {
+                return true;
+            }
+        }
+        vram += sizeof(word);
+    }
+    return false;
+}
+
+// Produces a key that identifies a function's body regardless of the function's name, address and section, which is a hash of the function's
+// instruction words and relocs with reloc addresses made relative to the start of the function and relocs against its own section normalized.
+// Functions with the same key still have to be compared with function_bodies_match, as different bodies can have the same key.
+static uint64_t get_function_body_key(const N64Recomp::Context& context, size_t func_index) {
+    const auto& func = context.functions[func_index];
+
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    auto hash_value = [&hash](uint32_t value) {
+        for (size_t i = 0; i < sizeof(value); i++) {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+
+    hash_value(static_cast<uint32_t>(func.words.size()));
+    for (uint32_t word : func.words) {
+        hash_value(word);
+    }
+    for (const N64Recomp::Reloc& reloc : get_function_relocs(context, func_index)) {
+        hash_value(reloc.address - func.vram);
+        hash_value(reloc.target_section_offset);
+        hash_value(reloc.symbol_index);
+        hash_value(get_normalized_reloc_section(context, func, reloc));
+        hash_value(static_cast<uint32_t>(reloc.type));
+        hash_value(reloc.reference_symbol);
+    }
+
+    return hash;
+}
+
+// Resolves a jal or j to a function the same way recompilation does, which searches the section of the instruction's reloc if it has one
+// and the calling function's section otherwise.
+static JalResolutionResult resolve_function_call(const N64Recomp::Context& context, const N64Recomp::Function& func, const N64Recomp::Reloc* reloc,
+    uint32_t target_func_vram, size_t& matched_function_index)
+{
+    uint16_t target_section = func.section_index;
+    if (reloc != nullptr && reloc->target_section < 65500) {
+        target_section = reloc->target_section;
+        if (context.sections[target_section].relocatable) {
+            auto find_bss_it = context.bss_section_to_section.find(target_section);
+            if (find_bss_it != context.bss_section_to_section.end()) {
+                target_section = find_bss_it->second;
+            }
+        }
+    }
+    return resolve_jal(context, target_section, target_func_vram, matched_function_index);
+}
+
+// Checks that every jal and j in two functions with the same words recompiles to the same code in both functions. Calls are resolved from each
+// function's own section, so copies of a function in different sections only match if their calls resolve to the same functions.
+static bool function_calls_match(const N64Recomp::Context& context, size_t func_index_a, size_t func_index_b) {
+    const auto& func_a = context.functions[func_index_a];
+    const auto& func_b = context.functions[func_index_b];
+    std::span<const N64Recomp::Reloc> relocs_a = get_function_relocs(context, func_index_a);
+    std::span<const N64Recomp::Reloc> relocs_b = get_function_relocs(context, func_index_b);
+    uint32_t func_size = func_a.words.size() * sizeof(func_a.words[0]);
+
+    for (size_t instr_index = 0; instr_index < func_a.words.size(); instr_index++) {
+        uint32_t instr_offset = instr_index * sizeof(func_a.words[0]);
+        rabbitizer::InstructionCpu instr_a{ byteswap(func_a.words[instr_index]), func_a.vram + instr_offset };
+        InstrId instr_id = instr_a.getUniqueId();
+        if (instr_id != InstrId::cpu_jal && instr_id != InstrId::cpu_j) {
+            continue;
+        }
+        rabbitizer::InstructionCpu instr_b{ byteswap(func_b.words[instr_index]), func_b.vram + instr_offset };
+        uint32_t target_a = instr_a.getBranchVramGeneric();
+        uint32_t target_b = instr_b.getBranchVramGeneric();
+
+        // Jumps within the function become gotos, so they have to land on the same instruction in both functions.
+        if (instr_id == InstrId::cpu_j) {
+            bool internal_a = target_a >= func_a.vram && target_a < func_a.vram + func_size;
+            bool internal_b = target_b >= func_b.vram && target_b < func_b.vram + func_size;
+            if (internal_a != internal_b || (internal_a && target_a - func_a.vram != target_b - func_b.vram)) {
+                return false;
+            }
+            if (internal_a) {
+                continue;
+            }
+        }
+
+        // Calls to reference symbols were already compared through the functions' relocs.
+        const N64Recomp::Reloc* reloc_a = find_instruction_reloc(relocs_a, func_a.vram + instr_offset);
+        const N64Recomp::Reloc* reloc_b = find_instruction_reloc(relocs_b, func_b.vram + instr_offset);
+        if (reloc_a != nullptr && reloc_a->reference_symbol) {
+            continue;
+        }
+
+        size_t matched_index_a = (size_t)-1;
+        size_t matched_index_b = (size_t)-1;
+        JalResolutionResult result_a = resolve_function_call(context, func_a, reloc_a, target_a, matched_index_a);
+        JalResolutionResult result_b = resolve_function_call(context, func_b, reloc_b, target_b, matched_index_b);
+        if (result_a != result_b) {
+            return false;
+        }
+        switch (result_a) {
+            case JalResolutionResult::Match:
+                if (matched_index_a != matched_index_b) {
+                    return false;
+                }
+                break;
+            case JalResolutionResult::Ambiguous:
+                // Ambiguous calls look up the target address at runtime.
+                if (target_a != target_b) {
+                    return false;
+                }
+                break;
+            default:
+                // Static functions are created per section, and the other results fail recompilation.
+                return false;
+        }
+    }
+
+    return true;
+}
+
+// Checks that the jump tables and function pointer tables found by analyzing two functions with the same words recompile to the same code
+// in both functions. Jump table entries become gotos, so they have to point at the same instructions relative to the start of each function.
+static bool function_tables_match(const N64Recomp::Context& context, size_t func_index_a, size_t func_index_b) {
+    auto analyze = [&context](const N64Recomp::Function& func, N64Recomp::FunctionStats& stats) {
+        std::vector<rabbitizer::InstructionCpu> instructions{};
+        instructions.reserve(func.words.size());
+        uint32_t vram = func.vram;
+        for (uint32_t word : func.words) {
+            instructions.emplace_back(byteswap(word), vram);
+            vram += sizeof(word);
+        }
+        return N64Recomp::analyze_function(context, func, instructions, stats);
+    };
+
+    const auto& func_a = context.functions[func_index_a];
+    const auto& func_b = context.functions[func_index_b];
+    N64Recomp::FunctionStats stats_a{};
+    N64Recomp::FunctionStats stats_b{};
+    if (!analyze(func_a, stats_a) || !analyze(func_b, stats_b) ||
+        stats_a.jump_tables.size() != stats_b.jump_tables.size() || stats_a.function_pointer_tables.size() != stats_b.function_pointer_tables.size())
+    {
+        return false;
+    }
+
+    for (size_t jtbl_index = 0; jtbl_index < stats_a.jump_tables.size(); jtbl_index++) {
+        const std::vector<uint32_t>& entries_a = stats_a.jump_tables[jtbl_index].entries;
+        const std::vector<uint32_t>& entries_b = stats_b.jump_tables[jtbl_index].entries;
+        if (entries_a.size() != entries_b.size()) {
+            return false;
+        }
+        for (size_t entry_index = 0; entry_index < entries_a.size(); entry_index++) {
+            if (entries_a[entry_index] - func_a.vram != entries_b[entry_index] - func_b.vram) {
+                return false;
+            }
+        }
+    }
+
+    for (size_t table_index = 0; table_index < stats_a.function_pointer_tables.size(); table_index++) {
+        if (stats_a.function_pointer_tables[table_index].candidates != stats_b.function_pointer_tables[table_index].candidates) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Checks whether two functions will recompile to the same code apart from their names, addresses and the index of their own section.
+static bool function_bodies_match(const N64Recomp::Context& context, size_t func_index_a, size_t func_index_b) {
+    const auto& func_a = context.functions[func_index_a];
+    const auto& func_b = context.functions[func_index_b];
+    // Relocs are only applied in relocatable sections, so a function in a relocatable section can't share a body with one in a section that isn't.
+    if (func_a.words != func_b.words || func_a.stubbed != func_b.stubbed || func_a.function_hooks != func_b.function_hooks ||
+        context.sections[func_a.section_index].relocatable != context.sections[func_b.section_index].relocatable)
+    {
+        return false;
+    }
+
+    std::span<const N64Recomp::Reloc> relocs_a = get_function_relocs(context, func_index_a);
+    std::span<const N64Recomp::Reloc> relocs_b = get_function_relocs(context, func_index_b);
+    if (relocs_a.size() != relocs_b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < relocs_a.size(); i++) {
+        const N64Recomp::Reloc& reloc_a = relocs_a[i];
+        const N64Recomp::Reloc& reloc_b = relocs_b[i];
+        if (reloc_a.address - func_a.vram != reloc_b.address - func_b.vram || reloc_a.target_section_offset != reloc_b.target_section_offset ||
+            reloc_a.symbol_index != reloc_b.symbol_index || reloc_a.type != reloc_b.type || reloc_a.reference_symbol != reloc_b.reference_symbol ||
+            get_normalized_reloc_section(context, func_a, reloc_a) != get_normalized_reloc_section(context, func_b, reloc_b))
+        {
+            return false;
+        }
+    }
+
+    // Stubbed functions don't recompile their instructions.
+    if (func_a.stubbed) {
+        return true;
+    }
+
+    return function_calls_match(context, func_index_a, func_index_b) && function_tables_match(context, func_index_a, func_index_b);
+}
+
+std::unordered_map<size_t, size_t> N64Recomp::find_duplicate_functions(const Context& context) {
+    // Maps the body key of each function that isn't a duplicate to the indices of the functions with that key.
+    std::unordered_map<uint64_t, std::vector<size_t>> original_functions{};
+    std::unordered_map<size_t, size_t> ret{};
+
+    for (size_t func_index = 0; func_index < context.functions.size(); func_index++) {
+        const auto& func = context.functions[func_index];
+        if (func.ignored || func.reimplemented || func.words.empty() || is_position_dependent(func)) {
+            continue;
+        }
+
+        std::vector<size_t>& candidates = original_functions[get_function_body_key(context, func_index)];
+        auto match_it = std::find_if(candidates.begin(), candidates.end(), [&](size_t candidate_index) {
+            return function_bodies_match(context, candidate_index, func_index);
+        });
+        if (match_it != candidates.end()) {
+            ret.emplace(func_index, *match_it);
+        }
+        else {
+            candidates.emplace_back(func_index);
+        }
+    }
+
+    return ret;
+}
+
+bool N64Recomp::function_uses_own_section(const Context& context, size_t function_index) {
+    const auto& func = context.functions[function_index];
+    if (func.stubbed) {
+        return false;
+    }
+    // Only HI16 and LO16 relocs against relocatable sections are recompiled into references to the section's address.
+    for (const Reloc& reloc : get_function_relocs(context, function_index)) {
+        if (!reloc.reference_symbol && reloc.target_section < context.sections.size() && context.sections[reloc.target_section].relocatable &&
+            (reloc.type == RelocType::R_MIPS_HI16 || reloc.type == RelocType::R_MIPS_LO16) &&
+            get_normalized_reloc_section(context, func, reloc) == own_section_placeholder)
+        {
+            return true;
+        }
+    }
+    return false;
+}